@@ -0,0 +1,258 @@
+/*
+  Copyright (c) 2019 Sogou, Inc.
+
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+
+      http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+  Authors: Wu Jiaxu (wujiaxu@sogou-inc.com)
+*/
+
+#ifndef _DNSCACHE_H_
+#define _DNSCACHE_H_
+
+#include <netdb.h>
+#include <stdint.h>
+#include <string>
+#include <mutex>
+#include <atomic>
+#include <utility>
+#include <functional>
+#include "LRUCache.h"
+#include "DnsUtil.h"
+
+#define GET_TYPE_TTL		0
+#define GET_TYPE_CONFIDENT	1
+
+#define DNS_CACHE_SHARDS		16
+#define DNS_CACHE_GENERATIONS	1024
+
+struct DnsCacheValue
+{
+	struct addrinfo *addrinfo;
+	int64_t confident_time;
+	int64_t expire_time;
+	int64_t refresh_time;
+
+	bool delayed() const
+	{
+		return addrinfo->ai_flags & 2;
+	}
+
+	bool refreshing() const
+	{
+		return addrinfo->ai_flags & 4;
+	}
+};
+
+struct DnsCacheStats
+{
+	size_t hits;
+	size_t misses;
+	size_t refreshes;
+};
+
+// RAII: NO. Release handle by user
+// Thread safety: YES
+// MUST call release when handle no longer used
+class DnsCache
+{
+public:
+	using HostPort = std::pair<std::string, unsigned short>;
+	using DnsHandle = LRUHandle<HostPort, DnsCacheValue>;
+
+public:
+	// get handler
+	// Need call release when handle no longer needed
+	//Handle *get(const KEY &key);
+	const DnsHandle *get(const HostPort& host_port);
+
+	const DnsHandle *get(const std::string& host, unsigned short port)
+	{
+		return get(HostPort(host, port));
+	}
+
+	const DnsHandle *get(const char *host, unsigned short port)
+	{
+		return get(std::string(host), port);
+	}
+
+	const DnsHandle *get_ttl(const HostPort& host_port)
+	{
+		return get_inner(host_port, GET_TYPE_TTL, NULL);
+	}
+
+	const DnsHandle *get_ttl(const std::string& host, unsigned short port)
+	{
+		return get_ttl(HostPort(host, port));
+	}
+
+	const DnsHandle *get_ttl(const char *host, unsigned short port)
+	{
+		return get_ttl(std::string(host), port);
+	}
+
+	// Same as get_ttl, and once the record is close to expiring, sets
+	// *refresh to true for exactly one caller, who should resolve again.
+	const DnsHandle *get_ttl(const HostPort& host_port, bool *refresh)
+	{
+		return get_inner(host_port, GET_TYPE_TTL, refresh);
+	}
+
+	const DnsHandle *get_ttl(const std::string& host, unsigned short port,
+							 bool *refresh)
+	{
+		return get_ttl(HostPort(host, port), refresh);
+	}
+
+	// Called by the caller who got *refresh but failed to resolve, so that
+	// a later lookup may start another refresh.
+	void refresh_failed(const HostPort& host_port);
+
+	void refresh_failed(const std::string& host, unsigned short port)
+	{
+		refresh_failed(HostPort(host, port));
+	}
+
+	const DnsHandle *get_confident(const HostPort& host_port)
+	{
+		return get_inner(host_port, GET_TYPE_CONFIDENT, NULL);
+	}
+
+	const DnsHandle *get_confident(const std::string& host, unsigned short port)
+	{
+		return get_confident(HostPort(host, port));
+	}
+
+	const DnsHandle *get_confident(const char *host, unsigned short port)
+	{
+		return get_confident(std::string(host), port);
+	}
+
+	const DnsHandle *put(const HostPort& host_port,
+						 struct addrinfo *addrinfo,
+						 unsigned int dns_ttl_default,
+						 unsigned int dns_ttl_min);
+
+	const DnsHandle *put(const std::string& host,
+						 unsigned short port,
+						 struct addrinfo *addrinfo,
+						 unsigned int dns_ttl_default,
+						 unsigned int dns_ttl_min)
+	{
+		return put(HostPort(host, port), addrinfo, dns_ttl_default, dns_ttl_min);
+	}
+
+	const DnsHandle *put(const char *host,
+						 unsigned short port,
+						 struct addrinfo *addrinfo,
+						 unsigned int dns_ttl_default,
+						 unsigned int dns_ttl_min)
+	{
+		return put(std::string(host), port, addrinfo, dns_ttl_default, dns_ttl_min);
+	}
+
+	// release handle by get/put
+	void release(const DnsHandle *handle);
+
+	// delete from cache, deleter delay called when all inuse-handle release.
+	void del(const HostPort& key);
+
+	void del(const std::string& host, unsigned short port)
+	{
+		del(HostPort(host, port));
+	}
+
+	void del(const char *host, unsigned short port)
+	{
+		del(std::string(host), port);
+	}
+
+	// Changed by every put and del of the host, and rarely by another host
+	// sharing the slot. Results derived from a cached value of the host may
+	// be reused as long as its generation is unchanged.
+	unsigned long long get_generation(const std::string& host,
+									  unsigned short port) const
+	{
+		size_t slot = get_hash(host, port) % DNS_CACHE_GENERATIONS;
+
+		return generations_[slot].load(std::memory_order_acquire);
+	}
+
+	unsigned long long get_generation(const HostPort& host_port) const
+	{
+		return get_generation(host_port.first, host_port.second);
+	}
+
+	// Lookups by get_ttl and get_confident, and refreshes handed out.
+	// Counted by each shard under its lock, and summed here.
+	void get_stats(struct DnsCacheStats *stats);
+
+private:
+	const DnsHandle *get_inner(const HostPort& host_port, int type,
+							   bool *refresh);
+
+	void inc_generation(const HostPort& host_port)
+	{
+		size_t slot = get_hash(host_port.first, host_port.second) %
+					  DNS_CACHE_GENERATIONS;
+
+		generations_[slot].fetch_add(1, std::memory_order_release);
+	}
+
+	std::atomic<unsigned long long> generations_[DNS_CACHE_GENERATIONS];
+
+	class ValueDeleter
+	{
+	public:
+		void operator() (const DnsCacheValue& value) const
+		{
+			struct addrinfo *ai = value.addrinfo;
+
+			if (ai)
+			{
+				if (ai->ai_flags & 1)
+					freeaddrinfo(ai);
+				else
+					protocol::DnsUtil::freeaddrinfo(ai);
+			}
+		}
+	};
+
+	struct Shard
+	{
+		std::mutex mutex;
+		LRUCache<HostPort, DnsCacheValue, ValueDeleter> cache_pool;
+		struct DnsCacheStats stats;
+	};
+
+	static size_t get_hash(const std::string& host, unsigned short port)
+	{
+		return std::hash<std::string>()(host) ^ port;
+	}
+
+	Shard *get_shard(const HostPort& host_port)
+	{
+		size_t h = get_hash(host_port.first, host_port.second);
+
+		return &shards_[h % DNS_CACHE_SHARDS];
+	}
+
+	Shard shards_[DNS_CACHE_SHARDS];
+
+public:
+	// To prevent inline calling LRUCache's constructor and deconstructor.
+	DnsCache();
+	~DnsCache();
+};
+
+#endif
+
@@ -0,0 +1,199 @@
+/*
+  Copyright (c) 2024 Sogou, Inc.
+
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+
+      http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+*/
+
+#ifndef _INLINEFUNCTION_H_
+#define _INLINEFUNCTION_H_
+
+#include <stddef.h>
+#include <new>
+#include <utility>
+#include <type_traits>
+
+/**
+ * @file   InlineFunction.h
+ * @brief  Move-only function wrapper with a small buffer
+ */
+
+// A callable up to N bytes, such as a lambda with a few captures or the
+// result of std::bind, is stored inside the object with no allocation.
+// A larger one, or one that may throw when moved, is allocated by new.
+// Calling an empty InlineFunction is an error.
+template<class SIG, size_t N = 64>
+class InlineFunction;
+
+template<class R, class... ARGS, size_t N>
+class InlineFunction<R (ARGS...), N>
+{
+public:
+	InlineFunction() : ops(NULL) { }
+	InlineFunction(std::nullptr_t) : ops(NULL) { }
+
+	template<class FUNC, class = typename std::enable_if<
+				!std::is_same<typename std::decay<FUNC>::type,
+							  InlineFunction>::value>::type>
+	InlineFunction(FUNC&& func)
+	{
+		typedef typename std::decay<FUNC>::type F;
+		typedef std::integral_constant<bool, InlineFunction::is_inline<F>()> I;
+
+		this->construct<F>(std::forward<FUNC>(func), I());
+	}
+
+	InlineFunction(InlineFunction&& f) : ops(f.ops)
+	{
+		if (this->ops)
+		{
+			this->ops->move(&this->buf, &f.buf);
+			f.ops = NULL;
+		}
+	}
+
+	InlineFunction& operator= (InlineFunction&& f)
+	{
+		if (&f != this)
+		{
+			if (this->ops)
+				this->ops->destroy(&this->buf);
+
+			this->ops = f.ops;
+			if (this->ops)
+			{
+				this->ops->move(&this->buf, &f.buf);
+				f.ops = NULL;
+			}
+		}
+
+		return *this;
+	}
+
+	~InlineFunction()
+	{
+		if (this->ops)
+			this->ops->destroy(&this->buf);
+	}
+
+public:
+	R operator() (ARGS... args) const
+	{
+		return this->ops->invoke((void *)&this->buf,
+								 std::forward<ARGS>(args)...);
+	}
+
+	explicit operator bool() const { return this->ops != NULL; }
+
+private:
+	struct Ops
+	{
+		R (*invoke)(void *buf, ARGS&&... args);
+		void (*move)(void *dst, void *src);	// src is destroyed
+		void (*destroy)(void *buf);
+	};
+
+	template<class F, class FUNC>
+	void construct(FUNC&& func, std::true_type)
+	{
+		new(&this->buf) F(std::forward<FUNC>(func));
+		this->ops = InlineFunction::inline_ops<F>();
+	}
+
+	template<class F, class FUNC>
+	void construct(FUNC&& func, std::false_type)
+	{
+		*(F **)&this->buf = new F(std::forward<FUNC>(func));
+		this->ops = InlineFunction::heap_ops<F>();
+	}
+
+	template<class F>
+	static constexpr bool is_inline()
+	{
+		return sizeof (F) <= N &&
+			   alignof (F) <= alignof (Storage) &&
+			   std::is_nothrow_move_constructible<F>::value;
+	}
+
+	template<class F>
+	static R invoke_inline(void *buf, ARGS&&... args)
+	{
+		return (*(F *)buf)(std::forward<ARGS>(args)...);
+	}
+
+	template<class F>
+	static void move_inline(void *dst, void *src)
+	{
+		new(dst) F(std::move(*(F *)src));
+		((F *)src)->~F();
+	}
+
+	template<class F>
+	static void destroy_inline(void *buf)
+	{
+		((F *)buf)->~F();
+	}
+
+	template<class F>
+	static R invoke_heap(void *buf, ARGS&&... args)
+	{
+		return (**(F **)buf)(std::forward<ARGS>(args)...);
+	}
+
+	static void move_heap(void *dst, void *src)
+	{
+		*(void **)dst = *(void **)src;
+	}
+
+	template<class F>
+	static void destroy_heap(void *buf)
+	{
+		delete *(F **)buf;
+	}
+
+	template<class F>
+	static const Ops *inline_ops()
+	{
+		static const Ops ops = {
+			InlineFunction::invoke_inline<F>,
+			InlineFunction::move_inline<F>,
+			InlineFunction::destroy_inline<F>
+		};
+
+		return &ops;
+	}
+
+	template<class F>
+	static const Ops *heap_ops()
+	{
+		static const Ops ops = {
+			InlineFunction::invoke_heap<F>,
+			InlineFunction::move_heap,
+			InlineFunction::destroy_heap<F>
+		};
+
+		return &ops;
+	}
+
+	typedef typename std::aligned_storage<(N > sizeof (void *) ?
+										   N : sizeof (void *))>::type Storage;
+
+	Storage buf;
+	const Ops *ops;
+
+public:
+	InlineFunction(const InlineFunction&) = delete;
+	InlineFunction& operator= (const InlineFunction&) = delete;
+};
+
+#endif
+
@@ -0,0 +1,37 @@
+/*
+  Copyright (c) 2022 Sogou, Inc.
+
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+
+      http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+  Author: Xie Han (xiehan@sogou-inc.com)
+*/
+
+#ifndef _MYSQLUTIL_H_
+#define _MYSQLUTIL_H_
+
+#include <string>
+
+namespace protocol
+{
+
+class MySQLUtil
+{
+public:
+	static std::string escape_string(const std::string& str);
+	static std::string escape_string_quote(const std::string& str, char quote);
+};
+
+}
+
+#endif
+
@@ -0,0 +1,125 @@
+/*
+  Copyright (c) 2019 Sogou, Inc.
+
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+
+      http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+  Authors: Wu Jiaxu (wujiaxu@sogou-inc.com)
+*/
+
+#ifndef _ROUTEMANAGER_H_
+#define _ROUTEMANAGER_H_
+
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <netdb.h>
+#include <string>
+#include <mutex>
+#include <openssl/ssl.h>
+#include "rbtree.h"
+#include "WFConnection.h"
+#include "EndpointParams.h"
+#include "CommScheduler.h"
+
+class RouteManager
+{
+public:
+	class RouteResult
+	{
+	public:
+		void *cookie;
+		CommSchedObject *request_object;
+
+	public:
+		RouteResult(): cookie(NULL), request_object(NULL) { }
+		void clear() { cookie = NULL; request_object = NULL; }
+	};
+
+	class RouteTarget : public CommSchedTarget
+	{
+#if OPENSSL_VERSION_NUMBER >= 0x10100000L
+	public:
+		int init(const struct sockaddr *addr, socklen_t addrlen, SSL_CTX *ssl_ctx,
+				 int connect_timeout, int ssl_connect_timeout, int response_timeout,
+				 size_t max_connections);
+		void deinit();
+#endif
+
+	public:
+		/* Keep the latest session of this target for resumption. */
+		void set_ssl_session(SSL_SESSION *session);
+
+	public:
+		int state;
+
+	protected:
+		/* Offer the cached session. Derived targets must call this. */
+		virtual int init_ssl(SSL *ssl);
+
+	private:
+		virtual WFConnection *new_connection(int connect_fd)
+		{
+			return new WFConnection;
+		}
+
+	private:
+		SSL_SESSION *ssl_session;
+		std::mutex ssl_mutex;
+
+	public:
+		RouteTarget() : state(0), ssl_session(NULL) { }
+	};
+
+	struct SSLSessionStats
+	{
+		size_t handshakes;
+		size_t resumed;
+	};
+
+public:
+	int get(enum TransportType type,
+			const struct addrinfo *addrinfo,
+			const std::string& other_info,
+			const struct EndpointParams *ep_params,
+			const std::string& hostname, SSL_CTX *ssl_ctx,
+			RouteResult& result);
+
+	RouteManager()
+	{
+		cache_.rb_node = NULL;
+	}
+
+	~RouteManager();
+
+private:
+	std::mutex mutex_;
+	struct rb_root cache_;
+
+public:
+	static void notify_unavailable(void *cookie, CommTarget *target);
+	static void notify_available(void *cookie, CommTarget *target);
+
+	/* Bring back broken targets whose time is up. Done by get(), and must
+	 * be done by anyone reusing a result without calling get(). */
+	static void check_breaker(void *cookie);
+
+	/* Let the targets keep the sessions of a client context for resumption.
+	 * Done to the global client context when it's created. Not thread safe,
+	 * so call it on your own context before using it. */
+	static void init_ssl_client_ctx(SSL_CTX *ssl_ctx);
+
+	/* Client TLS handshakes of all targets, and how many were resumed. */
+	static void get_ssl_session_stats(struct SSLSessionStats *stats);
+};
+
+#endif
+
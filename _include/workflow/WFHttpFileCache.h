@@ -0,0 +1,62 @@
+/*
+  Copyright (c) 2024 Sogou, Inc.
+
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+
+      http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+*/
+
+#ifndef _WFHTTPFILECACHE_H_
+#define _WFHTTPFILECACHE_H_
+
+#include <stddef.h>
+#include <string>
+#include "WFTaskFactory.h"
+
+/* Serve static files in WFHttpServer's process, with the hot ones kept in
+ * memory. A cache hit replies without any syscall. Files are invalidated
+ * by inotify on Linux, and reloaded every 5 seconds on other systems. */
+class WFHttpFileCache
+{
+public:
+	/* Files are looked up under 'root'. The cached files take at most
+	 * 'max_bytes' memory in 4 shards, and a file larger than a quarter of
+	 * a shard is served without caching. */
+	int init(const std::string& root, size_t max_bytes);
+
+	/* Call only after all the server tasks served finished. */
+	void deinit();
+
+public:
+	/* Serve GET and HEAD requests by the path of the request URI. A path
+	 * ending with '/' means its "index.html". ETag and Last-Modified are
+	 * given, and 'If-None-Match', 'If-Modified-Since' and single-range
+	 * 'Range' requests are supported. A missed file is read by the fio
+	 * threads before the server task replies.
+	 * The callback of the server task is used to release the file, so pass
+	 * it here instead of calling set_callback(). */
+	void serve(WFHttpTask *server_task)
+	{
+		this->serve(server_task, nullptr);
+	}
+
+	void serve(WFHttpTask *server_task, http_callback_t callback);
+
+public:
+	/* Number of bytes the cached files currently take. */
+	size_t size() const;
+
+private:
+	class HttpFileCacheMember *member;
+};
+
+#endif
+
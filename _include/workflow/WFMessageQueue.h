@@ -0,0 +1,134 @@
+/*
+  Copyright (c) 2022 Sogou, Inc.
+
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+
+      http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+  Authors: Xie Han (xiehan@sogou-inc.com)
+*/
+
+#ifndef _WFMESSAGEQUEUE_H_
+#define _WFMESSAGEQUEUE_H_
+
+#include <stddef.h>
+#include <mutex>
+#include <atomic>
+#include "list.h"
+#include "LockFreeRing.h"
+#include "WFTask.h"
+
+class WFMessageQueue
+{
+public:
+	WFConditional *get(SubTask *task, void **msgbuf);
+	WFConditional *get(SubTask *task);
+	void post(void *msg);
+
+public:
+	struct Data
+	{
+		void *pop() { return this->queue->pop(); }
+		void push(void *msg) { this->queue->push(msg); }
+
+		struct list_head msg_list;
+		struct list_head wait_list;
+		std::mutex mutex;
+		WFMessageQueue *queue;
+	};
+
+protected:
+	struct MessageEntry
+	{
+		struct list_head list;
+		void *msg;
+	};
+
+protected:
+	virtual void *pop()
+	{
+		struct MessageEntry *entry;
+		void *msg;
+
+		entry = list_entry(this->data.msg_list.next, struct MessageEntry, list);
+		list_del(&entry->list);
+		msg = entry->msg;
+		delete entry;
+
+		return msg;
+	}
+
+	virtual void push(void *msg)
+	{
+		struct MessageEntry *entry = new struct MessageEntry;
+		entry->msg = msg;
+		list_add_tail(&entry->list, &this->data.msg_list);
+	}
+
+protected:
+	struct Data data;
+
+public:
+	WFMessageQueue()
+	{
+		INIT_LIST_HEAD(&this->data.msg_list);
+		INIT_LIST_HEAD(&this->data.wait_list);
+		this->data.queue = this;
+	}
+
+	virtual ~WFMessageQueue() { }
+};
+
+/* A bounded queue holding at most 'capacity' (> 0) messages. Getting and
+ * posting take no lock unless a task has to wait. */
+class WFLockFreeMessageQueue
+{
+public:
+	WFConditional *get(SubTask *task, void **msgbuf);
+	WFConditional *get(SubTask *task);
+
+	/* Returns -1 with errno EAGAIN if the queue is full. */
+	int post(void *msg);
+
+	/* 'task' runs after 'msg' is queued, waiting while the queue is full. */
+	WFConditional *put(SubTask *task, void *msg);
+
+public:
+	struct Data
+	{
+		Data(size_t capacity) : ring(capacity) { }
+
+		LockFreeRing ring;
+		/* Messages minus waiting getters. */
+		std::atomic<long> value;
+		/* Free space minus waiting putters. */
+		std::atomic<long> space;
+		/* Acquired, but missed by the ring for the moment. */
+		std::atomic<long> pops_missed;
+		std::atomic<long> pushes_missed;
+		struct list_head get_list;
+		struct list_head put_list;
+		struct list_head pop_list;
+		struct list_head push_list;
+		std::mutex get_mutex;
+		std::mutex put_mutex;
+	};
+
+protected:
+	struct Data data;
+
+public:
+	WFLockFreeMessageQueue(size_t capacity);
+	virtual ~WFLockFreeMessageQueue() { }
+};
+
+#endif
+
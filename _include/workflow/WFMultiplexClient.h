@@ -0,0 +1,714 @@
+/*
+  Copyright (c) 2024 Sogou, Inc.
+
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+
+      http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+*/
+
+#ifndef _WFMULTIPLEXCLIENT_H_
+#define _WFMULTIPLEXCLIENT_H_
+
+#include <errno.h>
+#include <limits.h>
+#include <stdint.h>
+#include <sys/uio.h>
+#include <string>
+#include <utility>
+#include <functional>
+#include <unordered_map>
+#include <atomic>
+#include <mutex>
+#include <openssl/ssl.h>
+#include "URIParser.h"
+#include "EndpointParams.h"
+#include "ProtocolMessage.h"
+#include "PackageWrapper.h"
+#include "WFTask.h"
+#include "WFTaskFactory.h"
+
+/* Multiplexed client for protocols that carry an id (sequence id,
+ * correlation id or stream id) in each request and its response. All
+ * requests are sent through one long-lived connection without waiting
+ * for the previous responses, and responses are matched to requests by
+ * id, so they may come back in any order. */
+
+struct WFMultiplexParams
+{
+	enum TransportType transport_type;
+	int request_timeout;	/* per request, -1 for unlimited */
+	int idle_timeout;		/* max waiting time for each response */
+	uint32_t max_id;
+};
+
+static constexpr struct WFMultiplexParams MULTIPLEX_PARAMS_DEFAULT =
+{
+	.transport_type		=	TT_TCP,
+	.request_timeout	=	10 * 1000,
+	.idle_timeout		=	60 * 1000,
+	.max_id				=	0x7fffffff,
+};
+
+template<class REQ, class RESP>
+class __WFMultiplexCore;
+
+/* The timer of a request, woken when the response arrives. */
+template<class REQ, class RESP>
+class __WFMultiplexTimer : public WFTimerTask
+{
+protected:
+	virtual int duration(struct timespec *value)
+	{
+		value->tv_sec = this->seconds;
+		value->tv_nsec = this->nanoseconds;
+		return 0;
+	}
+
+	virtual void dispatch()
+	{
+		int ret;
+
+		this->core->mutex.lock();
+		ret = this->scheduler->sleep(this);
+		if (ret >= 0)
+		{
+			this->sleeping = true;
+			if (this->woken)
+				this->wake();
+		}
+
+		this->core->mutex.unlock();
+		if (ret < 0)
+			this->handle(SS_STATE_ERROR, errno);
+	}
+
+	virtual void handle(int state, int error)
+	{
+		this->core->mutex.lock();
+		this->sleeping = false;
+		this->core->mutex.unlock();
+		this->WFTimerTask::handle(state, error);
+	}
+
+public:
+	/* Called with the core's mutex locked. A timer not sleeping yet is
+	 * woken as soon as it sleeps, and one already fired is left alone. */
+	void wake()
+	{
+		this->woken = true;
+		if (this->sleeping)
+		{
+			this->sleeping = false;
+			this->cancel();
+		}
+	}
+
+protected:
+	__WFMultiplexCore<REQ, RESP> *core;
+	time_t seconds;
+	long nanoseconds;
+	bool sleeping;
+	bool woken;
+
+public:
+	__WFMultiplexTimer(__WFMultiplexCore<REQ, RESP> *core,
+					   time_t seconds, long nanoseconds,
+					   std::function<void (WFTimerTask *)>&& cb) :
+		WFTimerTask(WFGlobal::get_scheduler(), std::move(cb))
+	{
+		this->core = core;
+		this->seconds = seconds;
+		this->nanoseconds = nanoseconds;
+		this->sleeping = false;
+		this->woken = false;
+	}
+};
+
+template<class REQ, class RESP>
+class __WFMultiplexTask : public WFNetworkTask<REQ, RESP>
+{
+protected:
+	virtual CommMessageOut *message_out() { return &this->req; }
+	virtual CommMessageIn *message_in() { return &this->resp; }
+
+	virtual WFConnection *get_connection() const
+	{
+		errno = ENOTCONN;
+		return NULL;
+	}
+
+protected:
+	virtual void dispatch()
+	{
+		if (this->core->submit(this) >= 0)
+			series_of(this)->push_front(this->timer);
+		else
+		{
+			this->state = WFT_STATE_SYS_ERROR;
+			this->error = errno;
+		}
+
+		this->subtask_done();
+	}
+
+	/* If submitted, the task is finished by its timer. */
+	virtual SubTask *done()
+	{
+		SeriesWork *series = series_of(this);
+
+		if (!this->timer)
+			this->finish();
+
+		return series->pop();
+	}
+
+	void finish()
+	{
+		if (this->callback)
+			this->callback(this);
+
+		delete this;
+	}
+
+	static void timer_callback(WFTimerTask *timer)
+	{
+		auto *task = (__WFMultiplexTask<REQ, RESP> *)timer->user_data;
+
+		task->core->timer_done(task);
+		task->finish();
+	}
+
+protected:
+	__WFMultiplexCore<REQ, RESP> *core;
+	__WFMultiplexTimer<REQ, RESP> *timer;
+	uint32_t id;
+
+public:
+	__WFMultiplexTask(__WFMultiplexCore<REQ, RESP> *core,
+					  std::function<void (WFNetworkTask<REQ, RESP> *)>&& cb) :
+		WFNetworkTask<REQ, RESP>(NULL, WFGlobal::get_scheduler(),
+								 std::move(cb))
+	{
+		core->incref();
+		this->core = core;
+		this->timer = NULL;
+		this->id = 0;
+	}
+
+protected:
+	virtual ~__WFMultiplexTask() { this->core->decref(); }
+
+	friend class __WFMultiplexCore<REQ, RESP>;
+};
+
+template<class REQ, class RESP>
+class __WFMultiplexChannel : public WFComplexClientTask<REQ, RESP>
+{
+public:
+	virtual int push(const void *buf, size_t size)
+	{
+		return this->scheduler->push(buf, size, this);
+	}
+
+protected:
+	virtual CommMessageOut *message_out()
+	{
+		this->core->output(this, this->out.buf);
+		return &this->out;
+	}
+
+	virtual CommMessageIn *message_in() { return &this->wrapper; }
+	virtual int first_timeout() { return this->watch_timeo; }
+
+protected:
+	class Output : public protocol::ProtocolMessage
+	{
+	protected:
+		virtual int encode(struct iovec vectors[], int max)
+		{
+			vectors[0].iov_base = (void *)this->buf.c_str();
+			vectors[0].iov_len = this->buf.size();
+			return 1;
+		}
+
+	public:
+		std::string buf;
+	};
+
+	class Wrapper : public protocol::PackageWrapper
+	{
+	protected:
+		virtual int append(const void *buf, size_t *size)
+		{
+			if (!this->receiving)
+			{
+				this->receiving = true;
+				channel->core->receiving(channel);
+			}
+
+			return this->PackageWrapper::append(buf, size);
+		}
+
+		virtual protocol::ProtocolMessage *
+		next_in(protocol::ProtocolMessage *message)
+		{
+			if (!channel->core->response(channel, &channel->resp))
+				return NULL;
+
+			channel->clear_resp();
+			return &channel->resp;
+		}
+
+	protected:
+		__WFMultiplexChannel<REQ, RESP> *channel;
+		bool receiving;
+
+	public:
+		Wrapper(__WFMultiplexChannel<REQ, RESP> *channel) :
+			protocol::PackageWrapper(&channel->resp)
+		{
+			this->channel = channel;
+			this->receiving = false;
+		}
+	};
+
+protected:
+	Output out;
+	Wrapper wrapper;
+	__WFMultiplexCore<REQ, RESP> *core;
+
+public:
+	__WFMultiplexChannel(__WFMultiplexCore<REQ, RESP> *core) :
+		WFComplexClientTask<REQ, RESP>(0,
+			[core](WFNetworkTask<REQ, RESP> *task) {
+				core->channel_done((__WFMultiplexChannel<REQ, RESP> *)task);
+			}),
+		wrapper(this)
+	{
+		core->incref();
+		this->core = core;
+	}
+};
+
+template<class REQ, class RESP>
+class __WFMultiplexCore
+{
+public:
+	using task_t = __WFMultiplexTask<REQ, RESP>;
+	using timer_task_t = __WFMultiplexTimer<REQ, RESP>;
+	using channel_t = __WFMultiplexChannel<REQ, RESP>;
+
+public:
+	int submit(task_t *task);
+	void timer_done(task_t *task);
+	void output(channel_t *channel, std::string& buf);
+	void receiving(channel_t *channel);
+	bool response(channel_t *channel, RESP *resp);
+	void channel_done(channel_t *channel);
+
+	void stop()
+	{
+		this->mutex.lock();
+		this->stopped = true;
+		this->mutex.unlock();
+	}
+
+	void incref() { this->ref++; }
+
+	void decref()
+	{
+		if (--this->ref == 0)
+			delete this;
+	}
+
+private:
+	static int serialize(REQ *req, std::string& buf);
+	void set_result(task_t *task, int state, int error, int reason);
+	void fail_all(int state, int error, int reason);
+	int send(const std::string& data);
+
+public:
+	ParsedURI uri;
+	struct WFMultiplexParams params;
+	SSL_CTX *ssl_ctx;
+	std::function<void (REQ *, uint32_t)> set_id;
+	std::function<uint32_t (const RESP *)> get_id;
+
+private:
+	std::unordered_map<uint32_t, task_t *> pending;
+	std::string buffer;
+	channel_t *channel;
+	bool watching;
+	bool stopped;
+	uint32_t next_id;
+	std::atomic<int> ref;
+	std::mutex mutex;
+
+public:
+	__WFMultiplexCore() : ref(1)
+	{
+		this->ssl_ctx = NULL;
+		this->channel = NULL;
+		this->watching = false;
+		this->stopped = false;
+		this->next_id = 0;
+	}
+
+	friend class __WFMultiplexTimer<REQ, RESP>;
+};
+
+template<class REQ, class RESP>
+int __WFMultiplexCore<REQ, RESP>::serialize(REQ *req, std::string& buf)
+{
+	class Encoder : public protocol::ProtocolWrapper
+	{
+	public:
+		int encode(struct iovec vectors[], int max)
+		{
+			return this->ProtocolWrapper::encode(vectors, max);
+		}
+
+		Encoder(protocol::ProtocolMessage *msg) :
+			protocol::ProtocolWrapper(msg)
+		{
+		}
+	};
+
+	static constexpr int ENCODE_IOV_MAX = 2048;
+	struct iovec vectors[ENCODE_IOV_MAX];
+	Encoder encoder(req);
+	int cnt;
+	int i;
+
+	cnt = encoder.encode(vectors, ENCODE_IOV_MAX);
+	if ((unsigned int)cnt > ENCODE_IOV_MAX)
+	{
+		if (cnt > ENCODE_IOV_MAX)
+			errno = EOVERFLOW;
+
+		return -1;
+	}
+
+	for (i = 0; i < cnt; i++)
+		buf.append((const char *)vectors[i].iov_base, vectors[i].iov_len);
+
+	return 0;
+}
+
+/* Called with mutex locked. */
+template<class REQ, class RESP>
+void __WFMultiplexCore<REQ, RESP>::set_result(task_t *task,
+										      int state, int error, int reason)
+{
+	task->state = state;
+	task->error = error;
+	task->timeout_reason = reason;
+	task->timer->wake();
+}
+
+/* Called with mutex locked. The current channel is abandoned. */
+template<class REQ, class RESP>
+void __WFMultiplexCore<REQ, RESP>::fail_all(int state, int error, int reason)
+{
+	for (const auto& kv : this->pending)
+		this->set_result(kv.second, state, error, reason);
+
+	this->pending.clear();
+	this->buffer.clear();
+	this->channel = NULL;
+	this->watching = false;
+}
+
+/* Called with mutex locked. A partially sent request breaks the stream. */
+template<class REQ, class RESP>
+int __WFMultiplexCore<REQ, RESP>::send(const std::string& data)
+{
+	int ret = this->channel->push(data.c_str(), data.size());
+
+	if (ret == (int)data.size())
+		return 0;
+
+	if (ret > 0)
+	{
+		this->fail_all(WFT_STATE_SYS_ERROR, ENOBUFS, TOR_NOT_TIMEOUT);
+		return 1;
+	}
+
+	return -1;
+}
+
+template<class REQ, class RESP>
+int __WFMultiplexCore<REQ, RESP>::submit(task_t *task)
+{
+	int timeout = this->params.request_timeout;
+	channel_t *channel = NULL;
+	std::string data;
+	uint32_t id;
+
+	if (task->receive_timeo >= 0)
+		timeout = task->receive_timeo;
+
+	this->mutex.lock();
+	if (this->stopped)
+	{
+		this->mutex.unlock();
+		errno = ENOENT;
+		return -1;
+	}
+
+	if (this->pending.size() > this->params.max_id)
+	{
+		this->mutex.unlock();
+		errno = EAGAIN;
+		return -1;
+	}
+
+	do
+	{
+		id = this->next_id;
+		if (this->next_id == this->params.max_id)
+			this->next_id = 0;
+		else
+			this->next_id++;
+	} while (this->pending.count(id) != 0);
+
+	this->set_id(&task->req, id);
+	if (serialize(&task->req, data) < 0)
+	{
+		this->mutex.unlock();
+		return -1;
+	}
+
+	task->id = id;
+	if (timeout >= 0)
+	{
+		task->timer = new timer_task_t(this, timeout / 1000,
+								  timeout % 1000 * 1000000,
+								  task_t::timer_callback);
+	}
+	else
+		task->timer = new timer_task_t(this, INT_MAX, 0, task_t::timer_callback);
+
+	task->timer->user_data = task;
+	this->pending.emplace(id, task);
+	if (!this->channel)
+	{
+		channel = new channel_t(this);
+		this->channel = channel;
+		this->watching = false;
+	}
+
+	if (!this->watching)
+		this->buffer.append(data);
+	else if (this->send(data) < 0)
+	{
+		this->pending.erase(id);
+		this->set_result(task, WFT_STATE_SYS_ERROR, errno, TOR_NOT_TIMEOUT);
+	}
+
+	this->mutex.unlock();
+	if (channel)
+	{
+		channel->set_transport_type(this->params.transport_type);
+		channel->set_ssl_ctx(this->ssl_ctx);
+		channel->set_watch_timeout(this->params.idle_timeout);
+		channel->init(this->uri);
+		channel->start();
+	}
+
+	return 0;
+}
+
+template<class REQ, class RESP>
+void __WFMultiplexCore<REQ, RESP>::timer_done(task_t *task)
+{
+	this->mutex.lock();
+	auto it = this->pending.find(task->id);
+	if (it != this->pending.end() && it->second == task)
+	{
+		this->pending.erase(it);
+		task->state = WFT_STATE_SYS_ERROR;
+		task->error = ETIMEDOUT;
+		task->timeout_reason = TOR_TRANSMIT_TIMEOUT;
+	}
+
+	this->mutex.unlock();
+}
+
+/* Requests submitted before the channel is connected go out together.
+ * Later ones are kept until the connection is able to push. */
+template<class REQ, class RESP>
+void __WFMultiplexCore<REQ, RESP>::output(channel_t *channel,
+										  std::string& buf)
+{
+	this->mutex.lock();
+	if (channel == this->channel)
+	{
+		buf = std::move(this->buffer);
+		this->buffer.clear();
+	}
+
+	this->mutex.unlock();
+}
+
+/* Runs in the poller thread when the first response starts arriving. The
+ * kernel lets a client connection push only from then on, so this is the
+ * earliest time to send the requests kept since the channel connected. */
+template<class REQ, class RESP>
+void __WFMultiplexCore<REQ, RESP>::receiving(channel_t *channel)
+{
+	this->mutex.lock();
+	if (channel == this->channel && !this->watching)
+	{
+		this->watching = true;
+		if (!this->buffer.empty())
+		{
+			if (this->send(this->buffer) < 0)
+				this->fail_all(WFT_STATE_SYS_ERROR, errno, TOR_NOT_TIMEOUT);
+
+			this->buffer.clear();
+		}
+	}
+
+	this->mutex.unlock();
+}
+
+/* Runs in the poller thread on each complete response. */
+template<class REQ, class RESP>
+bool __WFMultiplexCore<REQ, RESP>::response(channel_t *channel, RESP *resp)
+{
+	bool ret = false;
+
+	this->mutex.lock();
+	if (channel == this->channel)
+	{
+		auto it = this->pending.find(this->get_id(resp));
+		if (it != this->pending.end())
+		{
+			task_t *task = it->second;
+
+			this->pending.erase(it);
+			task->resp = std::move(*resp);
+			this->set_result(task, WFT_STATE_SUCCESS, 0, TOR_NOT_TIMEOUT);
+		}
+
+		if (this->stopped && this->pending.empty())
+			this->channel = NULL;
+
+		ret = (channel == this->channel);
+	}
+
+	this->mutex.unlock();
+	return ret;
+}
+
+template<class REQ, class RESP>
+void __WFMultiplexCore<REQ, RESP>::channel_done(channel_t *channel)
+{
+	int state = channel->get_state();
+	int error = channel->get_error();
+
+	if (state == WFT_STATE_SUCCESS)
+	{
+		state = WFT_STATE_SYS_ERROR;
+		error = ECONNRESET;
+	}
+
+	this->mutex.lock();
+	if (channel == this->channel)
+		this->fail_all(state, error, channel->get_timeout_reason());
+
+	this->mutex.unlock();
+	this->decref();
+}
+
+template<class REQ, class RESP>
+class WFMultiplexClient
+{
+public:
+	using task_t = WFNetworkTask<REQ, RESP>;
+	using callback_t = std::function<void (task_t *)>;
+	using set_id_t = std::function<void (REQ *, uint32_t)>;
+	using get_id_t = std::function<uint32_t (const RESP *)>;
+
+public:
+	/* 'set_id' writes the id into a request before it is encoded, and
+	 * 'get_id' reads the id of a complete response. Responses of unknown
+	 * ids (e.g. requests that were timed out) are dropped. */
+	int init(const std::string& url, set_id_t set_id, get_id_t get_id)
+	{
+		return this->init(url, std::move(set_id), std::move(get_id),
+						  &MULTIPLEX_PARAMS_DEFAULT);
+	}
+
+	int init(const std::string& url, set_id_t set_id, get_id_t get_id,
+			 const struct WFMultiplexParams *params)
+	{
+		ParsedURI uri;
+
+		if (URIParser::parse(url, uri) < 0)
+			return -1;
+
+		return this->init(std::move(uri), std::move(set_id),
+						  std::move(get_id), params);
+	}
+
+	int init(ParsedURI uri, set_id_t set_id, get_id_t get_id,
+			 const struct WFMultiplexParams *params)
+	{
+		if (uri.state != URI_STATE_SUCCESS)
+		{
+			errno = (uri.state == URI_STATE_ERROR ? uri.error : EINVAL);
+			return -1;
+		}
+
+		this->core = new __WFMultiplexCore<REQ, RESP>;
+		this->core->uri = std::move(uri);
+		this->core->params = *params;
+		this->core->set_id = std::move(set_id);
+		this->core->get_id = std::move(get_id);
+		return 0;
+	}
+
+	/* Call before creating any task. */
+	void set_ssl_ctx(SSL_CTX *ssl_ctx) { this->core->ssl_ctx = ssl_ctx; }
+
+	/* Tasks that are running will finish normally. The connection is
+	 * closed after all responses arrived or idle timeout. */
+	void deinit()
+	{
+		if (this->core)
+		{
+			this->core->stop();
+			this->core->decref();
+			this->core = NULL;
+		}
+	}
+
+public:
+	/* The task's receive timeout, if set, overrides 'request_timeout'.
+	 * Other timeouts and 'get_connection()' are not supported. */
+	task_t *create_task(callback_t callback)
+	{
+		return new __WFMultiplexTask<REQ, RESP>(this->core,
+												std::move(callback));
+	}
+
+protected:
+	__WFMultiplexCore<REQ, RESP> *core;
+
+public:
+	WFMultiplexClient() { this->core = NULL; }
+	virtual ~WFMultiplexClient() { }
+};
+
+#endif
+
@@ -0,0 +1,69 @@
+/*
+  Copyright (c) 2024 Sogou, Inc.
+
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+
+      http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+*/
+
+#ifndef _WFREDISCACHINGCLIENT_H_
+#define _WFREDISCACHINGCLIENT_H_
+
+#include <stddef.h>
+#include <string>
+#include <vector>
+#include "RedisMessage.h"
+#include "WFTaskFactory.h"
+
+class WFRedisCachingClient
+{
+public:
+	/* example: redis://:password@10.160.23.23:6379/0
+	 * The server must support RESP3 (Redis 6 or above). A dedicated
+	 * connection runs 'CLIENT TRACKING ON BCAST' and receives invalidation
+	 * pushes. Replies are cached only while that connection is alive, in
+	 * at most 'max_bytes' memory. With 'prefixes', only keys starting with
+	 * one of them are tracked and cached. */
+	int init(const std::string& url, size_t max_bytes)
+	{
+		return this->init(url, max_bytes, { });
+	}
+
+	int init(const std::string& url, size_t max_bytes,
+			 const std::vector<std::string>& prefixes);
+
+	/* Call only after all the tasks of this client finished. */
+	void deinit();
+
+public:
+	/* Read-only commands of a single key, such as GET, HGET, HGETALL,
+	 * SMEMBERS or LRANGE, are answered from the cache if possible, and
+	 * a hit finishes the task without any network I/O. Other commands are
+	 * sent as normal redis tasks. Invalidations arrive asynchronously, so
+	 * a read right after a write of this process may still see the old
+	 * value for a short time. */
+	WFRedisTask *create_redis_task(const std::string& command,
+								   const std::vector<std::string>& params,
+								   int retry_max, redis_callback_t callback);
+
+	/* Drop all the cached replies. */
+	void flush();
+
+public:
+	/* Number of bytes the cached replies currently take. */
+	size_t size() const;
+
+private:
+	class RedisCacheMember *member;
+};
+
+#endif
+
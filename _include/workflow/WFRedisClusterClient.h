@@ -0,0 +1,72 @@
+/*
+  Copyright (c) 2024 Sogou, Inc.
+
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+
+      http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+*/
+
+#ifndef _WFREDISCLUSTERCLIENT_H_
+#define _WFREDISCLUSTERCLIENT_H_
+
+#include <stddef.h>
+#include <string>
+#include <vector>
+#include "RedisMessage.h"
+#include "WFTaskFactory.h"
+
+#define REDIS_CLUSTER_SLOTS		16384
+
+class WFRedisClusterClient
+{
+public:
+	/* example: redis://:password@10.160.23.23:7000
+	 * Any node of the cluster can be the seed. The slot table is loaded
+	 * in background by CLUSTER SHARDS (or CLUSTER SLOTS on old servers).
+	 * Until then, requests go to the seed and follow MOVED redirects. */
+	int init(const std::string& url);
+
+	/* Call only after all the tasks of this client finished. */
+	void deinit();
+
+public:
+	/* The request is set after creation. When the task starts, it's sent
+	 * directly to the node serving the slot of its key. Requests without
+	 * a key go to any master of the cluster. */
+	WFRedisTask *create_redis_task(int retry_max, redis_callback_t callback);
+
+	/* MGET, MSET, DEL, UNLINK, EXISTS and TOUCH with keys in different
+	 * slots are split into one request per slot, and the replies are
+	 * merged in the order of the original keys. Other commands are the
+	 * same as setting the request of the task above. */
+	WFRedisTask *create_redis_task(const std::string& command,
+								   const std::vector<std::string>& params,
+								   int retry_max, redis_callback_t callback);
+
+	/* Reload the slot table in background. A table is also reloaded
+	 * whenever some node answers MOVED. */
+	void refresh();
+
+public:
+	/* CRC16 of the key, or the hash tag in '{}', modulo 16384. */
+	static int key_slot(const char *key, size_t len);
+
+	static int key_slot(const std::string& key)
+	{
+		return WFRedisClusterClient::key_slot(key.c_str(), key.size());
+	}
+
+private:
+	class RedisClusterMember *member;
+};
+
+#endif
+
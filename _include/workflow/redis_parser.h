@@ -0,0 +1,154 @@
+/*
+  Copyright (c) 2019 Sogou, Inc.
+
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+
+      http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+  Authors: Wu Jiaxu (wujiaxu@sogou-inc.com)
+*/
+
+#ifndef _REDIS_PARSER_H_
+#define _REDIS_PARSER_H_
+
+#include <stddef.h>
+#include "list.h"
+
+// redis_parser_t is absolutely same as hiredis-redisReply in memory
+// If you include hiredis.h, redisReply* can cast to redis_reply_t* safely
+// Fields of RESP3 and the arena flag are appended, and not in hiredis-redisReply
+
+#define REDIS_REPLY_TYPE_STRING 1
+#define REDIS_REPLY_TYPE_ARRAY 2
+#define REDIS_REPLY_TYPE_INTEGER 3
+#define REDIS_REPLY_TYPE_NIL 4
+#define REDIS_REPLY_TYPE_STATUS 5
+#define REDIS_REPLY_TYPE_ERROR 6
+/* RESP3 */
+#define REDIS_REPLY_TYPE_DOUBLE 7
+#define REDIS_REPLY_TYPE_BOOL 8
+#define REDIS_REPLY_TYPE_MAP 9
+#define REDIS_REPLY_TYPE_SET 10
+#define REDIS_REPLY_TYPE_ATTR 11
+#define REDIS_REPLY_TYPE_PUSH 12
+#define REDIS_REPLY_TYPE_BIGNUM 13
+#define REDIS_REPLY_TYPE_VERB 14
+
+typedef struct __redis_reply {
+	int type; /* REDIS_REPLY_TYPE_* */
+	long long integer; /* The integer when type is INTEGER, 0/1 for BOOL */
+	size_t len; /* Length of string */
+	char *str; /* Used for ERROR, STRING, STATUS, DOUBLE, BIGNUM and VERB */
+	size_t elements; /* number of elements, for ARRAY, MAP, SET and PUSH */
+	struct __redis_reply **element; /* elements vector, a MAP is key-value */
+	double dval; /* The double when type is REDIS_REPLY_TYPE_DOUBLE */
+	char vtype[4]; /* Verbatim string format, such as "txt" */
+	int in_arena; /* The elements vector is from the arena of a parser */
+} redis_reply_t;
+
+typedef struct __redis_parser
+{
+	int parse_succ;//check first
+	int status;
+	char *msgbuf;
+	size_t msgsize;
+	size_t bufsize;
+	redis_reply_t *cur;
+	struct __redis_read_frame *stack;
+	int depth;
+	size_t msgidx;
+	size_t findidx;
+	int nchar;
+	char cmd;
+	struct list_head arena_list;
+	char *arena_ptr;
+	size_t arena_left;
+	redis_reply_t reply;
+} redis_parser_t;
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+void redis_parser_init(redis_parser_t *parser);
+void redis_parser_deinit(redis_parser_t *parser);
+int redis_parser_append_message(const void *buf, size_t *size,
+								redis_parser_t *parser);
+
+/* Elements of a reply parsed or set by the following two functions are
+ * allocated from the arena of the parser, and freed all together when
+ * the reply is cleared or the parser is deinited. */
+int redis_parser_set_array(size_t size, redis_reply_t *reply,
+						   redis_parser_t *parser);
+void redis_parser_clear_reply(redis_parser_t *parser);
+
+/* Free the elements allocated by malloc, element by element. Those from
+ * an arena are left to the parser, so any reply may be passed, and may be
+ * rewritten by redis_reply_set_array() afterwards. */
+void redis_reply_deinit(redis_reply_t *reply);
+
+int redis_reply_set_array(size_t size, redis_reply_t *reply);
+
+#ifdef __cplusplus
+}
+#endif
+
+static inline void redis_reply_init(redis_reply_t *reply)
+{
+	reply->type = REDIS_REPLY_TYPE_NIL;
+	reply->integer = 0;
+	reply->len = 0;
+	reply->str = NULL;
+	reply->elements = 0;
+	reply->element = NULL;
+	reply->dval = 0;
+	reply->vtype[0] = '\0';
+	reply->in_arena = 0;
+}
+
+static inline void redis_reply_set_string(const char *str, size_t len,
+										  redis_reply_t *reply)
+{
+	reply->type = REDIS_REPLY_TYPE_STRING;
+	reply->len = len;
+	reply->str = (char *)str;
+}
+
+static inline void redis_reply_set_integer(long long intv, redis_reply_t *reply)
+{
+	reply->type = REDIS_REPLY_TYPE_INTEGER;
+	reply->integer = intv;
+}
+
+static inline void redis_reply_set_null(redis_reply_t *reply)
+{
+	reply->type = REDIS_REPLY_TYPE_NIL;
+}
+
+static inline void redis_reply_set_error(const char *err, size_t len,
+										 redis_reply_t *reply)
+{
+	reply->type = REDIS_REPLY_TYPE_ERROR;
+	reply->len = len;
+	reply->str = (char *)err;
+}
+
+static inline void redis_reply_set_status(const char *str, size_t len,
+										  redis_reply_t *reply)
+{
+	reply->type = REDIS_REPLY_TYPE_STATUS;
+	reply->len = len;
+	reply->str = (char *)str;
+}
+
+#endif
+
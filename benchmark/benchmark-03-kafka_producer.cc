@@ -0,0 +1,150 @@
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <vector>
+
+#include <workflow/WFKafkaClient.h>
+#include <workflow/WFFacilities.h>
+
+#include "util/args.h"
+#include "util/content.h"
+
+using namespace protocol;
+
+static size_t count_records(WFKafkaTask * task)
+{
+	std::vector<std::vector<KafkaRecord *>> records;
+	size_t n = 0;
+
+	task->get_result()->fetch_records(records);
+	for (const auto & v : records)
+	{
+		n += v.size();
+	}
+	return n;
+}
+
+static void make_record(KafkaRecord & record, const std::string & content)
+{
+	record.set_key("key", 3);
+	record.set_value(content.data(), content.size());
+}
+
+// One produce task per record.
+static double bench_task(WFKafkaClient & client, const std::string & topic,
+						 size_t records, const std::string & content)
+{
+	WFFacilities::WaitGroup wait_group(records);
+	std::atomic<size_t> failed{0};
+
+	auto start = std::chrono::steady_clock::now();
+	for (size_t i = 0; i < records; i++)
+	{
+		WFKafkaTask * task = client.create_kafka_task("api=produce", 0,
+			[&wait_group, &failed](WFKafkaTask * task)
+		{
+			if (task->get_state() != WFT_STATE_SUCCESS)
+			{
+				failed++;
+			}
+			wait_group.done();
+		});
+
+		KafkaRecord record;
+		make_record(record, content);
+		task->add_produce_record(topic, -1, std::move(record));
+		task->start();
+	}
+
+	wait_group.wait();
+	std::chrono::duration<double> d = std::chrono::steady_clock::now() - start;
+	if (failed)
+	{
+		fprintf(stderr, "task: %zu records failed\n", failed.load());
+	}
+	return records / d.count();
+}
+
+// Records accumulated by WFKafkaProducer.
+static double bench_producer(WFKafkaClient & client, const std::string & topic,
+							 size_t records, const std::string & content,
+							 size_t batch_size, size_t linger)
+{
+	WFFacilities::WaitGroup wait_group(1);
+	std::atomic<size_t> done{0};
+	std::atomic<size_t> failed{0};
+
+	WFKafkaProducer * producer = client.create_producer(batch_size, linger, 0,
+		[&](WFKafkaTask * task)
+	{
+		size_t n = count_records(task);
+
+		if (task->get_state() != WFT_STATE_SUCCESS)
+		{
+			failed += n;
+		}
+		if ((done += n) == records)
+		{
+			wait_group.done();
+		}
+	});
+
+	auto start = std::chrono::steady_clock::now();
+	for (size_t i = 0; i < records; i++)
+	{
+		KafkaRecord record;
+		make_record(record, content);
+		producer->send(topic, -1, std::move(record));
+	}
+
+	producer->close();
+	wait_group.wait();
+	std::chrono::duration<double> d = std::chrono::steady_clock::now() - start;
+	if (failed)
+	{
+		fprintf(stderr, "producer: %zu records failed\n", failed.load());
+	}
+	return records / d.count();
+}
+
+int main(int argc, char ** argv)
+{
+	std::string url;
+	std::string topic;
+	size_t records;
+	size_t length;
+	size_t batch_size = 64 * 1024;
+	size_t linger = 5;
+
+	if (parse_args(argc, argv, url, topic, records, length,
+				   batch_size, linger) < 4)
+	{
+		fprintf(stderr, "Usage: %s <broker_url> <topic> <records> <length> "
+						"[batch_size] [linger_ms]\n", argv[0]);
+		return -1;
+	}
+
+	WFKafkaClient client;
+	if (client.init(url) < 0)
+	{
+		perror("client init");
+		return -1;
+	}
+
+	const std::string content = make_content(length);
+
+	// Fetch meta first, so both runs start with a warm client.
+	bench_task(client, topic, 1, content);
+
+	double task_rate = bench_task(client, topic, records, content);
+	double producer_rate = bench_producer(client, topic, records, content,
+										  batch_size, linger);
+
+	printf("per-task: %.0f records/sec\n", task_rate);
+	printf("producer: %.0f records/sec (batch_size %zu, linger %zums)\n",
+		   producer_rate, batch_size, linger);
+
+	client.deinit();
+	return 0;
+}
+
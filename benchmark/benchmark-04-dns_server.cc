@@ -0,0 +1,169 @@
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <chrono>
+#include <csignal>
+#include <cstdio>
+#include <cstring>
+#include <thread>
+#include <vector>
+
+#include <workflow/WFDnsServer.h>
+#include <workflow/WFGlobal.h>
+#include <workflow/WFFacilities.h>
+
+#include "util/args.h"
+
+static WFFacilities::WaitGroup wait_group{1};
+
+void signal_handler(int)
+{
+	wait_group.done();
+}
+
+static void process(WFDnsTask * task)
+{
+	auto * req = task->get_req();
+	auto * resp = task->get_resp();
+	std::string name = req->get_question_name();
+	struct in_addr addr;
+
+	addr.s_addr = htonl(INADDR_LOOPBACK);
+	resp->set_rcode(DNS_RCODE_NO_ERROR);
+	resp->set_aa(1);
+	resp->add_a_record(DNS_ANSWER_SECTION, name.c_str(), DNS_CLASS_IN, 600, &addr);
+}
+
+// A query of www.sogou.com, type A, class IN.
+static size_t make_query(unsigned char * buf, unsigned short id)
+{
+	static const unsigned char question[] =
+		"\x03www\x05sogou\x03" "com\x00\x00\x01\x00\x01";
+	unsigned char header[12] = { };
+
+	header[0] = id >> 8;
+	header[1] = id & 0xff;
+	header[2] = 0x01;	// RD
+	header[5] = 1;		// QDCOUNT
+	memcpy(buf, header, sizeof header);
+	memcpy(buf + sizeof header, question, sizeof question - 1);
+	return sizeof header + sizeof question - 1;
+}
+
+// Keep 'depth' queries in flight on one UDP socket, and count the replies.
+static void client_routine(unsigned short port, size_t depth,
+						   std::chrono::steady_clock::time_point deadline,
+						   std::atomic<size_t> & replies)
+{
+	struct sockaddr_in sin = { };
+	struct timeval tv = { 0, 100 * 1000 };
+	unsigned char buf[512];
+	unsigned short id = 0;
+	size_t n = 0;
+	size_t len;
+	int fd;
+
+	sin.sin_family = AF_INET;
+	sin.sin_port = htons(port);
+	sin.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+	fd = socket(AF_INET, SOCK_DGRAM, 0);
+	if (fd < 0 || connect(fd, (struct sockaddr *)&sin, sizeof sin) < 0 ||
+		setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof tv) < 0)
+	{
+		perror("client socket");
+		return;
+	}
+
+	while (std::chrono::steady_clock::now() < deadline)
+	{
+		// Refill the window. A timeout means the window was lost.
+		for (size_t i = 0; i < depth; i++)
+		{
+			len = make_query(buf, ++id);
+			send(fd, buf, len, 0);
+		}
+
+		while (recv(fd, buf, sizeof buf, 0) > 0)
+		{
+			n++;
+			len = make_query(buf, ++id);
+			send(fd, buf, len, 0);
+			if ((n & 1023) == 0 && std::chrono::steady_clock::now() >= deadline)
+			{
+				break;
+			}
+		}
+	}
+
+	replies += n;
+	close(fd);
+}
+
+int main(int argc, char ** argv)
+{
+	size_t pollers;
+	unsigned short port;
+	size_t batch;
+	size_t clients = 0;
+	size_t seconds = 10;
+	size_t depth = 16;
+
+	if (parse_args(argc, argv, pollers, port, batch,
+				   clients, seconds, depth) < 3)
+	{
+		fprintf(stderr, "Usage: %s <pollers> <port> <batch> "
+						"[clients] [seconds] [depth]\n", argv[0]);
+		return -1;
+	}
+
+	std::signal(SIGINT, signal_handler);
+	std::signal(SIGTERM, signal_handler);
+
+	WFGlobalSettings settings = GLOBAL_SETTINGS_DEFAULT;
+	settings.poller_threads = pollers;
+	WORKFLOW_library_init(&settings);
+
+	struct WFServerParams params = DNS_SERVER_PARAMS_DEFAULT;
+	params.datagram_batch = batch;
+	WFDnsServer server(&params, process);
+
+	if (server.start(port) != 0)
+	{
+		perror("server start");
+		return -1;
+	}
+
+	// Without clients, serve until signaled, for external tools like dnsperf.
+	if (clients == 0)
+	{
+		wait_group.wait();
+		server.stop();
+		return 0;
+	}
+
+	std::atomic<size_t> replies{0};
+	std::vector<std::thread> threads;
+	auto start = std::chrono::steady_clock::now();
+	auto deadline = start + std::chrono::seconds(seconds);
+
+	for (size_t i = 0; i < clients; i++)
+	{
+		threads.emplace_back(client_routine, port, depth, deadline,
+							 std::ref(replies));
+	}
+
+	for (auto & t : threads)
+	{
+		t.join();
+	}
+
+	std::chrono::duration<double> d = std::chrono::steady_clock::now() - start;
+	printf("batch %zu: %.0f queries/sec\n", batch, replies / d.count());
+
+	server.stop();
+	return 0;
+}
@@ -0,0 +1,142 @@
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <mutex>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <workflow/LRUCache.h>
+#include <workflow/ShardedCache.h>
+
+#include "util/args.h"
+
+struct ValueDeleter
+{
+	void operator() (std::string &) const { }
+};
+
+// LRUCache is not thread safe, so every user guards it with one mutex.
+class LockedLRUCache
+{
+public:
+	using Handle = LRUHandle<size_t, std::string>;
+
+	const Handle * get(size_t key)
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		return cache.get(key);
+	}
+
+	const Handle * put(size_t key, std::string value)
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		return cache.put(key, std::move(value));
+	}
+
+	void release(const Handle * handle)
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		cache.release(handle);
+	}
+
+	void set_max_size(size_t max_size)
+	{
+		cache.set_max_size(max_size);
+	}
+
+private:
+	std::mutex mutex;
+	LRUCache<size_t, std::string, ValueDeleter> cache;
+};
+
+using Sharded = ShardedCache<size_t, std::string, ValueDeleter>;
+
+// Keys follow a rough power law: a quarter of the key space takes most hits.
+template <typename CACHE>
+static void worker(CACHE * cache, size_t keys, unsigned int seed,
+				   std::chrono::steady_clock::time_point deadline,
+				   std::atomic<size_t> & ops, std::atomic<size_t> & hits)
+{
+	std::mt19937_64 gen(seed);
+	std::uniform_int_distribution<size_t> hot(0, keys / 4);
+	std::uniform_int_distribution<size_t> all(0, keys - 1);
+	size_t n = 0;
+	size_t h = 0;
+
+	while (true)
+	{
+		size_t key = (gen() % 10 < 8) ? hot(gen) : all(gen);
+		auto * handle = cache->get(key);
+
+		if (handle)
+		{
+			if (handle->get_key() != key)
+				std::abort();
+
+			h++;
+		}
+		else
+			handle = cache->put(key, std::to_string(key));
+
+		cache->release(handle);
+		if ((++n & 1023) == 0 && std::chrono::steady_clock::now() >= deadline)
+			break;
+	}
+
+	ops += n;
+	hits += h;
+}
+
+template <typename CACHE>
+static void run(const char * name, CACHE * cache, size_t threads, size_t keys,
+				size_t seconds)
+{
+	std::atomic<size_t> ops{0};
+	std::atomic<size_t> hits{0};
+	std::vector<std::thread> workers;
+	auto start = std::chrono::steady_clock::now();
+	auto deadline = start + std::chrono::seconds(seconds);
+
+	for (size_t i = 0; i < threads; i++)
+	{
+		workers.emplace_back(worker<CACHE>, cache, keys, (unsigned int)i,
+							 deadline, std::ref(ops), std::ref(hits));
+	}
+
+	for (auto & t : workers)
+	{
+		t.join();
+	}
+
+	std::chrono::duration<double> d = std::chrono::steady_clock::now() - start;
+	printf("%-8s %zu threads: %.0f ops/sec, hit ratio %.3f\n", name, threads,
+		   ops / d.count(), ops ? (double)hits / ops : 0.0);
+}
+
+int main(int argc, char ** argv)
+{
+	size_t threads = 0;
+	size_t keys = 1000000;
+	size_t capacity = 100000;
+	size_t shards = 16;
+	size_t seconds = 5;
+
+	if (parse_args(argc, argv, threads, keys, capacity, shards, seconds) < 1
+		|| threads == 0 || keys == 0)
+	{
+		fprintf(stderr, "Usage: %s <threads> [keys] [capacity] [shards] "
+						"[seconds]\n", argv[0]);
+		return -1;
+	}
+
+	LockedLRUCache lru;
+	lru.set_max_size(capacity);
+	run("lru", &lru, threads, keys, seconds);
+
+	Sharded sharded(shards);
+	sharded.set_max_size(capacity);
+	run("sharded", &sharded, threads, keys, seconds);
+	return 0;
+}
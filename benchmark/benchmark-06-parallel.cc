@@ -0,0 +1,82 @@
+#include <chrono>
+#include <cstdio>
+#include <vector>
+
+#include <workflow/Workflow.h>
+#include <workflow/WFTaskFactory.h>
+#include <workflow/WFFacilities.h>
+
+#include "util/args.h"
+
+// Every series runs one go task, so the cost measured is mostly creating,
+// starting and joining the series.
+static std::vector<SubTask *> create_tasks(size_t n)
+{
+	std::vector<SubTask *> tasks(n);
+
+	for (size_t i = 0; i < n; i++)
+		tasks[i] = WFTaskFactory::create_go_task("parallel", [](){});
+
+	return tasks;
+}
+
+static ParallelWork * create_normal(const std::vector<SubTask *> & tasks,
+									parallel_callback_t callback)
+{
+	ParallelWork * pwork = Workflow::create_parallel_work(std::move(callback));
+
+	for (SubTask * task : tasks)
+		pwork->add_series(Workflow::create_series_work(task, nullptr));
+
+	return pwork;
+}
+
+static ParallelWork * create_bulk(const std::vector<SubTask *> & tasks,
+								  parallel_callback_t callback)
+{
+	return Workflow::create_bulk_parallel_work(tasks.data(), tasks.size(),
+											   std::move(callback));
+}
+
+template <typename CREATE>
+static void run(const char * name, CREATE create, size_t n, size_t rounds)
+{
+	std::chrono::duration<double> total(0);
+
+	for (size_t r = 0; r < rounds; r++)
+	{
+		WFFacilities::WaitGroup wait_group(1);
+		std::vector<SubTask *> tasks = create_tasks(n);
+		auto start = std::chrono::steady_clock::now();
+		ParallelWork * pwork = create(tasks, [&wait_group](const ParallelWork *) {
+			wait_group.done();
+		});
+
+		Workflow::start_series_work(pwork, nullptr);
+		wait_group.wait();
+		total += std::chrono::steady_clock::now() - start;
+	}
+
+	printf("%-8s fan-out %-8zu %.0f tasks/sec\n", name, n,
+		   n * rounds / total.count());
+}
+
+int main(int argc, char ** argv)
+{
+	size_t rounds = 20;
+
+	parse_args(argc, argv, rounds);
+	if (argc > 1 || rounds == 0)
+	{
+		fprintf(stderr, "Usage: %s [rounds]\n", argv[0]);
+		return -1;
+	}
+
+	for (size_t n : {1000, 10000, 100000})
+	{
+		run("normal", create_normal, n, rounds);
+		run("bulk", create_bulk, n, rounds);
+	}
+
+	return 0;
+}
@@ -0,0 +1,190 @@
+#include <chrono>
+#include <cstdio>
+#include <string>
+
+#include <workflow/KafkaMessage.h>
+#include <workflow/KafkaDataTypes.h>
+
+#include "util/args.h"
+
+using namespace protocol;
+
+class FetchResponse : public KafkaResponse
+{
+public:
+	using KafkaResponse::append;
+};
+
+static void append_int(std::string & buf, uint64_t val, int bytes)
+{
+	while (--bytes >= 0)
+		buf.push_back((char)(val >> (bytes * 8)));
+}
+
+static void append_varint(std::string & buf, int64_t val)
+{
+	uint64_t n = ((uint64_t)val << 1) ^ (uint64_t)(val >> 63);
+
+	while (n >= 0x80)
+	{
+		buf.push_back((char)(n | 0x80));
+		n >>= 7;
+	}
+
+	buf.push_back((char)n);
+}
+
+// A magic 2 record batch, each record with 'headers' header pairs.
+static std::string record_batch(int64_t base_offset, size_t count,
+								size_t value_len, size_t headers)
+{
+	std::string records;
+	std::string batch;
+	std::string body;
+
+	for (size_t i = 0; i < count; i++)
+	{
+		std::string key = "key" + std::to_string(base_offset + i);
+
+		body.clear();
+		body.push_back(0);
+		append_varint(body, 0);
+		append_varint(body, i);
+		append_varint(body, key.size());
+		body.append(key);
+		append_varint(body, value_len);
+		body.append(value_len, 'v');
+		append_varint(body, headers);
+		for (size_t j = 0; j < headers; j++)
+		{
+			std::string name = "header" + std::to_string(j);
+
+			append_varint(body, name.size());
+			body.append(name);
+			append_varint(body, 8);
+			body.append("hdrvalue");
+		}
+
+		append_varint(records, body.size());
+		records.append(body);
+	}
+
+	body.clear();
+	append_int(body, 0, 2);
+	append_int(body, count - 1, 4);
+	append_int(body, 0, 8);
+	append_int(body, 0, 8);
+	append_int(body, -1, 8);
+	append_int(body, -1, 2);
+	append_int(body, -1, 4);
+	append_int(body, count, 4);
+	body.append(records);
+
+	append_int(batch, base_offset, 8);
+	append_int(batch, 4 + 1 + 4 + body.size(), 4);
+	append_int(batch, 0, 4);
+	batch.push_back(2);
+	append_int(batch, 0, 4);
+	batch.append(body);
+	return batch;
+}
+
+// A version 4 fetch response of one toppar.
+static std::string fetch_response(const std::string & record_set)
+{
+	std::string msg;
+	std::string buf;
+
+	append_int(msg, 1, 4);
+	append_int(msg, 0, 4);
+	append_int(msg, 1, 4);
+	append_int(msg, 4, 2);
+	msg.append("test");
+	append_int(msg, 1, 4);
+	append_int(msg, 0, 4);
+	append_int(msg, 0, 2);
+	append_int(msg, 0, 8);
+	append_int(msg, 0, 8);
+	append_int(msg, 0, 4);
+	append_int(msg, record_set.size(), 4);
+	msg.append(record_set);
+
+	append_int(buf, msg.size(), 4);
+	buf.append(msg);
+	return buf;
+}
+
+static size_t decode(const std::string & data)
+{
+	FetchResponse resp;
+	KafkaTopparList toppar_list;
+	KafkaToppar toppar;
+	KafkaToppar * t;
+	size_t size = data.size();
+	size_t n = 0;
+
+	toppar.set_topic_partition("test", 0);
+	toppar.set_offset(0);
+	toppar_list.add_item(std::move(toppar));
+	resp.set_api_type(Kafka_Fetch);
+	resp.set_api_version(4);
+	resp.set_toppar_list(toppar_list);
+	if (resp.append(data.data(), &size) != 1)
+		return 0;
+
+	resp.get_toppar_list()->rewind();
+	while ((t = resp.get_toppar_list()->get_next()) != NULL)
+	{
+		while (t->get_record_next() != NULL)
+			n++;
+	}
+
+	return n;
+}
+
+int main(int argc, char ** argv)
+{
+	size_t records = 0;
+	size_t headers = 2;
+	size_t value_len = 100;
+	size_t rounds = 2000;
+	std::string record_set;
+
+	if (parse_args(argc, argv, records, headers, value_len, rounds) < 1
+		|| records == 0)
+	{
+		fprintf(stderr, "Usage: %s <records> [headers] [value_len] [rounds]\n",
+				argv[0]);
+		return -1;
+	}
+
+	// Batches of 100 records, as a producer with default settings sends.
+	for (size_t i = 0; i < records; i += 100)
+	{
+		size_t count = records - i < 100 ? records - i : 100;
+		record_set.append(record_batch(i, count, value_len, headers));
+	}
+
+	std::string data = fetch_response(record_set);
+	size_t total = 0;
+
+	// Warm up the record pools.
+	decode(data);
+
+	auto start = std::chrono::steady_clock::now();
+	for (size_t i = 0; i < rounds; i++)
+		total += decode(data);
+
+	std::chrono::duration<double> d = std::chrono::steady_clock::now() - start;
+	if (total != records * rounds)
+	{
+		fprintf(stderr, "Decoded %zu records, expected %zu\n", total,
+				records * rounds);
+		return -1;
+	}
+
+	printf("%zu bytes, %zu records, %zu headers each: %.0f records/sec, "
+		   "%.1f MB/sec\n", data.size(), records, headers, total / d.count(),
+		   data.size() * rounds / d.count() / 1e6);
+	return 0;
+}
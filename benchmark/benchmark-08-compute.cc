@@ -0,0 +1,74 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <workflow/WFTaskFactory.h>
+#include <workflow/WFFacilities.h>
+
+#include "util/args.h"
+
+// Every submitter starts 'tasks' empty go tasks over 'queues' queue names,
+// so the cost measured is mostly queueing and dispatching in the executor.
+static double run(size_t threads, size_t queues, size_t tasks)
+{
+	WFFacilities::WaitGroup wait_group(threads * tasks);
+	std::vector<std::string> names(queues);
+	std::vector<std::thread> submitters;
+
+	for (size_t i = 0; i < queues; i++)
+		names[i] = "compute" + std::to_string(i);
+
+	auto start = std::chrono::steady_clock::now();
+	for (size_t t = 0; t < threads; t++)
+	{
+		submitters.emplace_back([&, t]() {
+			for (size_t i = 0; i < tasks; i++)
+			{
+				const std::string & name = names[(t + i) % queues];
+
+				WFTaskFactory::create_go_task(name, [&wait_group]() {
+					wait_group.done();
+				})->start();
+			}
+		});
+	}
+
+	for (std::thread & th : submitters)
+		th.join();
+
+	wait_group.wait();
+	std::chrono::duration<double> d = std::chrono::steady_clock::now() - start;
+	return threads * tasks / d.count();
+}
+
+int main(int argc, char ** argv)
+{
+	size_t threads = 4;
+	size_t tasks = 1000000;
+	size_t rounds = 5;
+
+	parse_args(argc, argv, threads, tasks, rounds);
+	if (argc > 1 || threads == 0 || tasks == 0 || rounds == 0)
+	{
+		fprintf(stderr, "Usage: %s [threads] [tasks] [rounds]\n", argv[0]);
+		return -1;
+	}
+
+	// Warm up the compute threads.
+	run(threads, 1, 1000);
+
+	for (size_t queues : {1, 16, 1024})
+	{
+		double best = 0;
+
+		for (size_t r = 0; r < rounds; r++)
+			best = std::max(best, run(threads, queues, tasks));
+
+		printf("queues %-6zu %.0f tasks/sec\n", queues, best);
+	}
+
+	return 0;
+}
@@ -12,9 +12,12 @@ function all_benchs()
     for _, x in ipairs(os.files("**.cc")) do
         local item = {}
         local s = path.filename(x)
-        table.insert(item, s:sub(1, #s - 3))       -- target
-        table.insert(item, path.relative(x, "."))  -- source
-        table.insert(res, item)
+        if s ~= "benchmark-03-kafka_producer.cc" and
+           s ~= "benchmark-07-kafka_decoder.cc" then
+            table.insert(item, s:sub(1, #s - 3))       -- target
+            table.insert(item, path.relative(x, "."))  -- source
+            table.insert(res, item)
+        end
     end
     return res
 end
@@ -24,3 +27,23 @@ target(bench[1])
     set_kind("binary")
     add_files(bench[2])
 end
+
+target("benchmark-03-kafka_producer")
+    if has_config("kafka") then
+        set_kind("binary")
+        add_files("benchmark-03-kafka_producer.cc")
+        add_packages("zlib", "snappy", "zstd", "lz4")
+        add_deps("wfkafka")
+    else
+        set_kind("phony")
+    end
+
+target("benchmark-07-kafka_decoder")
+    if has_config("kafka") then
+        set_kind("binary")
+        add_files("benchmark-07-kafka_decoder.cc")
+        add_packages("zlib", "snappy", "zstd", "lz4")
+        add_deps("wfkafka")
+    else
+        set_kind("phony")
+    end
@@ -25,8 +25,11 @@
 #include <vector>
 #include <set>
 #include <map>
+#include <deque>
+#include <chrono>
 #include <atomic>
 #include <mutex>
+#include <condition_variable>
 #include "WFTaskError.h"
 #include "StringUtil.h"
 #include "KafkaTaskImpl.inl"
@@ -1555,6 +1558,616 @@ int KafkaClientTask::arrange_produce()
 	return 0;
 }
 
+class KafkaProducer : public WFKafkaProducer
+{
+public:
+	KafkaProducer(WFKafkaClient *client, size_t batch_size, int linger,
+				  int retry_max, kafka_callback_t&& callback) :
+		callback(std::move(callback))
+	{
+		this->client = client;
+		this->batch_size = batch_size;
+		this->linger = linger;
+		this->retry_max = retry_max;
+		this->timer_name = "INTERNAL-kafka-producer:" +
+						   std::to_string((uintptr_t)this);
+		this->timer_running = false;
+		this->closed = false;
+		this->ref = 1;
+	}
+
+	virtual bool send(const std::string& topic, int partition,
+					  KafkaRecord record);
+	virtual void flush();
+	virtual void close();
+
+	virtual void set_partitioner(kafka_partitioner_t partitioner)
+	{
+		this->partitioner = std::move(partitioner);
+	}
+
+private:
+	struct Batch
+	{
+		KafkaToppar toppar;
+		size_t size;
+	};
+
+	using BatchMap = std::map<std::pair<std::string, int>, struct Batch>;
+
+	void start_produce(std::vector<KafkaToppar>& toppars);
+	static void timer_callback(WFTimerTask *timer);
+
+	/* Held by the user until close(), by the running timer, and by any
+	 * thread producing outside the mutex. The last one deletes it. */
+	void incref()
+	{
+		++this->ref;
+	}
+
+	void decref()
+	{
+		if (--this->ref == 0)
+			delete this;
+	}
+
+private:
+	WFKafkaClient *client;
+	size_t batch_size;
+	int linger;
+	int retry_max;
+	kafka_callback_t callback;
+	kafka_partitioner_t partitioner;
+	BatchMap batches;
+	std::string timer_name;
+	std::mutex mutex;
+	std::atomic<int> ref;
+	bool timer_running;
+	bool closed;
+};
+
+bool KafkaProducer::send(const std::string& topic, int partition,
+						 KafkaRecord record)
+{
+	std::vector<KafkaToppar> toppars;
+	WFTimerTask *timer = NULL;
+
+	this->mutex.lock();
+	if (this->closed)
+	{
+		this->mutex.unlock();
+		return false;
+	}
+
+	auto ret = this->batches.emplace(std::make_pair(topic, partition),
+									 Batch());
+	struct Batch& batch = ret.first->second;
+
+	if (ret.second)
+	{
+		if (!batch.toppar.set_topic_partition(topic, partition))
+		{
+			this->batches.erase(ret.first);
+			this->mutex.unlock();
+			return false;
+		}
+
+		batch.size = 0;
+	}
+
+	batch.size += record.get_key_len() + record.get_value_len();
+	batch.toppar.add_record(std::move(record));
+	if (batch.size >= this->batch_size)
+	{
+		toppars.emplace_back(std::move(batch.toppar));
+		this->batches.erase(ret.first);
+	}
+	else if (!this->timer_running)
+	{
+		timer = WFTaskFactory::create_timer_task(this->timer_name,
+												 this->linger / 1000,
+												 this->linger % 1000 * 1000000,
+												 KafkaProducer::timer_callback);
+		timer->user_data = this;
+		this->timer_running = true;
+		this->incref();
+	}
+
+	if (!toppars.empty())
+		this->incref();
+
+	this->mutex.unlock();
+	if (timer)
+		timer->start();
+
+	if (!toppars.empty())
+	{
+		this->start_produce(toppars);
+		this->decref();
+	}
+
+	return true;
+}
+
+void KafkaProducer::flush()
+{
+	std::vector<KafkaToppar> toppars;
+
+	this->mutex.lock();
+	for (auto& kv : this->batches)
+		toppars.emplace_back(std::move(kv.second.toppar));
+
+	this->batches.clear();
+	if (!toppars.empty())
+		this->incref();
+
+	this->mutex.unlock();
+	if (!toppars.empty())
+	{
+		this->start_produce(toppars);
+		this->decref();
+	}
+}
+
+void KafkaProducer::close()
+{
+	std::vector<KafkaToppar> toppars;
+	bool timer_running;
+
+	this->mutex.lock();
+	for (auto& kv : this->batches)
+		toppars.emplace_back(std::move(kv.second.toppar));
+
+	this->batches.clear();
+	this->closed = true;
+	timer_running = this->timer_running;
+	this->mutex.unlock();
+	if (timer_running)
+		WFTaskFactory::cancel_by_name(this->timer_name);
+
+	if (!toppars.empty())
+		this->start_produce(toppars);
+
+	/* Drop the reference of the user. */
+	this->decref();
+}
+
+void KafkaProducer::timer_callback(WFTimerTask *timer)
+{
+	KafkaProducer *producer = (KafkaProducer *)timer->user_data;
+
+	producer->mutex.lock();
+	producer->timer_running = false;
+	producer->mutex.unlock();
+	/* Nothing is left to flush after close(). */
+	producer->flush();
+	/* Drop the reference of the timer. */
+	producer->decref();
+}
+
+void KafkaProducer::start_produce(std::vector<KafkaToppar>& toppars)
+{
+	WFKafkaTask *task;
+
+	task = this->client->create_kafka_task(this->retry_max, this->callback);
+	task->set_api_type(Kafka_Produce);
+	if (this->partitioner)
+		task->set_partitioner(this->partitioner);
+
+	for (KafkaToppar& toppar : toppars)
+	{
+		task->add_topic(toppar.get_topic());
+		task->toppar_list.add_item(std::move(toppar));
+	}
+
+	task->start();
+}
+
+class KafkaConsumer : public WFKafkaConsumer
+{
+public:
+	KafkaConsumer(WFKafkaClient *client, const std::string& query,
+				  size_t buffer_size, int retry_max) :
+		query(query)
+	{
+		this->client = client;
+		this->buffer_size = buffer_size;
+		this->retry_max = retry_max;
+		this->max_fetches = 1;
+		this->fetches = 0;
+		this->own_toppars = false;
+		this->state = WFT_STATE_SUCCESS;
+		this->error = 0;
+		this->kafka_error = 0;
+		this->closed = false;
+	}
+
+	virtual bool add_toppar(const KafkaToppar& toppar)
+	{
+		KafkaToppar new_toppar;
+
+		if (!new_toppar.set_topic_partition(toppar.get_topic(),
+											toppar.get_partition()))
+			return false;
+
+		new_toppar.set_offset(toppar.get_offset());
+		new_toppar.set_offset_timestamp(toppar.get_offset_timestamp());
+		this->mutex.lock();
+		this->get_queue(new_toppar)->toppar = std::move(new_toppar);
+		this->own_toppars = true;
+		this->mutex.unlock();
+		return true;
+	}
+
+	virtual void set_broker_fetches(int max)
+	{
+		this->max_fetches = max > 0 ? max : 1;
+	}
+
+	virtual void start();
+	virtual int poll(KafkaResult *result, int timeout);
+	virtual void close();
+
+	virtual int get_state() const { return this->state; }
+	virtual int get_error() const { return this->error; }
+	virtual int get_kafka_error() const { return this->kafka_error; }
+
+private:
+	struct Fetched
+	{
+		KafkaResult result;
+		size_t size;
+	};
+
+	struct TopparQueue
+	{
+		KafkaToppar toppar;
+		std::deque<struct Fetched> fetched;
+		size_t buffered;
+		bool fetching;
+		bool ready;
+	};
+
+	struct FetchContext
+	{
+		KafkaConsumer *consumer;
+		int node_id;
+		std::vector<struct TopparQueue *> queues;
+	};
+
+	struct TopparQueue *get_queue(const KafkaToppar& toppar);
+	int get_node_id(const KafkaToppar& toppar);
+	WFKafkaTask *create_fetch_task(int node_id,
+								   std::vector<struct TopparQueue *>& queues);
+	void create_fetch_tasks(std::vector<WFKafkaTask *>& tasks);
+	void process_result(KafkaResult *result);
+	static void fetch_callback(WFKafkaTask *task);
+
+private:
+	WFKafkaClient *client;
+	std::string query;
+	size_t buffer_size;
+	int retry_max;
+	int max_fetches;
+	int fetches;
+	bool own_toppars;
+	std::map<std::pair<std::string, int>, struct TopparQueue> queues;
+	std::deque<struct TopparQueue *> ready;
+	std::map<int, int> broker_fetches;
+	int state;
+	int error;
+	int kafka_error;
+	std::mutex mutex;
+	std::condition_variable cond;
+	bool closed;
+};
+
+/* Called with mutex locked. */
+struct KafkaConsumer::TopparQueue *
+KafkaConsumer::get_queue(const KafkaToppar& toppar)
+{
+	auto key = std::make_pair(std::string(toppar.get_topic()),
+							  toppar.get_partition());
+	auto it = this->queues.find(key);
+
+	if (it == this->queues.end())
+	{
+		struct TopparQueue *queue = &this->queues[key];
+
+		queue->buffered = 0;
+		queue->fetching = false;
+		queue->ready = false;
+		return queue;
+	}
+
+	return &it->second;
+}
+
+/* The leader of a toppar, or -1 before the metadata is known. */
+int KafkaConsumer::get_node_id(const KafkaToppar& toppar)
+{
+	KafkaMember *member = this->client->member;
+	const kafka_broker_t *broker = NULL;
+	KafkaMeta *meta;
+
+	member->mutex.lock();
+	member->meta_list.rewind();
+	while ((meta = member->meta_list.get_next()) != NULL)
+	{
+		if (strcmp(meta->get_topic(), toppar.get_topic()) == 0)
+		{
+			broker = meta->get_broker(toppar.get_partition());
+			break;
+		}
+	}
+
+	member->mutex.unlock();
+	return broker ? broker->node_id : -1;
+}
+
+/* Called with mutex locked. A fetch asks each toppar for no more than the
+ * room left in its queue, so a response never overfills a queue, except
+ * that a broker always returns at least the first batch of a partition.
+ * With a consumer group, 'queues' is empty and the toppars fetched are the
+ * assigned ones, limited by the fullest queue known. */
+WFKafkaTask *
+KafkaConsumer::create_fetch_task(int node_id,
+								 std::vector<struct TopparQueue *>& queues)
+{
+	size_t msg_room = this->buffer_size;
+	size_t room = 0;
+	struct FetchContext *ctx;
+	KafkaConfig config;
+	WFKafkaTask *task;
+
+	task = this->client->create_kafka_task(this->query, this->retry_max,
+										   KafkaConsumer::fetch_callback);
+
+	for (auto& kv : this->queues)
+	{
+		if (msg_room > this->buffer_size - kv.second.buffered)
+			msg_room = this->buffer_size - kv.second.buffered;
+	}
+
+	if (!queues.empty())
+	{
+		msg_room = this->buffer_size;
+		for (struct TopparQueue *queue : queues)
+		{
+			room += this->buffer_size - queue->buffered;
+			if (msg_room > this->buffer_size - queue->buffered)
+				msg_room = this->buffer_size - queue->buffered;
+
+			queue->fetching = true;
+		}
+	}
+
+	if (config.copy_from(task->config))
+	{
+		if (room != 0 && room < (size_t)config.get_fetch_max_bytes())
+			config.set_fetch_max_bytes((int)room);
+
+		if (msg_room < (size_t)config.get_fetch_msg_max_bytes())
+			config.set_fetch_msg_max_bytes(msg_room ? (int)msg_room : 1);
+
+		task->set_config(std::move(config));
+	}
+
+	task->set_api_type(Kafka_Fetch);
+	for (struct TopparQueue *queue : queues)
+		task->add_toppar(queue->toppar);
+
+	ctx = new struct FetchContext;
+	ctx->consumer = this;
+	ctx->node_id = node_id;
+	ctx->queues = std::move(queues);
+	task->user_data = ctx;
+	this->broker_fetches[node_id]++;
+	this->fetches++;
+	return task;
+}
+
+/* Called with mutex locked. Our own toppars with room are fetched from
+ * their leaders, with at most 'max_fetches' fetches to a broker at a time.
+ * A toppar is in one fetch at a time, because the offset of its next fetch
+ * is known only when the current one returns. With a consumer group, the
+ * assigned toppars are owned by the client and change on rebalance, so the
+ * whole query is fetched by one task at a time, paused while any toppar
+ * queue is full. */
+void KafkaConsumer::create_fetch_tasks(std::vector<WFKafkaTask *>& tasks)
+{
+	std::map<int, std::vector<struct TopparQueue *>> idle;
+
+	if (this->closed || this->state != WFT_STATE_SUCCESS)
+		return;
+
+	if (!this->own_toppars)
+	{
+		std::vector<struct TopparQueue *> none;
+
+		if (this->fetches != 0)
+			return;
+
+		for (auto& kv : this->queues)
+		{
+			if (kv.second.buffered >= this->buffer_size)
+				return;
+		}
+
+		tasks.push_back(this->create_fetch_task(-1, none));
+		return;
+	}
+
+	for (auto& kv : this->queues)
+	{
+		struct TopparQueue *queue = &kv.second;
+
+		if (queue->buffered < this->buffer_size && !queue->fetching)
+			idle[this->get_node_id(queue->toppar)].push_back(queue);
+	}
+
+	for (auto& kv : idle)
+	{
+		if (this->broker_fetches[kv.first] < this->max_fetches)
+			tasks.push_back(this->create_fetch_task(kv.first, kv.second));
+	}
+}
+
+/* Called with mutex locked. Split the result by toppar, and advance the
+ * offsets of our own toppars. With a consumer group, offsets of the
+ * assigned toppars are advanced by the client. */
+void KafkaConsumer::process_result(KafkaResult *result)
+{
+	std::vector<KafkaToppar *> toppars;
+
+	result->fetch_toppars(toppars);
+	for (KafkaToppar *toppar : toppars)
+	{
+		struct TopparQueue *queue;
+		KafkaResponse resp;
+		KafkaRecord *record;
+		size_t size = 0;
+
+		toppar->record_rewind();
+		while ((record = toppar->get_record_next()) != NULL)
+			size += record->get_key_len() + record->get_value_len();
+
+		record = toppar->get_tail_record();
+		if (!record)
+			continue;
+
+		queue = this->get_queue(*toppar);
+		if (this->own_toppars)
+			queue->toppar.set_offset(record->get_offset() + 1);
+
+		/* Records keep their buffer alive, so they may leave the response. */
+		resp.set_api_type(Kafka_Fetch);
+		resp.get_toppar_list()->add_item(std::move(*toppar));
+		queue->fetched.push_back({KafkaResult(), size});
+		queue->fetched.back().result.create(1);
+		queue->fetched.back().result.set_resp(std::move(resp), 0);
+		queue->buffered += size;
+		if (!queue->ready)
+		{
+			queue->ready = true;
+			this->ready.push_back(queue);
+		}
+
+		this->cond.notify_one();
+	}
+}
+
+void KafkaConsumer::fetch_callback(WFKafkaTask *task)
+{
+	struct FetchContext *ctx = (struct FetchContext *)task->user_data;
+	KafkaConsumer *consumer = ctx->consumer;
+	std::vector<WFKafkaTask *> tasks;
+
+	consumer->mutex.lock();
+	consumer->broker_fetches[ctx->node_id]--;
+	consumer->fetches--;
+	for (struct TopparQueue *queue : ctx->queues)
+		queue->fetching = false;
+
+	delete ctx;
+	if (consumer->closed)
+	{
+		bool last = (consumer->fetches == 0);
+
+		consumer->mutex.unlock();
+		if (last)
+			delete consumer;
+
+		return;
+	}
+
+	if (task->get_state() == WFT_STATE_SUCCESS)
+	{
+		consumer->process_result(task->get_result());
+		consumer->create_fetch_tasks(tasks);
+	}
+	else if (consumer->state == WFT_STATE_SUCCESS)
+	{
+		consumer->state = task->get_state();
+		consumer->error = task->get_error();
+		consumer->kafka_error = task->get_kafka_error();
+		consumer->cond.notify_all();
+	}
+
+	consumer->mutex.unlock();
+	for (WFKafkaTask *next : tasks)
+		next->start();
+}
+
+void KafkaConsumer::start()
+{
+	std::vector<WFKafkaTask *> tasks;
+
+	this->mutex.lock();
+	this->create_fetch_tasks(tasks);
+	this->mutex.unlock();
+	for (WFKafkaTask *task : tasks)
+		task->start();
+}
+
+int KafkaConsumer::poll(KafkaResult *result, int timeout)
+{
+	std::unique_lock<std::mutex> lock(this->mutex);
+	std::vector<WFKafkaTask *> tasks;
+	struct TopparQueue *queue;
+
+	while (this->ready.empty())
+	{
+		if (this->state != WFT_STATE_SUCCESS)
+			return -1;
+
+		if (timeout < 0)
+			this->cond.wait(lock);
+		else if (timeout == 0 ||
+				 this->cond.wait_for(lock,
+						std::chrono::milliseconds(timeout)) ==
+				 std::cv_status::timeout)
+		{
+			if (this->ready.empty())
+				return this->state == WFT_STATE_SUCCESS ? 0 : -1;
+		}
+	}
+
+	/* Toppars with results take turns. */
+	queue = this->ready.front();
+	this->ready.pop_front();
+	*result = std::move(queue->fetched.front().result);
+	queue->buffered -= queue->fetched.front().size;
+	queue->fetched.pop_front();
+	if (!queue->fetched.empty())
+		this->ready.push_back(queue);
+	else
+		queue->ready = false;
+
+	/* Fetching of this toppar may have been paused by a full queue. */
+	this->create_fetch_tasks(tasks);
+	lock.unlock();
+	for (WFKafkaTask *task : tasks)
+		task->start();
+
+	return 1;
+}
+
+void KafkaConsumer::close()
+{
+	this->mutex.lock();
+	this->closed = true;
+	if (this->fetches != 0)
+	{
+		/* Deleted by the last fetch callback. */
+		this->mutex.unlock();
+		return;
+	}
+
+	this->mutex.unlock();
+	delete this;
+}
+
 SubTask *WFKafkaTask::done()
 {
 	SeriesWork *series = series_of(this);
@@ -1682,6 +2295,21 @@ WFKafkaTask *WFKafkaClient::create_leavegroup_task(int retry_max,
 	return task;
 }
 
+WFKafkaProducer *WFKafkaClient::create_producer(size_t batch_size, int linger,
+												 int retry_max,
+												 kafka_callback_t cb)
+{
+	return new KafkaProducer(this, batch_size, linger, retry_max,
+							 std::move(cb));
+}
+
+WFKafkaConsumer *WFKafkaClient::create_consumer(const std::string& query,
+												 size_t buffer_size,
+												 int retry_max)
+{
+	return new KafkaConsumer(this, query, buffer_size, retry_max);
+}
+
 void WFKafkaClient::set_config(protocol::KafkaConfig conf)
 {
 	this->member->config = std::move(conf);
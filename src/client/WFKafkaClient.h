@@ -28,6 +28,8 @@
 #include "KafkaResult.h"
 
 class WFKafkaTask;
+class WFKafkaProducer;
+class WFKafkaConsumer;
 class WFKafkaClient;
 
 using kafka_callback_t = std::function<void (WFKafkaTask *)>;
@@ -142,6 +144,61 @@ protected:
 
 private:
 	friend class WFKafkaClient;
+	friend class KafkaProducer;
+	friend class KafkaConsumer;
+};
+
+class WFKafkaProducer
+{
+public:
+	/* Buffer a record. Records of a toppar are sent in one produce task
+	 * when they reach 'batch_size' bytes, or after 'linger' milliseconds
+	 * since the first buffered record. 'partition' may be -1. */
+	virtual bool send(const std::string& topic, int partition,
+					  protocol::KafkaRecord record) = 0;
+
+	/* Send all buffered records now. */
+	virtual void flush() = 0;
+
+	/* Send all buffered records and release the producer. */
+	virtual void close() = 0;
+
+	virtual void set_partitioner(kafka_partitioner_t partitioner) = 0;
+
+protected:
+	virtual ~WFKafkaProducer() { }
+};
+
+class WFKafkaConsumer
+{
+public:
+	/* Without a consumer group, add toppars with their start offsets
+	 * before calling start(). */
+	virtual bool add_toppar(const protocol::KafkaToppar& toppar) = 0;
+
+	/* With our own toppars, allow up to 'max' fetches to one broker at a
+	 * time, each for the toppars of the broker not being fetched. Call
+	 * before start(). The default is 1. */
+	virtual void set_broker_fetches(int max) = 0;
+
+	virtual void start() = 0;
+
+	/* Move the oldest fetched result of a toppar into 'result'. Toppars
+	 * with results take turns. Wait at most 'timeout' milliseconds, -1 for
+	 * unlimited. Returns 1 if a result was moved, 0 on timeout, and -1 if
+	 * fetching was stopped by an error. Records of a result are valid while
+	 * the result is alive. */
+	virtual int poll(protocol::KafkaResult *result, int timeout) = 0;
+
+	/* The state, error and kafka error of the failed fetch. */
+	virtual int get_state() const = 0;
+	virtual int get_error() const = 0;
+	virtual int get_kafka_error() const = 0;
+
+	virtual void close() = 0;
+
+protected:
+	virtual ~WFKafkaConsumer() { }
 };
 
 class WFKafkaClient
@@ -180,6 +237,20 @@ public:
 
 	void set_config(protocol::KafkaConfig conf);
 
+	/* Accumulate produce records across calls. Each flushed batch is
+	 * a produce task, and 'cb' is called with it. Close the producer
+	 * before deinit. */
+	WFKafkaProducer *create_producer(size_t batch_size, int linger,
+									 int retry_max, kafka_callback_t cb);
+
+	/* Keep fetching in background. Each toppar has its own queue, and is
+	 * fetched until 'buffer_size' bytes of its records are waiting to be
+	 * polled. Each fetch asks for no more than the room left. Close the
+	 * consumer before deinit. */
+	// example: topic=xxx&topic=yyy
+	WFKafkaConsumer *create_consumer(const std::string& query,
+									 size_t buffer_size, int retry_max);
+
 public:
 	/* If you don't leavegroup manually, rebalance would be triggered */
 	WFKafkaTask *create_leavegroup_task(int retry_max,
@@ -193,6 +264,7 @@ public:
 private:
 	class KafkaMember *member;
 	friend class KafkaClientTask;
+	friend class KafkaConsumer;
 };
 
 #endif
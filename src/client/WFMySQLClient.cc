@@ -0,0 +1,559 @@
+/*
+  Copyright (c) 2024 Sogou, Inc.
+
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+
+      http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+*/
+
+#include <errno.h>
+#include <atomic>
+#include <mutex>
+#include <string>
+#include <vector>
+#include <utility>
+#include "list.h"
+#include "StringUtil.h"
+#include "URIParser.h"
+#include "WFGlobal.h"
+#include "WFTaskFactory.h"
+#include "WFMySQLClient.h"
+
+using namespace protocol;
+
+struct MySQLPoolSlot
+{
+	ParsedURI uri;
+	std::string db;			/* current database of the session */
+	bool dirty;				/* session may be changed by a transaction */
+	class MySQLPoolMember *member;
+};
+
+struct MySQLPoolWaiter
+{
+	struct list_head list;
+	class MySQLPoolTask *task;
+	class MySQLPoolMember *member;
+	std::atomic<int> ref;
+};
+
+class MySQLPoolMember
+{
+public:
+	/* Return 1 if got a slot, 0 if the task is queued to wait for one,
+	 * or -1 if no slot and no waiting. */
+	int acquire(MySQLPoolTask *task, MySQLPoolSlot **slot);
+	void release(MySQLPoolSlot *slot);
+
+	WFMySQLTask *create_task(MySQLPoolSlot *slot, mysql_callback_t callback)
+	{
+		using MySQLComplexTask = WFComplexClientTask<MySQLRequest,
+													 MySQLResponse>;
+		WFMySQLTask *task;
+
+		task = WFTaskFactory::create_mysql_task(slot->uri, 0,
+												std::move(callback));
+		((MySQLComplexTask *)task)->set_ssl_ctx(this->ssl_ctx);
+		return task;
+	}
+
+	void incref() { this->ref++; }
+
+	void decref()
+	{
+		if (--this->ref == 0)
+			delete this;
+	}
+
+private:
+	void put(MySQLPoolSlot *slot);
+
+	static void timer_callback(WFTimerTask *timer);
+	static void reset_callback(WFMySQLTask *task);
+
+public:
+	std::string db;
+	int wait_timeout;
+	SSL_CTX *ssl_ctx;
+
+private:
+	MySQLPoolSlot *slots;
+	std::vector<MySQLPoolSlot *> free_list;
+	struct list_head wait_list;
+	std::mutex mutex;
+	std::atomic<int> ref;
+
+public:
+	MySQLPoolMember(size_t max_connections) :
+		ref(1)
+	{
+		this->slots = new MySQLPoolSlot[max_connections];
+		this->free_list.reserve(max_connections);
+		INIT_LIST_HEAD(&this->wait_list);
+	}
+
+	/* The URL of each slot is made unique by its transaction name, so that
+	 * every slot has one connection of its own. */
+	int init_slots(const std::string& url, size_t max_connections);
+
+	~MySQLPoolMember()
+	{
+		delete []this->slots;
+	}
+};
+
+class MySQLPoolTask : public WFClientTask<MySQLRequest, MySQLResponse>
+{
+public:
+	void granted(MySQLPoolSlot *slot)
+	{
+		slot_ = slot;
+		this->acquired();
+		this->next();
+	}
+
+	void timeout()
+	{
+		this->state = WFT_STATE_SYS_ERROR;
+		this->error = ETIMEDOUT;
+		this->subtask_done();
+	}
+
+public:
+	MySQLPoolTask(MySQLPoolMember *member, const std::string& db,
+				  MySQLPoolSlot **pinned, bool finish,
+				  mysql_callback_t&& callback) :
+		WFClientTask(NULL, WFGlobal::get_scheduler(), std::move(callback)),
+		db_(db.empty() ? member->db : db)
+	{
+		member->incref();
+		member_ = member;
+		pinned_ = pinned;
+		slot_ = NULL;
+		stage_ = POOL_STAGE_START;
+		finish_ = finish;
+		fresh_ = false;
+		retried_ = false;
+	}
+
+	virtual ~MySQLPoolTask()
+	{
+		member_->decref();
+	}
+
+protected:
+	virtual void dispatch();
+	virtual SubTask *done();
+
+private:
+	void acquired();
+	void next();
+	void finish();
+
+	static void task_callback(WFMySQLTask *task);
+
+private:
+	enum
+	{
+		POOL_STAGE_START,
+		POOL_STAGE_INIT_DB,
+		POOL_STAGE_QUERY,
+	};
+
+	MySQLPoolMember *member_;
+	std::string db_;
+	MySQLPoolSlot **pinned_;
+	MySQLPoolSlot *slot_;
+	int stage_;
+	int state_;
+	int error_;
+	bool finish_;
+	bool fresh_;
+	bool retried_;
+};
+
+int MySQLPoolMember::init_slots(const std::string& url, size_t max_connections)
+{
+	static std::atomic<int> seq(0);
+	std::string prefix = url;
+	ParsedURI uri;
+	size_t i;
+
+	if (URIParser::parse(url, uri) < 0)
+	{
+		if (uri.state == URI_STATE_INVALID)
+			errno = EINVAL;
+
+		return -1;
+	}
+
+	if (uri.path && uri.path[0] == '/' && uri.path[1])
+	{
+		this->db = uri.path + 1;
+		StringUtil::url_decode(this->db);
+	}
+
+	prefix += uri.query ? '&' : '?';
+	prefix += "transaction=INTERNAL_POOL_" + std::to_string(seq++) + "_";
+	for (i = 0; i < max_connections; i++)
+	{
+		if (URIParser::parse(prefix + std::to_string(i), slots[i].uri) < 0)
+			return -1;
+
+		slots[i].db = this->db;
+		slots[i].dirty = false;
+		slots[i].member = this;
+		this->free_list.push_back(&slots[i]);
+	}
+
+	return 0;
+}
+
+int MySQLPoolMember::acquire(MySQLPoolTask *task, MySQLPoolSlot **slot)
+{
+	MySQLPoolWaiter *waiter;
+	WFTimerTask *timer;
+
+	this->mutex.lock();
+	if (!this->free_list.empty())
+	{
+		*slot = this->free_list.back();
+		this->free_list.pop_back();
+		this->mutex.unlock();
+		return 1;
+	}
+
+	if (this->wait_timeout == 0)
+	{
+		this->mutex.unlock();
+		return -1;
+	}
+
+	waiter = new MySQLPoolWaiter;
+	waiter->task = task;
+	waiter->member = this;
+	waiter->ref = this->wait_timeout > 0 ? 2 : 1;
+	list_add_tail(&waiter->list, &this->wait_list);
+	this->mutex.unlock();
+
+	if (this->wait_timeout > 0)
+	{
+		this->incref();
+		timer = WFTaskFactory::create_timer_task(this->wait_timeout / 1000,
+										this->wait_timeout % 1000 * 1000000,
+										MySQLPoolMember::timer_callback);
+		timer->user_data = waiter;
+		timer->start();
+	}
+
+	return 0;
+}
+
+void MySQLPoolMember::timer_callback(WFTimerTask *timer)
+{
+	auto *waiter = (MySQLPoolWaiter *)timer->user_data;
+	MySQLPoolMember *member = waiter->member;
+	MySQLPoolTask *task;
+
+	member->mutex.lock();
+	task = waiter->task;
+	if (task)
+	{
+		list_del(&waiter->list);
+		waiter->task = NULL;
+	}
+
+	member->mutex.unlock();
+	if (task)
+		task->timeout();
+
+	if (--waiter->ref == 0)
+		delete waiter;
+
+	member->decref();
+}
+
+void MySQLPoolMember::put(MySQLPoolSlot *slot)
+{
+	MySQLPoolWaiter *waiter = NULL;
+	MySQLPoolTask *task;
+
+	this->mutex.lock();
+	if (!list_empty(&this->wait_list))
+	{
+		waiter = list_entry(this->wait_list.next, MySQLPoolWaiter, list);
+		list_del(&waiter->list);
+		task = waiter->task;
+		waiter->task = NULL;
+	}
+	else
+		this->free_list.push_back(slot);
+
+	this->mutex.unlock();
+	if (waiter)
+	{
+		if (--waiter->ref == 0)
+			delete waiter;
+
+		task->granted(slot);
+	}
+}
+
+void MySQLPoolMember::release(MySQLPoolSlot *slot)
+{
+	WFMySQLTask *task;
+
+	if (!slot->dirty)
+		return this->put(slot);
+
+	task = this->create_task(slot, MySQLPoolMember::reset_callback);
+	task->get_req()->set_reset_connection();
+	task->user_data = slot;
+	this->incref();
+	task->start();
+}
+
+void MySQLPoolMember::reset_callback(WFMySQLTask *task)
+{
+	auto *slot = (MySQLPoolSlot *)task->user_data;
+	MySQLPoolMember *member = slot->member;
+	WFMySQLTask *next;
+
+	if ((task->get_state() == WFT_STATE_TASK_ERROR ||
+		 (task->get_state() == WFT_STATE_SUCCESS &&
+		  task->get_resp()->is_error_packet())) && slot->dirty)
+	{
+		/* Reset failed, or no COM_RESET_CONNECTION. Close the connection. */
+		next = member->create_task(slot, MySQLPoolMember::reset_callback);
+		next->get_req()->set_query("ROLLBACK");
+		next->set_keep_alive(0);
+		next->user_data = slot;
+		slot->dirty = false;
+		series_of(task)->push_back(next);
+		return;
+	}
+
+	if (task->get_state() != WFT_STATE_SUCCESS || !slot->dirty)
+		slot->db = member->db;
+
+	slot->dirty = false;
+	member->put(slot);
+	member->decref();
+}
+
+void MySQLPoolTask::task_callback(WFMySQLTask *task)
+{
+	auto *t = (MySQLPoolTask *)task->user_data;
+
+	t->state_ = task->get_state();
+	t->error_ = task->get_error();
+	t->resp = std::move(*task->get_resp());
+	if (t->stage_ == POOL_STAGE_QUERY)
+		t->req = std::move(*task->get_req());
+	else if (t->state_ == WFT_STATE_SUCCESS && !t->resp.is_error_packet())
+		t->slot_->db = t->db_;
+}
+
+void MySQLPoolTask::acquired()
+{
+	fresh_ = true;
+	if (pinned_)
+	{
+		*pinned_ = slot_;
+		slot_->dirty = true;
+	}
+}
+
+void MySQLPoolTask::dispatch()
+{
+	int ret;
+
+	if (!slot_)
+	{
+		if (pinned_ && *pinned_)
+			slot_ = *pinned_;
+		else
+		{
+			ret = member_->acquire(this, &slot_);
+			if (ret == 0)
+				return;
+
+			if (ret < 0)
+				return this->timeout();
+
+			this->acquired();
+		}
+	}
+
+	this->next();
+}
+
+void MySQLPoolTask::next()
+{
+	WFMySQLTask *task;
+
+	if (stage_ != POOL_STAGE_START && state_ != WFT_STATE_SUCCESS)
+	{
+		/* The connection is closed, and a new one uses the default db. */
+		if (state_ == WFT_STATE_SYS_ERROR)
+			slot_->db = member_->db;
+
+		if (state_ == WFT_STATE_SYS_ERROR && error_ == ECONNRESET &&
+			fresh_ && !retried_)
+		{
+			/* Found closed when idle. Nothing was sent. */
+			retried_ = true;
+			stage_ = POOL_STAGE_START;
+		}
+		else
+			return this->finish();
+	}
+
+	/* The db is not changed, so the query is not sent. */
+	if (stage_ == POOL_STAGE_INIT_DB && this->resp.is_error_packet())
+		return this->finish();
+
+	if (stage_ == POOL_STAGE_START && !db_.empty() && db_ != slot_->db)
+	{
+		task = member_->create_task(slot_, MySQLPoolTask::task_callback);
+		task->get_req()->set_init_db(db_);
+		stage_ = POOL_STAGE_INIT_DB;
+	}
+	else if (stage_ != POOL_STAGE_QUERY)
+	{
+		task = member_->create_task(slot_, MySQLPoolTask::task_callback);
+		*task->get_req() = std::move(this->req);
+		stage_ = POOL_STAGE_QUERY;
+	}
+	else
+		return this->finish();
+
+	task->set_send_timeout(this->send_timeo);
+	task->set_receive_timeout(this->receive_timeo);
+	task->set_watch_timeout(this->watch_timeo);
+	task->user_data = this;
+	series_of(this)->push_front(this);
+	series_of(this)->push_front(task);
+	this->subtask_done();
+}
+
+void MySQLPoolTask::finish()
+{
+	this->state = state_;
+	this->error = error_;
+	if (!pinned_)
+		member_->release(slot_);
+	else if (finish_)
+	{
+		*pinned_ = NULL;
+		member_->release(slot_);
+	}
+
+	this->subtask_done();
+}
+
+SubTask *MySQLPoolTask::done()
+{
+	if (this->state == WFT_STATE_UNDEFINED)
+		return series_of(this)->pop();
+
+	return this->WFClientTask::done();
+}
+
+int WFMySQLClient::init(const std::string& url, size_t max_connections,
+						int wait_timeout, SSL_CTX *ssl_ctx)
+{
+	if (max_connections == 0)
+	{
+		errno = EINVAL;
+		return -1;
+	}
+
+	this->member = new MySQLPoolMember(max_connections);
+	if (this->member->init_slots(url, max_connections) < 0)
+	{
+		delete this->member;
+		return -1;
+	}
+
+	this->member->wait_timeout = wait_timeout;
+	this->member->ssl_ctx = ssl_ctx;
+	return 0;
+}
+
+void WFMySQLClient::deinit()
+{
+	this->member->decref();
+}
+
+WFMySQLTask *WFMySQLClient::create_query_task(const std::string& db,
+											  const std::string& query,
+											  mysql_callback_t callback)
+{
+	auto *task = new MySQLPoolTask(this->member, db, NULL, false,
+								   std::move(callback));
+
+	task->get_req()->set_query(query);
+	return task;
+}
+
+WFMySQLTask *
+WFMySQLClient::create_pipeline_task(const std::vector<std::string>& queries,
+									mysql_callback_t callback)
+{
+	std::string query;
+
+	for (const std::string& q : queries)
+	{
+		if (!query.empty())
+			query += ';';
+
+		query += q;
+	}
+
+	return this->create_query_task(query, std::move(callback));
+}
+
+WFMySQLTransaction::WFMySQLTransaction(WFMySQLClient *client)
+{
+	client->member->incref();
+	this->member = client->member;
+	this->slot = NULL;
+}
+
+WFMySQLTransaction::~WFMySQLTransaction()
+{
+	if (this->slot)
+		this->member->release(this->slot);
+
+	this->member->decref();
+}
+
+WFMySQLTask *WFMySQLTransaction::create_query_task(const std::string& query,
+												   mysql_callback_t callback)
+{
+	auto *task = new MySQLPoolTask(this->member, std::string(), &this->slot,
+								   false, std::move(callback));
+
+	task->get_req()->set_query(query);
+	return task;
+}
+
+WFMySQLTask *WFMySQLTransaction::create_finish_task(const char *query,
+													mysql_callback_t callback)
+{
+	auto *task = new MySQLPoolTask(this->member, std::string(), &this->slot,
+								   true, std::move(callback));
+
+	task->get_req()->set_query(query);
+	return task;
+}
+
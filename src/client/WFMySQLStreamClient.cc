@@ -0,0 +1,74 @@
+/*
+  Copyright (c) 2024 Sogou, Inc.
+
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+
+      http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+*/
+
+#include "MySQLTaskImpl.inl"
+#include "WFMySQLStreamClient.h"
+
+void WFMySQLStreamTask::task_extract(WFMySQLTask *task)
+{
+	auto *t = (WFMySQLStreamTask *)task->user_data;
+	protocol::MySQLResponse *resp = task->get_resp();
+	int i;
+
+	if (t->extract)
+	{
+		/* The rows of the batch are in the last result set. */
+		t->cursor.reset(resp);
+		for (i = 1; i < resp->get_parser()->result_set_count; i++)
+			t->cursor.next_result_set();
+
+		t->extract(t);
+	}
+}
+
+void WFMySQLStreamTask::task_callback(WFMySQLTask *task)
+{
+	auto *t = (WFMySQLStreamTask *)task->user_data;
+
+	t->state = task->get_state();
+	t->error = task->get_error();
+	if (t->callback)
+		t->callback(t);
+
+	t->task = NULL;
+	delete t;
+}
+
+WFMySQLStreamTask *
+WFMySQLStreamClient::create_stream_task(const std::string& url,
+										int batch_rows,
+										extract_t extract,
+										callback_t callback)
+{
+	WFMySQLTask *task = __WFMySQLTaskFactory::create_stream_task(url,
+										batch_rows,
+										WFMySQLStreamTask::task_extract,
+										WFMySQLStreamTask::task_callback);
+	return new WFMySQLStreamTask(task, std::move(extract), std::move(callback));
+}
+
+WFMySQLStreamTask *
+WFMySQLStreamClient::create_stream_task(const ParsedURI& uri,
+										int batch_rows,
+										extract_t extract,
+										callback_t callback)
+{
+	WFMySQLTask *task = __WFMySQLTaskFactory::create_stream_task(uri,
+										batch_rows,
+										WFMySQLStreamTask::task_extract,
+										WFMySQLStreamTask::task_callback);
+	return new WFMySQLStreamTask(task, std::move(extract), std::move(callback));
+}
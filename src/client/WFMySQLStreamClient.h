@@ -0,0 +1,178 @@
+/*
+  Copyright (c) 2024 Sogou, Inc.
+
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+
+      http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+*/
+
+#ifndef _WFMYSQLSTREAMCLIENT_H_
+#define _WFMYSQLSTREAMCLIENT_H_
+
+#include <string>
+#include <utility>
+#include <functional>
+#include <openssl/ssl.h>
+#include "MySQLMessage.h"
+#include "MySQLResult.h"
+#include "WFTask.h"
+#include "WFTaskFactory.h"
+
+class WFMySQLStreamTask : public WFGenericTask
+{
+public:
+	/* Call only in 'extract'. The cursor is at the result set the rows
+	   of this batch belong to, and fetches only these rows. They are
+	   released after 'extract' returns. */
+	protocol::MySQLResultCursor *get_cursor()
+	{
+		return &this->cursor;
+	}
+
+public:
+	protocol::MySQLRequest *get_req()
+	{
+		return this->task->get_req();
+	}
+
+	const protocol::MySQLRequest *get_req() const
+	{
+		return this->task->get_req();
+	}
+
+	/* In 'callback', the response holds all the result sets with their
+	   fields and status, but no rows, which have been extracted. */
+	protocol::MySQLResponse *get_resp()
+	{
+		return this->task->get_resp();
+	}
+
+	const protocol::MySQLResponse *get_resp() const
+	{
+		return this->task->get_resp();
+	}
+
+public:
+	/* Timeout of waiting for the first package of the response. If not
+	   set, the max waiting time will be the global 'response_timeout'. */
+	void set_watch_timeout(int timeout)
+	{
+		this->task->set_watch_timeout(timeout);
+	}
+
+	/* Timeout of receiving a batch of rows. */
+	void set_receive_timeout(int timeout)
+	{
+		this->task->set_receive_timeout(timeout);
+	}
+
+	/* Timeout of sending the query. */
+	void set_send_timeout(int timeout)
+	{
+		this->task->set_send_timeout(timeout);
+	}
+
+	void set_keep_alive(int timeout)
+	{
+		this->task->set_keep_alive(timeout);
+	}
+
+public:
+	void set_ssl_ctx(SSL_CTX *ctx)
+	{
+		using MySQLRequest = protocol::MySQLRequest;
+		using MySQLResponse = protocol::MySQLResponse;
+		auto *t = (WFComplexClientTask<MySQLRequest, MySQLResponse> *)this->task;
+		t->set_ssl_ctx(ctx);
+	}
+
+public:
+	void set_extract(std::function<void (WFMySQLStreamTask *)> ex)
+	{
+		this->extract = std::move(ex);
+	}
+
+	void set_callback(std::function<void (WFMySQLStreamTask *)> cb)
+	{
+		this->callback = std::move(cb);
+	}
+
+public:
+	const WFMySQLTask *get_mysql_task() const
+	{
+		return this->task;
+	}
+
+protected:
+	virtual void dispatch()
+	{
+		series_of(this)->push_front(this->task);
+		this->subtask_done();
+	}
+
+	virtual SubTask *done()
+	{
+		return series_of(this)->pop();
+	}
+
+protected:
+	static void task_extract(WFMySQLTask *task);
+	static void task_callback(WFMySQLTask *task);
+
+protected:
+	WFMySQLTask *task;
+	protocol::MySQLResultCursor cursor;
+	std::function<void (WFMySQLStreamTask *)> extract;
+	std::function<void (WFMySQLStreamTask *)> callback;
+
+protected:
+	WFMySQLStreamTask(WFMySQLTask *task,
+					  std::function<void (WFMySQLStreamTask *)>&& ex,
+					  std::function<void (WFMySQLStreamTask *)>&& cb) :
+		extract(std::move(ex)),
+		callback(std::move(cb))
+	{
+		task->user_data = this;
+		this->task = task;
+	}
+
+	virtual ~WFMySQLStreamTask()
+	{
+		if (this->task)
+			this->task->dismiss();
+	}
+
+	friend class WFMySQLStreamClient;
+};
+
+class WFMySQLStreamClient
+{
+public:
+	using extract_t = std::function<void (WFMySQLStreamTask *)>;
+	using callback_t = std::function<void (WFMySQLStreamTask *)>;
+
+public:
+	/* Rows of a SELECT are extracted in batches of 'batch_rows' while the
+	 * response is being received, so a result set of any size takes the
+	 * memory of one batch. Set the query by 'get_req()->set_query()'. */
+	static WFMySQLStreamTask *create_stream_task(const std::string& url,
+												 int batch_rows,
+												 extract_t extract,
+												 callback_t callback);
+
+	static WFMySQLStreamTask *create_stream_task(const ParsedURI& uri,
+												 int batch_rows,
+												 extract_t extract,
+												 callback_t callback);
+};
+
+#endif
+
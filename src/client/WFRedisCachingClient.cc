@@ -0,0 +1,646 @@
+/*
+  Copyright (c) 2024 Sogou, Inc.
+
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+
+      http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+*/
+
+#include <errno.h>
+#include <stdint.h>
+#include <string.h>
+#include <strings.h>
+#include <atomic>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+#include <utility>
+#include "ShardedCache.h"
+#include "URIParser.h"
+#include "WFGlobal.h"
+#include "WFTaskFactory.h"
+#include "RedisTaskImpl.inl"
+#include "WFRedisCachingClient.h"
+
+#define REDIS_CACHE_SHARDS				32
+#define REDIS_CACHE_KEY_EPOCHS			256
+#define REDIS_CACHE_ENTRY_OVERHEAD		128
+#define REDIS_CACHE_RETRY_INTERVAL		1
+
+using namespace protocol;
+
+/* Read-only commands whose reply depends only on the key at params[0]. */
+static const char *__redis_cacheable_commands[] = {
+	"GET", "GETRANGE", "STRLEN", "GETBIT", "BITCOUNT", "TYPE",
+	"HGET", "HMGET", "HGETALL", "HKEYS", "HVALS", "HLEN", "HEXISTS",
+	"HSTRLEN", "LRANGE", "LINDEX", "LLEN", "SMEMBERS", "SISMEMBER",
+	"SMISMEMBER", "SCARD", "ZRANGE", "ZRANGEBYSCORE", "ZREVRANGE",
+	"ZREVRANGEBYSCORE", "ZRANGEBYLEX", "ZSCORE", "ZMSCORE", "ZCARD",
+	"ZCOUNT", "ZLEXCOUNT", "ZRANK", "ZREVRANK",
+};
+
+static bool __redis_cacheable(const std::string& command,
+							  const std::vector<std::string>& params)
+{
+	const char *cmd = command.c_str();
+	size_t i;
+
+	if (params.empty())
+		return false;
+
+	/* EXISTS of more than one key would need all of them invalidated. */
+	if (strcasecmp(cmd, "EXISTS") == 0)
+		return params.size() == 1;
+
+	for (i = 0; i < sizeof __redis_cacheable_commands / sizeof (char *); i++)
+	{
+		if (strcasecmp(cmd, __redis_cacheable_commands[i]) == 0)
+			return true;
+	}
+
+	return false;
+}
+
+/* The command and all the arguments after the key, length prefixed. */
+static std::string __redis_cache_field(const std::string& command,
+									   const std::vector<std::string>& params)
+{
+	std::string field;
+	size_t i;
+
+	field.reserve(command.size() + 16);
+	for (char c : command)
+		field += (c >= 'a' && c <= 'z') ? c - 'a' + 'A' : c;
+
+	for (i = 1; i < params.size(); i++)
+	{
+		field += ' ';
+		field += std::to_string(params[i].size());
+		field += ':';
+		field += params[i];
+	}
+
+	return field;
+}
+
+static size_t __redis_value_size(const RedisValue& value)
+{
+	size_t size = sizeof (RedisValue);
+	const std::string *str;
+	size_t i;
+
+	if (value.is_array())
+	{
+		for (i = 0; i < value.arr_size(); i++)
+			size += __redis_value_size(value[i]);
+	}
+	else if ((str = value.string_view()) != NULL)
+		size += str->size();
+
+	return size;
+}
+
+struct RedisCacheEntry
+{
+	std::map<std::string, RedisValue> replies;
+	size_t bytes;
+};
+
+class RedisCacheEntryDeleter
+{
+public:
+	void operator() (RedisCacheEntry& entry) const { }
+};
+
+using RedisCache = ShardedCache<std::string, RedisCacheEntry,
+								RedisCacheEntryDeleter>;
+
+/* Orders the puts against the invalidations of the keys hashed to it. */
+struct RedisCacheEpochs
+{
+	std::mutex mutex;
+	uint64_t epoch;
+	/* Without prefixes, BCAST invalidates every key written anywhere.
+	 * Counting them by key hash keeps other keys' reads cacheable. */
+	uint64_t key_epochs[REDIS_CACHE_KEY_EPOCHS];
+
+	RedisCacheEpochs() : epoch(0), key_epochs() { }
+
+	uint64_t& key_epoch(size_t hash)
+	{
+		return this->key_epochs[hash / REDIS_CACHE_SHARDS %
+								REDIS_CACHE_KEY_EPOCHS];
+	}
+};
+
+class RedisCacheMember
+{
+public:
+	RedisCacheMember() : cache(REDIS_CACHE_SHARDS), tracking(false), ref(1)
+	{
+		this->task = NULL;
+		this->stopped = false;
+	}
+
+	RedisCacheEpochs *get_epochs(size_t hash)
+	{
+		return &this->epochs[hash % REDIS_CACHE_SHARDS];
+	}
+
+	bool get(const std::string& key, const std::string& field,
+			 RedisValue& value);
+	uint64_t get_epoch(const std::string& key);
+	void put(const std::string& key, const std::string& field,
+			 const RedisValue& value, uint64_t epoch);
+	void invalidate(const std::string& key);
+	void flush();
+	size_t size();
+
+	void set_max_bytes(size_t max_bytes)
+	{
+		this->shard_max_bytes = max_bytes / REDIS_CACHE_SHARDS;
+		this->cache.set_max_size(max_bytes);
+	}
+
+	bool tracked(const std::string& key) const
+	{
+		if (this->prefixes.empty())
+			return true;
+
+		for (const std::string& prefix : this->prefixes)
+		{
+			if (key.compare(0, prefix.size(), prefix) == 0)
+				return true;
+		}
+
+		return false;
+	}
+
+	void incref()
+	{
+		++this->ref;
+	}
+
+	void decref()
+	{
+		if (--this->ref == 0)
+			delete this;
+	}
+
+	void start_tracking();
+	void stop_tracking();
+
+private:
+	WFRedisTask *create_tracking_task();
+	static void tracking_extract(WFRedisTask *task);
+	static void tracking_callback(WFRedisTask *task);
+	static void timer_callback(WFTimerTask *timer);
+
+public:
+	ParsedURI uri;
+	std::string tracking_url;
+	std::string timer_name;
+	std::vector<std::string> prefixes;
+
+private:
+	size_t shard_max_bytes;
+	RedisCache cache;
+	RedisCacheEpochs epochs[REDIS_CACHE_SHARDS];
+	/* Replies are served and stored only while invalidations arrive. */
+	std::atomic<bool> tracking;
+	std::atomic<int> ref;
+	std::mutex mutex;
+	WFRedisTask *task;
+	bool stopped;
+};
+
+bool RedisCacheMember::get(const std::string& key, const std::string& field,
+						   RedisValue& value)
+{
+	const ShardedCacheHandle<std::string, RedisCacheEntry> *handle;
+	bool hit = false;
+
+	if (!this->tracking.load(std::memory_order_acquire))
+		return false;
+
+	handle = this->cache.get(key);
+	if (handle)
+	{
+		auto iter = handle->value.replies.find(field);
+
+		if (iter != handle->value.replies.end())
+		{
+			value = iter->second;
+			hit = true;
+		}
+
+		this->cache.release(handle);
+	}
+
+	return hit;
+}
+
+uint64_t RedisCacheMember::get_epoch(const std::string& key)
+{
+	size_t h = std::hash<std::string>()(key);
+	RedisCacheEpochs *epochs = this->get_epochs(h);
+	uint64_t epoch;
+
+	/* Both only grow, so their sum changes if either does. */
+	epochs->mutex.lock();
+	epoch = epochs->epoch + epochs->key_epoch(h);
+	epochs->mutex.unlock();
+	return epoch;
+}
+
+void RedisCacheMember::put(const std::string& key, const std::string& field,
+						   const RedisValue& value, uint64_t epoch)
+{
+	const ShardedCacheHandle<std::string, RedisCacheEntry> *handle;
+	size_t h = std::hash<std::string>()(key);
+	RedisCacheEpochs *epochs = this->get_epochs(h);
+	size_t bytes = field.size() + REDIS_CACHE_ENTRY_OVERHEAD +
+				   __redis_value_size(value);
+	RedisCacheEntry entry;
+
+	if (!this->tracking.load(std::memory_order_acquire))
+		return;
+
+	if (bytes + key.size() + REDIS_CACHE_ENTRY_OVERHEAD >
+		this->shard_max_bytes)
+		return;
+
+	epochs->mutex.lock();
+	/* The key may have been invalidated while the request was in flight. */
+	if (epochs->epoch + epochs->key_epoch(h) == epoch)
+	{
+		/* Entries are shared with readers, so a new field goes to a copy. */
+		handle = this->cache.get(key);
+		if (handle)
+		{
+			entry = handle->value;
+			this->cache.release(handle);
+		}
+		else
+			entry.bytes = key.size() + REDIS_CACHE_ENTRY_OVERHEAD;
+
+		if (entry.bytes + bytes <= this->shard_max_bytes &&
+			entry.replies.emplace(field, value).second)
+		{
+			bytes += entry.bytes;
+			entry.bytes = bytes;
+			this->cache.release(this->cache.put(key, std::move(entry), bytes));
+		}
+	}
+
+	epochs->mutex.unlock();
+}
+
+void RedisCacheMember::invalidate(const std::string& key)
+{
+	size_t h = std::hash<std::string>()(key);
+	RedisCacheEpochs *epochs = this->get_epochs(h);
+
+	epochs->mutex.lock();
+	this->cache.del(key);
+	epochs->key_epoch(h)++;
+	epochs->mutex.unlock();
+}
+
+void RedisCacheMember::flush()
+{
+	int i;
+
+	/* A put either completes before its epoch moves, and is cleared
+	 * below, or sees the new epoch and stores nothing. */
+	for (i = 0; i < REDIS_CACHE_SHARDS; i++)
+	{
+		this->epochs[i].mutex.lock();
+		this->epochs[i].epoch++;
+		this->epochs[i].mutex.unlock();
+	}
+
+	this->cache.clear();
+}
+
+size_t RedisCacheMember::size()
+{
+	return this->cache.get_size();
+}
+
+WFRedisTask *RedisCacheMember::create_tracking_task()
+{
+	std::vector<std::string> params = { "TRACKING", "ON", "BCAST" };
+	WFRedisTask *task;
+
+	for (const std::string& prefix : this->prefixes)
+	{
+		params.push_back("PREFIX");
+		params.push_back(prefix);
+	}
+
+	task = __WFRedisTaskFactory::create_subscribe_task(this->tracking_url,
+									RedisCacheMember::tracking_extract,
+									RedisCacheMember::tracking_callback);
+	task->get_req()->set_request("CLIENT", params);
+	/* The connection may be quiet for long. Never time out waiting. */
+	task->set_watch_timeout(-1);
+	task->user_data = this;
+	return task;
+}
+
+void RedisCacheMember::start_tracking()
+{
+	WFRedisTask *task = this->create_tracking_task();
+
+	this->incref();
+	this->mutex.lock();
+	this->task = task;
+	this->mutex.unlock();
+	task->start();
+}
+
+static int __redis_push_quit(WFRedisTask *task)
+{
+	static const char quit[] = "*1\r\n$4\r\nQUIT\r\n";
+
+	return task->push(quit, sizeof quit - 1);
+}
+
+void RedisCacheMember::stop_tracking()
+{
+	this->mutex.lock();
+	this->stopped = true;
+	/* If not watching yet, QUIT is sent when tracking is turned on. */
+	if (this->task)
+		__redis_push_quit(this->task);
+
+	this->mutex.unlock();
+	WFTaskFactory::cancel_by_name(this->timer_name);
+}
+
+void RedisCacheMember::tracking_extract(WFRedisTask *task)
+{
+	auto *member = (RedisCacheMember *)task->user_data;
+	RedisValue value;
+	size_t i;
+
+	task->get_resp()->get_result(value);
+	if (!member->tracking.load(std::memory_order_relaxed))
+	{
+		/* The reply of CLIENT TRACKING. Anything cached before this point
+		 * has missed its invalidations. */
+		member->mutex.lock();
+		if (member->stopped)
+			__redis_push_quit(task);
+		else if (value.is_ok())
+		{
+			member->flush();
+			member->tracking.store(true, std::memory_order_release);
+		}
+
+		member->mutex.unlock();
+		return;
+	}
+
+	/* >2 invalidate [keys] or >2 invalidate _ after FLUSHALL. */
+	if (value.arr_size() != 2 || !value[0].is_string() ||
+		strcasecmp(value[0].string_view()->c_str(), "invalidate") != 0)
+		return;
+
+	if (value[1].is_array())
+	{
+		for (i = 0; i < value[1].arr_size(); i++)
+		{
+			if (value[1][i].is_string())
+				member->invalidate(*value[1][i].string_view());
+		}
+	}
+	else
+		member->flush();
+}
+
+void RedisCacheMember::tracking_callback(WFRedisTask *task)
+{
+	auto *member = (RedisCacheMember *)task->user_data;
+	WFTimerTask *timer = NULL;
+
+	member->tracking.store(false, std::memory_order_release);
+	member->flush();
+
+	member->mutex.lock();
+	member->task = NULL;
+	if (!member->stopped)
+	{
+		timer = WFTaskFactory::create_timer_task(member->timer_name,
+												 REDIS_CACHE_RETRY_INTERVAL, 0,
+												 RedisCacheMember::timer_callback);
+		timer->user_data = member;
+		series_of(task)->push_back(timer);
+	}
+
+	member->mutex.unlock();
+	if (!timer)
+		member->decref();
+}
+
+void RedisCacheMember::timer_callback(WFTimerTask *timer)
+{
+	auto *member = (RedisCacheMember *)timer->user_data;
+	WFRedisTask *task = NULL;
+
+	member->mutex.lock();
+	if (!member->stopped)
+	{
+		task = member->create_tracking_task();
+		member->task = task;
+		series_of(timer)->push_back(task);
+	}
+
+	member->mutex.unlock();
+	if (!task)
+		member->decref();
+}
+
+class RedisCachingTask : public WFClientTask<RedisRequest, RedisResponse>
+{
+public:
+	RedisCachingTask(RedisCacheMember *member, const std::string& key,
+					 std::string&& field, int retry_max,
+					 redis_callback_t&& callback) :
+		WFClientTask(NULL, WFGlobal::get_scheduler(), std::move(callback)),
+		key_(key),
+		field_(std::move(field))
+	{
+		member->incref();
+		member_ = member;
+		retry_max_ = retry_max;
+		dispatched_ = false;
+	}
+
+	virtual ~RedisCachingTask()
+	{
+		member_->decref();
+	}
+
+protected:
+	virtual void dispatch();
+	virtual SubTask *done();
+
+private:
+	static void redis_callback(WFRedisTask *task);
+
+private:
+	RedisCacheMember *member_;
+	std::string key_;
+	std::string field_;
+	RedisValue result_;
+	uint64_t epoch_;
+	int retry_max_;
+	bool dispatched_;
+};
+
+void RedisCachingTask::redis_callback(WFRedisTask *task)
+{
+	auto *t = (RedisCachingTask *)task->user_data;
+
+	t->state = task->get_state();
+	t->error = task->get_error();
+	if (t->state == WFT_STATE_SUCCESS)
+		task->get_resp()->get_result(t->result_);
+}
+
+void RedisCachingTask::dispatch()
+{
+	if (!dispatched_)
+	{
+		if (member_->get(key_, field_, result_))
+		{
+			this->resp.set_result(result_);
+			this->state = WFT_STATE_SUCCESS;
+			this->error = 0;
+		}
+		else
+		{
+			std::vector<std::string> params;
+			std::string command;
+			WFRedisTask *task;
+
+			this->req.get_command(command);
+			this->req.get_params(params);
+			task = WFTaskFactory::create_redis_task(member_->uri, retry_max_,
+											RedisCachingTask::redis_callback);
+			task->get_req()->set_request(command, params);
+			task->set_send_timeout(this->send_timeo);
+			task->set_receive_timeout(this->receive_timeo);
+			task->set_watch_timeout(this->watch_timeo);
+			task->user_data = this;
+
+			epoch_ = member_->get_epoch(key_);
+			dispatched_ = true;
+			series_of(this)->push_front(this);
+			series_of(this)->push_front(task);
+		}
+	}
+	else if (this->state == WFT_STATE_SUCCESS)
+	{
+		if (!result_.is_error())
+			member_->put(key_, field_, result_, epoch_);
+
+		this->resp.set_result(result_);
+	}
+
+	this->subtask_done();
+}
+
+SubTask *RedisCachingTask::done()
+{
+	if (this->state == WFT_STATE_UNDEFINED)
+		return series_of(this)->pop();
+
+	return this->WFClientTask::done();
+}
+
+int WFRedisCachingClient::init(const std::string& url, size_t max_bytes,
+							   const std::vector<std::string>& prefixes)
+{
+	static std::atomic<int> seq(0);
+	std::string tracking_url;
+	size_t pos;
+	ParsedURI uri;
+
+	if (URIParser::parse(url, uri) < 0)
+	{
+		if (uri.state == URI_STATE_INVALID)
+			errno = EINVAL;
+
+		return -1;
+	}
+
+	/* The first 'protocol' in query wins, so put ours at the front. */
+	pos = url.find('?');
+	if (pos == std::string::npos)
+		tracking_url = url + "?protocol=3";
+	else
+		tracking_url = url.substr(0, pos + 1) + "protocol=3&" +
+					   url.substr(pos + 1);
+
+	this->member = new RedisCacheMember;
+	this->member->uri = std::move(uri);
+	this->member->tracking_url = std::move(tracking_url);
+	this->member->timer_name = "redis.caching." + std::to_string(++seq);
+	this->member->prefixes = prefixes;
+	this->member->set_max_bytes(max_bytes);
+	this->member->start_tracking();
+	return 0;
+}
+
+void WFRedisCachingClient::deinit()
+{
+	this->member->stop_tracking();
+	this->member->decref();
+}
+
+WFRedisTask *
+WFRedisCachingClient::create_redis_task(const std::string& command,
+										const std::vector<std::string>& params,
+										int retry_max,
+										redis_callback_t callback)
+{
+	WFRedisTask *task;
+
+	if (__redis_cacheable(command, params) && this->member->tracked(params[0]))
+	{
+		task = new RedisCachingTask(this->member, params[0],
+									__redis_cache_field(command, params),
+									retry_max, std::move(callback));
+	}
+	else
+	{
+		task = WFTaskFactory::create_redis_task(this->member->uri, retry_max,
+												std::move(callback));
+	}
+
+	task->get_req()->set_request(command, params);
+	return task;
+}
+
+void WFRedisCachingClient::flush()
+{
+	this->member->flush();
+}
+
+size_t WFRedisCachingClient::size() const
+{
+	return this->member->size();
+}
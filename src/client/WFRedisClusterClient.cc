@@ -0,0 +1,816 @@
+/*
+  Copyright (c) 2024 Sogou, Inc.
+
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+
+      http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+*/
+
+#include <errno.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <set>
+#include <map>
+#include <string>
+#include <vector>
+#include <utility>
+#include "URIParser.h"
+#include "UpstreamManager.h"
+#include "WFGlobal.h"
+#include "WFTaskFactory.h"
+#include "Workflow.h"
+#include "RedisTaskImpl.inl"
+#include "WFRedisClusterClient.h"
+
+#define GET_CURRENT_MS	std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now().time_since_epoch()).count()
+
+#define REDIS_CLUSTER_NODES_MAX				1024
+#define REDIS_CLUSTER_REFRESH_INTERVAL		1000
+#define REDIS_CLUSTER_REFRESH_RETRY_MAX		1
+
+using namespace protocol;
+
+enum
+{
+	REDIS_MULTI_KEY_NONE = 0,
+	REDIS_MULTI_KEY_MGET,
+	REDIS_MULTI_KEY_MSET,
+	REDIS_MULTI_KEY_SUM,
+};
+
+static const char *__redis_keyless_commands[] = {
+	"PING", "ECHO", "INFO", "CLUSTER", "DBSIZE", "SCAN", "KEYS",
+	"FLUSHALL", "FLUSHDB", "RANDOMKEY", "TIME", "CONFIG", "CLIENT",
+	"COMMAND", "SCRIPT", "FUNCTION", "PUBLISH", "MULTI", "EXEC",
+	"DISCARD", "WAIT", "QUIT", "LASTSAVE", "SAVE", "BGSAVE", "SLOWLOG",
+	"HELLO", "READONLY", "READWRITE", "ROLE", "LATENCY", "MONITOR",
+};
+
+/* Position of the first key in params, or -1 if the command has no key. */
+static int __redis_key_pos(const std::string& command,
+						   const std::vector<std::string>& params)
+{
+	const char *cmd = command.c_str();
+	size_t i;
+
+	if (params.empty())
+		return -1;
+
+	for (i = 0; i < sizeof __redis_keyless_commands / sizeof (char *); i++)
+	{
+		if (strcasecmp(cmd, __redis_keyless_commands[i]) == 0)
+			return -1;
+	}
+
+	if (strncasecmp(cmd, "EVAL", 4) == 0 || strncasecmp(cmd, "FCALL", 5) == 0)
+	{
+		/* EVAL script numkeys key [key ...] arg [arg ...] */
+		if (params.size() > 2 && atoi(params[1].c_str()) > 0)
+			return 2;
+
+		return -1;
+	}
+
+	if (strcasecmp(cmd, "BITOP") == 0)
+		return params.size() > 1 ? 1 : -1;
+
+	if (strcasecmp(cmd, "XREAD") == 0 || strcasecmp(cmd, "XREADGROUP") == 0)
+	{
+		for (i = 0; i + 1 < params.size(); i++)
+		{
+			if (strcasecmp(params[i].c_str(), "STREAMS") == 0)
+				return i + 1;
+		}
+
+		return -1;
+	}
+
+	return 0;
+}
+
+static int __redis_multi_key_type(const std::string& command)
+{
+	const char *cmd = command.c_str();
+
+	if (strcasecmp(cmd, "MGET") == 0)
+		return REDIS_MULTI_KEY_MGET;
+
+	if (strcasecmp(cmd, "MSET") == 0)
+		return REDIS_MULTI_KEY_MSET;
+
+	if (strcasecmp(cmd, "DEL") == 0 || strcasecmp(cmd, "UNLINK") == 0 ||
+		strcasecmp(cmd, "EXISTS") == 0 || strcasecmp(cmd, "TOUCH") == 0)
+		return REDIS_MULTI_KEY_SUM;
+
+	return REDIS_MULTI_KEY_NONE;
+}
+
+static std::string __redis_node(const std::string& host, int port)
+{
+	std::string node;
+
+	if (host.find(':') != std::string::npos)
+		node = "[" + host + "]";
+	else
+		node = host;
+
+	node += ':';
+	node += std::to_string(port);
+	return node;
+}
+
+/* Value of 'key' in a RESP2 flattened map. */
+static const RedisValue *__redis_map_get(const RedisValue& map,
+										 const char *key)
+{
+	const std::string *str;
+	size_t i;
+
+	for (i = 0; i + 1 < map.arr_size(); i += 2)
+	{
+		str = map[i].string_view();
+		if (str && strcasecmp(str->c_str(), key) == 0)
+			return &map[i + 1];
+	}
+
+	return NULL;
+}
+
+struct RedisClusterRange
+{
+	int start;
+	int end;
+	std::string node;
+};
+
+class RedisClusterMember : public __WFRedisClusterRouter
+{
+public:
+	RedisClusterMember() : ref(1), refreshing(false), next_refresh(0)
+	{
+		int i;
+
+		for (i = 0; i < REDIS_CLUSTER_SLOTS; i++)
+			this->slots[i].store(-1, std::memory_order_relaxed);
+
+		this->nodes_count = 0;
+	}
+
+	virtual bool route(const RedisRequest *req, std::string& node);
+	virtual void moved(int slot, const std::string& node);
+
+	virtual void incref()
+	{
+		++this->ref;
+	}
+
+	virtual void decref()
+	{
+		if (--this->ref == 0)
+			delete this;
+	}
+
+	bool get_node(int slot, std::string& node) const
+	{
+		int index = this->slots[slot].load(std::memory_order_acquire);
+
+		if (index < 0)
+			return false;
+
+		node = this->nodes[index];
+		return true;
+	}
+
+	void refresh();
+
+private:
+	int node_index_locked(const std::string& node);
+	void update(const std::vector<RedisClusterRange>& ranges);
+	bool parse_shards(const RedisValue& value,
+					  std::vector<RedisClusterRange>& ranges) const;
+	bool parse_slots(const RedisValue& value,
+					 std::vector<RedisClusterRange>& ranges) const;
+
+	static void refresh_callback(WFRedisTask *task);
+
+public:
+	ParsedURI uri;
+	std::string seed_host;
+	std::string upstream_name;
+	std::set<std::string> masters;
+	std::mutex mutex;
+
+private:
+	/* 'nodes' are append-only, so a slot can be read without locking. */
+	std::string nodes[REDIS_CLUSTER_NODES_MAX];
+	int nodes_count;
+	std::atomic<int> slots[REDIS_CLUSTER_SLOTS];
+	std::atomic<int> ref;
+	std::atomic<bool> refreshing;
+	std::atomic<int64_t> next_refresh;
+};
+
+bool RedisClusterMember::route(const RedisRequest *req, std::string& node)
+{
+	std::vector<std::string> params;
+	std::string command;
+	int pos;
+
+	if (!req->get_command(command) || !req->get_params(params))
+		return false;
+
+	pos = __redis_key_pos(command, params);
+	if (pos < 0)
+		return false;
+
+	return this->get_node(WFRedisClusterClient::key_slot(params[pos]), node);
+}
+
+void RedisClusterMember::moved(int slot, const std::string& node)
+{
+	int index;
+
+	if (slot < 0 || slot >= REDIS_CLUSTER_SLOTS)
+		return;
+
+	this->mutex.lock();
+	index = this->node_index_locked(node);
+	if (index >= 0)
+		this->slots[slot].store(index, std::memory_order_release);
+
+	this->mutex.unlock();
+
+	/* One slot moved usually means a resharding. Reload the whole table,
+	 * but not more than once per interval. */
+	if (GET_CURRENT_MS >= this->next_refresh)
+		this->refresh();
+}
+
+int RedisClusterMember::node_index_locked(const std::string& node)
+{
+	int i;
+
+	for (i = 0; i < this->nodes_count; i++)
+	{
+		if (this->nodes[i] == node)
+			return i;
+	}
+
+	if (this->nodes_count == REDIS_CLUSTER_NODES_MAX)
+		return -1;
+
+	this->nodes[i] = node;
+	this->nodes_count++;
+	return i;
+}
+
+void RedisClusterMember::update(const std::vector<RedisClusterRange>& ranges)
+{
+	std::vector<int> table(REDIS_CLUSTER_SLOTS, -1);
+	std::set<std::string> masters;
+	int index;
+	int i;
+
+	this->mutex.lock();
+	for (const RedisClusterRange& range : ranges)
+	{
+		index = this->node_index_locked(range.node);
+		if (index < 0)
+			continue;
+
+		for (i = range.start; i <= range.end; i++)
+			table[i] = index;
+
+		masters.insert(range.node);
+	}
+
+	for (i = 0; i < REDIS_CLUSTER_SLOTS; i++)
+		this->slots[i].store(table[i], std::memory_order_release);
+
+	for (const std::string& node : masters)
+	{
+		if (this->masters.count(node) == 0)
+			UpstreamManager::upstream_add_server(this->upstream_name, node);
+	}
+
+	for (const std::string& node : this->masters)
+	{
+		if (masters.count(node) == 0)
+			UpstreamManager::upstream_remove_server(this->upstream_name, node);
+	}
+
+	this->masters = std::move(masters);
+	this->mutex.unlock();
+}
+
+/* CLUSTER SHARDS, Redis 7.0+. Each shard is a map with "slots" as a list
+ * of start and end pairs, and "nodes" as a list of node maps. */
+bool RedisClusterMember::parse_shards(const RedisValue& value,
+								std::vector<RedisClusterRange>& ranges) const
+{
+	bool ssl = (strcasecmp(this->uri.scheme, "rediss") == 0);
+	const RedisValue *slots;
+	const RedisValue *nodes;
+	const RedisValue *field;
+	std::string host;
+	int port;
+	size_t i, j;
+
+	if (!value.is_array())
+		return false;
+
+	for (i = 0; i < value.arr_size(); i++)
+	{
+		port = 0;
+		slots = __redis_map_get(value[i], "slots");
+		nodes = __redis_map_get(value[i], "nodes");
+		if (!slots || !nodes)
+			return false;
+
+		for (j = 0; j < nodes->arr_size(); j++)
+		{
+			const RedisValue& node = (*nodes)[j];
+
+			field = __redis_map_get(node, "role");
+			if (!field || field->string_value() != "master")
+				continue;
+
+			field = __redis_map_get(node, "endpoint");
+			host = field ? field->string_value() : "";
+			if (host.empty() || host == "?")
+			{
+				field = __redis_map_get(node, "ip");
+				host = field ? field->string_value() : "";
+			}
+
+			field = __redis_map_get(node, ssl ? "tls-port" : "port");
+			port = field ? field->int_value() : 0;
+			break;
+		}
+
+		if (j == nodes->arr_size() || port <= 0)
+			continue;
+
+		if (host.empty() || host == "?")
+			host = this->seed_host;
+
+		for (j = 0; j + 1 < slots->arr_size(); j += 2)
+		{
+			RedisClusterRange range = {
+				.start	=	(int)(*slots)[j].int_value(),
+				.end	=	(int)(*slots)[j + 1].int_value(),
+				.node	=	__redis_node(host, port),
+			};
+
+			if (range.start < 0 || range.end >= REDIS_CLUSTER_SLOTS)
+				return false;
+
+			ranges.emplace_back(std::move(range));
+		}
+	}
+
+	return true;
+}
+
+/* CLUSTER SLOTS: [start, end, [host, port, id], replicas...] */
+bool RedisClusterMember::parse_slots(const RedisValue& value,
+								std::vector<RedisClusterRange>& ranges) const
+{
+	std::string host;
+	size_t i;
+
+	if (!value.is_array())
+		return false;
+
+	for (i = 0; i < value.arr_size(); i++)
+	{
+		const RedisValue& entry = value[i];
+
+		if (entry.arr_size() < 3 || entry[2].arr_size() < 2)
+			return false;
+
+		host = entry[2][0].string_value();
+		if (host.empty() || host == "?")
+			host = this->seed_host;
+
+		RedisClusterRange range = {
+			.start	=	(int)entry[0].int_value(),
+			.end	=	(int)entry[1].int_value(),
+			.node	=	__redis_node(host, (int)entry[2][1].int_value()),
+		};
+
+		if (range.start < 0 || range.end >= REDIS_CLUSTER_SLOTS)
+			return false;
+
+		ranges.emplace_back(std::move(range));
+	}
+
+	return true;
+}
+
+void RedisClusterMember::refresh_callback(WFRedisTask *task)
+{
+	auto *member = (RedisClusterMember *)task->user_data;
+	std::vector<RedisClusterRange> ranges;
+	std::string command;
+	std::vector<std::string> params;
+	RedisValue value;
+	bool ret;
+
+	if (task->get_state() == WFT_STATE_SUCCESS)
+	{
+		task->get_resp()->get_result(value);
+		task->get_req()->get_params(params);
+		if (value.is_error() && params[0] == "SHARDS")
+		{
+			/* Older than Redis 7.0. */
+			auto *next = WFTaskFactory::create_redis_task(member->uri,
+											REDIS_CLUSTER_REFRESH_RETRY_MAX,
+											RedisClusterMember::refresh_callback);
+			next->get_req()->set_request("CLUSTER", {"SLOTS"});
+			next->user_data = member;
+			series_of(task)->push_front(next);
+			return;
+		}
+
+		if (params[0] == "SHARDS")
+			ret = member->parse_shards(value, ranges);
+		else
+			ret = member->parse_slots(value, ranges);
+
+		if (ret && !ranges.empty())
+			member->update(ranges);
+	}
+
+	member->next_refresh = GET_CURRENT_MS + REDIS_CLUSTER_REFRESH_INTERVAL;
+	member->refreshing = false;
+	member->decref();
+}
+
+void RedisClusterMember::refresh()
+{
+	WFRedisTask *task;
+
+	if (this->refreshing.exchange(true))
+		return;
+
+	this->incref();
+	task = WFTaskFactory::create_redis_task(this->uri,
+											REDIS_CLUSTER_REFRESH_RETRY_MAX,
+											RedisClusterMember::refresh_callback);
+	task->get_req()->set_request("CLUSTER", {"SHARDS"});
+	task->user_data = this;
+	task->start();
+}
+
+/* Keys of a multi-key command in the same slot. */
+struct RedisClusterGroup
+{
+	std::vector<size_t> keys;
+	std::vector<std::string> params;
+	int state;
+	int error;
+	RedisValue result;
+};
+
+class RedisClusterMultiTask : public WFClientTask<RedisRequest, RedisResponse>
+{
+public:
+	RedisClusterMultiTask(RedisClusterMember *member, int type,
+						  const std::string& command,
+						  std::vector<RedisClusterGroup>&& groups,
+						  size_t nkeys, int retry_max,
+						  redis_callback_t&& callback) :
+		WFClientTask(NULL, WFGlobal::get_scheduler(), std::move(callback)),
+		command_(command),
+		groups_(std::move(groups))
+	{
+		member->incref();
+		member_ = member;
+		type_ = type;
+		nkeys_ = nkeys;
+		retry_max_ = retry_max;
+		dispatched_ = false;
+	}
+
+	virtual ~RedisClusterMultiTask()
+	{
+		member_->decref();
+	}
+
+protected:
+	virtual void dispatch();
+	virtual SubTask *done();
+
+private:
+	void merge();
+	static void group_callback(WFRedisTask *task);
+
+private:
+	RedisClusterMember *member_;
+	std::string command_;
+	std::vector<RedisClusterGroup> groups_;
+	int type_;
+	size_t nkeys_;
+	int retry_max_;
+	bool dispatched_;
+};
+
+void RedisClusterMultiTask::group_callback(WFRedisTask *task)
+{
+	auto *group = (RedisClusterGroup *)task->user_data;
+
+	group->state = task->get_state();
+	group->error = task->get_error();
+	if (group->state == WFT_STATE_SUCCESS)
+		task->get_resp()->get_result(group->result);
+}
+
+void RedisClusterMultiTask::dispatch()
+{
+	if (!dispatched_)
+	{
+		ParallelWork *parallel = Workflow::create_parallel_work(nullptr);
+		WFRedisTask *task;
+
+		for (RedisClusterGroup& group : groups_)
+		{
+			task = __WFRedisTaskFactory::create_cluster_task(member_->uri,
+										retry_max_, member_,
+										RedisClusterMultiTask::group_callback);
+			task->get_req()->set_request(command_, group.params);
+			task->set_send_timeout(this->send_timeo);
+			task->set_receive_timeout(this->receive_timeo);
+			task->set_watch_timeout(this->watch_timeo);
+			task->user_data = &group;
+			parallel->add_series(Workflow::create_series_work(task, nullptr));
+		}
+
+		dispatched_ = true;
+		series_of(this)->push_front(this);
+		series_of(this)->push_front(parallel);
+	}
+	else
+		this->merge();
+
+	this->subtask_done();
+}
+
+SubTask *RedisClusterMultiTask::done()
+{
+	if (this->state == WFT_STATE_UNDEFINED)
+		return series_of(this)->pop();
+
+	return this->WFClientTask::done();
+}
+
+void RedisClusterMultiTask::merge()
+{
+	RedisValue value;
+	int64_t sum = 0;
+	size_t i;
+
+	for (RedisClusterGroup& group : groups_)
+	{
+		if (group.state != WFT_STATE_SUCCESS)
+		{
+			this->state = group.state;
+			this->error = group.error;
+			return;
+		}
+	}
+
+	for (RedisClusterGroup& group : groups_)
+	{
+		if (group.result.is_error())
+		{
+			this->resp.set_result(group.result);
+			this->state = WFT_STATE_SUCCESS;
+			return;
+		}
+	}
+
+	switch (type_)
+	{
+	case REDIS_MULTI_KEY_MGET:
+		value.set_array(nkeys_);
+		for (RedisClusterGroup& group : groups_)
+		{
+			for (i = 0; i < group.keys.size(); i++)
+			{
+				if (i < group.result.arr_size())
+					value[group.keys[i]] = std::move(group.result[i]);
+			}
+		}
+
+		break;
+
+	case REDIS_MULTI_KEY_MSET:
+		value.set_status("OK");
+		break;
+
+	default:
+		for (RedisClusterGroup& group : groups_)
+			sum += group.result.int_value();
+
+		value.set_int(sum);
+		break;
+	}
+
+	this->resp.set_result(value);
+	this->state = WFT_STATE_SUCCESS;
+}
+
+int WFRedisClusterClient::init(const std::string& url)
+{
+	static std::atomic<int> seq(0);
+	std::string name;
+	std::string seed;
+	ParsedURI uri;
+
+	if (URIParser::parse(url, uri) < 0)
+	{
+		if (uri.state == URI_STATE_INVALID)
+			errno = EINVAL;
+
+		return -1;
+	}
+
+	if (!uri.scheme || !uri.host || !uri.host[0] ||
+		(strcasecmp(uri.scheme, "redis") != 0 &&
+		 strcasecmp(uri.scheme, "rediss") != 0))
+	{
+		errno = EINVAL;
+		return -1;
+	}
+
+	seed = __redis_node(uri.host, uri.port ? atoi(uri.port) : 6379);
+	name = "redis.cluster." + std::to_string(++seq);
+	if (UpstreamManager::upstream_create_weighted_random(name, true) < 0)
+		return -1;
+
+	UpstreamManager::upstream_add_server(name, seed);
+	this->member = new RedisClusterMember;
+	this->member->seed_host = uri.host;
+	this->member->upstream_name = name;
+	this->member->masters.insert(seed);
+
+	/* Keyless requests and slot reloading go to the upstream of all the
+	 * masters, which skips the failed ones. */
+	free(uri.host);
+	free(uri.port);
+	uri.host = strdup(name.c_str());
+	uri.port = NULL;
+	if (!uri.host)
+	{
+		UpstreamManager::upstream_delete(name);
+		this->member->decref();
+		return -1;
+	}
+
+	this->member->uri = std::move(uri);
+	this->member->refresh();
+	return 0;
+}
+
+void WFRedisClusterClient::deinit()
+{
+	UpstreamManager::upstream_delete(this->member->upstream_name);
+	this->member->decref();
+}
+
+void WFRedisClusterClient::refresh()
+{
+	this->member->refresh();
+}
+
+WFRedisTask *WFRedisClusterClient::create_redis_task(int retry_max,
+													 redis_callback_t callback)
+{
+	return __WFRedisTaskFactory::create_cluster_task(this->member->uri,
+													 retry_max, this->member,
+													 std::move(callback));
+}
+
+WFRedisTask *
+WFRedisClusterClient::create_redis_task(const std::string& command,
+										const std::vector<std::string>& params,
+										int retry_max,
+										redis_callback_t callback)
+{
+	int type = __redis_multi_key_type(command);
+	size_t step = (type == REDIS_MULTI_KEY_MSET ? 2 : 1);
+	std::vector<RedisClusterGroup> groups;
+	std::map<int, size_t> slot_group;
+	WFRedisTask *task;
+	size_t i, j;
+	int slot;
+
+	if (type != REDIS_MULTI_KEY_NONE && params.size() > step &&
+		params.size() % step == 0)
+	{
+		for (i = 0; i < params.size(); i += step)
+		{
+			slot = WFRedisClusterClient::key_slot(params[i]);
+			auto it = slot_group.emplace(slot, groups.size());
+			if (it.second)
+				groups.emplace_back();
+
+			RedisClusterGroup& group = groups[it.first->second];
+			group.keys.push_back(i / step);
+			for (j = 0; j < step; j++)
+				group.params.push_back(params[i + j]);
+		}
+
+		if (groups.size() > 1)
+		{
+			task = new RedisClusterMultiTask(this->member, type, command,
+											 std::move(groups),
+											 params.size() / step, retry_max,
+											 std::move(callback));
+			task->get_req()->set_request(command, params);
+			return task;
+		}
+	}
+
+	task = this->create_redis_task(retry_max, std::move(callback));
+	task->get_req()->set_request(command, params);
+	return task;
+}
+
+/* CRC16-CCITT (XMODEM), as used by Redis Cluster. */
+static const uint16_t __crc16_table[256] = {
+	0x0000, 0x1021, 0x2042, 0x3063, 0x4084, 0x50a5, 0x60c6, 0x70e7,
+	0x8108, 0x9129, 0xa14a, 0xb16b, 0xc18c, 0xd1ad, 0xe1ce, 0xf1ef,
+	0x1231, 0x0210, 0x3273, 0x2252, 0x52b5, 0x4294, 0x72f7, 0x62d6,
+	0x9339, 0x8318, 0xb37b, 0xa35a, 0xd3bd, 0xc39c, 0xf3ff, 0xe3de,
+	0x2462, 0x3443, 0x0420, 0x1401, 0x64e6, 0x74c7, 0x44a4, 0x5485,
+	0xa56a, 0xb54b, 0x8528, 0x9509, 0xe5ee, 0xf5cf, 0xc5ac, 0xd58d,
+	0x3653, 0x2672, 0x1611, 0x0630, 0x76d7, 0x66f6, 0x5695, 0x46b4,
+	0xb75b, 0xa77a, 0x9719, 0x8738, 0xf7df, 0xe7fe, 0xd79d, 0xc7bc,
+	0x48c4, 0x58e5, 0x6886, 0x78a7, 0x0840, 0x1861, 0x2802, 0x3823,
+	0xc9cc, 0xd9ed, 0xe98e, 0xf9af, 0x8948, 0x9969, 0xa90a, 0xb92b,
+	0x5af5, 0x4ad4, 0x7ab7, 0x6a96, 0x1a71, 0x0a50, 0x3a33, 0x2a12,
+	0xdbfd, 0xcbdc, 0xfbbf, 0xeb9e, 0x9b79, 0x8b58, 0xbb3b, 0xab1a,
+	0x6ca6, 0x7c87, 0x4ce4, 0x5cc5, 0x2c22, 0x3c03, 0x0c60, 0x1c41,
+	0xedae, 0xfd8f, 0xcdec, 0xddcd, 0xad2a, 0xbd0b, 0x8d68, 0x9d49,
+	0x7e97, 0x6eb6, 0x5ed5, 0x4ef4, 0x3e13, 0x2e32, 0x1e51, 0x0e70,
+	0xff9f, 0xefbe, 0xdfdd, 0xcffc, 0xbf1b, 0xaf3a, 0x9f59, 0x8f78,
+	0x9188, 0x81a9, 0xb1ca, 0xa1eb, 0xd10c, 0xc12d, 0xf14e, 0xe16f,
+	0x1080, 0x00a1, 0x30c2, 0x20e3, 0x5004, 0x4025, 0x7046, 0x6067,
+	0x83b9, 0x9398, 0xa3fb, 0xb3da, 0xc33d, 0xd31c, 0xe37f, 0xf35e,
+	0x02b1, 0x1290, 0x22f3, 0x32d2, 0x4235, 0x5214, 0x6277, 0x7256,
+	0xb5ea, 0xa5cb, 0x95a8, 0x8589, 0xf56e, 0xe54f, 0xd52c, 0xc50d,
+	0x34e2, 0x24c3, 0x14a0, 0x0481, 0x7466, 0x6447, 0x5424, 0x4405,
+	0xa7db, 0xb7fa, 0x8799, 0x97b8, 0xe75f, 0xf77e, 0xc71d, 0xd73c,
+	0x26d3, 0x36f2, 0x0691, 0x16b0, 0x6657, 0x7676, 0x4615, 0x5634,
+	0xd94c, 0xc96d, 0xf90e, 0xe92f, 0x99c8, 0x89e9, 0xb98a, 0xa9ab,
+	0x5844, 0x4865, 0x7806, 0x6827, 0x18c0, 0x08e1, 0x3882, 0x28a3,
+	0xcb7d, 0xdb5c, 0xeb3f, 0xfb1e, 0x8bf9, 0x9bd8, 0xabbb, 0xbb9a,
+	0x4a75, 0x5a54, 0x6a37, 0x7a16, 0x0af1, 0x1ad0, 0x2ab3, 0x3a92,
+	0xfd2e, 0xed0f, 0xdd6c, 0xcd4d, 0xbdaa, 0xad8b, 0x9de8, 0x8dc9,
+	0x7c26, 0x6c07, 0x5c64, 0x4c45, 0x3ca2, 0x2c83, 0x1ce0, 0x0cc1,
+	0xef1f, 0xff3e, 0xcf5d, 0xdf7c, 0xaf9b, 0xbfba, 0x8fd9, 0x9ff8,
+	0x6e17, 0x7e36, 0x4e55, 0x5e74, 0x2e93, 0x3eb2, 0x0ed1, 0x1ef0,
+};
+
+static inline uint16_t __crc16(const char *buf, size_t len)
+{
+	uint16_t crc = 0;
+	size_t i;
+
+	for (i = 0; i < len; i++)
+		crc = (crc << 8) ^ __crc16_table[(crc >> 8 ^ buf[i]) & 0xff];
+
+	return crc;
+}
+
+int WFRedisClusterClient::key_slot(const char *key, size_t len)
+{
+	const char *start = (const char *)memchr(key, '{', len);
+	const char *end;
+
+	/* Only the first '{' counts, and the tag must not be empty. */
+	if (start)
+	{
+		start++;
+		end = (const char *)memchr(start, '}', key + len - start);
+		if (end && end > start)
+			return __crc16(start, end - start) & (REDIS_CLUSTER_SLOTS - 1);
+	}
+
+	return __crc16(key, len) & (REDIS_CLUSTER_SLOTS - 1);
+}
+
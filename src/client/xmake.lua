@@ -4,9 +4,13 @@ target("client")
     remove_files("WFKafkaClient.cc")
     if not has_config("redis") then
         remove_files("WFRedisSubscriber.cc")
+        remove_files("WFRedisClusterClient.cc")
+        remove_files("WFRedisCachingClient.cc")
     end
     if not has_config("mysql") then
         remove_files("WFMySQLConnection.cc")
+        remove_files("WFMySQLStreamClient.cc")
+        remove_files("WFMySQLClient.cc")
     end
     if not has_config("consul") then
         remove_files("WFConsulClient.cc")
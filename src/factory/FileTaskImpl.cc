@@ -17,12 +17,331 @@
            Li Jinghao (lijinghao@sogou-inc.com)
 */
 
+#include <sys/stat.h>
+#include <errno.h>
 #include <fcntl.h>
+#include <stdint.h>
+#include <stdlib.h>
 #include <unistd.h>
 #include <string>
+#include <vector>
+#include <map>
+#include <mutex>
+#include <chrono>
+#include <utility>
+#include "list.h"
+#include "Executor.h"
 #include "WFGlobal.h"
 #include "WFTaskFactory.h"
 
+#define DIRECT_ALIGNMENT		4096
+#define DIRECT_CLASS_MAX		10	/* 4KB << 10 == 4MB */
+#define DIRECT_CACHE_BYTES		(32 * 1024 * 1024)
+
+class __DirectBufferPool
+{
+public:
+	static __DirectBufferPool *get_instance()
+	{
+		static __DirectBufferPool kInstance;
+		return &kInstance;
+	}
+
+	void *get(size_t size)
+	{
+		int idx = __DirectBufferPool::size_class(&size);
+		void *buf;
+
+		if (idx <= DIRECT_CLASS_MAX)
+		{
+			std::lock_guard<std::mutex> lock(this->mutex);
+
+			if (!this->free_list[idx].empty())
+			{
+				buf = this->free_list[idx].back();
+				this->free_list[idx].pop_back();
+				return buf;
+			}
+		}
+
+		errno = posix_memalign(&buf, DIRECT_ALIGNMENT, size);
+		return errno == 0 ? buf : NULL;
+	}
+
+	void put(void *buf, size_t size)
+	{
+		int idx = __DirectBufferPool::size_class(&size);
+
+		if (idx <= DIRECT_CLASS_MAX)
+		{
+			std::lock_guard<std::mutex> lock(this->mutex);
+
+			if (this->free_list[idx].size() < DIRECT_CACHE_BYTES / size)
+			{
+				this->free_list[idx].push_back(buf);
+				return;
+			}
+		}
+
+		free(buf);
+	}
+
+private:
+	/* Round up 'size' to its class, and return the index of the class. */
+	static int size_class(size_t *size)
+	{
+		size_t n = DIRECT_ALIGNMENT;
+		int idx = 0;
+
+		while (n < *size && idx <= DIRECT_CLASS_MAX)
+		{
+			n <<= 1;
+			idx++;
+		}
+
+		if (idx <= DIRECT_CLASS_MAX)
+			*size = n;
+		else
+			*size = (*size + DIRECT_ALIGNMENT - 1) & ~(size_t)(DIRECT_ALIGNMENT - 1);
+
+		return idx;
+	}
+
+	~__DirectBufferPool()
+	{
+		for (int i = 0; i <= DIRECT_CLASS_MAX; i++)
+		{
+			for (void *buf : this->free_list[i])
+				free(buf);
+		}
+	}
+
+private:
+	std::vector<void *> free_list[DIRECT_CLASS_MAX + 1];
+	std::mutex mutex;
+};
+
+#define GET_CURRENT_SECOND	std::chrono::duration_cast<std::chrono::seconds>(std::chrono::steady_clock::now().time_since_epoch()).count()
+#define GET_CURRENT_MS		std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now().time_since_epoch()).count()
+
+#define FD_CACHE_IDLE_TIMEOUT	10		/* seconds */
+#define FD_CACHE_IDLE_MAX		1024
+#define FD_CACHE_CHECK_INTERVAL	1000	/* milliseconds */
+
+struct __FileCacheEntry
+{
+	std::pair<std::string, int> key;
+	int fd;
+	int ref;
+	bool stale;
+	struct stat st;
+	int64_t check_time;
+	int64_t idle_time;
+	struct list_head list;
+};
+
+/* File descriptors of the path read tasks, keyed by path name and flags.
+ * A cached fd is shared without any system call for FD_CACHE_CHECK_INTERVAL
+ * after it is checked. Then the next task checks it in a fio thread, and it
+ * is shared again only if stat() of the path still shows the file it was
+ * opened on, unchanged. So a file replaced or modified under the same path
+ * is read through an old fd for at most that long. Unused fds are closed
+ * after FD_CACHE_IDLE_TIMEOUT seconds, checked when the cache is accessed. */
+class __FileCache
+{
+public:
+	static __FileCache *get_instance()
+	{
+		static __FileCache kInstance;
+		return &kInstance;
+	}
+
+	/* Return NULL if not cached, or if the cached fd is due for a check. */
+	__FileCacheEntry *get(const std::string& path, int flags)
+	{
+		int64_t cur = GET_CURRENT_MS;
+		__FileCacheEntry *entry = NULL;
+
+		this->mutex.lock();
+		auto it = this->map.find(std::make_pair(path, flags));
+		if (it != this->map.end() &&
+			cur - it->second->check_time < FD_CACHE_CHECK_INTERVAL)
+		{
+			entry = it->second;
+			this->acquire_locked(entry);
+		}
+
+		this->mutex.unlock();
+		return entry;
+	}
+
+	/* Check the cached fd, or open the file and add it to the cache.
+	 * Called by the fio threads. */
+	__FileCacheEntry *open(const std::string& path, int flags)
+	{
+		__FileCacheEntry *entry;
+		__FileCacheEntry *old;
+		LIST_HEAD(closing);
+		struct stat st;
+		int fd;
+
+		/* Let open() report the error of a missing file. */
+		if (stat(path.c_str(), &st) >= 0)
+		{
+			entry = NULL;
+			this->mutex.lock();
+			auto it = this->map.find(std::make_pair(path, flags));
+			if (it != this->map.end() &&
+				__FileCache::same_file(&it->second->st, &st))
+			{
+				entry = it->second;
+				entry->check_time = GET_CURRENT_MS;
+				this->acquire_locked(entry);
+			}
+
+			this->mutex.unlock();
+			if (entry)
+				return entry;
+		}
+
+		fd = ::open(path.c_str(), flags);
+		if (fd < 0)
+			return NULL;
+
+		if (fstat(fd, &st) < 0)
+		{
+			close(fd);
+			return NULL;
+		}
+
+		entry = new __FileCacheEntry;
+		entry->key = std::make_pair(path, flags);
+		entry->fd = fd;
+		entry->ref = 1;
+		entry->stale = false;
+		entry->st = st;
+		entry->check_time = GET_CURRENT_MS;
+
+		this->mutex.lock();
+		auto ret = this->map.emplace(entry->key, entry);
+		if (!ret.second)
+		{
+			old = ret.first->second;
+			if (__FileCache::same_file(&old->st, &st))
+			{
+				/* Opened by another task at the same time. */
+				old->check_time = entry->check_time;
+				this->acquire_locked(old);
+				list_add(&entry->list, &closing);
+				entry = old;
+			}
+			else
+			{
+				ret.first->second = entry;
+				this->remove_locked(old, &closing);
+			}
+		}
+
+		this->mutex.unlock();
+		__FileCache::close_entries(&closing);
+		return entry;
+	}
+
+	void release(__FileCacheEntry *entry)
+	{
+		int64_t cur = GET_CURRENT_SECOND;
+		LIST_HEAD(closing);
+
+		this->mutex.lock();
+		if (--entry->ref == 0)
+		{
+			if (entry->stale)
+				list_add(&entry->list, &closing);
+			else
+			{
+				entry->idle_time = cur;
+				list_add_tail(&entry->list, &this->idle_list);
+				this->idle_cnt++;
+			}
+		}
+
+		while (!list_empty(&this->idle_list))
+		{
+			entry = list_entry(this->idle_list.next, __FileCacheEntry, list);
+			if (this->idle_cnt <= FD_CACHE_IDLE_MAX &&
+				cur - entry->idle_time < FD_CACHE_IDLE_TIMEOUT)
+				break;
+
+			this->map.erase(entry->key);
+			list_move(&entry->list, &closing);
+			this->idle_cnt--;
+		}
+
+		this->mutex.unlock();
+		__FileCache::close_entries(&closing);
+	}
+
+private:
+	/* Same file, and not written since. Times are compared in seconds. */
+	static bool same_file(const struct stat *a, const struct stat *b)
+	{
+		return a->st_dev == b->st_dev && a->st_ino == b->st_ino &&
+			   a->st_size == b->st_size && a->st_mtime == b->st_mtime &&
+			   a->st_ctime == b->st_ctime;
+	}
+
+	void acquire_locked(__FileCacheEntry *entry)
+	{
+		if (entry->ref++ == 0)
+		{
+			list_del(&entry->list);
+			this->idle_cnt--;
+		}
+	}
+
+	/* The entry has been taken out of the map. */
+	void remove_locked(__FileCacheEntry *entry, struct list_head *closing)
+	{
+		if (entry->ref == 0)
+		{
+			list_move(&entry->list, closing);
+			this->idle_cnt--;
+		}
+		else
+			entry->stale = true;
+	}
+
+	static void close_entries(struct list_head *closing)
+	{
+		struct list_head *pos, *tmp;
+		__FileCacheEntry *entry;
+
+		list_for_each_safe(pos, tmp, closing)
+		{
+			entry = list_entry(pos, __FileCacheEntry, list);
+			close(entry->fd);
+			delete entry;
+		}
+	}
+
+	__FileCache()
+	{
+		INIT_LIST_HEAD(&this->idle_list);
+		this->idle_cnt = 0;
+	}
+
+	~__FileCache()
+	{
+		__FileCache::close_entries(&this->idle_list);
+	}
+
+private:
+	std::map<std::pair<std::string, int>, __FileCacheEntry *> map;
+	struct list_head idle_list;
+	size_t idle_cnt;
+	std::mutex mutex;
+};
+
 class WFFilepreadTask : public WFFileIOTask
 {
 public:
@@ -145,85 +464,179 @@ protected:
 	}
 };
 
-/* File tasks created with path name. */
-
-class __WFFilepreadTask : public WFFilepreadTask
+class WFFileDirectpreadTask : public WFFileIOTask
 {
 public:
-	__WFFilepreadTask(const std::string& path, void *buf, size_t count,
-					  off_t offset, IOService *service, fio_callback_t&& cb):
-		WFFilepreadTask(-1, buf, count, offset, service, std::move(cb)),
-		pathname(path)
+	WFFileDirectpreadTask(int fd, size_t count, off_t offset,
+						  IOService *service, fio_callback_t&& cb) :
+		WFFileIOTask(service, std::move(cb))
 	{
+		this->args.fd = fd;
+		this->args.buf = NULL;
+		this->args.count = count;
+		this->args.offset = offset;
+		this->buf = NULL;
+	}
+
+	virtual ~WFFileDirectpreadTask()
+	{
+		if (this->buf)
+			__DirectBufferPool::get_instance()->put(this->buf, this->size);
 	}
 
 protected:
 	virtual int prepare()
 	{
-		this->args.fd = open(this->pathname.c_str(), O_RDONLY);
-		if (this->args.fd < 0)
+		off_t begin = this->args.offset & ~(off_t)(DIRECT_ALIGNMENT - 1);
+		off_t end = this->args.offset + this->args.count;
+
+		if (this->args.offset < 0 || end < this->args.offset)
+		{
+			errno = EINVAL;
+			return -1;
+		}
+
+		end = (end + DIRECT_ALIGNMENT - 1) & ~(off_t)(DIRECT_ALIGNMENT - 1);
+		this->size = end - begin;
+		this->buf = __DirectBufferPool::get_instance()->get(this->size);
+		if (!this->buf)
 			return -1;
 
-		return WFFilepreadTask::prepare();
+		this->args.buf = (char *)this->buf + (this->args.offset - begin);
+		this->prep_pread(this->args.fd, this->buf, this->size, begin);
+		return 0;
 	}
 
-	virtual SubTask *done()
+	/* Make the result count from 'offset' instead of the aligned begin. */
+	virtual void handle(int state, int error)
 	{
-		if (this->args.fd >= 0)
+		long n;
+
+		if (state == IOS_STATE_SUCCESS)
 		{
-			close(this->args.fd);
-			this->args.fd = -1;
+			n = this->get_res() - ((char *)this->args.buf - (char *)this->buf);
+			if (n < 0)
+				n = 0;
+			else if ((size_t)n > this->args.count)
+				n = this->args.count;
+
+			this->set_res(n);
 		}
 
-		return WFFilepreadTask::done();
+		WFFileIOTask::handle(state, error);
 	}
 
-protected:
-	std::string pathname;
+private:
+	void *buf;
+	size_t size;
 };
 
-class __WFFilepwriteTask : public WFFilepwriteTask
+/* File tasks created with path name. Reading tasks share the cached fds,
+ * and a file not cached is opened by the fio threads. */
+
+template<class TASK, int FLAGS>
+class __WFFilePathTask : public TASK
 {
 public:
-	__WFFilepwriteTask(const std::string& path, const void *buf, size_t count,
-					  off_t offset, IOService *service, fio_callback_t&& cb):
-		WFFilepwriteTask(-1, buf, count, offset, service, std::move(cb)),
-		pathname(path)
+	template<class... ARGS>
+	__WFFilePathTask(const std::string& path, ARGS&&... args) :
+		TASK(-1, std::forward<ARGS>(args)...),
+		pathname(path),
+		opener(this)
 	{
+		this->entry = NULL;
 	}
 
 protected:
-	virtual int prepare()
+	virtual void dispatch()
 	{
-		this->args.fd = open(this->pathname.c_str(), O_WRONLY | O_CREAT, 0644);
-		if (this->args.fd < 0)
-			return -1;
+		Executor *executor;
 
-		return WFFilepwriteTask::prepare();
+		this->entry = __FileCache::get_instance()->get(this->pathname, FLAGS);
+		if (this->entry)
+			this->open_done(0);
+		else
+		{
+			executor = WFGlobal::get_fio_executor();
+			if (executor->request(&this->opener, WFGlobal::get_fio_queue()) < 0)
+				this->handle(IOS_STATE_ERROR, errno);
+		}
 	}
 
 	virtual SubTask *done()
 	{
-		if (this->args.fd >= 0)
+		if (this->entry)
 		{
-			close(this->args.fd);
+			__FileCache::get_instance()->release(this->entry);
+			this->entry = NULL;
 			this->args.fd = -1;
 		}
 
-		return WFFilepwriteTask::done();
+		return TASK::done();
+	}
+
+private:
+	void open_done(int error)
+	{
+		if (this->entry)
+		{
+			this->args.fd = this->entry->fd;
+			TASK::dispatch();
+		}
+		else
+			this->handle(IOS_STATE_ERROR, error);
 	}
 
 protected:
 	std::string pathname;
+	__FileCacheEntry *entry;
+
+private:
+	class Opener : public ExecSession
+	{
+	public:
+		Opener(__WFFilePathTask *task) { this->task = task; }
+
+	private:
+		virtual void execute()
+		{
+			__FileCache *cache = __FileCache::get_instance();
+
+			this->task->entry = cache->open(this->task->pathname, FLAGS);
+			this->error = errno;
+		}
+
+		virtual void handle(int state, int error)
+		{
+			if (state == ES_STATE_FINISHED)
+				error = this->error;
+			else if (state == ES_STATE_CANCELED)
+				error = ECANCELED;
+
+			this->task->open_done(error);
+		}
+
+	private:
+		__WFFilePathTask *task;
+		int error;
+	} opener;
 };
 
-class __WFFilepreadvTask : public WFFilepreadvTask
+#ifndef O_DIRECT
+# define O_DIRECT	0
+#endif
+
+using __WFFilepreadTask = __WFFilePathTask<WFFilepreadTask, O_RDONLY>;
+using __WFFilepreadvTask = __WFFilePathTask<WFFilepreadvTask, O_RDONLY>;
+using __WFFileDirectpreadTask = __WFFilePathTask<WFFileDirectpreadTask,
+												 O_RDONLY | O_DIRECT>;
+
+class __WFFilepwriteTask : public WFFilepwriteTask
 {
 public:
-	__WFFilepreadvTask(const std::string& path, const struct iovec *iov,
-					   int iovcnt, off_t offset, IOService *service,
-					   fvio_callback_t&& cb) :
-		WFFilepreadvTask(-1, iov, iovcnt, offset, service, std::move(cb)),
+	__WFFilepwriteTask(const std::string& path, const void *buf, size_t count,
+					  off_t offset, IOService *service, fio_callback_t&& cb):
+		WFFilepwriteTask(-1, buf, count, offset, service, std::move(cb)),
 		pathname(path)
 	{
 	}
@@ -231,11 +644,11 @@ public:
 protected:
 	virtual int prepare()
 	{
-		this->args.fd = open(this->pathname.c_str(), O_RDONLY);
+		this->args.fd = open(this->pathname.c_str(), O_WRONLY | O_CREAT, 0644);
 		if (this->args.fd < 0)
 			return -1;
 
-		return WFFilepreadvTask::prepare();
+		return WFFilepwriteTask::prepare();
 	}
 
 	virtual SubTask *done()
@@ -246,7 +659,7 @@ protected:
 			this->args.fd = -1;
 		}
 
-		return WFFilepreadvTask::done();
+		return WFFilepwriteTask::done();
 	}
 
 protected:
@@ -398,3 +811,35 @@ WFFileVIOTask *WFTaskFactory::create_pwritev_task(const std::string& path,
 								   std::move(callback));
 }
 
+/* Direct I/O. */
+
+WFFileIOTask *WFTaskFactory::create_direct_pread_task(int fd,
+													  size_t count,
+													  off_t offset,
+													  fio_callback_t callback)
+{
+	return new WFFileDirectpreadTask(fd, count, offset,
+									 WFGlobal::get_io_service(),
+									 std::move(callback));
+}
+
+WFFileIOTask *WFTaskFactory::create_direct_pread_task(const std::string& path,
+													  size_t count,
+													  off_t offset,
+													  fio_callback_t callback)
+{
+	return new __WFFileDirectpreadTask(path, count, offset,
+									   WFGlobal::get_io_service(),
+									   std::move(callback));
+}
+
+void *WFTaskFactory::alloc_direct_buffer(size_t size)
+{
+	return __DirectBufferPool::get_instance()->get(size);
+}
+
+void WFTaskFactory::free_direct_buffer(void *buf, size_t size)
+{
+	__DirectBufferPool::get_instance()->put(buf, size);
+}
+
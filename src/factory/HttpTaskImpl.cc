@@ -19,10 +19,12 @@
            Li Yingxin (liyingxin@sogou-inc.com)
 */
 
+#include <ctype.h>
 #include <stdlib.h>
 #include <stdio.h>
 #include <string.h>
 #include <string>
+#include <mutex>
 #include <openssl/ssl.h>
 #include <openssl/bio.h>
 #include <openssl/evp.h>
@@ -39,6 +41,7 @@ using namespace protocol;
 
 #define HTTP_KEEPALIVE_DEFAULT	(60 * 1000)
 #define HTTP_KEEPALIVE_MAX		(300 * 1000)
+#define HTTP_100_RESP			"HTTP/1.1 100 Continue\r\n\r\n"
 
 /**********Client**********/
 
@@ -1223,6 +1226,423 @@ CommMessageOut *WFHttpServerTask::message_out()
 	return this->WFServerTask::message_out();
 }
 
+/**********Stream Server**********/
+
+class WFHttpStreamServerTask : public WFHttpServerTask
+{
+private:
+	using extract_t = std::function<void (WFHttpTask *, const void *, size_t)>;
+
+public:
+	void pause();
+	void resume();
+
+protected:
+	virtual CommMessageIn *message_in();
+	virtual void handle(int state, int error);
+
+private:
+	void stream_process();
+
+protected:
+	class BodyMessage : public ProtocolMessage
+	{
+	protected:
+		virtual int append(const void *buf, size_t *size);
+
+	private:
+		int append_chunked(const void *buf, size_t *size);
+
+	private:
+		enum
+		{
+			BODY_LENGTH,
+			CHUNK_SIZE,
+			CHUNK_EXT,
+			CHUNK_SIZE_LF,
+			CHUNK_DATA,
+			CHUNK_DATA_CR,
+			CHUNK_DATA_LF,
+			CHUNK_TRAILER,
+			CHUNK_TRAILER_LINE,
+			CHUNK_END_LF,
+		};
+
+		int state_;
+		bool has_size_;
+		size_t left_;
+		std::string piece_;
+		WFHttpStreamServerTask *task_;
+
+	public:
+		void init(size_t content_length)
+		{
+			state_ = BODY_LENGTH;
+			left_ = content_length;
+		}
+
+		void init_chunked()
+		{
+			state_ = CHUNK_SIZE;
+			has_size_ = false;
+			left_ = 0;
+		}
+
+	public:
+		BodyMessage(WFHttpStreamServerTask *task)
+		{
+			task_ = task;
+		}
+	};
+
+	class StreamWrapper : public PackageWrapper
+	{
+	protected:
+		virtual ProtocolMessage *next_in(ProtocolMessage *msg);
+
+	public:
+		int pause_reading() { return this->pause(); }
+		int resume_reading() { return this->resume(); }
+
+	protected:
+		WFHttpStreamServerTask *task_;
+
+	public:
+		StreamWrapper(WFHttpStreamServerTask *task) :
+			PackageWrapper(NULL)
+		{
+			task_ = task;
+		}
+
+		friend class WFHttpStreamServerTask;
+	};
+
+	/* Run process() in the thread that resumes the task. */
+	class DeferredProcess : public SubTask
+	{
+	protected:
+		virtual void dispatch()
+		{
+			task_->processor.task = task_;
+			task_->process_(task_);
+			task_->processor.task = NULL;
+			this->subtask_done();
+		}
+
+		virtual SubTask *done()
+		{
+			SeriesWork *series = series_of(this);
+
+			delete this;
+			return series->pop();
+		}
+
+	protected:
+		WFHttpStreamServerTask *task_;
+
+	public:
+		DeferredProcess(WFHttpStreamServerTask *task)
+		{
+			task_ = task;
+		}
+	};
+
+protected:
+	std::function<void (WFHttpTask *)>& process_;
+	extract_t& extract_;
+	std::function<void (WFHttpTask *)> stream_process_;
+	BodyMessage body_;
+	StreamWrapper wrapper_;
+	std::mutex mutex_;
+	bool paused_;
+	bool complete_;
+	bool failed_;
+	WFConditional *cond_;
+
+public:
+	WFHttpStreamServerTask(CommService *service,
+						   std::function<void (WFHttpTask *)>& proc,
+						   extract_t& extract) :
+		WFHttpServerTask(service, stream_process_),
+		process_(proc),
+		extract_(extract),
+		stream_process_([this](WFHttpTask *) { this->stream_process(); }),
+		body_(this),
+		wrapper_(this)
+	{
+		paused_ = false;
+		complete_ = false;
+		failed_ = false;
+		cond_ = NULL;
+	}
+};
+
+int WFHttpStreamServerTask::BodyMessage::append(const void *buf, size_t *size)
+{
+	int ret = 0;
+
+	if (state_ != BODY_LENGTH)
+		return this->append_chunked(buf, size);
+
+	if (*size >= left_)
+	{
+		*size = left_;
+		ret = 1;
+	}
+
+	left_ -= *size;
+	if (*size != 0)
+		task_->extract_(task_, buf, *size);
+
+	return ret;
+}
+
+/* All the data of one append() are passed to extract() at a time, so that
+ * a pause() in extract() stops reading before any further data. */
+int WFHttpStreamServerTask::BodyMessage::append_chunked(const void *buf,
+														size_t *size)
+{
+	const char *p = (const char *)buf;
+	const char *end = p + *size;
+	const char *data = NULL;
+	size_t len = 0;
+	size_t n;
+	int ret = 0;
+	int c;
+
+	while (p < end && ret == 0)
+	{
+		switch (state_)
+		{
+		case CHUNK_DATA:
+			n = end - p;
+			if (n > left_)
+				n = left_;
+
+			if (len == 0)
+				data = p;
+			else
+			{
+				if (data != piece_.data())
+					piece_.assign(data, len);
+
+				piece_.append(p, n);
+				data = piece_.data();
+			}
+
+			len += n;
+			left_ -= n;
+			p += n;
+			if (left_ == 0)
+				state_ = CHUNK_DATA_CR;
+
+			continue;
+
+		case CHUNK_SIZE:
+			c = *p;
+			if (isxdigit(c))
+			{
+				if (left_ > ((size_t)-1 >> 4))
+				{
+					errno = EMSGSIZE;
+					return -1;
+				}
+
+				c = isdigit(c) ? c - '0' : tolower(c) - 'a' + 10;
+				left_ = (left_ << 4) + c;
+				has_size_ = true;
+			}
+			else if (has_size_ && (c == ';' || c == ' ' || c == '\t'))
+				state_ = CHUNK_EXT;
+			else if (has_size_ && c == '\r')
+				state_ = CHUNK_SIZE_LF;
+			else
+				ret = -1;
+
+			break;
+
+		case CHUNK_EXT:
+			if (*p == '\r')
+				state_ = CHUNK_SIZE_LF;
+
+			break;
+
+		case CHUNK_SIZE_LF:
+			if (*p != '\n')
+				ret = -1;
+			else if (left_ != 0)
+				state_ = CHUNK_DATA;
+			else
+				state_ = CHUNK_TRAILER;
+
+			break;
+
+		case CHUNK_DATA_CR:
+			if (*p == '\r')
+				state_ = CHUNK_DATA_LF;
+			else
+				ret = -1;
+
+			break;
+
+		case CHUNK_DATA_LF:
+			if (*p == '\n')
+				this->init_chunked();
+			else
+				ret = -1;
+
+			break;
+
+		case CHUNK_TRAILER:
+			if (*p == '\r')
+				state_ = CHUNK_END_LF;
+			else
+				state_ = CHUNK_TRAILER_LINE;
+
+			break;
+
+		case CHUNK_TRAILER_LINE:
+			if (*p == '\n')
+				state_ = CHUNK_TRAILER;
+
+			break;
+
+		case CHUNK_END_LF:
+			if (*p == '\n')
+				ret = 1;
+			else
+				ret = -1;
+
+			break;
+		}
+
+		p++;
+	}
+
+	if (ret < 0)
+	{
+		errno = EBADMSG;
+		return -1;
+	}
+
+	*size = p - (const char *)buf;
+	if (len != 0)
+		task_->extract_(task_, data, len);
+
+	piece_.clear();
+	return ret;
+}
+
+ProtocolMessage *
+WFHttpStreamServerTask::StreamWrapper::next_in(ProtocolMessage *msg)
+{
+	HttpRequest *req = task_->get_req();
+
+	if (msg == req)
+	{
+		http_parser_t *parser = (http_parser_t *)req->get_parser();
+
+		if (parser->expect_continue)
+			this->feedback(HTTP_100_RESP, strlen(HTTP_100_RESP));
+
+		if (req->is_chunked())
+		{
+			task_->body_.init_chunked();
+			return &task_->body_;
+		}
+
+		if (parser->content_length != 0)
+		{
+			task_->body_.init(parser->content_length);
+			return &task_->body_;
+		}
+	}
+
+	task_->mutex_.lock();
+	task_->complete_ = true;
+	task_->mutex_.unlock();
+	return NULL;
+}
+
+CommMessageIn *WFHttpStreamServerTask::message_in()
+{
+	this->req.parse_zero_body();
+	wrapper_.set_message(&this->req);
+	return &wrapper_;
+}
+
+void WFHttpStreamServerTask::handle(int state, int error)
+{
+	if (state != WFT_STATE_TOREPLY && this->state != WFT_STATE_TOREPLY)
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+
+		/* Deleted by resume(). */
+		if (paused_)
+		{
+			failed_ = true;
+			return;
+		}
+	}
+
+	this->WFHttpServerTask::handle(state, error);
+}
+
+void WFHttpStreamServerTask::stream_process()
+{
+	mutex_.lock();
+	if (paused_)
+	{
+		cond_ = WFTaskFactory::create_conditional(new DeferredProcess(this));
+		series_of(&this->processor)->push_front(cond_);
+		mutex_.unlock();
+		return;
+	}
+
+	mutex_.unlock();
+	process_(this);
+}
+
+void WFHttpStreamServerTask::pause()
+{
+	std::lock_guard<std::mutex> lock(mutex_);
+
+	if (!paused_ && !complete_ && wrapper_.pause_reading() >= 0)
+		paused_ = true;
+}
+
+void WFHttpStreamServerTask::resume()
+{
+	WFConditional *cond = NULL;
+
+	mutex_.lock();
+	if (!paused_)
+	{
+		mutex_.unlock();
+		return;
+	}
+
+	paused_ = false;
+	if (failed_)
+	{
+		mutex_.unlock();
+		delete this;
+		return;
+	}
+
+	if (!complete_)
+		wrapper_.resume_reading();
+	else
+	{
+		cond = cond_;
+		cond_ = NULL;
+	}
+
+	mutex_.unlock();
+	if (cond)
+		cond->signal(NULL);
+}
+
 /**********Server Factory**********/
 
 WFHttpTask *WFServerTaskFactory::create_http_task(CommService *service,
@@ -1231,3 +1651,20 @@ WFHttpTask *WFServerTaskFactory::create_http_task(CommService *service,
 	return new WFHttpServerTask(service, process);
 }
 
+WFHttpTask *__WFHttpTaskFactory::create_stream_server_task(CommService *service,
+							std::function<void (WFHttpTask *)>& process,
+							stream_extract_t& extract)
+{
+	return new WFHttpStreamServerTask(service, process, extract);
+}
+
+void __WFHttpTaskFactory::pause_stream_server_task(WFHttpTask *task)
+{
+	static_cast<WFHttpStreamServerTask *>(task)->pause();
+}
+
+void __WFHttpTaskFactory::resume_stream_server_task(WFHttpTask *task)
+{
+	static_cast<WFHttpStreamServerTask *>(task)->resume();
+}
+
@@ -19,7 +19,7 @@
 #include "HttpMessage.h"
 #include "WFTaskFactory.h"
 
-// Internal, for WFHttpChunkedTask only.
+// Internal, for WFHttpChunkedTask and WFHttpStreamServer only.
 
 class __WFHttpTaskFactory
 {
@@ -37,5 +37,17 @@ public:
 										   int redirect_max,
 										   extract_t extract,
 										   http_callback_t callback);
+
+private:
+	using stream_extract_t = std::function<void (WFHttpTask *,
+												 const void *, size_t)>;
+
+public:
+	static WFHttpTask *create_stream_server_task(CommService *service,
+							std::function<void (WFHttpTask *)>& process,
+							stream_extract_t& extract);
+
+	static void pause_stream_server_task(WFHttpTask *task);
+	static void resume_stream_server_task(WFHttpTask *task);
 };
 
@@ -0,0 +1,40 @@
+/*
+  Copyright (c) 2024 Sogou, Inc.
+
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+
+      http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+*/
+
+#include "MySQLMessage.h"
+#include "WFTaskFactory.h"
+
+// Internal, for WFMySQLStreamTask only.
+
+class __WFMySQLTaskFactory
+{
+private:
+	using extract_t = std::function<void (WFMySQLTask *)>;
+
+public:
+	/* 'extract' is called with every batch of at most 'batch_rows' rows,
+	 * while the response is still being received. */
+	static WFMySQLTask *create_stream_task(const std::string& url,
+										   int batch_rows,
+										   extract_t extract,
+										   mysql_callback_t callback);
+
+	static WFMySQLTask *create_stream_task(const ParsedURI& uri,
+										   int batch_rows,
+										   extract_t extract,
+										   mysql_callback_t callback);
+};
+
@@ -41,6 +41,7 @@ public:
 	ComplexRedisTask(int retry_max, redis_callback_t&& callback):
 		WFComplexClientTask(retry_max, std::move(callback)),
 		db_num_(0),
+		resp3_(false),
 		is_user_request_(true),
 		redirect_count_(0)
 	{}
@@ -55,11 +56,15 @@ protected:
 	virtual bool finish_once();
 
 protected:
+	virtual void moved(int slot, const std::string& hostport) { }
+
 	bool need_redirect();
+	void set_hostport(const std::string& hostport);
 
 	std::string username_;
 	std::string password_;
 	int db_num_;
+	bool resp3_;
 	bool succ_;
 	bool is_user_request_;
 	int redirect_count_;
@@ -89,7 +94,27 @@ CommMessageOut *ComplexRedisTask::message_out()
 
 	if (seqid <= 1)
 	{
-		if (seqid == 0 && (!password_.empty() || !username_.empty()))
+		bool auth = (!password_.empty() || !username_.empty());
+
+		if (seqid == 0 && resp3_)
+		{
+			auto *hello_req = new RedisRequest;
+
+			if (auth)
+			{
+				hello_req->set_request("HELLO", {"3", "AUTH",
+							username_.empty() ? "default" : username_,
+							password_});
+			}
+			else
+				hello_req->set_request("HELLO", {"3"});
+
+			succ_ = false;
+			is_user_request_ = false;
+			return hello_req;
+		}
+
+		if (seqid == 0 && auth)
 		{
 			auto *auth_req = new RedisRequest;
 
@@ -103,8 +128,7 @@ CommMessageOut *ComplexRedisTask::message_out()
 			return auth_req;
 		}
 
-		if (db_num_ > 0 &&
-			(seqid == 0 || !password_.empty() || !username_.empty()))
+		if (db_num_ > 0 && (seqid == 0 || auth || resp3_))
 		{
 			auto *select_req = new RedisRequest;
 			char buf[32];
@@ -191,11 +215,20 @@ bool ComplexRedisTask::init_success()
 	if (uri_.path && uri_.path[0] == '/' && uri_.path[1])
 		db_num_ = atoi(uri_.path + 1);
 
+	/* redis://host:port/db?protocol=3 to speak RESP3 by HELLO. */
+	if (uri_.query)
+	{
+		auto query = URIParser::split_query(uri_.query);
+		const auto it = query.find("protocol");
+
+		resp3_ = (it != query.end() && it->second == "3");
+	}
+
 	size_t info_len = username_.size() + password_.size() + 32 + 32;
 	char *info = new char[info_len];
 
-	sprintf(info, "redis|user:%s|pass:%s|db:%d", username_.c_str(),
-			password_.c_str(), db_num_);
+	sprintf(info, "redis|user:%s|pass:%s|db:%d%s", username_.c_str(),
+			password_.c_str(), db_num_, resp3_ ? "|proto:3" : "");
 	this->WFComplexClientTask::set_transport_type(type);
 	this->WFComplexClientTask::set_info(info);
 
@@ -241,18 +274,10 @@ bool ComplexRedisTask::need_redirect()
 			std::string& hostport = split_result[2];
 			redirect_count_++;
 
-			ParsedURI uri;
-			std::string url;
-			url.append(uri_.scheme);
-			url.append("://");
-			url.append(hostport);
-
-			URIParser::parse(url, uri);
-			std::swap(uri.host, uri_.host);
-			std::swap(uri.port, uri_.port);
-			std::swap(uri.state, uri_.state);
-			std::swap(uri.error, uri_.error);
+			if (!asking)
+				this->moved(atoi(split_result[1].c_str()), hostport);
 
+			this->set_hostport(hostport);
 			return true;
 		}
 	}
@@ -260,6 +285,21 @@ bool ComplexRedisTask::need_redirect()
 	return false;
 }
 
+void ComplexRedisTask::set_hostport(const std::string& hostport)
+{
+	ParsedURI uri;
+	std::string url;
+	url.append(uri_.scheme);
+	url.append("://");
+	url.append(hostport);
+
+	URIParser::parse(url, uri);
+	std::swap(uri.host, uri_.host);
+	std::swap(uri.port, uri_.port);
+	std::swap(uri.state, uri_.state);
+	std::swap(uri.error, uri_.error);
+}
+
 bool ComplexRedisTask::finish_once()
 {
 	if (!is_user_request_)
@@ -293,6 +333,57 @@ bool ComplexRedisTask::finish_once()
 	return true;
 }
 
+/****** Redis Cluster ******/
+
+class ComplexRedisClusterTask : public ComplexRedisTask
+{
+public:
+	ComplexRedisClusterTask(int retry_max, __WFRedisClusterRouter *router,
+							redis_callback_t&& callback) :
+		ComplexRedisTask(retry_max, std::move(callback))
+	{
+		router->incref();
+		router_ = router;
+		routed_ = false;
+	}
+
+	virtual ~ComplexRedisClusterTask()
+	{
+		router_->decref();
+	}
+
+protected:
+	virtual bool check_request();
+
+	virtual void moved(int slot, const std::string& hostport)
+	{
+		router_->moved(slot, hostport);
+	}
+
+protected:
+	__WFRedisClusterRouter *router_;
+	bool routed_;
+};
+
+bool ComplexRedisClusterTask::check_request()
+{
+	if (!this->ComplexRedisTask::check_request())
+		return false;
+
+	/* Only the first dispatch is routed by slot. Redirections and
+	 * retries keep the address they were given. */
+	if (!routed_)
+	{
+		std::string hostport;
+
+		routed_ = true;
+		if (router_->route(&this->req, hostport))
+			this->set_hostport(hostport);
+	}
+
+	return true;
+}
+
 /****** Redis Subscribe ******/
 
 class ComplexRedisSubscribeTask : public ComplexRedisTask
@@ -369,7 +460,11 @@ ComplexRedisSubscribeTask::SubscribeWrapper::next_in(ProtocolMessage *message)
 {
 	redis_reply_t *reply = task_->resp.result_ptr();
 
-	if (reply->type != REDIS_REPLY_TYPE_ARRAY)
+	/* Messages are pushes in RESP3. A status may be the first reply of a
+	 * command that turns on pushing, such as 'CLIENT TRACKING'. */
+	if (reply->type != REDIS_REPLY_TYPE_ARRAY &&
+		reply->type != REDIS_REPLY_TYPE_PUSH &&
+		(reply->type != REDIS_REPLY_TYPE_STATUS || task_->watching_))
 	{
 		task_->finished_ = true;
 		return NULL;
@@ -420,6 +515,20 @@ WFRedisTask *WFTaskFactory::create_redis_task(const ParsedURI& uri,
 	return task;
 }
 
+WFRedisTask *
+__WFRedisTaskFactory::create_cluster_task(const ParsedURI& uri,
+										  int retry_max,
+										  __WFRedisClusterRouter *router,
+										  redis_callback_t callback)
+{
+	auto *task = new ComplexRedisClusterTask(retry_max, router,
+											 std::move(callback));
+
+	task->init(uri);
+	task->set_keep_alive(REDIS_KEEPALIVE_DEFAULT);
+	return task;
+}
+
 WFRedisTask *
 __WFRedisTaskFactory::create_subscribe_task(const std::string& url,
 											extract_t extract,
@@ -18,7 +18,27 @@
 
 #include "WFTaskFactory.h"
 
-// Internal, for WFRedisSubscribeTask only.
+// Internal, for WFRedisClusterClient only.
+
+class __WFRedisClusterRouter
+{
+public:
+	/* Fill 'node' with the "host:port" serving the key of 'req'. Returns
+	 * false if the request has no key or its slot is not known yet. */
+	virtual bool route(const protocol::RedisRequest *req,
+					   std::string& node) = 0;
+
+	/* Called when a node answers MOVED. */
+	virtual void moved(int slot, const std::string& node) = 0;
+
+	virtual void incref() = 0;
+	virtual void decref() = 0;
+
+protected:
+	virtual ~__WFRedisClusterRouter() { }
+};
+
+// Internal, for WFRedisSubscribeTask and WFRedisClusterClient only.
 
 class __WFRedisTaskFactory
 {
@@ -26,6 +46,11 @@ private:
 	using extract_t = std::function<void (WFRedisTask *)>;
 
 public:
+	static WFRedisTask *create_cluster_task(const ParsedURI& uri,
+											int retry_max,
+											__WFRedisClusterRouter *router,
+											redis_callback_t callback);
+
 	static WFRedisTask *create_subscribe_task(const std::string& url,
 											  extract_t extract,
 											  redis_callback_t callback);
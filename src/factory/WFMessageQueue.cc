@@ -16,6 +16,8 @@
   Authors: Xie Han (xiehan@sogou-inc.com)
 */
 
+#include <errno.h>
+#include <atomic>
 #include "list.h"
 #include "WFTask.h"
 #include "WFMessageQueue.h"
@@ -92,3 +94,318 @@ void WFMessageQueue::post(void *msg)
 		cond->WFConditional::signal(msg);
 }
 
+
+class __LFMQConditional : public WFConditional
+{
+public:
+	struct list_head list;
+	struct WFLockFreeMessageQueue::Data *data;
+
+public:
+	virtual void dispatch();
+	virtual void signal(void *msg) { }
+
+public:
+	__LFMQConditional(SubTask *task, void **msgbuf,
+					  struct WFLockFreeMessageQueue::Data *data) :
+		WFConditional(task, msgbuf)
+	{
+		this->data = data;
+	}
+
+	__LFMQConditional(SubTask *task,
+					  struct WFLockFreeMessageQueue::Data *data) :
+		WFConditional(task)
+	{
+		this->data = data;
+	}
+};
+
+class __LFMQPutConditional : public WFConditional
+{
+public:
+	struct list_head list;
+	struct WFLockFreeMessageQueue::Data *data;
+	void *msg;
+
+public:
+	virtual void dispatch();
+	virtual void signal(void *msg) { }
+
+public:
+	__LFMQPutConditional(SubTask *task, void *msg,
+						 struct WFLockFreeMessageQueue::Data *data) :
+		WFConditional(task)
+	{
+		this->data = data;
+		this->msg = msg;
+	}
+};
+
+static bool __try_acquire(std::atomic<long> *value)
+{
+	long n = value->load(std::memory_order_relaxed);
+
+	while (n > 0)
+	{
+		if (value->compare_exchange_weak(n, n - 1))
+			return true;
+	}
+
+	return false;
+}
+
+/* A pop holding a message, or a push holding a space, that the ring missed
+ * for the moment. The push or the pop in progress on the same cell finishes
+ * it, not waiting for it. 'cond' of a posted message is NULL. */
+struct __LFMQPending
+{
+	struct list_head list;
+	WFConditional *cond;
+	void *msg;
+};
+
+static void __lfmq_pop_done(struct WFLockFreeMessageQueue::Data *data,
+							void *msg, WFConditional *cond);
+static void __lfmq_push_done(struct WFLockFreeMessageQueue::Data *data,
+							 WFConditional *cond);
+
+/* Called after a message is pushed or a pop is missed. */
+static void __lfmq_retry_pops(struct WFLockFreeMessageQueue::Data *data)
+{
+	struct __LFMQPending *pending;
+	struct list_head *pos, *tmp;
+	LIST_HEAD(list);
+
+	/* Either a missed pop is seen here, or the push is seen by its retry. */
+	std::atomic_thread_fence(std::memory_order_seq_cst);
+	if (data->pops_missed.load(std::memory_order_relaxed) == 0)
+		return;
+
+	data->get_mutex.lock();
+	while (!list_empty(&data->pop_list))
+	{
+		pending = list_entry(data->pop_list.next, struct __LFMQPending, list);
+		if (!data->ring.pop(&pending->msg))
+			break;
+
+		list_move_tail(&pending->list, &list);
+		data->pops_missed--;
+	}
+
+	data->get_mutex.unlock();
+	list_for_each_safe(pos, tmp, &list)
+	{
+		pending = list_entry(pos, struct __LFMQPending, list);
+		__lfmq_pop_done(data, pending->msg, pending->cond);
+		delete pending;
+	}
+}
+
+/* Called after a message is popped or a push is missed. */
+static void __lfmq_retry_pushes(struct WFLockFreeMessageQueue::Data *data)
+{
+	struct __LFMQPending *pending;
+	struct list_head *pos, *tmp;
+	LIST_HEAD(list);
+
+	std::atomic_thread_fence(std::memory_order_seq_cst);
+	if (data->pushes_missed.load(std::memory_order_relaxed) == 0)
+		return;
+
+	data->put_mutex.lock();
+	while (!list_empty(&data->push_list))
+	{
+		pending = list_entry(data->push_list.next, struct __LFMQPending, list);
+		if (!data->ring.push(pending->msg))
+			break;
+
+		list_move_tail(&pending->list, &list);
+		data->pushes_missed--;
+	}
+
+	data->put_mutex.unlock();
+	list_for_each_safe(pos, tmp, &list)
+	{
+		pending = list_entry(pos, struct __LFMQPending, list);
+		__lfmq_push_done(data, pending->cond);
+		delete pending;
+	}
+}
+
+/* Called after a message is acquired for 'cond'. The ring only misses it
+ * while a push is in progress. */
+static void __lfmq_get(struct WFLockFreeMessageQueue::Data *data,
+					   WFConditional *cond)
+{
+	struct __LFMQPending *pending;
+	void *msg;
+
+	if (data->ring.pop(&msg))
+	{
+		__lfmq_pop_done(data, msg, cond);
+		return;
+	}
+
+	pending = new struct __LFMQPending;
+	pending->cond = cond;
+	data->get_mutex.lock();
+	list_add_tail(&pending->list, &data->pop_list);
+	data->pops_missed++;
+	data->get_mutex.unlock();
+	__lfmq_retry_pops(data);
+}
+
+/* Called after a space is acquired. The ring may still be full for a
+ * moment, while the pop that gave back the space is completing. */
+static void __lfmq_put(struct WFLockFreeMessageQueue::Data *data,
+					   void *msg, WFConditional *cond)
+{
+	struct __LFMQPending *pending;
+
+	if (data->ring.push(msg))
+	{
+		__lfmq_push_done(data, cond);
+		return;
+	}
+
+	pending = new struct __LFMQPending;
+	pending->cond = cond;
+	pending->msg = msg;
+	data->put_mutex.lock();
+	list_add_tail(&pending->list, &data->push_list);
+	data->pushes_missed++;
+	data->put_mutex.unlock();
+	__lfmq_retry_pushes(data);
+}
+
+static void __lfmq_pop_done(struct WFLockFreeMessageQueue::Data *data,
+							void *msg, WFConditional *cond)
+{
+	__LFMQPutConditional *put;
+
+	__lfmq_retry_pushes(data);
+
+	/* Hand the space given back to the first waiting putter if any. The
+	 * putter is in the list once its decrement is seen. */
+	if (data->space.fetch_add(1) < 0)
+	{
+		data->put_mutex.lock();
+		put = list_entry(data->put_list.next, __LFMQPutConditional, list);
+		list_del(&put->list);
+		data->put_mutex.unlock();
+
+		__lfmq_put(data, put->msg, put);
+	}
+
+	cond->WFConditional::signal(msg);
+}
+
+static void __lfmq_push_done(struct WFLockFreeMessageQueue::Data *data,
+							 WFConditional *cond)
+{
+	__LFMQConditional *get;
+
+	__lfmq_retry_pops(data);
+
+	/* Hand the message to the first waiting getter if any. */
+	if (data->value.fetch_add(1) < 0)
+	{
+		data->get_mutex.lock();
+		get = list_entry(data->get_list.next, __LFMQConditional, list);
+		list_del(&get->list);
+		data->get_mutex.unlock();
+
+		__lfmq_get(data, get);
+	}
+
+	if (cond)
+		cond->WFConditional::signal(NULL);
+}
+
+void __LFMQConditional::dispatch()
+{
+	struct WFLockFreeMessageQueue::Data *data = this->data;
+
+	if (__try_acquire(&data->value))
+		__lfmq_get(data, this);
+	else
+	{
+		data->get_mutex.lock();
+		if (data->value.fetch_sub(1) > 0)
+		{
+			data->get_mutex.unlock();
+			__lfmq_get(data, this);
+		}
+		else
+		{
+			list_add_tail(&this->list, &data->get_list);
+			data->get_mutex.unlock();
+		}
+	}
+
+	this->WFConditional::dispatch();
+}
+
+void __LFMQPutConditional::dispatch()
+{
+	struct WFLockFreeMessageQueue::Data *data = this->data;
+	bool acquired = __try_acquire(&data->space);
+
+	if (!acquired)
+	{
+		data->put_mutex.lock();
+		if (data->space.fetch_sub(1) > 0)
+			acquired = true;
+		else
+			list_add_tail(&this->list, &data->put_list);
+
+		data->put_mutex.unlock();
+	}
+
+	if (acquired)
+		__lfmq_put(data, this->msg, this);
+
+	this->WFConditional::dispatch();
+}
+
+WFConditional *WFLockFreeMessageQueue::get(SubTask *task, void **msgbuf)
+{
+	return new __LFMQConditional(task, msgbuf, &this->data);
+}
+
+WFConditional *WFLockFreeMessageQueue::get(SubTask *task)
+{
+	return new __LFMQConditional(task, &this->data);
+}
+
+int WFLockFreeMessageQueue::post(void *msg)
+{
+	if (!__try_acquire(&this->data.space))
+	{
+		errno = EAGAIN;
+		return -1;
+	}
+
+	__lfmq_put(&this->data, msg, NULL);
+	return 0;
+}
+
+WFConditional *WFLockFreeMessageQueue::put(SubTask *task, void *msg)
+{
+	return new __LFMQPutConditional(task, msg, &this->data);
+}
+
+WFLockFreeMessageQueue::WFLockFreeMessageQueue(size_t capacity) :
+	data(capacity)
+{
+	this->data.value = 0;
+	this->data.space = capacity;
+	this->data.pops_missed = 0;
+	this->data.pushes_missed = 0;
+	INIT_LIST_HEAD(&this->data.get_list);
+	INIT_LIST_HEAD(&this->data.put_list);
+	INIT_LIST_HEAD(&this->data.pop_list);
+	INIT_LIST_HEAD(&this->data.push_list);
+}
+
@@ -19,8 +19,11 @@
 #ifndef _WFMESSAGEQUEUE_H_
 #define _WFMESSAGEQUEUE_H_
 
+#include <stddef.h>
 #include <mutex>
+#include <atomic>
 #include "list.h"
+#include "LockFreeRing.h"
 #include "WFTask.h"
 
 class WFMessageQueue
@@ -84,5 +87,48 @@ public:
 	virtual ~WFMessageQueue() { }
 };
 
+/* A bounded queue holding at most 'capacity' (> 0) messages. Getting and
+ * posting take no lock unless a task has to wait. */
+class WFLockFreeMessageQueue
+{
+public:
+	WFConditional *get(SubTask *task, void **msgbuf);
+	WFConditional *get(SubTask *task);
+
+	/* Returns -1 with errno EAGAIN if the queue is full. */
+	int post(void *msg);
+
+	/* 'task' runs after 'msg' is queued, waiting while the queue is full. */
+	WFConditional *put(SubTask *task, void *msg);
+
+public:
+	struct Data
+	{
+		Data(size_t capacity) : ring(capacity) { }
+
+		LockFreeRing ring;
+		/* Messages minus waiting getters. */
+		std::atomic<long> value;
+		/* Free space minus waiting putters. */
+		std::atomic<long> space;
+		/* Acquired, but missed by the ring for the moment. */
+		std::atomic<long> pops_missed;
+		std::atomic<long> pushes_missed;
+		struct list_head get_list;
+		struct list_head put_list;
+		struct list_head pop_list;
+		struct list_head push_list;
+		std::mutex get_mutex;
+		std::mutex put_mutex;
+	};
+
+protected:
+	struct Data data;
+
+public:
+	WFLockFreeMessageQueue(size_t capacity);
+	virtual ~WFLockFreeMessageQueue() { }
+};
+
 #endif
 
@@ -18,6 +18,7 @@
 */
 
 #include <string.h>
+#include <atomic>
 #include "list.h"
 #include "WFTask.h"
 #include "WFResourcePool.h"
@@ -115,3 +116,253 @@ void WFResourcePool::post(void *res)
 		cond->WFConditional::signal(res);
 }
 
+
+class __LFRPConditional : public WFConditional
+{
+public:
+	struct list_head list;
+	struct WFLockFreeResourcePool::Data *data;
+
+public:
+	virtual void dispatch();
+	virtual void signal(void *res) { }
+
+public:
+	__LFRPConditional(SubTask *task, void **resbuf,
+					  struct WFLockFreeResourcePool::Data *data) :
+		WFConditional(task, resbuf)
+	{
+		this->data = data;
+	}
+
+	__LFRPConditional(SubTask *task,
+					  struct WFLockFreeResourcePool::Data *data) :
+		WFConditional(task)
+	{
+		this->data = data;
+	}
+};
+
+/* A get holding a resource, or a post, that the ring missed for the moment.
+ * The post or the get in progress on the same cell finishes it, not waiting
+ * for it. 'cond' of a post is NULL. */
+struct __LFRPPending
+{
+	struct list_head list;
+	WFConditional *cond;
+	void *res;
+};
+
+static void __lfrp_pop_done(struct WFLockFreeResourcePool::Data *data,
+							void *res, WFConditional *cond);
+static void __lfrp_push_done(struct WFLockFreeResourcePool::Data *data);
+
+/* Called after a resource is pushed or a pop is missed. */
+static void __lfrp_retry_pops(struct WFLockFreeResourcePool::Data *data)
+{
+	struct __LFRPPending *pending;
+	struct list_head *pos, *tmp;
+	LIST_HEAD(list);
+
+	/* Either a missed pop is seen here, or the push is seen by its retry. */
+	std::atomic_thread_fence(std::memory_order_seq_cst);
+	if (data->pops_missed.load(std::memory_order_relaxed) == 0)
+		return;
+
+	data->mutex.lock();
+	while (!list_empty(&data->pop_list))
+	{
+		pending = list_entry(data->pop_list.next, struct __LFRPPending, list);
+		if (!data->ring.pop(&pending->res))
+			break;
+
+		list_move_tail(&pending->list, &list);
+		data->pops_missed--;
+	}
+
+	data->mutex.unlock();
+	list_for_each_safe(pos, tmp, &list)
+	{
+		pending = list_entry(pos, struct __LFRPPending, list);
+		__lfrp_pop_done(data, pending->res, pending->cond);
+		delete pending;
+	}
+}
+
+/* Called after a resource is popped or a push is missed. */
+static void __lfrp_retry_pushes(struct WFLockFreeResourcePool::Data *data)
+{
+	struct __LFRPPending *pending;
+	struct list_head *pos, *tmp;
+	LIST_HEAD(list);
+
+	std::atomic_thread_fence(std::memory_order_seq_cst);
+	if (data->pushes_missed.load(std::memory_order_relaxed) == 0)
+		return;
+
+	data->mutex.lock();
+	while (!list_empty(&data->push_list))
+	{
+		pending = list_entry(data->push_list.next, struct __LFRPPending, list);
+		if (!data->ring.push(pending->res))
+			break;
+
+		list_move_tail(&pending->list, &list);
+		data->pushes_missed--;
+	}
+
+	data->mutex.unlock();
+	list_for_each_safe(pos, tmp, &list)
+	{
+		pending = list_entry(pos, struct __LFRPPending, list);
+		__lfrp_push_done(data);
+		delete pending;
+	}
+}
+
+/* Called after a resource is acquired for 'cond'. The ring only misses it
+ * while a post is in progress. */
+static void __lfrp_get(struct WFLockFreeResourcePool::Data *data,
+					   WFConditional *cond)
+{
+	struct __LFRPPending *pending;
+	void *res;
+
+	if (data->ring.pop(&res))
+	{
+		__lfrp_pop_done(data, res, cond);
+		return;
+	}
+
+	pending = new struct __LFRPPending;
+	pending->cond = cond;
+	data->mutex.lock();
+	list_add_tail(&pending->list, &data->pop_list);
+	data->pops_missed++;
+	data->mutex.unlock();
+	__lfrp_retry_pops(data);
+}
+
+/* The ring is full only for a moment, while another pop is completing. */
+static void __lfrp_put(struct WFLockFreeResourcePool::Data *data, void *res)
+{
+	struct __LFRPPending *pending;
+
+	if (data->ring.push(res))
+	{
+		__lfrp_push_done(data);
+		return;
+	}
+
+	pending = new struct __LFRPPending;
+	pending->cond = NULL;
+	pending->res = res;
+	data->mutex.lock();
+	list_add_tail(&pending->list, &data->push_list);
+	data->pushes_missed++;
+	data->mutex.unlock();
+	__lfrp_retry_pushes(data);
+}
+
+static void __lfrp_pop_done(struct WFLockFreeResourcePool::Data *data,
+							void *res, WFConditional *cond)
+{
+	__lfrp_retry_pushes(data);
+	cond->WFConditional::signal(res);
+}
+
+static void __lfrp_push_done(struct WFLockFreeResourcePool::Data *data)
+{
+	WFConditional *cond;
+
+	__lfrp_retry_pops(data);
+	if (data->value.fetch_add(1) >= 0)
+		return;
+
+	/* The waiting task is in the list once its decrement is seen. */
+	data->mutex.lock();
+	cond = list_entry(data->wait_list.next, __LFRPConditional, list);
+	list_del(data->wait_list.next);
+	data->mutex.unlock();
+
+	__lfrp_get(data, cond);
+}
+
+void __LFRPConditional::dispatch()
+{
+	struct WFLockFreeResourcePool::Data *data = this->data;
+	long n = data->value.load(std::memory_order_relaxed);
+
+	while (n > 0)
+	{
+		if (data->value.compare_exchange_weak(n, n - 1))
+			break;
+	}
+
+	if (n > 0)
+		__lfrp_get(data, this);
+	else
+	{
+		data->mutex.lock();
+		if (data->value.fetch_sub(1) > 0)
+		{
+			data->mutex.unlock();
+			__lfrp_get(data, this);
+		}
+		else
+		{
+			list_add_tail(&this->list, &data->wait_list);
+			data->mutex.unlock();
+		}
+	}
+
+	this->WFConditional::dispatch();
+}
+
+WFConditional *WFLockFreeResourcePool::get(SubTask *task, void **resbuf)
+{
+	return new __LFRPConditional(task, resbuf, &this->data);
+}
+
+WFConditional *WFLockFreeResourcePool::get(SubTask *task)
+{
+	return new __LFRPConditional(task, &this->data);
+}
+
+WFLockFreeResourcePool::WFLockFreeResourcePool(void *const *res, size_t n) :
+	data(n)
+{
+	size_t i;
+
+	for (i = 0; i < n; i++)
+		this->data.ring.push(res[i]);
+
+	this->data.value = n;
+	this->data.pops_missed = 0;
+	this->data.pushes_missed = 0;
+	INIT_LIST_HEAD(&this->data.wait_list);
+	INIT_LIST_HEAD(&this->data.pop_list);
+	INIT_LIST_HEAD(&this->data.push_list);
+}
+
+WFLockFreeResourcePool::WFLockFreeResourcePool(size_t n) :
+	data(n)
+{
+	size_t i;
+
+	for (i = 0; i < n; i++)
+		this->data.ring.push(NULL);
+
+	this->data.value = n;
+	this->data.pops_missed = 0;
+	this->data.pushes_missed = 0;
+	INIT_LIST_HEAD(&this->data.wait_list);
+	INIT_LIST_HEAD(&this->data.pop_list);
+	INIT_LIST_HEAD(&this->data.push_list);
+}
+
+void WFLockFreeResourcePool::post(void *res)
+{
+	__lfrp_put(&this->data, res);
+}
+
@@ -20,8 +20,11 @@
 #ifndef _WFRESOURCEPOOL_H_
 #define _WFRESOURCEPOOL_H_
 
+#include <stddef.h>
 #include <mutex>
+#include <atomic>
 #include "list.h"
+#include "LockFreeRing.h"
 #include "WFTask.h"
 
 class WFResourcePool
@@ -68,5 +71,40 @@ public:
 	virtual ~WFResourcePool() { delete []this->data.res; }
 };
 
+/* The same as WFResourcePool, but getting and posting take no lock unless
+ * a task has to wait. Resources are handed out in FIFO order. */
+class WFLockFreeResourcePool
+{
+public:
+	WFConditional *get(SubTask *task, void **resbuf);
+	WFConditional *get(SubTask *task);
+	void post(void *res);
+
+public:
+	struct Data
+	{
+		Data(size_t n) : ring(n) { }
+
+		LockFreeRing ring;
+		/* Resources minus waiting tasks. */
+		std::atomic<long> value;
+		/* Acquired or posted, but missed by the ring for the moment. */
+		std::atomic<long> pops_missed;
+		std::atomic<long> pushes_missed;
+		struct list_head wait_list;
+		struct list_head pop_list;
+		struct list_head push_list;
+		std::mutex mutex;
+	};
+
+protected:
+	struct Data data;
+
+public:
+	WFLockFreeResourcePool(void *const *res, size_t n);
+	WFLockFreeResourcePool(size_t n);
+	virtual ~WFLockFreeResourcePool() { }
+};
+
 #endif
 
@@ -45,11 +45,12 @@ enum
 	WFT_STATE_SSL_ERROR = 65,
 	WFT_STATE_DNS_ERROR = 66,					/* for client task only */
 	WFT_STATE_TASK_ERROR = 67,
-	WFT_STATE_ABORTED = CS_STATE_STOPPED
+	WFT_STATE_ABORTED = CS_STATE_STOPPED,
+	WFT_STATE_EXPIRED = ES_STATE_EXPIRED		/* for go task with deadline only */
 };
 
 template<class INPUT, class OUTPUT>
-class WFThreadTask : public ExecRequest
+class WFThreadTask : public ExecRequest, public RecycledObject
 {
 public:
 	void start()
@@ -117,7 +118,7 @@ protected:
 };
 
 template<class REQ, class RESP>
-class WFNetworkTask : public CommRequest
+class WFNetworkTask : public CommRequest, public RecycledObject
 {
 public:
 	/* start(), dismiss() are for client tasks only. */
@@ -261,7 +262,7 @@ protected:
 	virtual ~WFNetworkTask() { }
 };
 
-class WFTimerTask : public SleepRequest
+class WFTimerTask : public SleepRequest, public RecycledObject
 {
 public:
 	void start()
@@ -700,7 +701,7 @@ protected:
 	}
 };
 
-class WFGoTask : public ExecRequest
+class WFGoTask : public ExecRequest, public RecycledObject
 {
 public:
 	void start()
@@ -728,6 +729,15 @@ public:
 		this->callback = std::move(cb);
 	}
 
+public:
+	/* If the task is not started by the compute threads within this time
+	 * from now, it is dropped with state WFT_STATE_EXPIRED and ETIMEDOUT.
+	 * Sessions with earlier deadlines are run first across queues. */
+	void set_deadline(time_t seconds, long nanoseconds)
+	{
+		this->ExecSession::set_deadline(seconds, nanoseconds);
+	}
+
 protected:
 	virtual SubTask *done()
 	{
@@ -862,6 +872,10 @@ protected:
 	SubTask *first;
 	std::function<void (const WFModuleTask *)> callback;
 
+public:
+	using SeriesWork::operator new;
+	using SeriesWork::operator delete;
+
 public:
 	WFModuleTask(SubTask *first,
 				 std::function<void (const WFModuleTask *)>&& cb) :
@@ -18,11 +18,13 @@
 
 #include <sys/types.h>
 #include <errno.h>
+#include <stdint.h>
 #include <time.h>
 #include <utility>
 #include <string>
 #include <mutex>
 #include <atomic>
+#include <functional>
 #include "list.h"
 #include "rbtree.h"
 #include "WFGlobal.h"
@@ -97,8 +99,8 @@ WFTimerTask *WFTaskFactory::create_timer_task(unsigned int microseconds,
 template<typename T>
 struct __NamedObjectList
 {
-	__NamedObjectList(const std::string& str):
-		name(str)
+	__NamedObjectList(const std::string& str, size_t h):
+		name(str), hash(h)
 	{
 		INIT_LIST_HEAD(&this->head);
 	}
@@ -128,11 +130,13 @@ struct __NamedObjectList
 	struct rb_node rb;
 	struct list_head head;
 	std::string name;
+	size_t hash;
 };
 
+/* Lists are ordered by the name hash first, so names are seldom compared. */
 template<typename T>
-static T *__get_object_list(const std::string& name, struct rb_root *root,
-							bool insert)
+static T *__get_object_list(const std::string& name, size_t hash,
+							struct rb_root *root, bool insert)
 {
 	struct rb_node **p = &root->rb_node;
 	struct rb_node *parent = NULL;
@@ -143,7 +147,13 @@ static T *__get_object_list(const std::string& name, struct rb_root *root,
 	{
 		parent = *p;
 		objs = rb_entry(*p, T, rb);
-		n = name.compare(objs->name);
+		if (hash < objs->hash)
+			n = -1;
+		else if (hash > objs->hash)
+			n = 1;
+		else
+			n = name.compare(objs->name);
+
 		if (n < 0)
 			p = &(*p)->rb_left;
 		else if (n > 0)
@@ -154,7 +164,7 @@ static T *__get_object_list(const std::string& name, struct rb_root *root,
 
 	if (insert)
 	{
-		objs = new T(name);
+		objs = new T(name, hash);
 		rb_link_node(&objs->rb, parent, p);
 		rb_insert_color(&objs->rb, root);
 		return objs;
@@ -163,6 +173,41 @@ static T *__get_object_list(const std::string& name, struct rb_root *root,
 	return NULL;
 }
 
+static inline size_t __get_name_hash(const std::string& name)
+{
+	return std::hash<std::string>()(name);
+}
+
+#define NAMED_OBJECT_SHARD_BITS		6
+
+struct alignas(64) __NamedObjectShard
+{
+	struct rb_root root;
+	std::mutex mutex;
+};
+
+/* Names are spread over the shards by hash, each with its own lock. */
+class __NamedObjectShards
+{
+public:
+	__NamedObjectShard *get(size_t hash)
+	{
+		uint64_t h = (uint64_t)hash * 0x9E3779B97F4A7C15ULL;
+
+		return &shards_[h >> (64 - NAMED_OBJECT_SHARD_BITS)];
+	}
+
+public:
+	__NamedObjectShards()
+	{
+		for (auto& shard : shards_)
+			shard.root.rb_node = NULL;
+	}
+
+private:
+	__NamedObjectShard shards_[1 << NAMED_OBJECT_SHARD_BITS];
+};
+
 /****************** Named Timer ******************/
 
 class __WFNamedTimerTask;
@@ -179,23 +224,16 @@ public:
 	using TimerList = __NamedObjectList<struct __timer_node>;
 
 public:
-	WFTimerTask *create(const std::string& name,
+	WFTimerTask *create(const std::string& name, size_t hash,
 						time_t seconds, long nanoseconds,
 						CommScheduler *scheduler,
 						timer_callback_t&& cb);
 
 public:
-	int cancel(const std::string& name, size_t max);
+	int cancel(const std::string& name, size_t hash, size_t max);
 
 private:
-	struct rb_root root_;
-	std::mutex mutex_;
-
-public:
-	__NamedTimerMap()
-	{
-		root_.rb_node = NULL;
-	}
+	__NamedObjectShards shards_;
 
 	friend class __WFNamedTimerTask;
 } __timer_map;
@@ -222,13 +260,14 @@ public:
 	{
 		if (node_.task)
 		{
+			auto *shard = __timer_map.shards_.get(timers_->hash);
 			bool erased = false;
 
-			__timer_map.mutex_.lock();
+			shard->mutex.lock();
 			if (node_.task)
-				erased = timers_->del(&node_, &__timer_map.root_);
+				erased = timers_->del(&node_, &shard->root);
 
-			__timer_map.mutex_.unlock();
+			shard->mutex.unlock();
 			if (erased)
 				delete timers_;
 		}
@@ -266,17 +305,18 @@ void __WFNamedTimerTask::handle(int state, int error)
 
 	if (node_.task)
 	{
+		auto *shard = __timer_map.shards_.get(timers_->hash);
 		bool erased = false;
 
-		__timer_map.mutex_.lock();
+		shard->mutex.lock();
 		if (node_.task)
 		{
 			canceled = false;
-			erased = timers_->del(&node_, &__timer_map.root_);
+			erased = timers_->del(&node_, &shard->root);
 			node_.task = NULL;
 		}
 
-		__timer_map.mutex_.unlock();
+		shard->mutex.unlock();
 		if (erased)
 			delete timers_;
 	}
@@ -292,27 +332,30 @@ void __WFNamedTimerTask::handle(int state, int error)
 	this->__WFTimerTask::handle(state, error);
 }
 
-WFTimerTask *__NamedTimerMap::create(const std::string& name,
+WFTimerTask *__NamedTimerMap::create(const std::string& name, size_t hash,
 									 time_t seconds, long nanoseconds,
 									 CommScheduler *scheduler,
 									 timer_callback_t&& cb)
 {
 	auto *task = new __WFNamedTimerTask(seconds, nanoseconds, scheduler,
 										std::move(cb));
-	mutex_.lock();
-	task->push_to(__get_object_list<TimerList>(name, &root_, true));
-	mutex_.unlock();
+	auto *shard = shards_.get(hash);
+
+	shard->mutex.lock();
+	task->push_to(__get_object_list<TimerList>(name, hash, &shard->root, true));
+	shard->mutex.unlock();
 	return task;
 }
 
-int __NamedTimerMap::cancel(const std::string& name, size_t max)
+int __NamedTimerMap::cancel(const std::string& name, size_t hash, size_t max)
 {
+	auto *shard = shards_.get(hash);
 	struct __timer_node *node;
 	TimerList *timers;
 	int ret = 0;
 
-	mutex_.lock();
-	timers = __get_object_list<TimerList>(name, &root_, false);
+	shard->mutex.lock();
+	timers = __get_object_list<TimerList>(name, hash, &shard->root, false);
 	if (timers)
 	{
 		while (1)
@@ -333,13 +376,13 @@ int __NamedTimerMap::cancel(const std::string& name, size_t max)
 			ret++;
 			if (timers->empty())
 			{
-				rb_erase(&timers->rb, &root_);
+				rb_erase(&timers->rb, &shard->root);
 				break;
 			}
 		}
 	}
 
-	mutex_.unlock();
+	shard->mutex.unlock();
 	delete timers;
 	return ret;
 }
@@ -348,14 +391,30 @@ WFTimerTask *WFTaskFactory::create_timer_task(const std::string& name,
 											  time_t seconds, long nanoseconds,
 											  timer_callback_t callback)
 {
-	return __timer_map.create(name, seconds, nanoseconds,
+	return __timer_map.create(name, __get_name_hash(name),
+							  seconds, nanoseconds,
+							  WFGlobal::get_scheduler(),
+							  std::move(callback));
+}
+
+WFTimerTask *WFTaskFactory::create_timer_task(const WFTaskName& name,
+											  time_t seconds, long nanoseconds,
+											  timer_callback_t callback)
+{
+	return __timer_map.create(name.get_name(), name.get_hash(),
+							  seconds, nanoseconds,
 							  WFGlobal::get_scheduler(),
 							  std::move(callback));
 }
 
 int WFTaskFactory::cancel_by_name(const std::string& name, size_t max)
 {
-	return __timer_map.cancel(name, max);
+	return __timer_map.cancel(name, __get_name_hash(name), max);
+}
+
+int WFTaskFactory::cancel_by_name(const WFTaskName& name, size_t max)
+{
+	return __timer_map.cancel(name.get_name(), name.get_hash(), max);
 }
 
 /****************** Named Counter ******************/
@@ -375,34 +434,29 @@ public:
 	using CounterList = __NamedObjectList<struct __counter_node>;
 
 public:
-	WFCounterTask *create(const std::string& name, unsigned int target_value,
+	WFCounterTask *create(const std::string& name, size_t hash,
+						  unsigned int target_value,
 						  counter_callback_t&& cb);
 
-	int count_n(const std::string& name, unsigned int n);
+	int count_n(const std::string& name, size_t hash, unsigned int n);
 	void count(CounterList *counters, struct __counter_node *node);
 
 	void remove(CounterList *counters, struct __counter_node *node)
 	{
+		auto *shard = shards_.get(counters->hash);
 		bool erased;
 
-		mutex_.lock();
-		erased = counters->del(node, &root_);
-		mutex_.unlock();
+		shard->mutex.lock();
+		erased = counters->del(node, &shard->root);
+		shard->mutex.unlock();
 		if (erased)
 			delete counters;
 	}
 
 private:
 	bool count_n_locked(CounterList *counters, unsigned int n,
-						struct list_head *task_list);
-	struct rb_root root_;
-	std::mutex mutex_;
-
-public:
-	__NamedCounterMap()
-	{
-		root_.rb_node = NULL;
-	}
+						struct rb_root *root, struct list_head *task_list);
+	__NamedObjectShards shards_;
 } __counter_map;
 
 class __WFNamedCounterTask : public WFCounterTask
@@ -437,7 +491,7 @@ private:
 	__NamedCounterMap::CounterList *counters_;
 };
 
-WFCounterTask *__NamedCounterMap::create(const std::string& name,
+WFCounterTask *__NamedCounterMap::create(const std::string& name, size_t hash,
 										 unsigned int target_value,
 										 counter_callback_t&& cb)
 {
@@ -445,13 +499,17 @@ WFCounterTask *__NamedCounterMap::create(const std::string& name,
 		return new WFCounterTask(0, std::move(cb));
 
 	auto *task = new __WFNamedCounterTask(target_value, std::move(cb));
-	mutex_.lock();
-	task->push_to(__get_object_list<CounterList>(name, &root_, true));
-	mutex_.unlock();
+	auto *shard = shards_.get(hash);
+
+	shard->mutex.lock();
+	task->push_to(__get_object_list<CounterList>(name, hash, &shard->root,
+												 true));
+	shard->mutex.unlock();
 	return task;
 }
 
 bool __NamedCounterMap::count_n_locked(CounterList *counters, unsigned int n,
+									   struct rb_root *root,
 									   struct list_head *task_list)
 {
 	struct __counter_node *node;
@@ -466,7 +524,7 @@ bool __NamedCounterMap::count_n_locked(CounterList *counters, unsigned int n,
 			list_move_tail(&node->list, task_list);
 			if (counters->empty())
 			{
-				rb_erase(&counters->rb, &root_);
+				rb_erase(&counters->rb, root);
 				return true;
 			}
 		}
@@ -480,20 +538,22 @@ bool __NamedCounterMap::count_n_locked(CounterList *counters, unsigned int n,
 	return false;
 }
 
-int __NamedCounterMap::count_n(const std::string& name, unsigned int n)
+int __NamedCounterMap::count_n(const std::string& name, size_t hash,
+							   unsigned int n)
 {
+	auto *shard = shards_.get(hash);
 	LIST_HEAD(task_list);
 	struct __counter_node *node;
 	CounterList *counters;
 	bool erased = false;
 	int ret = 0;
 
-	mutex_.lock();
-	counters = __get_object_list<CounterList>(name, &root_, false);
+	shard->mutex.lock();
+	counters = __get_object_list<CounterList>(name, hash, &shard->root, false);
 	if (counters)
-		erased = count_n_locked(counters, n, &task_list);
+		erased = count_n_locked(counters, n, &shard->root, &task_list);
 
-	mutex_.unlock();
+	shard->mutex.unlock();
 	if (erased)
 		delete counters;
 
@@ -511,17 +571,18 @@ int __NamedCounterMap::count_n(const std::string& name, unsigned int n)
 void __NamedCounterMap::count(CounterList *counters,
 							  struct __counter_node *node)
 {
+	auto *shard = shards_.get(counters->hash);
 	__WFNamedCounterTask *task = NULL;
 	bool erased = false;
 
-	mutex_.lock();
+	shard->mutex.lock();
 	if (--node->target_value == 0)
 	{
 		task = node->task;
-		erased = counters->del(node, &root_);
+		erased = counters->del(node, &shard->root);
 	}
 
-	mutex_.unlock();
+	shard->mutex.unlock();
 	if (erased)
 		delete counters;
 
@@ -533,12 +594,26 @@ WFCounterTask *WFTaskFactory::create_counter_task(const std::string& name,
 												  unsigned int target_value,
 												  counter_callback_t callback)
 {
-	return __counter_map.create(name, target_value, std::move(callback));
+	return __counter_map.create(name, __get_name_hash(name), target_value,
+								std::move(callback));
+}
+
+WFCounterTask *WFTaskFactory::create_counter_task(const WFTaskName& name,
+												  unsigned int target_value,
+												  counter_callback_t callback)
+{
+	return __counter_map.create(name.get_name(), name.get_hash(),
+								target_value, std::move(callback));
 }
 
 int WFTaskFactory::count_by_name(const std::string& name, unsigned int n)
 {
-	return __counter_map.count_n(name, n);
+	return __counter_map.count_n(name, __get_name_hash(name), n);
+}
+
+int WFTaskFactory::count_by_name(const WFTaskName& name, unsigned int n)
+{
+	return __counter_map.count_n(name.get_name(), name.get_hash(), n);
 }
 
 /****************** Named Mailbox ******************/
@@ -557,35 +632,33 @@ public:
 	using MailboxList = __NamedObjectList<struct __mailbox_node>;
 
 public:
-	WFMailboxTask *create(const std::string& name, void **mailbox,
+	WFMailboxTask *create(const std::string& name, size_t hash,
+						  void **mailbox, mailbox_callback_t&& cb);
+	WFMailboxTask *create(const std::string& name, size_t hash,
 						  mailbox_callback_t&& cb);
-	WFMailboxTask *create(const std::string& name, mailbox_callback_t&& cb);
 
-	int send(const std::string& name, void *const msg[], size_t max, int inc);
+	int send(const std::string& name, size_t hash,
+			 void *const msg[], size_t max, int inc);
 	void send(MailboxList *mailboxes, struct __mailbox_node *node, void *msg);
 
 	void remove(MailboxList *mailboxes, struct __mailbox_node *node)
 	{
+		auto *shard = shards_.get(mailboxes->hash);
 		bool erased;
 
-		mutex_.lock();
-		erased = mailboxes->del(node, &root_);
-		mutex_.unlock();
+		shard->mutex.lock();
+		erased = mailboxes->del(node, &shard->root);
+		shard->mutex.unlock();
 		if (erased)
 			delete mailboxes;
 	}
 
 private:
+	void push_to(__WFNamedMailboxTask *task,
+				 const std::string& name, size_t hash);
 	bool send_max_locked(MailboxList *mailboxes, size_t max,
-						 struct list_head *task_list);
-	struct rb_root root_;
-	std::mutex mutex_;
-
-public:
-	__NamedMailboxMap()
-	{
-		root_.rb_node = NULL;
-	}
+						 struct rb_root *root, struct list_head *task_list);
+	__NamedObjectShards shards_;
 } __mailbox_map;
 
 class __WFNamedMailboxTask : public WFMailboxTask
@@ -625,28 +698,36 @@ private:
 	__NamedMailboxMap::MailboxList *mailboxes_;
 };
 
-WFMailboxTask *__NamedMailboxMap::create(const std::string& name,
+void __NamedMailboxMap::push_to(__WFNamedMailboxTask *task,
+								const std::string& name, size_t hash)
+{
+	auto *shard = shards_.get(hash);
+
+	shard->mutex.lock();
+	task->push_to(__get_object_list<MailboxList>(name, hash, &shard->root,
+												 true));
+	shard->mutex.unlock();
+}
+
+WFMailboxTask *__NamedMailboxMap::create(const std::string& name, size_t hash,
 										 void **mailbox,
 										 mailbox_callback_t&& cb)
 {
 	auto *task = new __WFNamedMailboxTask(mailbox, std::move(cb));
-	mutex_.lock();
-	task->push_to(__get_object_list<MailboxList>(name, &root_, true));
-	mutex_.unlock();
+	push_to(task, name, hash);
 	return task;
 }
 
-WFMailboxTask *__NamedMailboxMap::create(const std::string& name,
+WFMailboxTask *__NamedMailboxMap::create(const std::string& name, size_t hash,
 										 mailbox_callback_t&& cb)
 {
 	auto *task = new __WFNamedMailboxTask(std::move(cb));
-	mutex_.lock();
-	task->push_to(__get_object_list<MailboxList>(name, &root_, true));
-	mutex_.unlock();
+	push_to(task, name, hash);
 	return task;
 }
 
 bool __NamedMailboxMap::send_max_locked(MailboxList *mailboxes, size_t max,
+										struct rb_root *root,
 										struct list_head *task_list)
 {
 	if (max == (size_t)-1)
@@ -663,25 +744,27 @@ bool __NamedMailboxMap::send_max_locked(MailboxList *mailboxes, size_t max,
 		} while (!mailboxes->empty());
 	}
 
-	rb_erase(&mailboxes->rb, &root_);
+	rb_erase(&mailboxes->rb, root);
 	return true;
 }
 
-int __NamedMailboxMap::send(const std::string& name, void *const msg[],
-							size_t max, int inc)
+int __NamedMailboxMap::send(const std::string& name, size_t hash,
+							void *const msg[], size_t max, int inc)
 {
+	auto *shard = shards_.get(hash);
 	LIST_HEAD(task_list);
 	struct __mailbox_node *node;
 	MailboxList *mailboxes;
 	bool erased = false;
 	int ret = 0;
 
-	mutex_.lock();
-	mailboxes = __get_object_list<MailboxList>(name, &root_, false);
+	shard->mutex.lock();
+	mailboxes = __get_object_list<MailboxList>(name, hash, &shard->root,
+											   false);
 	if (mailboxes)
-		erased = send_max_locked(mailboxes, max, &task_list);
+		erased = send_max_locked(mailboxes, max, &shard->root, &task_list);
 
-	mutex_.unlock();
+	shard->mutex.unlock();
 	if (erased)
 		delete mailboxes;
 
@@ -701,11 +784,12 @@ void __NamedMailboxMap::send(MailboxList *mailboxes,
 							 struct __mailbox_node *node,
 							 void *msg)
 {
+	auto *shard = shards_.get(mailboxes->hash);
 	bool erased;
 
-	mutex_.lock();
-	erased = mailboxes->del(node, &root_);
-	mutex_.unlock();
+	shard->mutex.lock();
+	erased = mailboxes->del(node, &shard->root);
+	shard->mutex.unlock();
 	if (erased)
 		delete mailboxes;
 
@@ -716,26 +800,49 @@ WFMailboxTask *WFTaskFactory::create_mailbox_task(const std::string& name,
 												  void **mailbox,
 												  mailbox_callback_t callback)
 {
-	return __mailbox_map.create(name, mailbox, std::move(callback));
+	return __mailbox_map.create(name, __get_name_hash(name), mailbox,
+								std::move(callback));
 }
 
 WFMailboxTask *WFTaskFactory::create_mailbox_task(const std::string& name,
 												  mailbox_callback_t callback)
 {
-	return __mailbox_map.create(name, std::move(callback));
+	return __mailbox_map.create(name, __get_name_hash(name),
+								std::move(callback));
+}
+
+WFMailboxTask *WFTaskFactory::create_mailbox_task(const WFTaskName& name,
+												  void **mailbox,
+												  mailbox_callback_t callback)
+{
+	return __mailbox_map.create(name.get_name(), name.get_hash(), mailbox,
+								std::move(callback));
+}
+
+WFMailboxTask *WFTaskFactory::create_mailbox_task(const WFTaskName& name,
+												  mailbox_callback_t callback)
+{
+	return __mailbox_map.create(name.get_name(), name.get_hash(),
+								std::move(callback));
 }
 
 int WFTaskFactory::send_by_name(const std::string& name, void *msg,
 								size_t max)
 {
-	return __mailbox_map.send(name, &msg, max, 0);
+	return __mailbox_map.send(name, __get_name_hash(name), &msg, max, 0);
+}
+
+int WFTaskFactory::send_by_name(const WFTaskName& name, void *msg,
+								size_t max)
+{
+	return __mailbox_map.send(name.get_name(), name.get_hash(), &msg, max, 0);
 }
 
 template<>
 int WFTaskFactory::send_by_name(const std::string& name, void *const msg[],
 								size_t max)
 {
-	return __mailbox_map.send(name, msg, max, 1);
+	return __mailbox_map.send(name, __get_name_hash(name), msg, max, 1);
 }
 
 /****************** Named Conditional ******************/
@@ -754,36 +861,34 @@ public:
 	using ConditionalList = __NamedObjectList<struct __conditional_node>;
 
 public:
-	WFConditional *create(const std::string& name, SubTask *task,
-						  void **msgbuf);
-	WFConditional *create(const std::string& name, SubTask *task);
+	WFConditional *create(const std::string& name, size_t hash,
+						  SubTask *task, void **msgbuf);
+	WFConditional *create(const std::string& name, size_t hash,
+						  SubTask *task);
 
-	int signal(const std::string& name, void *const msg[], size_t max, int inc);
+	int signal(const std::string& name, size_t hash,
+			   void *const msg[], size_t max, int inc);
 	void signal(ConditionalList *conds, struct __conditional_node *node,
 				void *msg);
 
 	void remove(ConditionalList *conds, struct __conditional_node *node)
 	{
+		auto *shard = shards_.get(conds->hash);
 		bool erased;
 
-		mutex_.lock();
-		erased = conds->del(node, &root_);
-		mutex_.unlock();
+		shard->mutex.lock();
+		erased = conds->del(node, &shard->root);
+		shard->mutex.unlock();
 		if (erased)
 			delete conds;
 	}
 
 private:
+	void push_to(__WFNamedConditional *cond,
+				 const std::string& name, size_t hash);
 	bool signal_max_locked(ConditionalList *conds, size_t max,
-						   struct list_head *cond_list);
-	struct rb_root root_;
-	std::mutex mutex_;
-
-public:
-	__NamedConditionalMap()
-	{
-		root_.rb_node = NULL;
-	}
+						   struct rb_root *root, struct list_head *cond_list);
+	__NamedObjectShards shards_;
 } __conditional_map;
 
 class __WFNamedConditional : public WFConditional
@@ -823,28 +928,38 @@ private:
 	__NamedConditionalMap::ConditionalList *conds_;
 };
 
+void __NamedConditionalMap::push_to(__WFNamedConditional *cond,
+									const std::string& name, size_t hash)
+{
+	auto *shard = shards_.get(hash);
+
+	shard->mutex.lock();
+	cond->push_to(__get_object_list<ConditionalList>(name, hash, &shard->root,
+													 true));
+	shard->mutex.unlock();
+}
+
 WFConditional *__NamedConditionalMap::create(const std::string& name,
+											 size_t hash,
 											 SubTask *task, void **msgbuf)
 {
 	auto *cond = new __WFNamedConditional(task, msgbuf);
-	mutex_.lock();
-	cond->push_to(__get_object_list<ConditionalList>(name, &root_, true));
-	mutex_.unlock();
+	push_to(cond, name, hash);
 	return cond;
 }
 
 WFConditional *__NamedConditionalMap::create(const std::string& name,
+											 size_t hash,
 											 SubTask *task)
 {
 	auto *cond = new __WFNamedConditional(task);
-	mutex_.lock();
-	cond->push_to(__get_object_list<ConditionalList>(name, &root_, true));
-	mutex_.unlock();
+	push_to(cond, name, hash);
 	return cond;
 }
 
 bool __NamedConditionalMap::signal_max_locked(ConditionalList *conds,
 											  size_t max,
+											  struct rb_root *root,
 											  struct list_head *cond_list)
 {
 	if (max == (size_t)-1)
@@ -861,25 +976,27 @@ bool __NamedConditionalMap::signal_max_locked(ConditionalList *conds,
 		} while (!conds->empty());
 	}
 
-	rb_erase(&conds->rb, &root_);
+	rb_erase(&conds->rb, root);
 	return true;
 }
 
-int __NamedConditionalMap::signal(const std::string& name, void *const msg[],
-								  size_t max, int inc)
+int __NamedConditionalMap::signal(const std::string& name, size_t hash,
+								  void *const msg[], size_t max, int inc)
 {
+	auto *shard = shards_.get(hash);
 	LIST_HEAD(cond_list);
 	struct __conditional_node *node;
 	ConditionalList *conds;
 	bool erased = false;
 	int ret = 0;
 
-	mutex_.lock();
-	conds = __get_object_list<ConditionalList>(name, &root_, false);
+	shard->mutex.lock();
+	conds = __get_object_list<ConditionalList>(name, hash, &shard->root,
+											   false);
 	if (conds)
-		erased = signal_max_locked(conds, max, &cond_list);
+		erased = signal_max_locked(conds, max, &shard->root, &cond_list);
 
-	mutex_.unlock();
+	shard->mutex.unlock();
 	if (erased)
 		delete conds;
 
@@ -899,11 +1016,12 @@ void __NamedConditionalMap::signal(ConditionalList *conds,
 								   struct __conditional_node *node,
 								   void *msg)
 {
+	auto *shard = shards_.get(conds->hash);
 	bool erased;
 
-	mutex_.lock();
-	erased = conds->del(node, &root_);
-	mutex_.unlock();
+	shard->mutex.lock();
+	erased = conds->del(node, &shard->root);
+	shard->mutex.unlock();
 	if (erased)
 		delete conds;
 
@@ -913,26 +1031,46 @@ void __NamedConditionalMap::signal(ConditionalList *conds,
 WFConditional *WFTaskFactory::create_conditional(const std::string& name,
 												 SubTask *task, void **msgbuf)
 {
-	return __conditional_map.create(name, task, msgbuf);
+	return __conditional_map.create(name, __get_name_hash(name), task, msgbuf);
 }
 
 WFConditional *WFTaskFactory::create_conditional(const std::string& name,
 												 SubTask *task)
 {
-	return __conditional_map.create(name, task);
+	return __conditional_map.create(name, __get_name_hash(name), task);
+}
+
+WFConditional *WFTaskFactory::create_conditional(const WFTaskName& name,
+												 SubTask *task, void **msgbuf)
+{
+	return __conditional_map.create(name.get_name(), name.get_hash(),
+									task, msgbuf);
+}
+
+WFConditional *WFTaskFactory::create_conditional(const WFTaskName& name,
+												 SubTask *task)
+{
+	return __conditional_map.create(name.get_name(), name.get_hash(), task);
 }
 
 int WFTaskFactory::signal_by_name(const std::string& name, void *msg,
 								  size_t max)
 {
-	return __conditional_map.signal(name, &msg, max, 0);
+	return __conditional_map.signal(name, __get_name_hash(name), &msg, max, 0);
+}
+
+int WFTaskFactory::signal_by_name(const WFTaskName& name, void *msg,
+								  size_t max)
+{
+	return __conditional_map.signal(name.get_name(), name.get_hash(),
+									&msg, max, 0);
 }
 
 template<>
 int WFTaskFactory::signal_by_name(const std::string& name, void *const msg[],
 								  size_t max)
 {
-	return __conditional_map.signal(name, msg, max, 1);
+	return __conditional_map.signal(name, __get_name_hash(name), msg, max, 1);
 }
 
 /****************** Named Guard ******************/
@@ -950,7 +1088,8 @@ static class __NamedGuardMap
 public:
 	struct GuardList : public __NamedObjectList<struct __guard_node>
 	{
-		GuardList(const std::string& name) : __NamedObjectList(name)
+		GuardList(const std::string& name, size_t hash) :
+			__NamedObjectList(name, hash)
 		{
 			acquired = false;
 			refcnt = 0;
@@ -962,33 +1101,30 @@ public:
 	};
 
 public:
-	WFConditional *create(const std::string& name, SubTask *task);
-	WFConditional *create(const std::string& name, SubTask *task,
-						  void **msgbuf);
+	WFConditional *create(const std::string& name, size_t hash,
+						  SubTask *task);
+	WFConditional *create(const std::string& name, size_t hash,
+						  SubTask *task, void **msgbuf);
 
-	struct __guard_node *release(const std::string& name);
+	struct __guard_node *release(const std::string& name, size_t hash);
 
 	void unref(GuardList *guards)
 	{
-		mutex_.lock();
+		auto *shard = shards_.get(guards->hash);
+
+		shard->mutex.lock();
 		if (--guards->refcnt == 0)
-			rb_erase(&guards->rb, &root_);
+			rb_erase(&guards->rb, &shard->root);
 		else
 			guards = NULL;
 
-		mutex_.unlock();
+		shard->mutex.unlock();
 		delete guards;
 	}
 
 private:
-	struct rb_root root_;
-	std::mutex mutex_;
-
-public:
-	__NamedGuardMap()
-	{
-		root_.rb_node = NULL;
-	}
+	GuardList *acquire(const std::string& name, size_t hash);
+	__NamedObjectShards shards_;
 } __guard_map;
 
 class __WFNamedGuard : public WFConditional
@@ -1035,39 +1171,48 @@ void __WFNamedGuard::dispatch()
 	this->WFConditional::dispatch();
 }
 
-WFConditional *__NamedGuardMap::create(const std::string& name,
+__NamedGuardMap::GuardList *__NamedGuardMap::acquire(const std::string& name,
+													  size_t hash)
+{
+	auto *shard = shards_.get(hash);
+	GuardList *guards;
+
+	shard->mutex.lock();
+	guards = __get_object_list<GuardList>(name, hash, &shard->root, true);
+	guards->refcnt++;
+	shard->mutex.unlock();
+	return guards;
+}
+
+WFConditional *__NamedGuardMap::create(const std::string& name, size_t hash,
 									   SubTask *task)
 {
 	auto *guard = new __WFNamedGuard(task);
-	mutex_.lock();
-	guard->guards_ = __get_object_list<GuardList>(name, &root_, true);
-	guard->guards_->refcnt++;
-	mutex_.unlock();
+	guard->guards_ = acquire(name, hash);
 	return guard;
 }
 
-WFConditional *__NamedGuardMap::create(const std::string& name,
+WFConditional *__NamedGuardMap::create(const std::string& name, size_t hash,
 									   SubTask *task, void **msgbuf)
 {
 	auto *guard = new __WFNamedGuard(task, msgbuf);
-	mutex_.lock();
-	guard->guards_ = __get_object_list<GuardList>(name, &root_, true);
-	guard->guards_->refcnt++;
-	mutex_.unlock();
+	guard->guards_ = acquire(name, hash);
 	return guard;
 }
 
-struct __guard_node *__NamedGuardMap::release(const std::string& name)
+struct __guard_node *__NamedGuardMap::release(const std::string& name,
+											  size_t hash)
 {
+	auto *shard = shards_.get(hash);
 	struct __guard_node *node = NULL;
 	GuardList *guards;
 
-	mutex_.lock();
-	guards = __get_object_list<GuardList>(name, &root_, false);
+	shard->mutex.lock();
+	guards = __get_object_list<GuardList>(name, hash, &shard->root, false);
 	if (guards)
 	{
 		if (--guards->refcnt == 0)
-			rb_erase(&guards->rb, &root_);
+			rb_erase(&guards->rb, &shard->root);
 		else
 		{
 			guards->mutex.lock();
@@ -1084,7 +1229,7 @@ struct __guard_node *__NamedGuardMap::release(const std::string& name)
 		}
 	}
 
-	mutex_.unlock();
+	shard->mutex.unlock();
 	delete guards;
 	return node;
 }
@@ -1092,19 +1237,29 @@ struct __guard_node *__NamedGuardMap::release(const std::string& name)
 WFConditional *WFTaskFactory::create_guard(const std::string& name,
 										   SubTask *task)
 {
-	return __guard_map.create(name, task);
+	return __guard_map.create(name, __get_name_hash(name), task);
 }
 
 WFConditional *WFTaskFactory::create_guard(const std::string& name,
 										   SubTask *task, void **msgbuf)
 {
-	return __guard_map.create(name, task, msgbuf);
+	return __guard_map.create(name, __get_name_hash(name), task, msgbuf);
 }
 
-int WFTaskFactory::release_guard(const std::string& name, void *msg)
+WFConditional *WFTaskFactory::create_guard(const WFTaskName& name,
+										   SubTask *task)
+{
+	return __guard_map.create(name.get_name(), name.get_hash(), task);
+}
+
+WFConditional *WFTaskFactory::create_guard(const WFTaskName& name,
+										   SubTask *task, void **msgbuf)
 {
-	struct __guard_node *node = __guard_map.release(name);
+	return __guard_map.create(name.get_name(), name.get_hash(), task, msgbuf);
+}
 
+static int __release_guard(struct __guard_node *node, void *msg)
+{
 	if (!node)
 		return 0;
 
@@ -1112,9 +1267,8 @@ int WFTaskFactory::release_guard(const std::string& name, void *msg)
 	return 1;
 }
 
-int WFTaskFactory::release_guard_safe(const std::string& name, void *msg)
+static int __release_guard_safe(struct __guard_node *node, void *msg)
 {
-	struct __guard_node *node = __guard_map.release(name);
 	WFTimerTask *timer;
 
 	if (!node)
@@ -1128,6 +1282,33 @@ int WFTaskFactory::release_guard_safe(const std::string& name, void *msg)
 	return 1;
 }
 
+int WFTaskFactory::release_guard(const std::string& name, void *msg)
+{
+	return __release_guard(__guard_map.release(name, __get_name_hash(name)),
+						   msg);
+}
+
+int WFTaskFactory::release_guard(const WFTaskName& name, void *msg)
+{
+	return __release_guard(__guard_map.release(name.get_name(),
+											   name.get_hash()),
+						   msg);
+}
+
+int WFTaskFactory::release_guard_safe(const std::string& name, void *msg)
+{
+	return __release_guard_safe(__guard_map.release(name,
+													__get_name_hash(name)),
+								msg);
+}
+
+int WFTaskFactory::release_guard_safe(const WFTaskName& name, void *msg)
+{
+	return __release_guard_safe(__guard_map.release(name.get_name(),
+													name.get_hash()),
+								msg);
+}
+
 /**************** Timed Go Task *****************/
 
 void __WFTimedGoTask::dispatch()
@@ -24,6 +24,7 @@
 #include <sys/uio.h>
 #include <time.h>
 #include <utility>
+#include <string>
 #include <functional>
 #include <openssl/ssl.h>
 #include "URIParser.h"
@@ -107,6 +108,29 @@ using repeater_callback_t = std::function<void (WFRepeaterTask *)>;
 
 using module_callback_t = std::function<void (const WFModuleTask *)>;
 
+/* A name of timers, counters, mailboxes, conditionals or guards, hashed
+ * once. Keep it and pass it instead of the string for frequent calls. */
+class WFTaskName
+{
+public:
+	WFTaskName(const std::string& name) :
+		name(name), hash(std::hash<std::string>()(name))
+	{
+	}
+
+	WFTaskName(std::string&& name) :
+		name(std::move(name)), hash(std::hash<std::string>()(this->name))
+	{
+	}
+
+	const std::string& get_name() const { return this->name; }
+	size_t get_hash() const { return this->hash; }
+
+private:
+	std::string name;
+	size_t hash;
+};
+
 class WFTaskFactory
 {
 public:
@@ -215,6 +239,31 @@ public:
 											  off_t offset,
 											  fvio_callback_t callback);
 
+	/* Direct I/O read tasks, bypassing the page cache. Any 'offset' and
+	 * 'count' are allowed. The 4KB aligned blocks covering them are read
+	 * into an aligned buffer from the pool below. In callback, 'args.buf'
+	 * points to the data at 'offset' and the retval is the number of bytes
+	 * there, which is less than 'count' at the end of file. The buffer is
+	 * given back to the pool after callback. The fd version requires a fd
+	 * opened with O_DIRECT, and the path version opens the file with it. */
+public:
+	static WFFileIOTask *create_direct_pread_task(int fd,
+												  size_t count,
+												  off_t offset,
+												  fio_callback_t callback);
+
+	static WFFileIOTask *create_direct_pread_task(const std::string& path,
+												  size_t count,
+												  off_t offset,
+												  fio_callback_t callback);
+
+	/* Buffers aligned to 4KB for direct I/O. 'size' is rounded up to a
+	 * power of 2, and buffers up to 4MB are cached for reuse. Return NULL
+	 * with errno set on failure. Free with the same 'size'. */
+public:
+	static void *alloc_direct_buffer(size_t size);
+	static void free_direct_buffer(void *buf, size_t size);
+
 public:
 	static WFTimerTask *create_timer_task(time_t seconds, long nanoseconds,
 										  timer_callback_t callback);
@@ -233,6 +282,18 @@ public:
 	/* Cancel at most 'max' timers under the name. */
 	static int cancel_by_name(const std::string& timer_name, size_t max);
 
+	/* The same functions with a pre-hashed name. */
+	static WFTimerTask *create_timer_task(const WFTaskName& timer_name,
+										  time_t seconds, long nanoseconds,
+										  timer_callback_t callback);
+
+	static int cancel_by_name(const WFTaskName& timer_name)
+	{
+		return WFTaskFactory::cancel_by_name(timer_name, (size_t)-1);
+	}
+
+	static int cancel_by_name(const WFTaskName& timer_name, size_t max);
+
 	/* Timer to be canceled immediately after started. */
 	static WFTimerTask *create_timer_task(timer_callback_t callback);
 
@@ -267,6 +328,17 @@ public:
 	 * creation, and more than one counter may reach target value. */
 	static int count_by_name(const std::string& counter_name, unsigned int n);
 
+	static WFCounterTask *create_counter_task(const WFTaskName& counter_name,
+											  unsigned int target_value,
+											  counter_callback_t callback);
+
+	static int count_by_name(const WFTaskName& counter_name)
+	{
+		return WFTaskFactory::count_by_name(counter_name, 1);
+	}
+
+	static int count_by_name(const WFTaskName& counter_name, unsigned int n);
+
 public:
 	static WFMailboxTask *create_mailbox_task(void **mailbox,
 											  mailbox_callback_t callback)
@@ -301,6 +373,21 @@ public:
 	static int send_by_name(const std::string& mailbox_name, T *const msg[],
 							size_t max);
 
+	static WFMailboxTask *create_mailbox_task(const WFTaskName& mailbox_name,
+											  void **mailbox,
+											  mailbox_callback_t callback);
+
+	static WFMailboxTask *create_mailbox_task(const WFTaskName& mailbox_name,
+											  mailbox_callback_t callback);
+
+	static int send_by_name(const WFTaskName& mailbox_name, void *msg)
+	{
+		return WFTaskFactory::send_by_name(mailbox_name, msg, (size_t)-1);
+	}
+
+	static int send_by_name(const WFTaskName& mailbox_name, void *msg,
+							size_t max);
+
 public:
 	static WFSelectorTask *create_selector_task(size_t candidates,
 												selector_callback_t callback)
@@ -337,6 +424,20 @@ public:
 	static int signal_by_name(const std::string& cond_name, T *const msg[],
 							  size_t max);
 
+	static WFConditional *create_conditional(const WFTaskName& cond_name,
+											 SubTask *task, void **msgbuf);
+
+	static WFConditional *create_conditional(const WFTaskName& cond_name,
+											 SubTask *task);
+
+	static int signal_by_name(const WFTaskName& cond_name, void *msg)
+	{
+		return WFTaskFactory::signal_by_name(cond_name, msg, (size_t)-1);
+	}
+
+	static int signal_by_name(const WFTaskName& cond_name, void *msg,
+							  size_t max);
+
 public:
 	static WFConditional *create_guard(const std::string& resource_name,
 									   SubTask *task);
@@ -351,6 +452,16 @@ public:
 
 	static int release_guard_safe(const std::string& resource_name, void *msg);
 
+	static WFConditional *create_guard(const WFTaskName& resource_name,
+									   SubTask *task);
+
+	static WFConditional *create_guard(const WFTaskName& resource_name,
+									   SubTask *task, void **msgbuf);
+
+	static int release_guard(const WFTaskName& resource_name, void *msg);
+
+	static int release_guard_safe(const WFTaskName& resource_name, void *msg);
+
 public:
 	template<class FUNC, class... ARGS>
 	static WFGoTask *create_go_task(const std::string& queue_name,
@@ -34,6 +34,7 @@
 #include "WFTask.h"
 #include "RouteManager.h"
 #include "URIParser.h"
+#include "InlineFunction.h"
 #include "WFTaskError.h"
 #include "EndpointParams.h"
 #include "WFNameService.h"
@@ -616,10 +617,14 @@ public:
 
 /************Go Task Factory************/
 
+/* The routine and its arguments are stored in the task, unless they are
+ * larger than the buffer of InlineFunction. */
+using __go_func_t = InlineFunction<void ()>;
+
 class __WFGoTask : public WFGoTask
 {
 public:
-	void set_go_func(std::function<void ()> func)
+	void set_go_func(__go_func_t func)
 	{
 		this->go = std::move(func);
 	}
@@ -631,11 +636,11 @@ protected:
 	}
 
 protected:
-	std::function<void ()> go;
+	__go_func_t go;
 
 public:
 	__WFGoTask(ExecQueue *queue, Executor *executor,
-			   std::function<void ()>&& func) :
+			   __go_func_t&& func) :
 		WFGoTask(queue, executor),
 		go(std::move(func))
 	{
@@ -662,7 +667,7 @@ protected:
 public:
 	__WFTimedGoTask(time_t seconds, long nanoseconds,
 					ExecQueue *queue, Executor *executor,
-					std::function<void ()>&& func) :
+					__go_func_t&& func) :
 		__WFGoTask(queue, executor, std::move(func)),
 		ref(4)
 	{
@@ -19,10 +19,14 @@
 #include <assert.h>
 #include <stddef.h>
 #include <string.h>
+#include <new>
 #include <utility>
 #include <functional>
 #include <mutex>
 #include "Workflow.h"
+#include "WFTaskFactory.h"
+
+#define PARALLEL_DISPATCH_BATCH	1024
 
 SeriesWork::SeriesWork(SubTask *first, series_callback_t&& cb) :
 	callback(std::move(cb))
@@ -166,6 +170,8 @@ ParallelWork::ParallelWork(parallel_callback_t&& cb) :
 {
 	this->buf_size = 4;
 	this->all_series = (SeriesWork **)&this->subtasks[this->buf_size];
+	this->series_block = NULL;
+	this->block_size = 0;
 	this->context = NULL;
 }
 
@@ -186,6 +192,31 @@ ParallelWork::ParallelWork(SeriesWork *const all_series[], size_t n,
 		this->subtasks[i] = all_series[i]->first;
 	}
 
+	this->series_block = NULL;
+	this->block_size = 0;
+	this->context = NULL;
+}
+
+ParallelWork::ParallelWork(SubTask *const tasks[], size_t n,
+						   parallel_callback_t&& cb) :
+	ParallelTask(new SubTask *[2 * (n > 4 ? n : 4)], n),
+	callback(std::move(cb))
+{
+	SeriesWork *series;
+	size_t i;
+
+	this->buf_size = (n > 4 ? n : 4);
+	this->all_series = (SeriesWork **)&this->subtasks[this->buf_size];
+	this->series_block = (SeriesWork *)::operator new(n * sizeof (SeriesWork));
+	this->block_size = n;
+	for (i = 0; i < n; i++)
+	{
+		series = new(&this->series_block[i]) SeriesWork(tasks[i], nullptr);
+		series->in_parallel = this;
+		this->all_series[i] = series;
+		this->subtasks[i] = tasks[i];
+	}
+
 	this->context = NULL;
 }
 
@@ -217,6 +248,31 @@ void ParallelWork::add_series(SeriesWork *series)
 	this->subtasks_nr++;
 }
 
+/* Starting a huge bulk parallel may take long. Its batches except the
+ * first are started by the compute threads. */
+void ParallelWork::dispatch_subtasks(SubTask **subtasks, size_t n)
+{
+	size_t batch = PARALLEL_DISPATCH_BATCH;
+	size_t i;
+
+	if (this->series_block && n > batch)
+	{
+		for (i = batch; i < n; i += batch)
+		{
+			size_t nr = n - i < batch ? n - i : batch;
+
+			WFTaskFactory::create_go_task("__parallel_dispatch",
+										  [this, subtasks, i, nr]() {
+				this->ParallelTask::dispatch_subtasks(subtasks + i, nr);
+			})->start();
+		}
+
+		n = batch;
+	}
+
+	this->ParallelTask::dispatch_subtasks(subtasks, n);
+}
+
 SubTask *ParallelWork::done()
 {
 	SeriesWork *series = series_of(this);
@@ -226,7 +282,12 @@ SubTask *ParallelWork::done()
 		this->callback(this);
 
 	for (i = 0; i < this->subtasks_nr; i++)
-		delete this->all_series[i];
+	{
+		if (this->in_block(this->all_series[i]))
+			this->all_series[i]->~SeriesWork();
+		else
+			delete this->all_series[i];
+	}
 
 	this->subtasks_nr = 0;
 	delete this;
@@ -235,14 +296,26 @@ SubTask *ParallelWork::done()
 
 ParallelWork::~ParallelWork()
 {
+	SeriesWork *series;
 	size_t i;
 
 	for (i = 0; i < this->subtasks_nr; i++)
 	{
-		this->all_series[i]->in_parallel = NULL;
-		this->all_series[i]->dismiss_recursive();
+		series = this->all_series[i];
+		if (this->in_block(series))
+		{
+			/* Still in parallel, so that it's not deleted by itself. */
+			series->dismiss_recursive();
+			series->~SeriesWork();
+		}
+		else
+		{
+			series->in_parallel = NULL;
+			series->dismiss_recursive();
+		}
 	}
 
+	::operator delete(this->series_block);
 	delete []this->subtasks;
 }
 
@@ -25,6 +25,7 @@
 #include <functional>
 #include <mutex>
 #include "SubTask.h"
+#include "ObjectRecycler.h"
 
 class SeriesWork;
 class ParallelWork;
@@ -52,6 +53,17 @@ public:
 	start_parallel_work(SeriesWork *const all_series[], size_t n,
 						parallel_callback_t callback);
 
+	/* Create a parallel of 'n' series, the i-th starting with 'tasks[i]'.
+	 * All the series are allocated in one block, and a large parallel is
+	 * started in batches by the compute threads. */
+	static ParallelWork *
+	create_bulk_parallel_work(SubTask *const tasks[], size_t n,
+							  parallel_callback_t callback);
+
+	static void
+	start_bulk_parallel_work(SubTask *const tasks[], size_t n,
+							 parallel_callback_t callback);
+
 public:
 	static SeriesWork *
 	create_series_work(SubTask *first, SubTask *last,
@@ -62,7 +74,7 @@ public:
 					  series_callback_t callback);
 };
 
-class SeriesWork
+class SeriesWork : public RecycledObject
 {
 public:
 	void start()
@@ -265,6 +277,7 @@ public:
 
 protected:
 	virtual SubTask *done();
+	virtual void dispatch_subtasks(SubTask **subtasks, size_t n);
 
 protected:
 	void *context;
@@ -272,15 +285,24 @@ protected:
 
 private:
 	void expand_buf();
+	bool in_block(const SeriesWork *series) const
+	{
+		return series >= this->series_block &&
+			   series < this->series_block + this->block_size;
+	}
 
 private:
 	size_t buf_size;
 	SeriesWork **all_series;
+	SeriesWork *series_block;
+	size_t block_size;
 
 protected:
 	ParallelWork(parallel_callback_t&& callback);
 	ParallelWork(SeriesWork *const all_series[], size_t n,
 				 parallel_callback_t&& callback);
+	ParallelWork(SubTask *const tasks[], size_t n,
+				 parallel_callback_t&& callback);
 	virtual ~ParallelWork();
 	friend class Workflow;
 };
@@ -306,5 +328,20 @@ Workflow::start_parallel_work(SeriesWork *const all_series[], size_t n,
 	Workflow::start_series_work(p, nullptr);
 }
 
+inline ParallelWork *
+Workflow::create_bulk_parallel_work(SubTask *const tasks[], size_t n,
+									parallel_callback_t callback)
+{
+	return new ParallelWork(tasks, n, std::move(callback));
+}
+
+inline void
+Workflow::start_bulk_parallel_work(SubTask *const tasks[], size_t n,
+								   parallel_callback_t callback)
+{
+	ParallelWork *p = new ParallelWork(tasks, n, std::move(callback));
+	Workflow::start_series_work(p, nullptr);
+}
+
 #endif
 
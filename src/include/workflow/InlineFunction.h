@@ -0,0 +1 @@
+../../util/InlineFunction.h
\ No newline at end of file
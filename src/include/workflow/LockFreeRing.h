@@ -0,0 +1 @@
+../../util/LockFreeRing.h
\ No newline at end of file
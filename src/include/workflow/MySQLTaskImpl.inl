@@ -0,0 +1 @@
+../../factory/MySQLTaskImpl.inl
\ No newline at end of file
@@ -0,0 +1 @@
+../../util/ObjectRecycler.h
\ No newline at end of file
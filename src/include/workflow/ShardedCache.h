@@ -0,0 +1 @@
+../../util/ShardedCache.h
\ No newline at end of file
@@ -0,0 +1 @@
+../../server/WFHttpFileCache.h
\ No newline at end of file
@@ -0,0 +1 @@
+../../client/WFMultiplexClient.h
\ No newline at end of file
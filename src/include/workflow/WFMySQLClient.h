@@ -0,0 +1 @@
+../../client/WFMySQLClient.h
\ No newline at end of file
@@ -0,0 +1 @@
+../../client/WFMySQLStreamClient.h
\ No newline at end of file
@@ -0,0 +1 @@
+../../client/WFRedisCachingClient.h
\ No newline at end of file
@@ -0,0 +1 @@
+../../client/WFRedisClusterClient.h
\ No newline at end of file
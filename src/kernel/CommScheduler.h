@@ -209,6 +209,11 @@ public:
 		this->comm.customize_event_handler(handler);
 	}
 
+	void set_receive_budget(size_t budget)
+	{
+		this->comm.set_receive_budget(budget);
+	}
+
 private:
 	Communicator comm;
 
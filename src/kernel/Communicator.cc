@@ -37,6 +37,10 @@
 #include "mpoller.h"
 #include "Communicator.h"
 
+/* A connection is read again only after resumed for every reason. */
+#define PAUSE_BY_MESSAGE		1
+#define PAUSE_BY_BUDGET			2
+
 struct CommConnEntry
 {
 	struct list_head list;
@@ -60,6 +64,15 @@ struct CommConnEntry
 	CommTarget *target;
 	CommService *service;
 	mpoller_t *mpoller;
+	Communicator *comm;
+#define BUDGET_STATE_NONE		0
+#define BUDGET_STATE_RECEIVING	1
+#define BUDGET_STATE_PAUSED		2
+#define BUDGET_STATE_HELD		3
+	int budget_state;
+	size_t budget_size;
+	size_t budget_receiving;
+	struct list_head budget_list;
 	/* Connection entry's mutex is for client session only. */
 	pthread_mutex_t mutex;
 };
@@ -267,6 +280,18 @@ void CommMessageIn::renew()
 	session->begin_time.tv_nsec = -1;
 }
 
+int CommMessageIn::pause()
+{
+	struct CommConnEntry *entry = this->entry;
+	return mpoller_pause(entry->sockfd, PAUSE_BY_MESSAGE, entry->mpoller);
+}
+
+int CommMessageIn::resume()
+{
+	struct CommConnEntry *entry = this->entry;
+	return mpoller_resume(entry->sockfd, PAUSE_BY_MESSAGE, entry->mpoller);
+}
+
 int CommService::init(const struct sockaddr *bind_addr, socklen_t addrlen,
 					  int listen_timeout, int response_timeout)
 {
@@ -276,6 +301,13 @@ int CommService::init(const struct sockaddr *bind_addr, socklen_t addrlen,
 	if (this->bind_addr)
 	{
 		ret = pthread_mutex_init(&this->mutex, NULL);
+		if (ret == 0)
+		{
+			ret = pthread_cond_init(&this->cond, NULL);
+			if (ret != 0)
+				pthread_mutex_destroy(&this->mutex);
+		}
+
 		if (ret == 0)
 		{
 			memcpy(this->bind_addr, bind_addr, addrlen);
@@ -286,6 +318,11 @@ int CommService::init(const struct sockaddr *bind_addr, socklen_t addrlen,
 
 			this->ssl_ctx = NULL;
 			this->ssl_accept_timeout = 0;
+			this->receive_budget = 0;
+			this->receive_size = 0;
+			this->datagram_batch = 1;
+			this->flushing = 0;
+			INIT_LIST_HEAD(&this->datagram_list);
 			return 0;
 		}
 
@@ -298,6 +335,7 @@ int CommService::init(const struct sockaddr *bind_addr, socklen_t addrlen,
 
 void CommService::deinit()
 {
+	pthread_cond_destroy(&this->cond);
 	pthread_mutex_destroy(&this->mutex);
 	free(this->bind_addr);
 }
@@ -680,6 +718,7 @@ void Communicator::handle_incoming_request(struct poller_result *res)
 	case PR_ST_STOPPED:
 			state = CS_STATE_STOPPED;
 
+		this->release_budget(entry, 1);
 		pthread_mutex_lock(&target->mutex);
 		switch (entry->state)
 		{
@@ -733,6 +772,7 @@ void Communicator::handle_incoming_reply(struct poller_result *res)
 	pthread_mutex_t *mutex;
 	int state;
 
+	this->release_budget(entry, res->state != PR_ST_SUCCESS);
 	switch (res->state)
 	{
 	case PR_ST_SUCCESS:
@@ -827,6 +867,7 @@ void Communicator::handle_reply_result(struct poller_result *res)
 	int timeout;
 	int state;
 
+	this->release_budget(entry, 0);
 	switch (res->state)
 	{
 	case PR_ST_FINISHED:
@@ -961,6 +1002,9 @@ struct CommConnEntry *Communicator::accept_conn(CommServiceTarget *target,
 			{
 				entry->seq = 0;
 				entry->mpoller = NULL;
+				entry->budget_state = BUDGET_STATE_NONE;
+				entry->budget_size = 0;
+				entry->budget_receiving = 0;
 				entry->service = service;
 				entry->target = target;
 				entry->ssl = NULL;
@@ -1067,6 +1111,7 @@ void Communicator::handle_listen_result(struct poller_result *res)
 		if (entry)
 		{
 			entry->mpoller = this->mpoller;
+			entry->comm = this;
 			if (service->ssl_ctx)
 			{
 				if (__create_ssl(service->ssl_ctx, entry) >= 0 &&
@@ -1296,6 +1341,130 @@ void Communicator::handle_poller_result(struct poller_result *res)
 	free(res);
 }
 
+int Communicator::over_budget(const CommService *service) const
+{
+	if (this->receive_budget != 0 &&
+		this->receive_size > this->receive_budget)
+		return 1;
+
+	return service && service->receive_budget != 0 &&
+		   service->receive_size > service->receive_budget;
+}
+
+void Communicator::consume_budget(struct CommConnEntry *entry, size_t n,
+								  int complete)
+{
+	CommService *service = entry->service;
+
+	if (entry->budget_state == BUDGET_STATE_NONE)
+	{
+		if (this->receive_budget == 0 &&
+			(!service || service->receive_budget == 0))
+			return;
+	}
+
+	pthread_mutex_lock(&this->budget_mutex);
+	/* A pipelined request may start while the previous one is held. */
+	if (entry->budget_state == BUDGET_STATE_NONE ||
+		entry->budget_state == BUDGET_STATE_HELD)
+	{
+		entry->budget_state = BUDGET_STATE_RECEIVING;
+		this->receiving_conns++;
+	}
+
+	entry->budget_size += n;
+	entry->budget_receiving += n;
+	this->receive_size += n;
+	this->receiving_size += n;
+	if (service)
+		service->receive_size += n;
+
+	if (complete)
+	{
+		/* A request is held until replied. A reply is released soon. */
+		if (entry->budget_state == BUDGET_STATE_PAUSED)
+			list_del(&entry->budget_list);
+		else
+			this->receiving_conns--;
+
+		this->receiving_size -= entry->budget_receiving;
+		entry->budget_receiving = 0;
+		entry->budget_state = BUDGET_STATE_HELD;
+	}
+	else if (entry->budget_state == BUDGET_STATE_RECEIVING &&
+			 this->receiving_conns > 1 && this->over_budget(service) &&
+			 entry->budget_receiving * this->receiving_conns >=
+			 this->receiving_size)
+	{
+		/* Not smaller than the average, and another connection keeps
+		 * receiving, so that some message is always going to complete. */
+		if (mpoller_pause(entry->sockfd, PAUSE_BY_BUDGET,
+				  entry->mpoller) >= 0)
+		{
+			entry->budget_state = BUDGET_STATE_PAUSED;
+			list_add_tail(&entry->budget_list, &this->paused_list);
+			this->receiving_conns--;
+		}
+	}
+
+	pthread_mutex_unlock(&this->budget_mutex);
+}
+
+void Communicator::release_budget(struct CommConnEntry *entry, int closing)
+{
+	CommService *service = entry->service;
+	struct CommConnEntry *paused;
+	struct list_head *pos, *tmp;
+	size_t size;
+
+	if (entry->budget_state == BUDGET_STATE_NONE)
+		return;
+
+	pthread_mutex_lock(&this->budget_mutex);
+	/* Unless closing, a pipelined message being received is kept. */
+	if (closing)
+	{
+		switch (entry->budget_state)
+		{
+		case BUDGET_STATE_PAUSED:
+			list_del(&entry->budget_list);
+			this->receiving_size -= entry->budget_receiving;
+			break;
+
+		case BUDGET_STATE_RECEIVING:
+			this->receiving_conns--;
+			this->receiving_size -= entry->budget_receiving;
+			break;
+		}
+
+		entry->budget_receiving = 0;
+		entry->budget_state = BUDGET_STATE_NONE;
+	}
+	else if (entry->budget_state == BUDGET_STATE_HELD)
+		entry->budget_state = BUDGET_STATE_NONE;
+
+	size = entry->budget_size - entry->budget_receiving;
+	this->receive_size -= size;
+	if (service)
+		service->receive_size -= size;
+
+	entry->budget_size = entry->budget_receiving;
+	list_for_each_safe(pos, tmp, &this->paused_list)
+	{
+		paused = list_entry(pos, struct CommConnEntry, budget_list);
+		/* Even over budget, one connection must be receiving. */
+		if (this->receiving_conns != 0 && this->over_budget(paused->service))
+			continue;
+
+		list_del(pos);
+		paused->budget_state = BUDGET_STATE_RECEIVING;
+		this->receiving_conns++;
+		mpoller_resume(paused->sockfd, PAUSE_BY_BUDGET, paused->mpoller);
+	}
+
+	pthread_mutex_unlock(&this->budget_mutex);
+}
+
 void Communicator::handler_thread_routine(void *context)
 {
 	Communicator *comm = (Communicator *)context;
@@ -1315,6 +1484,9 @@ int Communicator::append_message(const void *buf, size_t *size,
 	int ret;
 
 	ret = in->append(buf, size);
+	if (ret >= 0)
+		entry->comm->consume_budget(entry, *size, ret);
+
 	if (ret > 0)
 	{
 		entry->state = CONN_STATE_SUCCESS;
@@ -1644,6 +1816,12 @@ int Communicator::init(size_t poller_threads, size_t handler_threads)
 		{
 			this->event_handler = NULL;
 			this->stop_flag = 0;
+			this->receive_budget = 0;
+			this->receive_size = 0;
+			this->receiving_size = 0;
+			this->receiving_conns = 0;
+			INIT_LIST_HEAD(&this->paused_list);
+			pthread_mutex_init(&this->budget_mutex, NULL);
 			return 0;
 		}
 
@@ -1666,6 +1844,7 @@ void Communicator::deinit()
 	thrdpool_destroy(NULL, this->thrdpool);
 	mpoller_destroy(this->mpoller);
 	msgqueue_destroy(this->msgqueue);
+	pthread_mutex_destroy(&this->budget_mutex);
 }
 
 int Communicator::nonblock_connect(CommTarget *target)
@@ -1710,6 +1889,9 @@ struct CommConnEntry *Communicator::launch_conn(CommSession *session,
 				{
 					entry->seq = 0;
 					entry->mpoller = NULL;
+					entry->budget_state = BUDGET_STATE_NONE;
+					entry->budget_size = 0;
+					entry->budget_receiving = 0;
 					entry->service = NULL;
 					entry->target = target;
 					entry->session = session;
@@ -1796,6 +1978,7 @@ int Communicator::request_new_conn(CommSession *session, CommTarget *target)
 	if (entry)
 	{
 		entry->mpoller = this->mpoller;
+		entry->comm = this;
 		session->conn = entry->conn;
 		session->seq = entry->seq++;
 		data.operation = PD_OP_CONNECT;
@@ -1890,6 +2073,7 @@ int Communicator::bind(CommService *service)
 		{
 			data.operation = PD_OP_RECVFROM;
 			data.recvfrom = Communicator::recvfrom;
+			data.batch = service->datagram_batch;
 		}
 
 		if (mpoller_add(&data, service->listen_timeout, this->mpoller) >= 0)
@@ -1948,6 +2132,139 @@ int Communicator::reply_reliable(CommSession *session, CommTarget *target)
 	return ret;
 }
 
+struct CommDatagram
+{
+	struct list_head list;
+	const struct sockaddr *addr;
+	socklen_t addrlen;
+	struct iovec *vectors;
+	int cnt;
+	int state;
+	int error;
+};
+
+#ifdef __linux__
+
+#define DATAGRAM_BATCH_MAX	64
+
+static void __send_datagrams(int sockfd, struct list_head *list, int batch)
+{
+	struct CommDatagram *dgrams[DATAGRAM_BATCH_MAX];
+	struct mmsghdr msgs[DATAGRAM_BATCH_MAX];
+	struct list_head *pos = list->next;
+	int ret;
+	int n;
+	int i;
+
+	while (pos != list)
+	{
+		n = 0;
+		do
+		{
+			dgrams[n] = list_entry(pos, struct CommDatagram, list);
+			pos = pos->next;
+			memset(&msgs[n], 0, sizeof (struct mmsghdr));
+			msgs[n].msg_hdr.msg_name = (struct sockaddr *)dgrams[n]->addr;
+			msgs[n].msg_hdr.msg_namelen = dgrams[n]->addrlen;
+			msgs[n].msg_hdr.msg_iov = dgrams[n]->vectors;
+			msgs[n].msg_hdr.msg_iovlen = dgrams[n]->cnt;
+		} while (++n < batch && pos != list);
+
+		/* sendmmsg() stops at the first datagram failed. Record the error
+		 * to its owner and go on with the rest. */
+		for (i = 0; i < n; i += ret)
+		{
+			ret = sendmmsg(sockfd, &msgs[i], n - i, 0);
+			if (ret <= 0)
+			{
+				dgrams[i]->error = ret < 0 ? errno : EAGAIN;
+				ret = 1;
+			}
+		}
+	}
+}
+
+#else
+
+static void __send_datagrams(int sockfd, struct list_head *list, int batch)
+{
+	struct CommDatagram *dgram;
+	struct list_head *pos;
+
+	list_for_each(pos, list)
+	{
+		dgram = list_entry(pos, struct CommDatagram, list);
+		struct msghdr message = {
+			.msg_name		=	(struct sockaddr *)dgram->addr,
+			.msg_namelen	=	dgram->addrlen,
+			.msg_iov		=	dgram->vectors,
+			.msg_iovlen		=	dgram->cnt,
+		};
+		if (sendmsg(sockfd, &message, 0) < 0)
+			dgram->error = errno;
+	}
+}
+
+#endif
+
+int Communicator::reply_message_batched(struct iovec vectors[], int cnt,
+										struct CommConnEntry *entry)
+{
+	CommService *service = entry->service;
+	struct CommDatagram dgram;
+	struct CommDatagram *cur;
+	struct list_head list;
+	struct list_head *pos, *tmp;
+
+	dgram.addr = entry->target->addr;
+	dgram.addrlen = entry->target->addrlen;
+	dgram.vectors = vectors;
+	dgram.cnt = cnt;
+	dgram.state = 0;
+	dgram.error = 0;
+
+	/* The first replier sends all the datagrams queued until it finishes,
+	 * while the others wait for the results of their own. All the datagrams
+	 * are sent through the flusher's fd, a dup of the listening socket. */
+	pthread_mutex_lock(&service->mutex);
+	list_add_tail(&dgram.list, &service->datagram_list);
+	if (!service->flushing)
+	{
+		service->flushing = 1;
+		do
+		{
+			INIT_LIST_HEAD(&list);
+			list_splice_init(&service->datagram_list, &list);
+			pthread_mutex_unlock(&service->mutex);
+			__send_datagrams(entry->sockfd, &list, service->datagram_batch);
+			pthread_mutex_lock(&service->mutex);
+			list_for_each_safe(pos, tmp, &list)
+			{
+				cur = list_entry(pos, struct CommDatagram, list);
+				cur->state = 1;
+			}
+
+			pthread_cond_broadcast(&service->cond);
+		} while (!list_empty(&service->datagram_list));
+
+		service->flushing = 0;
+	}
+	else
+	{
+		while (!dgram.state)
+			pthread_cond_wait(&service->cond, &service->mutex);
+	}
+
+	pthread_mutex_unlock(&service->mutex);
+	if (dgram.error)
+	{
+		errno = dgram.error;
+		return -1;
+	}
+
+	return 0;
+}
+
 int Communicator::reply_message_unreliable(struct CommConnEntry *entry)
 {
 	struct iovec vectors[ENCODE_IOV_MAX];
@@ -1961,6 +2278,9 @@ int Communicator::reply_message_unreliable(struct CommConnEntry *entry)
 		return -1;
 	}
 
+	if (cnt > 0 && entry->service->datagram_batch > 1)
+		return this->reply_message_batched(vectors, cnt, entry);
+
 	if (cnt > 0)
 	{
 		struct msghdr message = {
@@ -2036,6 +2356,7 @@ int Communicator::reply(CommSession *session)
 	if (ret == 0)
 	{
 		entry = session->in->entry;
+		this->release_budget(entry, 0);
 		session->handle(CS_STATE_SUCCESS, 0);
 		if (__sync_sub_and_fetch(&entry->ref, 1) == 0)
 		{
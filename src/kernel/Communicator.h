@@ -116,6 +116,14 @@ protected:
 	/* In append(), reset the begin time of receiving to current time. */
 	virtual void renew();
 
+	/* In append(), stop reading the connection after the data already read.
+	 * A pause is cancelled when the message is completed. */
+	virtual int pause();
+
+	/* Restart reading of a paused connection. Can be called in any thread,
+	 * but only before the message is completed or failed. */
+	virtual int resume();
+
 	/* Return the deepest wrapped message. */
 	virtual CommMessageIn *inner() { return this; }
 
@@ -194,6 +202,18 @@ protected:
 
 	SSL_CTX *get_ssl_ctx() const { return this->ssl_ctx; }
 
+	/* Budget of this service only. See Communicator::set_receive_budget(). */
+	void set_receive_budget(size_t budget) { this->receive_budget = budget; }
+
+	/* For unreliable service. Up to 'batch' (at most 64) datagrams are read
+	 * by one recvmmsg(), and replies made at the same time by different
+	 * threads are sent together by sendmmsg(). Each replier still gets the
+	 * result of its own datagram. */
+	void set_datagram_batch(size_t batch)
+	{
+		this->datagram_batch = batch < 64 ? (int)batch : 64;
+	}
+
 private:
 	virtual CommSession *new_session(long long seq, CommConnection *conn) = 0;
 	virtual void handle_stop(int error) { }
@@ -220,6 +240,16 @@ private:
 	int ssl_accept_timeout;
 	SSL_CTX *ssl_ctx;
 
+private:
+	size_t receive_budget;
+	size_t receive_size;
+
+private:
+	int datagram_batch;
+	int flushing;
+	struct list_head datagram_list;
+	pthread_cond_t cond;
+
 private:
 	void incref();
 	void decref();
@@ -306,12 +336,26 @@ public:
 public:
 	void customize_event_handler(CommEventHandler *handler);
 
+	/* Limit the total size of the messages being received, and of the
+	 * requests not yet replied. When exceeded, the connections receiving
+	 * the largest messages stop reading until some memory is released.
+	 * 0 means no limit. */
+	void set_receive_budget(size_t budget) { this->receive_budget = budget; }
+
 private:
 	struct __mpoller *mpoller;
 	struct __msgqueue *msgqueue;
 	struct __thrdpool *thrdpool;
 	int stop_flag;
 
+private:
+	size_t receive_budget;
+	size_t receive_size;
+	size_t receiving_size;
+	size_t receiving_conns;
+	struct list_head paused_list;
+	pthread_mutex_t budget_mutex;
+
 private:
 	CommEventHandler *event_handler;
 
@@ -334,11 +378,17 @@ private:
 	int request_new_conn(CommSession *session, CommTarget *target);
 	int request_idle_conn(CommSession *session, CommTarget *target);
 
+	int reply_message_batched(struct iovec vectors[], int cnt,
+							  struct CommConnEntry *entry);
 	int reply_message_unreliable(struct CommConnEntry *entry);
 
 	int reply_reliable(CommSession *session, CommTarget *target);
 	int reply_unreliable(CommSession *session, CommTarget *target);
 
+	int over_budget(const CommService *service) const;
+	void consume_budget(struct CommConnEntry *entry, size_t n, int complete);
+	void release_budget(struct CommConnEntry *entry, int closing);
+
 	void handle_poller_result(struct poller_result *res);
 
 	void handle_incoming_request(struct poller_result *res);
@@ -18,18 +18,32 @@
 
 #include <errno.h>
 #include <stdlib.h>
+#include <limits.h>
+#include <time.h>
 #include <pthread.h>
 #include "list.h"
+#include "rbtree.h"
 #include "thrdpool.h"
 #include "Executor.h"
 
+/* A queue of weight 1 advances its pass by this for every session. */
+#define EXEC_STRIDE		(1ULL << 20)
+
 struct ExecSessionEntry
 {
 	struct list_head list;
 	ExecSession *session;
-	thrdpool_t *thrdpool;
+	Executor *executor;
 };
 
+static long long __get_current_time()
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
 int ExecQueue::init()
 {
 	int ret;
@@ -38,6 +52,10 @@ int ExecQueue::init()
 	if (ret == 0)
 	{
 		INIT_LIST_HEAD(&this->session_list);
+		this->priority = 0;
+		this->weight = 1;
+		this->in_tree = false;
+		this->pass = 0;
 		return 0;
 	}
 
@@ -50,11 +68,38 @@ void ExecQueue::deinit()
 	pthread_mutex_destroy(&this->mutex);
 }
 
+void ExecQueue::set_priority(int priority, int weight)
+{
+	pthread_mutex_lock(&this->mutex);
+	this->priority = priority;
+	this->weight = weight > 0 ? weight : 1;
+	pthread_mutex_unlock(&this->mutex);
+}
+
+void ExecSession::set_deadline(time_t seconds, long nanoseconds)
+{
+	this->deadline = __get_current_time() + seconds * 1000000000LL + nanoseconds;
+}
+
 int Executor::init(size_t nthreads)
 {
-	this->thrdpool = thrdpool_create(nthreads, 0);
-	if (this->thrdpool)
-		return 0;
+	int ret;
+
+	ret = pthread_mutex_init(&this->mutex, NULL);
+	if (ret == 0)
+	{
+		this->thrdpool = thrdpool_create(nthreads, 0);
+		if (this->thrdpool)
+		{
+			this->queue_tree.rb_node = NULL;
+			this->tree_size = 0;
+			return 0;
+		}
+
+		pthread_mutex_destroy(&this->mutex);
+	}
+	else
+		errno = ret;
 
 	return -1;
 }
@@ -62,46 +107,221 @@ int Executor::init(size_t nthreads)
 void Executor::deinit()
 {
 	thrdpool_destroy(Executor::executor_cancel, this->thrdpool);
+	pthread_mutex_destroy(&this->mutex);
+}
+
+/* Called with queue->mutex held. The key is taken from the first session,
+ * and never changes while the queue is in the tree. */
+void Executor::push_queue(ExecQueue *queue, bool wakeup)
+{
+	struct ExecSessionEntry *entry;
+	struct rb_node **p = &this->queue_tree.rb_node;
+	struct rb_node *parent = NULL;
+	ExecQueue *q;
+
+	entry = list_entry(queue->session_list.next, struct ExecSessionEntry, list);
+	queue->key_priority = queue->priority;
+	queue->key_weight = queue->weight;
+	queue->key_deadline = entry->session->deadline;
+	if (queue->key_deadline == 0)
+		queue->key_deadline = LLONG_MAX;
+
+	pthread_mutex_lock(&this->mutex);
+	if (wakeup)
+	{
+		/* An idle queue can not save up its share. Catch up with the least
+		 * pass of the ready queues of the same priority and no deadline. */
+		struct rb_node *node = this->queue_tree.rb_node;
+		ExecQueue *bound = NULL;
+
+		while (node)
+		{
+			q = rb_entry(node, ExecQueue, rb);
+			if (q->key_priority < queue->key_priority ||
+				(q->key_priority == queue->key_priority &&
+				 q->key_deadline == LLONG_MAX))
+			{
+				bound = q;
+				node = node->rb_left;
+			}
+			else
+				node = node->rb_right;
+		}
+
+		if (bound && bound->key_priority == queue->key_priority &&
+			queue->pass < bound->pass)
+			queue->pass = bound->pass;
+	}
+
+	while (*p)
+	{
+		parent = *p;
+		q = rb_entry(*p, ExecQueue, rb);
+		if (queue->key_priority > q->key_priority)
+			p = &(*p)->rb_left;
+		else if (queue->key_priority < q->key_priority)
+			p = &(*p)->rb_right;
+		else if (queue->key_deadline < q->key_deadline)
+			p = &(*p)->rb_left;
+		else if (queue->key_deadline > q->key_deadline)
+			p = &(*p)->rb_right;
+		else if (queue->pass < q->pass)
+			p = &(*p)->rb_left;
+		else
+			p = &(*p)->rb_right;
+	}
+
+	rb_link_node(&queue->rb, parent, p);
+	rb_insert_color(&queue->rb, &this->queue_tree);
+	queue->in_tree = true;
+	__atomic_store_n(&this->tree_size, this->tree_size + 1, __ATOMIC_RELAXED);
+	pthread_mutex_unlock(&this->mutex);
+}
+
+ExecQueue *Executor::pop_queue()
+{
+	ExecQueue *queue = NULL;
+	struct rb_node *first;
+
+	pthread_mutex_lock(&this->mutex);
+	first = rb_first(&this->queue_tree);
+	if (first)
+	{
+		queue = rb_entry(first, ExecQueue, rb);
+		rb_erase(first, &this->queue_tree);
+		queue->in_tree = false;
+		__atomic_store_n(&this->tree_size, this->tree_size - 1, __ATOMIC_RELAXED);
+		queue->pass += EXEC_STRIDE / queue->key_weight;
+	}
+
+	pthread_mutex_unlock(&this->mutex);
+	return queue;
+}
+
+/* Called with queue->mutex held. Sets the task that runs the first session
+ * of the queue. While no queue waits in the tree, a queue of the default
+ * priority and weight, whose first session has no deadline, needs no
+ * ordering. Its session is scheduled by itself, not taking the mutex of
+ * the executor. */
+void Executor::ready_queue(ExecQueue *queue, bool wakeup,
+						   struct thrdpool_task *task)
+{
+	struct ExecSessionEntry *entry;
+
+	entry = list_entry(queue->session_list.next, struct ExecSessionEntry, list);
+	if (queue->priority == 0 && queue->weight == 1 &&
+		entry->session->deadline == 0 &&
+		__atomic_load_n(&this->tree_size, __ATOMIC_RELAXED) == 0)
+	{
+		task->routine = Executor::executor_queue_routine;
+		task->context = entry;
+	}
+	else
+	{
+		this->push_queue(queue, wakeup);
+		task->routine = Executor::executor_thread_routine;
+		task->context = this;
+	}
 }
 
 extern "C" void __thrdpool_schedule(const struct thrdpool_task *, void *,
 									thrdpool_t *);
 
-void Executor::executor_thread_routine(void *context)
+/* Called with queue->mutex held, and releases it. Runs the first session
+ * of the queue, after scheduling the next one. */
+void Executor::execute(ExecQueue *queue, bool wakeup)
 {
-	ExecQueue *queue = (ExecQueue *)context;
 	struct ExecSessionEntry *entry;
+	struct thrdpool_task task;
 	ExecSession *session;
 	int empty;
 
 	entry = list_entry(queue->session_list.next, struct ExecSessionEntry, list);
-	pthread_mutex_lock(&queue->mutex);
 	list_del(&entry->list);
 	empty = list_empty(&queue->session_list);
+	if (!empty)
+		this->ready_queue(queue, wakeup, &task);
+
 	pthread_mutex_unlock(&queue->mutex);
 
 	session = entry->session;
 	if (!empty)
-	{
-		struct thrdpool_task task = {
-			.routine	=	Executor::executor_thread_routine,
-			.context	=	queue
-		};
-		__thrdpool_schedule(&task, entry, entry->thrdpool);
-	}
+		__thrdpool_schedule(&task, entry, this->thrdpool);
 	else
 		free(entry);
 
-	session->execute();
-	session->handle(ES_STATE_FINISHED, 0);
+	if (session->deadline != 0 && session->deadline <= __get_current_time())
+		session->handle(ES_STATE_EXPIRED, ETIMEDOUT);
+	else
+	{
+		session->execute();
+		session->handle(ES_STATE_FINISHED, 0);
+	}
+}
+
+/* Every thread pool task of this routine stands for one queue in the tree,
+ * but not a certain one. It runs the first session of the best queue. */
+void Executor::executor_thread_routine(void *context)
+{
+	Executor *executor = (Executor *)context;
+	ExecQueue *queue;
+
+	while (1)
+	{
+		queue = executor->pop_queue();
+		if (!queue)
+			return;
+
+		pthread_mutex_lock(&queue->mutex);
+		if (!list_empty(&queue->session_list))
+			break;
+
+		/* Only when a request failed to schedule and removed its session. */
+		pthread_mutex_unlock(&queue->mutex);
+	}
+
+	executor->execute(queue, false);
+}
+
+/* A thread pool task of this routine runs the session of its entry, which
+ * is the first of its queue. If some queues got into the tree since, the
+ * queue joins them, and the task runs the best one instead. */
+void Executor::executor_queue_routine(void *context)
+{
+	struct ExecSessionEntry *entry = (struct ExecSessionEntry *)context;
+	Executor *executor = entry->executor;
+	ExecQueue *queue = entry->session->queue;
+
+	pthread_mutex_lock(&queue->mutex);
+	if (__atomic_load_n(&executor->tree_size, __ATOMIC_RELAXED) != 0)
+	{
+		executor->push_queue(queue, true);
+		pthread_mutex_unlock(&queue->mutex);
+		Executor::executor_thread_routine(executor);
+	}
+	else
+		executor->execute(queue, true);
 }
 
 void Executor::executor_cancel(const struct thrdpool_task *task)
 {
-	ExecQueue *queue = (ExecQueue *)task->context;
+	Executor *executor = (Executor *)task->context;
 	struct ExecSessionEntry *entry;
 	struct list_head *pos, *tmp;
 	ExecSession *session;
+	ExecQueue *queue;
+
+	if (task->routine == Executor::executor_queue_routine)
+	{
+		entry = (struct ExecSessionEntry *)task->context;
+		queue = entry->session->queue;
+	}
+	else
+	{
+		queue = executor->pop_queue();
+		if (!queue)
+			return;
+	}
 
 	list_for_each_safe(pos, tmp, &queue->session_list)
 	{
@@ -123,17 +343,26 @@ int Executor::request(ExecSession *session, ExecQueue *queue)
 	if (entry)
 	{
 		entry->session = session;
-		entry->thrdpool = this->thrdpool;
+		entry->executor = this;
 		pthread_mutex_lock(&queue->mutex);
 		list_add_tail(&entry->list, &queue->session_list);
 		if (queue->session_list.next == &entry->list)
 		{
-			struct thrdpool_task task = {
-				.routine	=	Executor::executor_thread_routine,
-				.context	=	queue
-			};
+			struct thrdpool_task task;
+
+			this->ready_queue(queue, true, &task);
 			if (thrdpool_schedule(&task, this->thrdpool) < 0)
 			{
+				pthread_mutex_lock(&this->mutex);
+				if (queue->in_tree)
+				{
+					rb_erase(&queue->rb, &this->queue_tree);
+					queue->in_tree = false;
+					__atomic_store_n(&this->tree_size, this->tree_size - 1,
+									 __ATOMIC_RELAXED);
+				}
+
+				pthread_mutex_unlock(&this->mutex);
 				list_del(&entry->list);
 				free(entry);
 				entry = NULL;
@@ -155,4 +384,3 @@ int Executor::decrease_thread()
 {
 	return thrdpool_decrease(this->thrdpool);
 }
-
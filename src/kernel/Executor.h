@@ -20,19 +20,43 @@
 #define _EXECUTOR_H_
 
 #include <stddef.h>
+#include <time.h>
 #include <pthread.h>
 #include "list.h"
-
+#include "rbtree.h"
+
+/* An executor runs the sessions of one queue in FIFO order. Across queues,
+ * the queues of a higher priority go first. Among the queues of the same
+ * priority, the one whose first session has the earliest deadline goes
+ * first, and the others share the threads in proportion to their weights.
+ * A queue is of priority 0 and weight 1 by default. While every ready queue
+ * is of the default, the queues are run in the order they get ready, with
+ * no lock shared among them. */
 class ExecQueue
 {
 public:
 	int init();
 	void deinit();
 
+public:
+	void set_priority(int priority, int weight);
+
 private:
 	struct list_head session_list;
 	pthread_mutex_t mutex;
 
+private:
+	int priority;
+	int weight;
+
+private:
+	struct rb_node rb;
+	bool in_tree;
+	int key_priority;
+	int key_weight;
+	long long key_deadline;
+	unsigned long long pass;
+
 public:
 	virtual ~ExecQueue() { }
 	friend class Executor;
@@ -41,6 +65,7 @@ public:
 #define ES_STATE_FINISHED	0
 #define ES_STATE_ERROR		1
 #define ES_STATE_CANCELED	2
+#define ES_STATE_EXPIRED	5	/* not executed before the deadline. */
 
 class ExecSession
 {
@@ -51,10 +76,15 @@ private:
 protected:
 	ExecQueue *get_queue() const { return this->queue; }
 
+	/* Expire the session if it is not executed within this time from now. */
+	void set_deadline(time_t seconds, long nanoseconds);
+
 private:
 	ExecQueue *queue;
+	long long deadline;
 
 public:
+	ExecSession() { this->deadline = 0; }
 	virtual ~ExecSession() { }
 	friend class Executor;
 };
@@ -73,9 +103,19 @@ public:
 
 private:
 	struct __thrdpool *thrdpool;
+	struct rb_root queue_tree;
+	size_t tree_size;
+	pthread_mutex_t mutex;
+
+private:
+	void push_queue(ExecQueue *queue, bool wakeup);
+	ExecQueue *pop_queue();
+	void ready_queue(ExecQueue *queue, bool wakeup, struct thrdpool_task *task);
+	void execute(ExecQueue *queue, bool wakeup);
 
 private:
 	static void executor_thread_routine(void *context);
+	static void executor_queue_routine(void *context);
 	static void executor_cancel(const struct thrdpool_task *task);
 
 public:
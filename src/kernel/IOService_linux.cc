@@ -21,6 +21,7 @@
 #include <sys/uio.h>
 #include <errno.h>
 #include <unistd.h>
+#include <stdlib.h>
 #include <string.h>
 #include <pthread.h>
 #include "list.h"
@@ -244,6 +245,8 @@ void IOSession::prep_fdsync(int fd)
 	iocb->aio_lio_opcode = IO_CMD_FDSYNC;
 }
 
+#define IOS_EVENTS_MAX		64
+
 int IOService::init(int maxevents)
 {
 	int ret;
@@ -254,6 +257,11 @@ int IOService::init(int maxevents)
 		return -1;
 	}
 
+	this->events = (struct io_event *)malloc(IOS_EVENTS_MAX *
+											 sizeof (struct io_event));
+	if (!this->events)
+		return -1;
+
 	this->io_ctx = NULL;
 	if (io_setup(maxevents, &this->io_ctx) >= 0)
 	{
@@ -261,6 +269,8 @@ int IOService::init(int maxevents)
 		if (ret == 0)
 		{
 			INIT_LIST_HEAD(&this->session_list);
+			this->events_cnt = 0;
+			this->events_pos = 0;
 			this->event_fd = -1;
 			return 0;
 		}
@@ -269,6 +279,7 @@ int IOService::init(int maxevents)
 		io_destroy(this->io_ctx);
 	}
 
+	free(this->events);
 	return -1;
 }
 
@@ -276,6 +287,7 @@ void IOService::deinit()
 {
 	pthread_mutex_destroy(&this->mutex);
 	io_destroy(this->io_ctx);
+	free(this->events);
 }
 
 inline void IOService::incref()
@@ -283,21 +295,44 @@ inline void IOService::incref()
 	__sync_add_and_fetch(&this->ref, 1);
 }
 
+/* Completion events are reaped in batches. Every event is still counted
+ * by the eventfd, so aio_finish() is called once for each of them. */
+IOSession *IOService::get_event(long min_nr)
+{
+	struct io_event *event;
+	IOSession *session;
+	int n;
+
+	if (this->events_pos == this->events_cnt)
+	{
+		n = io_getevents(this->io_ctx, min_nr, IOS_EVENTS_MAX, this->events,
+						 NULL);
+		if (n <= 0)
+			return NULL;
+
+		this->events_cnt = n;
+		this->events_pos = 0;
+	}
+
+	event = &this->events[this->events_pos++];
+	session = (IOSession *)event->data;
+	session->res = event->res;
+	return session;
+}
+
 void IOService::decref()
 {
 	IOSession *session;
-	struct io_event event;
 	int state, error;
 
 	if (__sync_sub_and_fetch(&this->ref, 1) == 0)
 	{
 		while (!list_empty(&this->session_list))
 		{
-			if (io_getevents(this->io_ctx, 1, 1, &event, NULL) > 0)
+			session = this->get_event(1);
+			if (session)
 			{
-				session = (IOSession *)event.data;
 				list_del(&session->list);
-				session->res = event.res;
 				if (session->res >= 0)
 				{
 					state = IOS_STATE_SUCCESS;
@@ -347,13 +382,11 @@ void *IOService::aio_finish(void *context)
 {
 	IOService *service = (IOService *)context;
 	IOSession *session;
-	struct io_event event;
 
-	if (io_getevents(service->io_ctx, 1, 1, &event, NULL) > 0)
+	session = service->get_event(1);
+	if (session)
 	{
 		service->incref();
-		session = (IOSession *)event.data;
-		session->res = event.res;
 		return session;
 	}
 
@@ -47,6 +47,7 @@ protected:
 
 protected:
 	long get_res() const { return this->res; }
+	void set_res(long res) { this->res = res; }
 
 private:
 	char iocb_buf[64];
@@ -81,6 +82,9 @@ private:
 
 private:
 	struct io_context *io_ctx;
+	struct io_event *events;
+	int events_cnt;
+	int events_pos;
 
 private:
 	void incref();
@@ -94,6 +98,9 @@ private:
 	struct list_head session_list;
 	pthread_mutex_t mutex;
 
+private:
+	IOSession *get_event(long min_nr);
+
 private:
 	static void *aio_finish(void *context);
 
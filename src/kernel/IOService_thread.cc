@@ -22,8 +22,13 @@
 #include <unistd.h>
 #include <pthread.h>
 #include "list.h"
+#include "thrdpool.h"
 #include "IOService_thread.h"
 
+/* Blocking operations are run by a fixed number of threads instead of
+ * a thread for each request. */
+#define IOS_THREADS_MAX		16
+
 typedef enum io_iocb_cmd {
 	IO_CMD_PREAD = 0,
 	IO_CMD_PWRITE = 1,
@@ -88,6 +93,7 @@ void IOSession::prep_fdsync(int fd)
 
 int IOService::init(int maxevents)
 {
+	size_t nthreads;
 	void *p;
 	int ret;
 
@@ -97,13 +103,6 @@ int IOService::init(int maxevents)
 		return -1;
 	}
 
-	ret = pthread_mutex_init(&this->mutex, NULL);
-	if (ret)
-	{
-		errno = ret;
-		return -1;
-	}
-
 	p = dlsym(RTLD_DEFAULT, "preadv");
 	if (p)
 		this->preadv = (ssize_t (*)(int, const struct iovec *, int, off_t))p;
@@ -116,16 +115,37 @@ int IOService::init(int maxevents)
 	else
 		this->pwritev = IOService::pwritev_emul;
 
-	this->maxevents = maxevents;
-	this->nevents = 0;
-	INIT_LIST_HEAD(&this->session_list);
-	this->pipe_fd[0] = -1;
-	this->pipe_fd[1] = -1;
-	return 0;
+	nthreads = maxevents < IOS_THREADS_MAX ? maxevents : IOS_THREADS_MAX;
+	this->thrdpool = thrdpool_create(nthreads, 0);
+	if (!this->thrdpool)
+		return -1;
+
+	ret = pthread_mutex_init(&this->mutex, NULL);
+	if (ret == 0)
+	{
+		ret = pthread_cond_init(&this->cond, NULL);
+		if (ret == 0)
+		{
+			this->maxevents = maxevents;
+			this->nevents = 0;
+			INIT_LIST_HEAD(&this->session_list);
+			this->pipe_fd[0] = -1;
+			this->pipe_fd[1] = -1;
+			return 0;
+		}
+
+		pthread_mutex_destroy(&this->mutex);
+	}
+
+	thrdpool_destroy(NULL, this->thrdpool);
+	errno = ret;
+	return -1;
 }
 
 void IOService::deinit()
 {
+	thrdpool_destroy(NULL, this->thrdpool);
+	pthread_cond_destroy(&this->cond);
 	pthread_mutex_destroy(&this->mutex);
 }
 
@@ -141,10 +161,15 @@ void IOService::decref()
 
 	if (__sync_sub_and_fetch(&this->ref, 1) == 0)
 	{
+		/* Wait for the running and queued operations. */
+		pthread_mutex_lock(&this->mutex);
+		while (this->nevents != 0)
+			pthread_cond_wait(&this->cond, &this->mutex);
+
+		pthread_mutex_unlock(&this->mutex);
 		while (!list_empty(&this->session_list))
 		{
 			session = list_entry(this->session_list.next, IOSession, list);
-			pthread_join(session->tid, NULL);
 			list_del(&session->list);
 			if (session->res >= 0)
 			{
@@ -160,16 +185,16 @@ void IOService::decref()
 			session->handle(state, error);
 		}
 
-		pthread_mutex_lock(&this->mutex);
-		/* Wait for detached threads. */
-		pthread_mutex_unlock(&this->mutex);
 		this->handle_unbound();
 	}
 }
 
 int IOService::request(IOSession *session)
 {
-	pthread_t tid;
+	struct thrdpool_task task = {
+		.routine	=	IOService::io_routine,
+		.context	=	session
+	};
 	int ret = -1;
 
 	pthread_mutex_lock(&this->mutex);
@@ -180,18 +205,12 @@ int IOService::request(IOSession *session)
 	else if (session->prepare() >= 0)
 	{
 		session->service = this;
-		ret = pthread_create(&tid, NULL, IOService::io_routine, session);
-		if (ret == 0)
+		ret = thrdpool_schedule(&task, this->thrdpool);
+		if (ret >= 0)
 		{
-			session->tid = tid;
 			list_add_tail(&session->list, &this->session_list);
 			this->nevents++;
 		}
-		else
-		{
-			errno = ret;
-			ret = -1;
-		}
 	}
 
 	pthread_mutex_unlock(&this->mutex);
@@ -201,7 +220,7 @@ int IOService::request(IOSession *session)
 	return ret;
 }
 
-void *IOService::io_routine(void *arg)
+void IOService::io_routine(void *arg)
 {
 	IOSession *session = (IOSession *)arg;
 	IOService *service = session->service;
@@ -248,9 +267,10 @@ void *IOService::io_routine(void *arg)
 	if (service->pipe_fd[1] >= 0)
 		write(service->pipe_fd[1], &session, sizeof (void *));
 
-	service->nevents--;
+	if (--service->nevents == 0)
+		pthread_cond_signal(&service->cond);
+
 	pthread_mutex_unlock(&service->mutex);
-	return NULL;
 }
 
 void *IOService::aio_finish(void *ptr, void *context)
@@ -259,7 +279,6 @@ void *IOService::aio_finish(void *ptr, void *context)
 	IOSession *session = (IOSession *)ptr;
 
 	service->incref();
-	pthread_detach(session->tid);
 	return session;
 }
 
@@ -47,6 +47,7 @@ protected:
 
 protected:
 	long get_res() const { return this->res; }
+	void set_res(long res) { this->res = res; }
 
 private:
 	int fd;
@@ -59,7 +60,6 @@ private:
 private:
 	struct list_head list;
 	class IOService *service;
-	pthread_t tid;
 
 public:
 	virtual ~IOSession() { }
@@ -88,6 +88,7 @@ private:
 private:
 	int maxevents;
 	int nevents;
+	struct __thrdpool *thrdpool;
 
 private:
 	void incref();
@@ -100,9 +101,10 @@ private:
 private:
 	struct list_head session_list;
 	pthread_mutex_t mutex;
+	pthread_cond_t cond;
 
 private:
-	static void *io_routine(void *arg);
+	static void io_routine(void *arg);
 	static void *aio_finish(void *ptr, void *context);
 
 private:
@@ -45,20 +45,24 @@ void SubTask::subtask_done()
 	}
 }
 
-void ParallelTask::dispatch()
+void ParallelTask::dispatch_subtasks(SubTask **subtasks, size_t n)
 {
-	SubTask **end = this->subtasks + this->subtasks_nr;
-	SubTask **p = this->subtasks;
+	SubTask **end = subtasks + n;
+	SubTask **p = subtasks;
 
-	this->nleft = this->subtasks_nr;
-	if (this->nleft != 0)
+	while (p != end)
 	{
-		do
-		{
-			(*p)->parent = this;
-			(*p)->dispatch();
-		} while (++p != end);
+		(*p)->parent = this;
+		(*p)->dispatch();
+		p++;
 	}
+}
+
+void ParallelTask::dispatch()
+{
+	this->nleft = this->subtasks_nr;
+	if (this->nleft != 0)
+		this->dispatch_subtasks(this->subtasks, this->subtasks_nr);
 	else
 		this->subtask_done();
 }
@@ -56,6 +56,12 @@ class ParallelTask : public SubTask
 public:
 	virtual void dispatch();
 
+protected:
+	/* Start subtasks[0, n). A derived class may override it to start them
+	 * in batches, each by calling ParallelTask::dispatch_subtasks(). The
+	 * parallel may finish as soon as the last subtask is started. */
+	virtual void dispatch_subtasks(SubTask **subtasks, size_t n);
+
 protected:
 	SubTask **subtasks;
 	size_t subtasks_nr;
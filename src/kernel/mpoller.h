@@ -67,6 +67,18 @@ static inline int mpoller_mod(const struct poller_data *data, int timeout,
 	return poller_mod(data, timeout, mpoller->poller[index]);
 }
 
+static inline int mpoller_pause(int fd, int reason, mpoller_t *mpoller)
+{
+	int index = (unsigned int)fd % mpoller->nthreads;
+	return poller_pause(fd, reason, mpoller->poller[index]);
+}
+
+static inline int mpoller_resume(int fd, int reason, mpoller_t *mpoller)
+{
+	int index = (unsigned int)fd % mpoller->nthreads;
+	return poller_resume(fd, reason, mpoller->poller[index]);
+}
+
 static inline int mpoller_set_timeout(int fd, int timeout, mpoller_t *mpoller)
 {
 	int index = (unsigned int)fd % mpoller->nthreads;
@@ -16,6 +16,9 @@
   Author: Xie Han (xiehan@sogou-inc.com)
 */
 
+#ifdef __linux__
+# define _GNU_SOURCE
+#endif
 #include <sys/types.h>
 #include <sys/socket.h>
 #include <sys/uio.h>
@@ -41,6 +44,8 @@
 
 #define POLLER_BUFSIZE			(256 * 1024)
 #define POLLER_EVENTS_MAX		256
+#define POLLER_BATCH_MAX		64
+#define POLLER_DGRAM_SIZE		(64 * 1024)
 
 struct __poller_node
 {
@@ -56,6 +61,8 @@ struct __poller_node
 #pragma pack()
 	char in_rbtree;
 	char removed;
+	char paused;
+	char read_off;
 	int event;
 	struct timespec timeout;
 	struct __poller_node *res;
@@ -80,6 +87,11 @@ struct __poller
 	struct list_head no_timeo_list;
 	struct __poller_node **nodes;
 	pthread_mutex_t mutex;
+#ifdef __linux__
+	struct mmsghdr *msgs;
+	char *dgrams;
+	int nmsgs;
+#endif
 	char buf[POLLER_BUFSIZE];
 };
 
@@ -386,6 +398,15 @@ static int __poller_append_message(const void *buf, size_t *n,
 	ret = msg->append(buf, n, msg);
 	if (ret > 0)
 	{
+		if (node->paused)
+		{
+			pthread_mutex_lock(&poller->mutex);
+			if (!node->read_off)
+				node->paused = 0;
+
+			pthread_mutex_unlock(&poller->mutex);
+		}
+
 		res->data = node->data;
 		res->error = 0;
 		res->state = PR_ST_SUCCESS;
@@ -435,6 +456,26 @@ static int __poller_handle_ssl_error(struct __poller_node *node, int ret,
 	return ret;
 }
 
+static int __poller_pause_node(struct __poller_node *node, poller_t *poller)
+{
+	int paused = 0;
+
+	pthread_mutex_lock(&poller->mutex);
+	if (node->paused && !node->read_off && !node->removed)
+	{
+		if (__poller_del_fd(node->data.fd, node->event, poller) >= 0)
+		{
+			node->read_off = 1;
+			paused = 1;
+		}
+		else
+			node->paused = 0;
+	}
+
+	pthread_mutex_unlock(&poller->mutex);
+	return paused;
+}
+
 static void __poller_handle_read(struct __poller_node *node,
 								 poller_t *poller)
 {
@@ -489,6 +530,9 @@ static void __poller_handle_read(struct __poller_node *node,
 
 		if (node->removed)
 			return;
+
+		if (node->paused && __poller_pause_node(node, poller))
+			return;
 	}
 
 	if (__poller_remove_node(node, poller))
@@ -674,6 +718,120 @@ static void __poller_handle_connect(struct __poller_node *node,
 	poller->callback((struct poller_result *)node, poller->context);
 }
 
+#ifdef __linux__
+
+static int __poller_prepare_msgs(int batch, poller_t *poller)
+{
+	size_t size = sizeof (struct mmsghdr) + sizeof (struct iovec) +
+				  sizeof (struct sockaddr_storage);
+	struct sockaddr_storage *ss;
+	struct mmsghdr *msgs;
+	struct iovec *iov;
+	char *dgrams;
+	int i;
+
+	if (poller->nmsgs >= batch)
+		return 0;
+
+	msgs = (struct mmsghdr *)malloc(batch * size);
+	dgrams = (char *)malloc((size_t)batch * POLLER_DGRAM_SIZE);
+	if (!msgs || !dgrams)
+	{
+		free(dgrams);
+		free(msgs);
+		return -1;
+	}
+
+	iov = (struct iovec *)(msgs + batch);
+	ss = (struct sockaddr_storage *)(iov + batch);
+	memset(msgs, 0, batch * sizeof (struct mmsghdr));
+	for (i = 0; i < batch; i++)
+	{
+		iov[i].iov_base = dgrams + (size_t)i * POLLER_DGRAM_SIZE;
+		iov[i].iov_len = POLLER_DGRAM_SIZE;
+		msgs[i].msg_hdr.msg_name = &ss[i];
+		msgs[i].msg_hdr.msg_iov = &iov[i];
+		msgs[i].msg_hdr.msg_iovlen = 1;
+	}
+
+	free(poller->dgrams);
+	free(poller->msgs);
+	poller->msgs = msgs;
+	poller->dgrams = dgrams;
+	poller->nmsgs = batch;
+	return 0;
+}
+
+static void __poller_handle_recvmmsg(struct __poller_node *node,
+									 poller_t *poller)
+{
+	struct __poller_node *res = node->res;
+	int batch = node->data.batch;
+	struct msghdr *msg;
+	void *result;
+	int n, i;
+
+	if (batch > POLLER_BATCH_MAX)
+		batch = POLLER_BATCH_MAX;
+
+	if (__poller_prepare_msgs(batch, poller) >= 0)
+	{
+		while (1)
+		{
+			for (i = 0; i < batch; i++)
+				poller->msgs[i].msg_hdr.msg_namelen = sizeof (struct sockaddr_storage);
+
+			n = recvmmsg(node->data.fd, poller->msgs, batch, 0, NULL);
+			if (n < 0)
+			{
+				if (errno == EAGAIN)
+					return;
+				else
+					break;
+			}
+
+			for (i = 0; i < n; i++)
+			{
+				msg = &poller->msgs[i].msg_hdr;
+				result = node->data.recvfrom((struct sockaddr *)msg->msg_name,
+											 msg->msg_namelen,
+											 msg->msg_iov->iov_base,
+											 poller->msgs[i].msg_len,
+											 node->data.context);
+				if (!result)
+					break;
+
+				res->data = node->data;
+				res->data.result = result;
+				res->error = 0;
+				res->state = PR_ST_SUCCESS;
+				poller->callback((struct poller_result *)res, poller->context);
+
+				res = (struct __poller_node *)malloc(sizeof (struct __poller_node));
+				node->res = res;
+				if (!res)
+					break;
+
+				if (node->removed)
+					return;
+			}
+
+			if (i < n)
+				break;
+		}
+	}
+
+	if (__poller_remove_node(node, poller))
+		return;
+
+	node->error = errno;
+	node->state = PR_ST_ERROR;
+	free(node->res);
+	poller->callback((struct poller_result *)node, poller->context);
+}
+
+#endif
+
 static void __poller_handle_recvfrom(struct __poller_node *node,
 									 poller_t *poller)
 {
@@ -684,6 +842,14 @@ static void __poller_handle_recvfrom(struct __poller_node *node,
 	void *result;
 	ssize_t n;
 
+#ifdef __linux__
+	if (node->data.batch > 1)
+	{
+		__poller_handle_recvmmsg(node, poller);
+		return;
+	}
+#endif
+
 	while (1)
 	{
 		addrlen = sizeof (struct sockaddr_storage);
@@ -1185,6 +1351,11 @@ poller_t *__poller_create(void **nodes_buf, const struct poller_params *params)
 				poller->tree_last = NULL;
 				INIT_LIST_HEAD(&poller->timeo_list);
 				INIT_LIST_HEAD(&poller->no_timeo_list);
+#ifdef __linux__
+				poller->msgs = NULL;
+				poller->dgrams = NULL;
+				poller->nmsgs = 0;
+#endif
 
 				poller->stopped = 1;
 				return poller;
@@ -1220,6 +1391,10 @@ poller_t *poller_create(const struct poller_params *params)
 
 void __poller_destroy(poller_t *poller)
 {
+#ifdef __linux__
+	free(poller->dgrams);
+	free(poller->msgs);
+#endif
 	pthread_mutex_destroy(&poller->mutex);
 	__poller_close_timerfd(poller->timerfd);
 	__poller_close_pfd(poller->pfd);
@@ -1375,6 +1550,8 @@ static struct __poller_node *__poller_new_node(const struct poller_data *data,
 	node->event = event;
 	node->in_rbtree = 0;
 	node->removed = 0;
+	node->paused = 0;
+	node->read_off = 0;
 	node->res = res;
 	if (timeout >= 0)
 		__poller_node_set_timeout(timeout, node);
@@ -1467,6 +1644,7 @@ int poller_mod(const struct poller_data *data, int timeout, poller_t *poller)
 	struct __poller_node *node;
 	struct __poller_node *orig;
 	int stopped = 0;
+	int ret;
 
 	node = __poller_new_node(data, timeout, poller);
 	if (!node)
@@ -1476,7 +1654,12 @@ int poller_mod(const struct poller_data *data, int timeout, poller_t *poller)
 	orig = poller->nodes[data->fd];
 	if (orig)
 	{
-		if (__poller_mod_fd(data->fd, orig->event, node->event, node, poller) >= 0)
+		if (orig->read_off)
+			ret = __poller_add_fd(data->fd, node->event, node, poller);
+		else
+			ret = __poller_mod_fd(data->fd, orig->event, node->event, node, poller);
+
+		if (ret >= 0)
 		{
 			if (orig->in_rbtree)
 				__poller_tree_erase(orig, poller);
@@ -1519,6 +1702,64 @@ int poller_mod(const struct poller_data *data, int timeout, poller_t *poller)
 	return -1;
 }
 
+int poller_pause(int fd, int reason, poller_t *poller)
+{
+	struct __poller_node *node;
+
+	if ((size_t)fd >= poller->max_open_files)
+	{
+		errno = fd < 0 ? EBADF : EMFILE;
+		return -1;
+	}
+
+	pthread_mutex_lock(&poller->mutex);
+	node = poller->nodes[fd];
+	if (node && node->data.operation == PD_OP_READ)
+		node->paused |= reason;
+	else
+	{
+		errno = node ? EINVAL : ENOENT;
+		node = NULL;
+	}
+
+	pthread_mutex_unlock(&poller->mutex);
+	return -!node;
+}
+
+int poller_resume(int fd, int reason, poller_t *poller)
+{
+	struct __poller_node *node;
+	int ret = 0;
+
+	if ((size_t)fd >= poller->max_open_files)
+	{
+		errno = fd < 0 ? EBADF : EMFILE;
+		return -1;
+	}
+
+	pthread_mutex_lock(&poller->mutex);
+	node = poller->nodes[fd];
+	if (node)
+	{
+		/* Reading restarts only when no other reason keeps it paused. */
+		node->paused &= ~reason;
+		if (!node->paused && node->read_off)
+		{
+			ret = __poller_add_fd(fd, node->event, node, poller);
+			if (ret >= 0)
+				node->read_off = 0;
+		}
+	}
+	else
+	{
+		errno = ENOENT;
+		ret = -1;
+	}
+
+	pthread_mutex_unlock(&poller->mutex);
+	return ret;
+}
+
 int poller_set_timeout(int fd, int timeout, poller_t *poller)
 {
 	struct __poller_node time_node;
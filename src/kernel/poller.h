@@ -49,7 +49,11 @@ struct poller_data
 #define PD_OP_EVENT			9
 #define PD_OP_NOTIFY		10
 	short operation;
-	unsigned short iovcnt;
+	union
+	{
+		unsigned short iovcnt;
+		unsigned short batch;	/* max datagrams of one PD_OP_RECVFROM read */
+	};
 	int fd;
 	SSL *ssl;
 	union
@@ -102,6 +106,8 @@ int poller_start(poller_t *poller);
 int poller_add(const struct poller_data *data, int timeout, poller_t *poller);
 int poller_del(int fd, poller_t *poller);
 int poller_mod(const struct poller_data *data, int timeout, poller_t *poller);
+int poller_pause(int fd, int reason, poller_t *poller);
+int poller_resume(int fd, int reason, poller_t *poller);
 int poller_set_timeout(int fd, int timeout, poller_t *poller);
 int poller_add_timer(const struct timespec *value, void *context, void **timer,
 					 poller_t *poller);
@@ -24,13 +24,19 @@
 #define GET_CURRENT_SECOND	std::chrono::duration_cast<std::chrono::seconds>(std::chrono::steady_clock::now().time_since_epoch()).count()
 
 #define	TTL_INC				5
+/* Refresh a record in the last tenth of its TTL. */
+#define REFRESH_AHEAD_RATIO	10
 
 const DnsCache::DnsHandle *DnsCache::get_inner(const HostPort& host_port,
-											   int type)
+											   int type, bool *refresh)
 {
 	int64_t cur = GET_CURRENT_SECOND;
-	std::lock_guard<std::mutex> lock(mutex_);
-	const DnsHandle *handle = cache_pool_.get(host_port);
+	Shard *shard = get_shard(host_port);
+	std::lock_guard<std::mutex> lock(shard->mutex);
+	const DnsHandle *handle = shard->cache_pool.get(host_port);
+
+	if (refresh)
+		*refresh = false;
 
 	if (handle && ((type == GET_TYPE_TTL && cur > handle->value.expire_time) ||
 		(type == GET_TYPE_CONFIDENT && cur > handle->value.confident_time)))
@@ -46,13 +52,42 @@ const DnsCache::DnsHandle *DnsCache::get_inner(const HostPort& host_port,
 			h->value.addrinfo->ai_flags |= 2;
 		}
 
-		cache_pool_.release(handle);
+		shard->cache_pool.release(handle);
+		shard->stats.misses++;
 		return NULL;
 	}
 
+	if (!handle)
+	{
+		shard->stats.misses++;
+		return NULL;
+	}
+
+	if (refresh && cur >= handle->value.refresh_time &&
+		!handle->value.delayed() && !handle->value.refreshing())
+	{
+		handle->value.addrinfo->ai_flags |= 4;
+		*refresh = true;
+		shard->stats.refreshes++;
+	}
+
+	shard->stats.hits++;
 	return handle;
 }
 
+void DnsCache::refresh_failed(const HostPort& host_port)
+{
+	Shard *shard = get_shard(host_port);
+	std::lock_guard<std::mutex> lock(shard->mutex);
+	const DnsHandle *handle = shard->cache_pool.get(host_port);
+
+	if (handle)
+	{
+		handle->value.addrinfo->ai_flags &= ~4;
+		shard->cache_pool.release(handle);
+	}
+}
+
 const DnsCache::DnsHandle *DnsCache::put(const HostPort& host_port,
 										 struct addrinfo *addrinfo,
 										 unsigned int dns_ttl_default,
@@ -60,7 +95,9 @@ const DnsCache::DnsHandle *DnsCache::put(const HostPort& host_port,
 {
 	int64_t expire_time;
 	int64_t confident_time;
+	int64_t refresh_time;
 	int64_t cur_time = GET_CURRENT_SECOND;
+	Shard *shard = get_shard(host_port);
 
 	if (dns_ttl_min > dns_ttl_default)
 		dns_ttl_min = dns_ttl_default;
@@ -71,34 +108,69 @@ const DnsCache::DnsHandle *DnsCache::put(const HostPort& host_port,
 		confident_time = cur_time + dns_ttl_min;
 
 	if (dns_ttl_default == (unsigned int)-1)
+	{
 		expire_time = INT64_MAX;
+		refresh_time = INT64_MAX;
+	}
 	else
+	{
 		expire_time = cur_time + dns_ttl_default;
+		refresh_time = expire_time - dns_ttl_default / REFRESH_AHEAD_RATIO;
+	}
 
-	std::lock_guard<std::mutex> lock(mutex_);
-	return cache_pool_.put(host_port, {addrinfo, confident_time, expire_time});
+	std::lock_guard<std::mutex> lock(shard->mutex);
+	inc_generation(host_port);
+	return shard->cache_pool.put(host_port, {addrinfo, confident_time,
+											 expire_time, refresh_time});
 }
 
 const DnsCache::DnsHandle *DnsCache::get(const DnsCache::HostPort& host_port)
 {
-	std::lock_guard<std::mutex> lock(mutex_);
-	return cache_pool_.get(host_port);
+	Shard *shard = get_shard(host_port);
+	std::lock_guard<std::mutex> lock(shard->mutex);
+
+	return shard->cache_pool.get(host_port);
 }
 
 void DnsCache::release(const DnsCache::DnsHandle *handle)
 {
-	std::lock_guard<std::mutex> lock(mutex_);
-	cache_pool_.release(handle);
+	Shard *shard = get_shard(handle->get_key());
+	std::lock_guard<std::mutex> lock(shard->mutex);
+
+	shard->cache_pool.release(handle);
 }
 
 void DnsCache::del(const DnsCache::HostPort& key)
 {
-	std::lock_guard<std::mutex> lock(mutex_);
-	cache_pool_.del(key);
+	Shard *shard = get_shard(key);
+	std::lock_guard<std::mutex> lock(shard->mutex);
+
+	inc_generation(key);
+	shard->cache_pool.del(key);
+}
+
+void DnsCache::get_stats(struct DnsCacheStats *stats)
+{
+	stats->hits = 0;
+	stats->misses = 0;
+	stats->refreshes = 0;
+	for (size_t i = 0; i < DNS_CACHE_SHARDS; i++)
+	{
+		std::lock_guard<std::mutex> lock(shards_[i].mutex);
+
+		stats->hits += shards_[i].stats.hits;
+		stats->misses += shards_[i].stats.misses;
+		stats->refreshes += shards_[i].stats.refreshes;
+	}
 }
 
 DnsCache::DnsCache()
 {
+	for (size_t i = 0; i < DNS_CACHE_GENERATIONS; i++)
+		generations_[i].store(0, std::memory_order_relaxed);
+
+	for (size_t i = 0; i < DNS_CACHE_SHARDS; i++)
+		shards_[i].stats = { 0, 0, 0 };
 }
 
 DnsCache::~DnsCache()
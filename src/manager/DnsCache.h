@@ -23,23 +23,41 @@
 #include <stdint.h>
 #include <string>
 #include <mutex>
+#include <atomic>
 #include <utility>
+#include <functional>
 #include "LRUCache.h"
 #include "DnsUtil.h"
 
 #define GET_TYPE_TTL		0
 #define GET_TYPE_CONFIDENT	1
 
+#define DNS_CACHE_SHARDS		16
+#define DNS_CACHE_GENERATIONS	1024
+
 struct DnsCacheValue
 {
 	struct addrinfo *addrinfo;
 	int64_t confident_time;
 	int64_t expire_time;
+	int64_t refresh_time;
 
 	bool delayed() const
 	{
 		return addrinfo->ai_flags & 2;
 	}
+
+	bool refreshing() const
+	{
+		return addrinfo->ai_flags & 4;
+	}
+};
+
+struct DnsCacheStats
+{
+	size_t hits;
+	size_t misses;
+	size_t refreshes;
 };
 
 // RAII: NO. Release handle by user
@@ -69,7 +87,7 @@ public:
 
 	const DnsHandle *get_ttl(const HostPort& host_port)
 	{
-		return get_inner(host_port, GET_TYPE_TTL);
+		return get_inner(host_port, GET_TYPE_TTL, NULL);
 	}
 
 	const DnsHandle *get_ttl(const std::string& host, unsigned short port)
@@ -82,9 +100,31 @@ public:
 		return get_ttl(std::string(host), port);
 	}
 
+	// Same as get_ttl, and once the record is close to expiring, sets
+	// *refresh to true for exactly one caller, who should resolve again.
+	const DnsHandle *get_ttl(const HostPort& host_port, bool *refresh)
+	{
+		return get_inner(host_port, GET_TYPE_TTL, refresh);
+	}
+
+	const DnsHandle *get_ttl(const std::string& host, unsigned short port,
+							 bool *refresh)
+	{
+		return get_ttl(HostPort(host, port), refresh);
+	}
+
+	// Called by the caller who got *refresh but failed to resolve, so that
+	// a later lookup may start another refresh.
+	void refresh_failed(const HostPort& host_port);
+
+	void refresh_failed(const std::string& host, unsigned short port)
+	{
+		refresh_failed(HostPort(host, port));
+	}
+
 	const DnsHandle *get_confident(const HostPort& host_port)
 	{
-		return get_inner(host_port, GET_TYPE_CONFIDENT);
+		return get_inner(host_port, GET_TYPE_CONFIDENT, NULL);
 	}
 
 	const DnsHandle *get_confident(const std::string& host, unsigned short port)
@@ -136,10 +176,39 @@ public:
 		del(std::string(host), port);
 	}
 
+	// Changed by every put and del of the host, and rarely by another host
+	// sharing the slot. Results derived from a cached value of the host may
+	// be reused as long as its generation is unchanged.
+	unsigned long long get_generation(const std::string& host,
+									  unsigned short port) const
+	{
+		size_t slot = get_hash(host, port) % DNS_CACHE_GENERATIONS;
+
+		return generations_[slot].load(std::memory_order_acquire);
+	}
+
+	unsigned long long get_generation(const HostPort& host_port) const
+	{
+		return get_generation(host_port.first, host_port.second);
+	}
+
+	// Lookups by get_ttl and get_confident, and refreshes handed out.
+	// Counted by each shard under its lock, and summed here.
+	void get_stats(struct DnsCacheStats *stats);
+
 private:
-	const DnsHandle *get_inner(const HostPort& host_port, int type);
+	const DnsHandle *get_inner(const HostPort& host_port, int type,
+							   bool *refresh);
 
-	std::mutex mutex_;
+	void inc_generation(const HostPort& host_port)
+	{
+		size_t slot = get_hash(host_port.first, host_port.second) %
+					  DNS_CACHE_GENERATIONS;
+
+		generations_[slot].fetch_add(1, std::memory_order_release);
+	}
+
+	std::atomic<unsigned long long> generations_[DNS_CACHE_GENERATIONS];
 
 	class ValueDeleter
 	{
@@ -158,7 +227,26 @@ private:
 		}
 	};
 
-	LRUCache<HostPort, DnsCacheValue, ValueDeleter> cache_pool_;
+	struct Shard
+	{
+		std::mutex mutex;
+		LRUCache<HostPort, DnsCacheValue, ValueDeleter> cache_pool;
+		struct DnsCacheStats stats;
+	};
+
+	static size_t get_hash(const std::string& host, unsigned short port)
+	{
+		return std::hash<std::string>()(host) ^ port;
+	}
+
+	Shard *get_shard(const HostPort& host_port)
+	{
+		size_t h = get_hash(host_port.first, host_port.second);
+
+		return &shards_[h % DNS_CACHE_SHARDS];
+	}
+
+	Shard shards_[DNS_CACHE_SHARDS];
 
 public:
 	// To prevent inline calling LRUCache's constructor and deconstructor.
@@ -30,6 +30,7 @@
 #include <vector>
 #include <string>
 #include <algorithm>
+#include <atomic>
 #include <openssl/ssl.h>
 #include "list.h"
 #include "rbtree.h"
@@ -44,6 +45,158 @@
 
 using RouteTargetTCP = RouteManager::RouteTarget;
 
+static std::atomic<size_t> __ssl_handshakes(0);
+static std::atomic<size_t> __ssl_resumed(0);
+
+#if OPENSSL_VERSION_NUMBER >= 0x10100000L
+static int __ssl_target_index()
+{
+	static int index = SSL_get_ex_new_index(0, NULL, NULL, NULL, NULL);
+	return index;
+}
+
+/* Called for session tickets and TLS 1.3 PSKs received from the server. */
+static int __ssl_new_session(SSL *ssl, SSL_SESSION *session)
+{
+	void *target = SSL_get_ex_data(ssl, __ssl_target_index());
+
+	if (!target)
+		return 0;
+
+#if OPENSSL_VERSION_NUMBER >= 0x10101000L
+	/* A connection closed without close_notify marks its session not
+	 * resumable when freed. Keep a copy instead. */
+	session = SSL_SESSION_dup(session);
+	if (!session)
+		return 0;
+
+	((RouteManager::RouteTarget *)target)->set_ssl_session(session);
+	return 0;
+#else
+	((RouteManager::RouteTarget *)target)->set_ssl_session(session);
+	return 1;
+#endif
+}
+
+static void __ssl_info_callback(const SSL *ssl, int where, int ret)
+{
+	void (*cb)(const SSL *, int, int);
+
+	if (where & SSL_CB_HANDSHAKE_DONE)
+	{
+		__ssl_handshakes++;
+		if (SSL_session_reused((SSL *)ssl))
+			__ssl_resumed++;
+
+		/* Count only the first handshake of a connection. */
+		SSL_set_info_callback((SSL *)ssl, NULL);
+	}
+
+	cb = SSL_CTX_get_info_callback(SSL_get_SSL_CTX(ssl));
+	if (cb)
+		cb(ssl, where, ret);
+}
+
+int RouteManager::RouteTarget::init(const struct sockaddr *addr,
+									socklen_t addrlen, SSL_CTX *ssl_ctx,
+									int connect_timeout,
+									int ssl_connect_timeout,
+									int response_timeout,
+									size_t max_connections)
+{
+	int ret = this->CommSchedTarget::init(addr, addrlen, ssl_ctx,
+						connect_timeout, ssl_connect_timeout,
+						response_timeout, max_connections);
+
+	if (ret >= 0 && ssl_ctx)
+		SSL_CTX_up_ref(ssl_ctx);
+
+	return ret;
+}
+
+void RouteManager::RouteTarget::deinit()
+{
+	SSL_CTX *ssl_ctx = this->get_ssl_ctx();
+
+	this->CommSchedTarget::deinit();
+	if (ssl_ctx)
+		SSL_CTX_free(ssl_ctx);
+
+	if (this->ssl_session)
+		SSL_SESSION_free(this->ssl_session);
+}
+
+void RouteManager::RouteTarget::set_ssl_session(SSL_SESSION *session)
+{
+	SSL_SESSION *old;
+
+	this->ssl_mutex.lock();
+	old = this->ssl_session;
+	this->ssl_session = session;
+	this->ssl_mutex.unlock();
+
+	if (old)
+		SSL_SESSION_free(old);
+}
+
+int RouteManager::RouteTarget::init_ssl(SSL *ssl)
+{
+	SSL_SESSION *session;
+	int ret = 0;
+
+	if (SSL_set_ex_data(ssl, __ssl_target_index(), this) <= 0)
+		return -1;
+
+	SSL_set_info_callback(ssl, __ssl_info_callback);
+	this->ssl_mutex.lock();
+	session = this->ssl_session;
+#if OPENSSL_VERSION_NUMBER >= 0x10101000L
+	/* Each connection resumes from a copy, for the same reason. */
+	if (session)
+		session = SSL_SESSION_dup(session);
+#else
+	if (session)
+		SSL_SESSION_up_ref(session);
+#endif
+	this->ssl_mutex.unlock();
+
+	if (session)
+	{
+		if (SSL_set_session(ssl, session) <= 0)
+			ret = -1;
+
+		SSL_SESSION_free(session);
+	}
+
+	return ret;
+}
+#else
+void RouteManager::RouteTarget::set_ssl_session(SSL_SESSION *session)
+{
+	SSL_SESSION_free(session);
+}
+
+int RouteManager::RouteTarget::init_ssl(SSL *ssl)
+{
+	return 0;
+}
+#endif
+
+void RouteManager::init_ssl_client_ctx(SSL_CTX *ssl_ctx)
+{
+#if OPENSSL_VERSION_NUMBER >= 0x10100000L
+	SSL_CTX_set_session_cache_mode(ssl_ctx, SSL_SESS_CACHE_CLIENT |
+									SSL_SESS_CACHE_NO_INTERNAL_STORE);
+	SSL_CTX_sess_set_new_cb(ssl_ctx, __ssl_new_session);
+#endif
+}
+
+void RouteManager::get_ssl_session_stats(struct SSLSessionStats *stats)
+{
+	stats->handshakes = __ssl_handshakes;
+	stats->resumed = __ssl_resumed;
+}
+
 class RouteTargetUDP : public RouteManager::RouteTarget
 {
 private:
@@ -86,6 +239,9 @@ class RouteTargetTCP_TLS_SNI : public RouteTargetTCP_SSL
 private:
 	virtual int init_ssl(SSL *ssl)
 	{
+		if (this->RouteTarget::init_ssl(ssl) < 0)
+			return -1;
+
 		if (SSL_set_tlsext_host_name(ssl, this->hostname.c_str()) > 0)
 			return 0;
 		else
@@ -108,6 +264,9 @@ class RouteTargetSCTP_TLS_SNI : public RouteTargetSCTP_SSL
 private:
 	virtual int init_ssl(SSL *ssl)
 	{
+		if (this->RouteTarget::init_ssl(ssl) < 0)
+			return -1;
+
 		if (SSL_set_tlsext_host_name(ssl, this->hostname.c_str()) > 0)
 			return 0;
 		else
@@ -587,3 +746,9 @@ void RouteManager::notify_available(void *cookie, CommTarget *target)
 		((RouteResultEntry *)cookie)->notify_available((RouteTarget *)target);
 }
 
+void RouteManager::check_breaker(void *cookie)
+{
+	if (cookie)
+		((RouteResultEntry *)cookie)->check_breaker();
+}
+
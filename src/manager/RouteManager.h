@@ -50,39 +50,39 @@ public:
 	public:
 		int init(const struct sockaddr *addr, socklen_t addrlen, SSL_CTX *ssl_ctx,
 				 int connect_timeout, int ssl_connect_timeout, int response_timeout,
-				 size_t max_connections)
-		{
-			int ret = this->CommSchedTarget::init(addr, addrlen, ssl_ctx,
-								connect_timeout, ssl_connect_timeout,
-								response_timeout, max_connections);
-
-			if (ret >= 0 && ssl_ctx)
-				SSL_CTX_up_ref(ssl_ctx);
-
-			return ret;
-		}
-
-		void deinit()
-		{
-			SSL_CTX *ssl_ctx = this->get_ssl_ctx();
-
-			this->CommSchedTarget::deinit();
-			if (ssl_ctx)
-				SSL_CTX_free(ssl_ctx);
-		}
+				 size_t max_connections);
+		void deinit();
 #endif
 
+	public:
+		/* Keep the latest session of this target for resumption. */
+		void set_ssl_session(SSL_SESSION *session);
+
 	public:
 		int state;
 
+	protected:
+		/* Offer the cached session. Derived targets must call this. */
+		virtual int init_ssl(SSL *ssl);
+
 	private:
 		virtual WFConnection *new_connection(int connect_fd)
 		{
 			return new WFConnection;
 		}
 
+	private:
+		SSL_SESSION *ssl_session;
+		std::mutex ssl_mutex;
+
 	public:
-		RouteTarget() : state(0) { }
+		RouteTarget() : state(0), ssl_session(NULL) { }
+	};
+
+	struct SSLSessionStats
+	{
+		size_t handshakes;
+		size_t resumed;
 	};
 
 public:
@@ -107,6 +107,18 @@ private:
 public:
 	static void notify_unavailable(void *cookie, CommTarget *target);
 	static void notify_available(void *cookie, CommTarget *target);
+
+	/* Bring back broken targets whose time is up. Done by get(), and must
+	 * be done by anyone reusing a result without calling get(). */
+	static void check_breaker(void *cookie);
+
+	/* Let the targets keep the sessions of a client context for resumption.
+	 * Done to the global client context when it's created. Not thread safe,
+	 * so call it on your own context before using it. */
+	static void init_ssl_client_ctx(SSL_CTX *ssl_ctx);
+
+	/* Client TLS handshakes of all targets, and how many were resumed. */
+	static void get_ssl_session_stats(struct SSLSessionStats *stats);
 };
 
 #endif
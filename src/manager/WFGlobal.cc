@@ -43,7 +43,9 @@
 #include "WFTaskError.h"
 #include "WFDnsClient.h"
 #include "WFGlobal.h"
+#include "RouteManager.h"
 #include "URIParser.h"
+#include "ObjectRecycler.h"
 
 class __WFGlobal
 {
@@ -218,6 +220,8 @@ private:
 		ssl_client_ctx_ = SSL_CTX_new(SSLv23_client_method());
 		if (ssl_client_ctx_ == NULL)
 			abort();
+
+		RouteManager::init_ssl_client_ctx(ssl_client_ctx_);
 	}
 
 	~__SSLManager()
@@ -340,6 +344,42 @@ private:
 	Executor dns_executor_;
 };
 
+class __ThreadFileManager
+{
+public:
+	static __ThreadFileManager *get_instance()
+	{
+		static __ThreadFileManager kInstance;
+		return &kInstance;
+	}
+
+	ExecQueue *get_fio_queue() { return &fio_queue_; }
+	Executor *get_fio_executor() { return &fio_executor_; }
+
+	__ThreadFileManager()
+	{
+		int ret;
+
+		ret = fio_queue_.init();
+		if (ret < 0)
+			abort();
+
+		ret = fio_executor_.init(WFGlobal::get_global_settings()->fio_threads);
+		if (ret < 0)
+			abort();
+	}
+
+	~__ThreadFileManager()
+	{
+		fio_executor_.deinit();
+		fio_queue_.deinit();
+	}
+
+private:
+	ExecQueue fio_queue_;
+	Executor fio_executor_;
+};
+
 class __CommManager
 {
 public:
@@ -364,6 +404,8 @@ private:
 							settings->handler_threads) < 0)
 			abort();
 
+		scheduler_.set_receive_budget(settings->receive_budget);
+
 		signal(SIGPIPE, SIG_IGN);
 	}
 
@@ -730,6 +772,15 @@ ExecQueue *WFGlobal::get_exec_queue(const std::string& queue_name)
 	return __ExecManager::get_instance()->get_exec_queue(queue_name);
 }
 
+void WFGlobal::set_exec_queue_priority(const std::string& queue_name,
+									   int priority, int weight)
+{
+	ExecQueue *queue = WFGlobal::get_exec_queue(queue_name);
+
+	if (queue)
+		queue->set_priority(priority, weight);
+}
+
 Executor *WFGlobal::get_compute_executor()
 {
 	return __ExecManager::get_instance()->get_compute_executor();
@@ -750,6 +801,16 @@ Executor *WFGlobal::get_dns_executor()
 	return __ThreadDnsManager::get_instance()->get_dns_executor();
 }
 
+ExecQueue *WFGlobal::get_fio_queue()
+{
+	return __ThreadFileManager::get_instance()->get_fio_queue();
+}
+
+Executor *WFGlobal::get_fio_executor()
+{
+	return __ThreadFileManager::get_instance()->get_fio_executor();
+}
+
 WFDnsClient *WFGlobal::get_dns_client()
 {
 	return __DnsClientManager::get_instance()->get_dns_client();
@@ -968,6 +1029,9 @@ const char *WFGlobal::get_error_string(int state, int error)
 	case WFT_STATE_ABORTED:
 		return "Aborted";
 
+	case WFT_STATE_EXPIRED:
+		return "Expired";
+
 	case WFT_STATE_UNDEFINED:
 		return "Undefined";
 
@@ -981,5 +1045,6 @@ const char *WFGlobal::get_error_string(int state, int error)
 void WORKFLOW_library_init(const struct WFGlobalSettings *settings)
 {
 	WFGlobal::set_global_settings(settings);
+	ObjectRecycler::set_max_cached(settings->object_pool_size);
 }
 
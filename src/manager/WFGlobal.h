@@ -58,6 +58,9 @@ struct WFGlobalSettings
 	int fio_max_events;
 	const char *resolv_conf_path;
 	const char *hosts_path;
+	size_t receive_budget;			///< bytes of messages being received, 0: no limit
+	size_t object_pool_size;		///< freed tasks kept by each thread for reuse, 0: none
+	int fio_threads;				///< threads for blocking file operations like open()
 };
 
 /**
@@ -76,6 +79,9 @@ static constexpr struct WFGlobalSettings GLOBAL_SETTINGS_DEFAULT =
 	.fio_max_events		=	4096,
 	.resolv_conf_path	=	"/etc/resolv.conf",
 	.hosts_path			=	"/etc/hosts",
+	.receive_budget		=	0,
+	.object_pool_size	=	0,
+	.fio_threads		=	4,
 };
 
 /**
@@ -144,6 +150,15 @@ public:
 		return WFGlobal::get_compute_executor()->decrease_thread() == 0;
 	}
 
+	/**
+	 * @brief      set the priority and weight of a named computing queue
+	 * @param[in]  queue_name       queue name of go tasks and thread tasks
+	 * @param[in]  priority         queues of higher priority run first
+	 * @param[in]  weight           share of threads among queues of the same priority
+	 */
+	static void set_exec_queue_priority(const std::string& queue_name,
+										int priority, int weight);
+
 	// Internal usage only
 public:
 	static bool is_scheduler_created();
@@ -155,6 +170,8 @@ public:
 	static class IOService *get_io_service();
 	static class ExecQueue *get_dns_queue();
 	static class Executor *get_dns_executor();
+	static class ExecQueue *get_fio_queue();
+	static class Executor *get_fio_executor();
 	static class WFDnsClient *get_dns_client();
 	static class WFResourcePool *get_dns_respool();
 
@@ -28,9 +28,13 @@
 #include <stdlib.h>
 #include <stdio.h>
 #include <stdint.h>
+#include <string.h>
 #include <ctype.h>
+#include <chrono>
 #include <utility>
 #include <string>
+#include <unordered_map>
+#include <list>
 #include "EndpointParams.h"
 #include "RouteManager.h"
 #include "WFGlobal.h"
@@ -44,6 +48,9 @@
 
 #define HOSTS_LINEBUF_INIT_SIZE	128
 #define PORT_STR_MAX			5
+#define ROUTE_CACHE_MAX			1024
+
+#define GET_CURRENT_SECOND	std::chrono::duration_cast<std::chrono::seconds>(std::chrono::steady_clock::now().time_since_epoch()).count()
 
 class DnsInput
 {
@@ -374,6 +381,194 @@ static std::string __get_guard_name(const std::string& cache_host,
 	return guard_name;
 }
 
+/* Routing inputs of a request, pointing into the request. */
+struct __route_key
+{
+	const char *host;
+	unsigned short port;
+	const struct WFNSParams *params;
+	const struct EndpointParams *ep_params;
+};
+
+/* Per-thread shortcut from a request's routing inputs to the route result,
+ * skipping the DNS cache and the route manager. Entries are found by the
+ * hash of the inputs, and keep their own copy of the inputs to compare.
+ * Entries expire with the DNS record they were made from, and any change
+ * of the record in the DNS cache invalidates them. The least recently used
+ * entry is evicted when full. Route results are never freed while running. */
+struct __route_cache_entry
+{
+	size_t hash;
+	std::string host;
+	unsigned short port;
+	enum TransportType type;
+	bool fixed_addr;
+	SSL_CTX *ssl_ctx;
+	bool has_info;
+	std::string info;
+	struct EndpointParams ep_params;
+	std::string cache_host;
+	RouteManager::RouteResult result;
+	int64_t confident_time;
+	int64_t expire_time;
+	int64_t refresh_time;
+	unsigned long long generation;
+};
+
+using __route_cache_list = std::list<__route_cache_entry>;
+using __route_cache_map = std::unordered_multimap<size_t,
+												  __route_cache_list::iterator>;
+
+struct __route_cache
+{
+	__route_cache_list list;
+	__route_cache_map map;
+};
+
+static thread_local struct __route_cache __route_cache;
+
+static inline size_t __route_hash_bytes(size_t h, const void *buf, size_t n)
+{
+	const unsigned char *p = (const unsigned char *)buf;
+	size_t i;
+
+	for (i = 0; i < n; i++)
+		h = (h ^ p[i]) * 1099511628211ULL;
+
+	return h;
+}
+
+static size_t __route_hash(const struct __route_key *key)
+{
+	const struct WFNSParams *params = key->params;
+	const struct EndpointParams *ep_params = key->ep_params;
+	const long values[] = {
+		key->port, params->type, params->fixed_addr,
+		(long)params->ssl_ctx, ep_params->address_family,
+		(long)ep_params->max_connections, ep_params->connect_timeout,
+		ep_params->response_timeout, ep_params->ssl_connect_timeout,
+		ep_params->use_tls_sni
+	};
+	size_t h = 14695981039346656037ULL;
+
+	h = __route_hash_bytes(h, values, sizeof values);
+	h = __route_hash_bytes(h, key->host, strlen(key->host) + 1);
+	if (params->info)
+		h = __route_hash_bytes(h, params->info, strlen(params->info));
+
+	return h;
+}
+
+static bool __route_key_equal(const struct __route_key *key,
+							  const __route_cache_entry& entry)
+{
+	const struct WFNSParams *params = key->params;
+	const struct EndpointParams *ep_params = key->ep_params;
+
+	return key->port == entry.port &&
+		   params->type == entry.type &&
+		   params->fixed_addr == entry.fixed_addr &&
+		   params->ssl_ctx == entry.ssl_ctx &&
+		   ep_params->address_family == entry.ep_params.address_family &&
+		   ep_params->max_connections == entry.ep_params.max_connections &&
+		   ep_params->connect_timeout == entry.ep_params.connect_timeout &&
+		   ep_params->response_timeout == entry.ep_params.response_timeout &&
+		   ep_params->ssl_connect_timeout ==
+				entry.ep_params.ssl_connect_timeout &&
+		   ep_params->use_tls_sni == entry.ep_params.use_tls_sni &&
+		   entry.host == key->host &&
+		   (params->info ? entry.has_info && entry.info == params->info :
+						   !entry.has_info);
+}
+
+static __route_cache_map::iterator
+__route_cache_find(const struct __route_key *key, size_t hash)
+{
+	auto range = __route_cache.map.equal_range(hash);
+
+	for (auto it = range.first; it != range.second; ++it)
+	{
+		if (__route_key_equal(key, *it->second))
+			return it;
+	}
+
+	return __route_cache.map.end();
+}
+
+static void __route_cache_erase(__route_cache_map::iterator it)
+{
+	__route_cache.list.erase(it->second);
+	__route_cache.map.erase(it);
+}
+
+static bool __route_cache_get(const struct __route_key *key, size_t hash,
+							  int retry_times,
+							  RouteManager::RouteResult *result)
+{
+	DnsCache *dns_cache = WFGlobal::get_dns_cache();
+	auto it = __route_cache_find(key, hash);
+
+	if (it == __route_cache.map.end())
+		return false;
+
+	const __route_cache_entry& entry = *it->second;
+	int64_t time = retry_times == 0 ? entry.expire_time : entry.confident_time;
+	int64_t cur = GET_CURRENT_SECOND;
+
+	if (entry.generation != dns_cache->get_generation(entry.cache_host,
+													  entry.port) ||
+		cur > time)
+	{
+		__route_cache_erase(it);
+		return false;
+	}
+
+	/* Let the DNS cache see the lookup and start a refresh. */
+	if (retry_times == 0 && cur >= entry.refresh_time)
+		return false;
+
+	__route_cache.list.splice(__route_cache.list.begin(), __route_cache.list,
+							  it->second);
+	*result = entry.result;
+	RouteManager::check_breaker(result->cookie);
+	return true;
+}
+
+static void __route_cache_put(const struct __route_key *key, size_t hash,
+							  const std::string& cache_host,
+							  const DnsCacheValue *value,
+							  unsigned long long generation,
+							  const RouteManager::RouteResult *result)
+{
+	const struct WFNSParams *params = key->params;
+	auto it = __route_cache_find(key, hash);
+
+	if (it != __route_cache.map.end())
+		__route_cache_erase(it);
+	else if (__route_cache.map.size() >= ROUTE_CACHE_MAX)
+	{
+		const __route_cache_entry& last = __route_cache.list.back();
+		auto range = __route_cache.map.equal_range(last.hash);
+
+		for (it = range.first; it != range.second; ++it)
+		{
+			if (&*it->second == &last)
+				break;
+		}
+
+		__route_cache_erase(it);
+	}
+
+	__route_cache.list.push_front({
+		hash, key->host, key->port, params->type, params->fixed_addr,
+		params->ssl_ctx, params->info != NULL,
+		params->info ? params->info : "", *key->ep_params, cache_host,
+		*result, value->confident_time, value->expire_time,
+		value->refresh_time, generation
+	});
+	__route_cache.map.emplace(hash, __route_cache.list.begin());
+}
+
 void WFResolverTask::dispatch()
 {
 	if (this->msg_)
@@ -388,16 +583,40 @@ void WFResolverTask::dispatch()
 	host_ = uri.host ? uri.host : "";
 	port_ = uri.port ? atoi(uri.port) : 0;
 
+	struct __route_key route_key = {
+		.host		=	host_,
+		.port		=	port_,
+		.params		=	&ns_params_,
+		.ep_params	=	&ep_params_,
+	};
+	size_t route_hash = __route_hash(&route_key);
+
+	if (!refresh_ && __route_cache_get(&route_key, route_hash,
+									   ns_params_.retry_times, &this->result))
+	{
+		this->state = WFT_STATE_SUCCESS;
+		this->subtask_done();
+		return;
+	}
+
 	DnsCache *dns_cache = WFGlobal::get_dns_cache();
 	const DnsCache::DnsHandle *addr_handle;
 	std::string hostname = host_;
 	int family = ep_params_.address_family;
 	std::string cache_host = __get_cache_host(hostname, family);
+	unsigned long long generation = 0;
+	bool refresh = false;
 
-	if (ns_params_.retry_times == 0)
-		addr_handle = dns_cache->get_ttl(cache_host, port_);
+	if (refresh_)
+		addr_handle = NULL;
 	else
-		addr_handle = dns_cache->get_confident(cache_host, port_);
+	{
+		generation = dns_cache->get_generation(cache_host, port_);
+		if (ns_params_.retry_times == 0)
+			addr_handle = dns_cache->get_ttl(cache_host, port_, &refresh);
+		else
+			addr_handle = dns_cache->get_confident(cache_host, port_);
+	}
 
 	if (in_guard_ && (addr_handle == NULL || addr_handle->value.delayed()))
 	{
@@ -429,9 +648,21 @@ void WFResolverTask::dispatch()
 			this->error = errno;
 		}
 		else
+		{
+			if (!addr_handle->value.delayed())
+			{
+				__route_cache_put(&route_key, route_hash, cache_host,
+								  &addr_handle->value, generation,
+								  &this->result);
+			}
+
 			this->state = WFT_STATE_SUCCESS;
+		}
 
 		dns_cache->release(addr_handle);
+		if (refresh)
+			this->refresh_dns();
+
 		this->subtask_done();
 		return;
 	}
@@ -497,6 +728,31 @@ void WFResolverTask::dispatch()
 	this->subtask_done();
 }
 
+/* Resolve a record that is about to expire in a series of its own. The
+ * cached record keeps serving requests meanwhile. */
+void WFResolverTask::refresh_dns()
+{
+	ParsedURI *uri = new ParsedURI(ns_params_.uri);
+	struct WFNSParams params = {
+		.type			=	ns_params_.type,
+		.uri			=	*uri,
+		.info			=	"",
+		.ssl_ctx		=	ns_params_.ssl_ctx,
+		.fixed_addr		=	ns_params_.fixed_addr,
+		.fixed_conn		=	ns_params_.fixed_conn,
+		.retry_times	=	0,
+		.tracing		=	NULL,
+	};
+	WFResolverTask *task;
+
+	task = new WFResolverTask(&params, dns_ttl_default_, dns_ttl_min_,
+							  &ep_params_, [uri](WFRouterTask *) {
+		delete uri;
+	});
+	task->refresh_ = true;
+	Workflow::start_series_work(task, nullptr);
+}
+
 void WFResolverTask::request_dns()
 {
 	WFDnsClient *client = WFGlobal::get_dns_client();
@@ -617,7 +873,9 @@ void WFResolverTask::dns_callback_internal(void *thrd_dns_output,
 		addr_handle = dns_cache->put(cache_host, port_, addrinfo,
 									 (unsigned int)ttl_default,
 									 (unsigned int)ttl_min);
-		if (route_manager->get(ns_params_.type, addrinfo, ns_params_.info,
+		if (refresh_)
+			this->state = WFT_STATE_SUCCESS;
+		else if (route_manager->get(ns_params_.type, addrinfo, ns_params_.info,
 							   &ep_params_, hostname, ns_params_.ssl_ctx,
 							   this->result) < 0)
 		{
@@ -728,13 +986,22 @@ void WFResolverTask::thread_dns_callback(void *thrd_dns_task)
 
 void WFResolverTask::task_callback()
 {
+	if (refresh_ && this->state != WFT_STATE_SUCCESS)
+	{
+		int family = ep_params_.address_family;
+		std::string cache_host = __get_cache_host(host_, family);
+
+		WFGlobal::get_dns_cache()->refresh_failed(cache_host, port_);
+	}
+
 	if (in_guard_)
 	{
 		int family = ep_params_.address_family;
 		std::string cache_host = __get_cache_host(host_, family);
 		std::string guard_name = __get_guard_name(cache_host, port_);
 
-		if (this->state == WFT_STATE_DNS_ERROR)
+		/* A failed refresh leaves the cached record to the waiters. */
+		if (this->state == WFT_STATE_DNS_ERROR && !refresh_)
 			msg_ = (void *)(intptr_t)this->error;
 
 		WFTaskFactory::release_guard_safe(guard_name, msg_);
@@ -42,6 +42,7 @@ public:
 		dns_ttl_min_ = dns_ttl_min;
 		has_next_ = false;
 		in_guard_ = false;
+		refresh_ = false;
 		msg_ = NULL;
 	}
 
@@ -55,6 +56,7 @@ public:
 
 		has_next_ = false;
 		in_guard_ = false;
+		refresh_ = false;
 		msg_ = NULL;
 	}
 
@@ -72,6 +74,7 @@ private:
 							   unsigned int ttl_min);
 
 	void request_dns();
+	void refresh_dns();
 	void task_callback();
 
 protected:
@@ -85,6 +88,7 @@ private:
 	unsigned short port_;
 	bool has_next_;
 	bool in_guard_;
+	bool refresh_;
 	void *msg_;
 };
 
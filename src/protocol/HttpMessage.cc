@@ -291,7 +291,7 @@ HttpMessage& HttpMessage::operator = (HttpMessage&& msg)
 		if (this->parser)
 		{
 			http_parser_deinit(this->parser);
-			delete this->parser;
+			ObjectRecycler::free(this->parser, sizeof (http_parser_t));
 		}
 
 		this->parser = msg.parser;
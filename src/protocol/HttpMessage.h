@@ -24,6 +24,7 @@
 #include <utility>
 #include <string>
 #include "list.h"
+#include "ObjectRecycler.h"
 #include "ProtocolMessage.h"
 #include "http_parser.h"
 
@@ -228,8 +229,9 @@ private:
 	size_t output_body_size;
 
 public:
-	HttpMessage(bool is_resp) : parser(new http_parser_t)
+	HttpMessage(bool is_resp)
 	{
+		this->parser = (http_parser_t *)ObjectRecycler::alloc(sizeof (http_parser_t));
 		http_parser_init(is_resp, this->parser);
 		INIT_LIST_HEAD(&this->output_body);
 		this->output_body_size = 0;
@@ -242,7 +244,7 @@ public:
 		if (this->parser)
 		{
 			http_parser_deinit(this->parser);
-			delete this->parser;
+			ObjectRecycler::free(this->parser, sizeof (http_parser_t));
 		}
 	}
 
@@ -312,6 +314,14 @@ public:
 		return this->set_request_uri(uri.c_str());
 	}
 
+public:
+	/* Tell the parser to stop after the header, and leave the body
+	 * to be received by others. For implementations. */
+	void parse_zero_body()
+	{
+		this->parser->transfer_length = 0;
+	}
+
 protected:
 	virtual int append(const void *buf, size_t *size);
 
@@ -23,9 +23,180 @@
 
 #define MIN(x, y)	((x) <= (y) ? (x) : (y))
 
+#define KAFKA_RECORD_POOL_MAX	4096
+
 namespace protocol
 {
 
+struct __record_block
+{
+	kafka_record_t record;
+	std::atomic<int> ref;
+	KafkaRecordBuffer *buffer;
+};
+
+struct __free_block
+{
+	struct __free_block *next;
+};
+
+/* Trivial, so that it is still usable after the thread's cleaner ran,
+ * e.g. by records freed by other thread_local or static destructors. */
+struct __free_list
+{
+	struct __free_block *head;
+	size_t size;
+	bool registered;
+	bool closed;
+};
+
+/* One for the record blocks, and one for the KafkaRecord objects. */
+static thread_local struct __free_list __record_pool;
+static thread_local struct __free_list __object_pool;
+
+static void __free_list_clear(struct __free_list *pool)
+{
+	struct __free_block *block;
+
+	while ((block = pool->head) != NULL)
+	{
+		pool->head = block->next;
+		::operator delete(block);
+	}
+
+	pool->size = 0;
+	pool->closed = true;
+}
+
+static class __RecordPoolCleaner
+{
+public:
+	~__RecordPoolCleaner()
+	{
+		__free_list_clear(&__record_pool);
+		__free_list_clear(&__object_pool);
+	}
+} thread_local __record_pool_cleaner;
+
+static void *__free_list_get(struct __free_list *pool, size_t size)
+{
+	struct __free_block *block = pool->head;
+
+	if (block)
+	{
+		pool->head = block->next;
+		pool->size--;
+		return block;
+	}
+
+	return ::operator new(size);
+}
+
+static void __free_list_put(struct __free_list *pool, void *p)
+{
+	struct __free_block *block = (struct __free_block *)p;
+
+	if (!pool->closed && pool->size < KAFKA_RECORD_POOL_MAX)
+	{
+		/* The cleaner frees the pools of this thread when it exits. */
+		if (!pool->registered)
+		{
+			pool->registered = true;
+			(void)&__record_pool_cleaner;
+		}
+
+		block->next = pool->head;
+		pool->head = block;
+		pool->size++;
+	}
+	else
+		::operator delete(block);
+}
+
+kafka_record_t *KafkaRecord::alloc_record(std::atomic<int> **ref)
+{
+	struct __record_block *block;
+
+	block = (struct __record_block *)
+			__free_list_get(&__record_pool, sizeof (struct __record_block));
+	kafka_record_init(&block->record);
+	block->ref = 1;
+	block->buffer = NULL;
+	*ref = &block->ref;
+	return &block->record;
+}
+
+void KafkaRecord::free_record(kafka_record_t *record)
+{
+	struct __record_block *block = (struct __record_block *)record;
+
+	kafka_record_deinit(record);
+	if (block->buffer)
+		block->buffer->decref();
+
+	__free_list_put(&__record_pool, block);
+}
+
+void KafkaRecord::set_buffer(KafkaRecordBuffer *buffer)
+{
+	struct __record_block *block = (struct __record_block *)this->ptr;
+
+	buffer->incref();
+	if (block->buffer)
+		block->buffer->decref();
+
+	block->buffer = buffer;
+}
+
+void *KafkaRecord::operator new(size_t size)
+{
+	return __free_list_get(&__object_pool, size);
+}
+
+void KafkaRecord::operator delete(void *p)
+{
+	__free_list_put(&__object_pool, p);
+}
+
+#define KAFKA_HEADER_CHUNK	64
+
+struct __header_chunk
+{
+	struct __header_chunk *next;
+	kafka_record_header_t headers[KAFKA_HEADER_CHUNK];
+};
+
+kafka_record_header_t *KafkaRecordBuffer::alloc_header()
+{
+	struct __header_chunk *chunk = this->chunks;
+
+	if (this->chunk_left == 0)
+	{
+		chunk = (struct __header_chunk *)malloc(sizeof (struct __header_chunk));
+		if (!chunk)
+			return NULL;
+
+		chunk->next = this->chunks;
+		this->chunks = chunk;
+		this->chunk_left = KAFKA_HEADER_CHUNK;
+	}
+
+	return &chunk->headers[KAFKA_HEADER_CHUNK - this->chunk_left--];
+}
+
+KafkaRecordBuffer::~KafkaRecordBuffer()
+{
+	struct __header_chunk *chunk;
+
+	while ((chunk = this->chunks) != NULL)
+	{
+		this->chunks = chunk->next;
+		free(chunk);
+	}
+
+	free(this->msgbuf);
+}
+
 std::string KafkaConfig::get_sasl_info() const
 {
 	std::string info;
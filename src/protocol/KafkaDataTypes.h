@@ -558,6 +558,12 @@ public:
 		return this->ptr->client_new(this->ptr, sasl) == 0;
 	}
 
+	/* Copy the settings, instead of sharing them like copy constructor. */
+	bool copy_from(const KafkaConfig& config)
+	{
+		return kafka_config_copy(this->ptr, config.ptr) == 0;
+	}
+
 public:
 	KafkaConfig()
 	{
@@ -627,6 +633,8 @@ private:
 	std::atomic<int> *ref;
 };
 
+class KafkaRecordBuffer;
+
 class KafkaRecord
 {
 public:
@@ -675,28 +683,20 @@ public:
 public:
 	KafkaRecord()
 	{
-		this->ptr = new kafka_record_t;
-		kafka_record_init(this->ptr);
-		this->ref = new std::atomic<int>(1);
+		this->ptr = KafkaRecord::alloc_record(&this->ref);
 	}
 
 	~KafkaRecord()
 	{
 		if (--*this->ref == 0)
-		{
-			kafka_record_deinit(this->ptr);
-			delete this->ptr;
-			delete this->ref;
-		}
+			KafkaRecord::free_record(this->ptr);
 	}
 
 	KafkaRecord(KafkaRecord&& move)
 	{
 		this->ptr = move.ptr;
 		this->ref = move.ref;
-		move.ptr = new kafka_record_t;
-		kafka_record_init(move.ptr);
-		move.ref = new std::atomic<int>(1);
+		move.ptr = KafkaRecord::alloc_record(&move.ref);
 	}
 
 	KafkaRecord& operator= (KafkaRecord&& move)
@@ -706,9 +706,7 @@ public:
 			this->~KafkaRecord();
 			this->ptr = move.ptr;
 			this->ref = move.ref;
-			move.ptr = new kafka_record_t;
-			kafka_record_init(move.ptr);
-			move.ref = new std::atomic<int>(1);
+			move.ptr = KafkaRecord::alloc_record(&move.ref);
 		}
 
 		return *this;
@@ -738,6 +736,22 @@ public:
 
 	struct list_head *get_header_list() const { return &this->ptr->header_list; }
 
+public:
+	/* A fetch response makes one for each record, so they are recycled
+	 * by a per-thread free list too. */
+	static void *operator new(size_t size);
+	static void operator delete(void *p);
+
+private:
+	/* Record and its ref count in one block, recycled by a per-thread
+	 * free list. */
+	static kafka_record_t *alloc_record(std::atomic<int> **ref);
+	static void free_record(kafka_record_t *record);
+
+	/* Key, value and headers of a fetched record are views into 'buffer'.
+	 * The record keeps it alive, so it may outlive its response. */
+	void set_buffer(KafkaRecordBuffer *buffer);
+
 private:
 	struct list_head list;
 	kafka_record_t *ptr;
@@ -1584,6 +1598,49 @@ private:
 	bool insert_flag;
 };
 
+struct __header_chunk;
+
+/* Owner of a fetch response buffer and the batches uncompressed from it.
+ * Records parsed from the response point into these buffers, and each
+ * holds a reference until it is destroyed. */
+class KafkaRecordBuffer
+{
+public:
+	KafkaRecordBuffer(void *msgbuf) : ref(1)
+	{
+		this->msgbuf = msgbuf;
+		this->chunks = NULL;
+		this->chunk_left = 0;
+	}
+
+	void incref() { ++this->ref; }
+
+	void decref()
+	{
+		if (--this->ref == 0)
+			delete this;
+	}
+
+	void add_block(KafkaBlock block)
+	{
+		this->uncompressed.add_item(std::move(block));
+	}
+
+	/* Header nodes of the records, allocated in chunks and freed with
+	 * the buffer. */
+	kafka_record_header_t *alloc_header();
+
+private:
+	~KafkaRecordBuffer();
+
+private:
+	std::atomic<int> ref;
+	void *msgbuf;
+	KafkaBuffer uncompressed;
+	struct __header_chunk *chunks;
+	size_t chunk_left;
+};
+
 class KafkaSnappySink : public snappy::Sink
 {
 public:
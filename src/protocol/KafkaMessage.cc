@@ -1154,7 +1154,7 @@ static int parse_varint_u64(void **buf, size_t *size, uint64_t *val)
 int KafkaMessage::parse_message_set(void **buf, size_t *size,
 									bool check_crcs, int msg_vers,
 									struct list_head *record_list,
-									KafkaBuffer *uncompressed,
+									KafkaRecordBuffer *buffer,
 									KafkaToppar *toppar)
 {
 	int64_t offset;
@@ -1215,6 +1215,7 @@ int KafkaMessage::parse_message_set(void **buf, size_t *size,
 		{
 			KafkaRecord *kafka_record = new KafkaRecord;
 			kafka_record_t *record = kafka_record->get_raw_ptr();
+			kafka_record->set_buffer(buffer);
 			record->key = key;
 			record->key_len = key_len;
 			record->timestamp = timestamp;
@@ -1236,9 +1237,9 @@ int KafkaMessage::parse_message_set(void **buf, size_t *size,
 			void *uncompressed_ptr = block.get_block();
 			size_t uncompressed_len = block.get_len();
 			parse_message_set(&uncompressed_ptr, &uncompressed_len, check_crcs,
-							msg_vers, record_list, uncompressed, toppar);
+							msg_vers, record_list, buffer, toppar);
 
-			uncompressed->add_item(std::move(block));
+			buffer->add_block(std::move(block));
 
 			if (msg_vers == 1)
 			{
@@ -1264,7 +1265,7 @@ int KafkaMessage::parse_message_set(void **buf, size_t *size,
 	if (*size > 0)
 	{
 		return parse_message_set(buf, size, check_crcs, msg_vers,
-								 record_list, uncompressed, toppar);
+								 record_list, buffer, toppar);
 	}
 
 	return 0;
@@ -1319,6 +1320,7 @@ struct KafkaBatchRecordHeader
 };
 
 int KafkaMessage::parse_message_record(void **buf, size_t *size,
+									   KafkaRecordBuffer *buffer,
 									   kafka_record_t *record)
 {
 	int64_t length;
@@ -1353,28 +1355,21 @@ int KafkaMessage::parse_message_record(void **buf, size_t *size,
 
 	for (int i = 0; i < hdr_size; ++i)
 	{
-		kafka_record_header_t *header;
+		kafka_record_header_t *header = buffer->alloc_header();
 
-		header = (kafka_record_header_t *)malloc(sizeof(kafka_record_header_t));
 		if (!header)
 			return -1;
 
+		/* The node and its key and value all belong to the buffer. */
 		kafka_record_header_init(header);
+		header->key_is_moved = 1;
+		header->value_is_moved = 1;
+		header->node_is_moved = 1;
 		if (parse_varint_bytes(buf, size, &header->key, &header->key_len) < 0)
-		{
-			free(header);
 			return -1;
-		}
 
 		if (parse_varint_bytes(buf, size, &header->value, &header->value_len) < 0)
-		{
-			kafka_record_header_deinit(header);
-			free(header);
 			return -1;
-		}
-
-		header->key_is_moved = 1;
-		header->value_is_moved = 1;
 
 		list_add_tail(&header->list, &record->header_list);
 	}
@@ -1385,7 +1380,7 @@ int KafkaMessage::parse_message_record(void **buf, size_t *size,
 int KafkaMessage::parse_record_batch(void **buf, size_t *size,
 									 bool check_crcs,
 									 struct list_head *record_list,
-									 KafkaBuffer *uncompressed,
+									 KafkaRecordBuffer *buffer,
 									 KafkaToppar *toppar)
 {
 	KafkaBatchRecordHeader hdr;
@@ -1471,13 +1466,14 @@ int KafkaMessage::parse_record_batch(void **buf, size_t *size,
 	for (int i = 0; i < hdr.record_count; ++i)
 	{
 		KafkaRecord *record = new KafkaRecord;
+		record->set_buffer(buffer);
 		record->set_offset(hdr.base_offset);
 		record->set_timestamp(hdr.base_timestamp);
 		record->get_raw_ptr()->key_is_moved = 1;
 		record->get_raw_ptr()->value_is_moved = 1;
 		record->get_raw_ptr()->toppar = toppar->get_raw_ptr();
 
-		switch (parse_message_record(&p, &n, record->get_raw_ptr()))
+		switch (parse_message_record(&p, &n, buffer, record->get_raw_ptr()))
 		{
 			case -1:
 				delete record;
@@ -1498,13 +1494,13 @@ int KafkaMessage::parse_record_batch(void **buf, size_t *size,
 	}
 
 	if (block.get_len() > 0)
-		uncompressed->add_item(std::move(block));
+		buffer->add_block(std::move(block));
 
 	return 0;
 }
 
 int KafkaMessage::parse_records(void **buf, size_t *size, bool check_crcs,
-								KafkaBuffer *uncompressed, KafkaToppar *toppar)
+								KafkaRecordBuffer *buffer, KafkaToppar *toppar)
 {
 	struct list_head *record_list = toppar->get_record();
 	int msg_set_size = 0;
@@ -1534,12 +1530,12 @@ int KafkaMessage::parse_records(void **buf, size_t *size, bool check_crcs,
 		case 1:
 			ret = parse_message_set(buf, &msg_size, check_crcs,
 									magic, record_list,
-									uncompressed, toppar);
+									buffer, toppar);
 			break;
 
 		case 2:
 			ret = parse_record_batch(buf, &msg_size, check_crcs,
-									 record_list, uncompressed, toppar);
+									 record_list, buffer, toppar);
 			break;
 
 		default:
@@ -1577,6 +1573,7 @@ KafkaMessage::KafkaMessage()
 	this->api_type = Kafka_Unknown;
 	this->correlation_id = 0;
 	this->cur_size = 0;
+	this->record_buffer = NULL;
 }
 
 KafkaMessage::~KafkaMessage()
@@ -1587,6 +1584,9 @@ KafkaMessage::~KafkaMessage()
 		delete this->parser;
 		delete this->stream;
 	}
+
+	if (this->record_buffer)
+		this->record_buffer->decref();
 }
 
 KafkaMessage::KafkaMessage(KafkaMessage&& msg) :
@@ -1602,7 +1602,8 @@ KafkaMessage::KafkaMessage(KafkaMessage&& msg) :
 
 	this->toppar_list = std::move(msg.toppar_list);
 	this->serialized = std::move(msg.serialized);
-	this->uncompressed = std::move(msg.uncompressed);
+	this->record_buffer = msg.record_buffer;
+	msg.record_buffer = NULL;
 
 	this->api_type = msg.api_type;
 	msg.api_type = Kafka_Unknown;
@@ -1637,7 +1638,11 @@ KafkaMessage& KafkaMessage::operator= (KafkaMessage &&msg)
 
 		this->toppar_list = std::move(msg.toppar_list);
 		this->serialized = std::move(msg.serialized);
-		this->uncompressed = std::move(msg.uncompressed);
+		if (this->record_buffer)
+			this->record_buffer->decref();
+
+		this->record_buffer = msg.record_buffer;
+		msg.record_buffer = NULL;
 
 		this->api_type = msg.api_type;
 		msg.api_type = Kafka_Unknown;
@@ -3166,6 +3171,13 @@ int KafkaResponse::parse_fetch(void **buf, size_t *size)
 	while ((toppar = this->toppar_list.get_next()) != NULL)
 		toppar->clear_records();
 
+	/* Records are views into the response, which now belongs to them. */
+	if (this->record_buffer)
+		this->record_buffer->decref();
+
+	this->record_buffer = new KafkaRecordBuffer(this->parser->msgbuf);
+	this->parser->msgbuf = NULL;
+
 	if (this->api_version >= 1)
 		CHECK_RET(parse_i32(buf, size, &throttle_time));
 
@@ -3232,7 +3244,7 @@ int KafkaResponse::parse_fetch(void **buf, size_t *size)
 			}
 
 			if (parse_records(buf, size, this->config.get_check_crcs(),
-							  &this->uncompressed, toppar) != 0)
+							  this->record_buffer, toppar) != 0)
 			{
 				ptr->error = KAFKA_CORRUPT_MESSAGE;
 				return -1;
@@ -143,27 +143,32 @@ public:
 		kafka_parser_init(this->parser);
 		this->cur_size = 0;
 		this->serialized = KafkaBuffer();
-		this->uncompressed = KafkaBuffer();
+		if (this->record_buffer)
+		{
+			this->record_buffer->decref();
+			this->record_buffer = NULL;
+		}
 	}
 
 protected:
 	static int parse_message_set(void **buf, size_t *size,
 								 bool check_crcs, int msg_vers,
 								 struct list_head *record_list,
-								 KafkaBuffer *uncompressed,
+								 KafkaRecordBuffer *buffer,
 								 KafkaToppar *toppar);
 
 	static int parse_message_record(void **buf, size_t *size,
+									KafkaRecordBuffer *buffer,
 									kafka_record_t *kafka_record);
 
 	static int parse_record_batch(void **buf, size_t *size,
 								  bool check_crcs,
 								  struct list_head *record_list,
-								  KafkaBuffer *uncompressed,
+								  KafkaRecordBuffer *buffer,
 								  KafkaToppar *toppar);
 
 	static int parse_records(void **buf, size_t *size, bool check_crcs,
-							 KafkaBuffer *uncompressed, KafkaToppar *toppar);
+							 KafkaRecordBuffer *buffer, KafkaToppar *toppar);
 
 	static std::string get_member_assignment(kafka_member_t *member);
 
@@ -195,7 +200,7 @@ protected:
 	KafkaBrokerList broker_list;
 	KafkaTopparList toppar_list;
 	KafkaBuffer serialized;
-	KafkaBuffer uncompressed;
+	KafkaRecordBuffer *record_buffer;
 
 	int api_type;
 	int api_version;
@@ -58,6 +58,7 @@ MySQLMessage::MySQLMessage(MySQLMessage&& move) :
 	parser_ = move.parser_;
 	stream_ = move.stream_;
 	seqid_ = move.seqid_;
+	buf_ = std::move(move.buf_);
 	cur_size_ = move.cur_size_;
 
 	move.parser_ = NULL;
@@ -83,6 +84,7 @@ MySQLMessage& MySQLMessage::operator= (MySQLMessage&& move)
 		parser_ = move.parser_;
 		stream_ = move.stream_;
 		seqid_ = move.seqid_;
+		buf_ = std::move(move.buf_);
 		cur_size_ = move.cur_size_;
 
 		move.parser_ = NULL;
@@ -127,8 +129,11 @@ int MySQLMessage::append(const void *buf, size_t *size)
 
 		buf = (const char *)buf + n;
 		nleft -= n;
-	} while (nleft > 0);
+	} while (nleft > 0 && ret == 0);
 
+	/* A streaming response may complete a batch in the middle. */
+	cur_size_ -= nleft;
+	*size -= nleft;
 	return ret;
 }
 
@@ -181,6 +186,23 @@ void MySQLRequest::set_query(const char *query, size_t length)
 		memcpy(buffer + 1, query, length);
 }
 
+void MySQLRequest::set_init_db(const std::string& db)
+{
+	set_command(MYSQL_COM_INIT_DB);
+	buf_.resize(db.size() + 1);
+	char *buffer = const_cast<char *>(buf_.c_str());
+
+	buffer[0] = MYSQL_COM_INIT_DB;
+	if (db.size() > 0)
+		memcpy(buffer + 1, db.c_str(), db.size());
+}
+
+void MySQLRequest::set_reset_connection()
+{
+	set_command(MYSQL_COM_RESET_CONNECTION);
+	buf_.assign(1, MYSQL_COM_RESET_CONNECTION);
+}
+
 std::string MySQLRequest::get_query() const
 {
 	size_t len = buf_.size();
@@ -620,7 +642,71 @@ void MySQLResponse::set_ok_packet()
 
 int MySQLResponse::decode_packet(const unsigned char *buf, size_t buflen)
 {
-	return mysql_parser_parse(buf, buflen, parser_);
+	int ret = mysql_parser_parse(buf, buflen, parser_);
+
+	batch_end_ = false;
+	if (ret != 0 || row_batch_ <= 0 || parser_->result_set_count == 0)
+		return ret;
+
+	struct __mysql_result_set *result_set = parser_->current_result_set;
+
+	if (result_set->type != MYSQL_PACKET_GET_RESULT ||
+		result_set->rows_begin_offset == 0)
+		return 0;
+
+	if (result_set->rows_end_offset == 0)
+	{
+		if (result_set->row_count < row_batch_)
+			return 0;
+
+		result_set->rows_end_offset = parser_->offset;
+	}
+	else if (result_set->row_count == 0)
+		return 0;
+
+	/* The buffer may have been moved since the last complete packet. */
+	parser_->buf = buf;
+	batch_end_ = true;
+	return 1;
+}
+
+bool MySQLResponse::has_row_batch() const
+{
+	struct __mysql_result_set *result_set;
+
+	if (parser_->result_set_count == 0)
+		return false;
+
+	result_set = parser_->current_result_set;
+	return result_set->type == MYSQL_PACKET_GET_RESULT &&
+		   result_set->rows_end_offset != 0 && result_set->row_count > 0;
+}
+
+void MySQLResponse::discard_row_batch()
+{
+	struct __mysql_result_set *result_set;
+	size_t begin, end;
+	char *buf;
+
+	if (!this->has_row_batch())
+		return;
+
+	result_set = parser_->current_result_set;
+	begin = result_set->rows_begin_offset;
+	end = result_set->rows_end_offset;
+	buf = (char *)stream_->buf;
+
+	/* Only the EOF packet may follow the rows. */
+	memmove(buf + begin, buf + end, stream_->length - end);
+	stream_->length -= end - begin;
+	cur_size_ -= end - begin;
+	result_set->row_count = 0;
+	if (parser_->offset == end)
+		result_set->rows_end_offset = 0;
+	else
+		result_set->rows_end_offset = begin;
+
+	parser_->offset -= end - begin;
 }
 
 unsigned long long MySQLResponse::get_affected_rows() const
@@ -77,6 +77,11 @@ public:
 	std::string get_query() const;
 	bool query_is_unset() const;
 
+	/* COM_INIT_DB and COM_RESET_CONNECTION. They change the state of the
+	 * session, and are allowed only on transaction connections. */
+	void set_init_db(const std::string& db);
+	void set_reset_connection();
+
 public:
 	MySQLRequest() = default;
 	//move constructor
@@ -103,7 +108,28 @@ public:
 	void set_ok_packet();
 
 public:
-	MySQLResponse() = default;
+	/* Streaming mode. The message is reported complete every 'rows' rows
+	 * of a result set and at the end of each result set, so that the rows
+	 * received can be read by MySQLResultCursor. Then call
+	 * 'discard_row_batch()' to release them and continue receiving. */
+	void set_row_batch(int rows) { row_batch_ = rows; }
+	bool has_row_batch() const;
+	void discard_row_batch();
+
+	/* True if the message was reported complete only for a batch. */
+	bool is_batch_end() const { return batch_end_; }
+
+protected:
+	int row_batch_;
+	bool batch_end_;
+
+public:
+	MySQLResponse()
+	{
+		row_batch_ = 0;
+		batch_end_ = false;
+	}
+
 	//move constructor
 	MySQLResponse(MySQLResponse&& move) = default;
 	//move operator
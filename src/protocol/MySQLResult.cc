@@ -16,6 +16,7 @@
   Authors: Li Yingxin (liyingxin@sogou-inc.com)
 */
 
+#include <new>
 #include <vector>
 #include "mysql_types.h"
 #include "mysql_byteorder.h"
@@ -63,6 +64,21 @@ MySQLField::MySQLField(const void *buf, mysql_field_t *field)
 	this->data_type = field->data_type;
 }
 
+/* The pointer table and the fields in one allocation. */
+MySQLField **MySQLResultCursor::new_fields(const void *buf,
+							const struct __mysql_result_set *result_set)
+{
+	int n = result_set->field_count;
+	char *p = new char[n * (sizeof (MySQLField *) + sizeof (MySQLField))];
+	MySQLField **fields = (MySQLField **)p;
+	MySQLField *field = (MySQLField *)(p + n * sizeof (MySQLField *));
+
+	for (int i = 0; i < n; i++)
+		fields[i] = new(&field[i]) MySQLField(buf, result_set->fields[i]);
+
+	return fields;
+}
+
 MySQLResultCursor::MySQLResultCursor()
 {
 	this->init();
@@ -104,9 +120,8 @@ void MySQLResultCursor::fetch_result_set(const struct __mysql_result_set *result
 		this->end = buf + result_set->rows_end_offset;
 		this->row_count = result_set->row_count;
 
-		this->fields = new MySQLField *[this->field_count];
-		for (int i = 0; i < this->field_count; i++)
-			this->fields[i] = new MySQLField(this->parser->buf, result_set->fields[i]);
+		this->fields = MySQLResultCursor::new_fields(this->parser->buf,
+													result_set);
 		break;
 
 	case MYSQL_PACKET_OK:
@@ -157,11 +172,7 @@ bool MySQLResultCursor::next_result_set()
 	struct __mysql_result_set *result_set;
 	if (mysql_result_set_cursor_next(&result_set, &this->cursor) == 0)
 	{
-		for (int i = 0; i < this->field_count; i++)
-			delete this->fields[i];
-
-		delete []this->fields;
-
+		this->clear();
 		this->current_field = 0;
 		this->current_row = 0;
 
@@ -320,11 +331,7 @@ void MySQLResultCursor::first_result_set()
 
 	if (mysql_result_set_cursor_next(&result_set, &this->cursor) == 0)
 	{
-		for (int i = 0; i < this->field_count; i++)
-			delete this->fields[i];
-
-		delete []this->fields;
-
+		this->clear();
 		this->current_field = 0;
 		this->current_row = 0;
 
@@ -162,6 +162,8 @@ private:
 	void clear();
 
 	void fetch_result_set(const struct __mysql_result_set *result_set);
+	static MySQLField **new_fields(const void *buf,
+							const struct __mysql_result_set *result_set);
 
 	template<class T>
 	bool fetch_row(T& row_map); 
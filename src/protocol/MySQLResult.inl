@@ -17,6 +17,8 @@
 */
 
 #include <math.h>
+#include <stdlib.h>
+#include <string.h>
 #include <string>
 #include <utility>
 #include "mysql_byteorder.h"
@@ -106,6 +108,35 @@ inline int MySQLField::get_data_type() const
 	return this->data_type;
 }
 
+/* Cells are decoded from the row buffer directly, without a std::string
+ * to terminate them. */
+static inline long long __mysql_cell_to_ll(const char *p, size_t len)
+{
+	const char *end = p + len;
+	unsigned long long n = 0;
+	bool neg = false;
+
+	if (p < end && (*p == '-' || *p == '+'))
+		neg = (*p++ == '-');
+
+	while (p < end && *p >= '0' && *p <= '9')
+		n = n * 10 + (*p++ - '0');
+
+	return neg ? -(long long)n : (long long)n;
+}
+
+static inline double __mysql_cell_to_double(const char *p, size_t len)
+{
+	char buf[64];
+
+	if (len >= sizeof buf)
+		return strtod(std::string(p, len).c_str(), NULL);
+
+	memcpy(buf, p, len);
+	buf[len] = '\0';
+	return strtod(buf, NULL);
+}
+
 inline MySQLCell::MySQLCell(MySQLCell&& move)
 {
 	this->operator=(std::move(move));
@@ -176,8 +207,7 @@ inline int MySQLCell::as_int() const
 	if (!this->is_int())
 		return 0;
 
-	std::string num((char *)this->data, this->len);
-	return atoi(num.c_str());
+	return (int)__mysql_cell_to_ll((const char *)this->data, this->len);
 }
 
 inline bool MySQLCell::is_float() const
@@ -190,8 +220,7 @@ inline float MySQLCell::as_float() const
 	if (!this->is_float())
 		return NAN;
 
-	std::string num((char *)this->data, this->len);
-	return strtof(num.c_str(), NULL);
+	return (float)__mysql_cell_to_double((const char *)this->data, this->len);
 }
 
 inline bool MySQLCell::is_double() const
@@ -204,8 +233,7 @@ inline double MySQLCell::as_double() const
 	if (!this->is_double())
 		return NAN;
 
-	std::string num((char *)this->data, this->len);
-	return strtod(num.c_str(), NULL);
+	return __mysql_cell_to_double((const char *)this->data, this->len);
 }
 
 inline bool MySQLCell::is_ulonglong() const
@@ -218,8 +246,8 @@ inline unsigned long long MySQLCell::as_ulonglong() const
 	if (!this->is_ulonglong())
 		return (unsigned long long)-1;
 
-	std::string num((char *)this->data, this->len);
-	return strtoull(num.c_str(), NULL, 10);
+	return (unsigned long long)__mysql_cell_to_ll((const char *)this->data,
+												 this->len);
 }
 
 inline bool MySQLCell::is_date() const
@@ -420,10 +448,9 @@ inline std::string MySQLResultCursor::get_info() const
 
 inline void MySQLResultCursor::clear()
 {
-	for (int i = 0; i < this->field_count; i++)
-		delete this->fields[i];
-
-	delete []this->fields;
+	/* MySQLField is trivially destructible. See 'new_fields()'. */
+	delete [](char *)this->fields;
+	this->fields = NULL;
 }
 
 inline MySQLResultCursor::~MySQLResultCursor()
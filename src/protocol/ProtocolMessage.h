@@ -90,6 +90,22 @@ protected:
 			return this->CommMessageIn::renew();
 	}
 
+	virtual int pause()
+	{
+		if (this->wrapper)
+			return this->wrapper->pause();
+		else
+			return this->CommMessageIn::pause();
+	}
+
+	virtual int resume()
+	{
+		if (this->wrapper)
+			return this->wrapper->resume();
+		else
+			return this->CommMessageIn::resume();
+	}
+
 	virtual ProtocolMessage *inner() { return this; }
 
 protected:
@@ -18,6 +18,7 @@
 */
 
 #include <errno.h>
+#include <stdio.h>
 #include <string.h>
 #include <sstream>
 #include <utility>
@@ -307,10 +308,22 @@ void RedisValue::set(const redis_reply_t *reply)
 		break;
 
 	case REDIS_REPLY_TYPE_STRING:
+	case REDIS_REPLY_TYPE_DOUBLE:
+	case REDIS_REPLY_TYPE_BIGNUM:
+	case REDIS_REPLY_TYPE_VERB:
 		set_string(reply->str, reply->len);
 		break;
 
+	case REDIS_REPLY_TYPE_BOOL:
+		set_int(reply->integer);
+		break;
+
+	/* RESP3 aggregates are arrays here, and a map is key-value pairs.
+	 * Use 'result_ptr()' to tell the original types. */
 	case REDIS_REPLY_TYPE_ARRAY:
+	case REDIS_REPLY_TYPE_MAP:
+	case REDIS_REPLY_TYPE_SET:
+	case REDIS_REPLY_TYPE_PUSH:
 		set_array(reply->elements);
 
 		if (reply->elements > 0)
@@ -384,6 +397,53 @@ bool RedisValue::transform(redis_reply_t *reply) const
 	return true;
 }
 
+/* Same as RedisValue::transform(), but elements are from the arena of
+ * the parser, so that they are freed together with the message. */
+static bool __redis_value_transform(const RedisValue& value,
+									redis_reply_t *reply,
+									redis_parser_t *parser)
+{
+	const std::string *pstr;
+	size_t i;
+
+	redis_reply_set_null(reply);
+	switch (value.get_type())
+	{
+	case REDIS_REPLY_TYPE_INTEGER:
+		redis_reply_set_integer(value.int_value(), reply);
+		break;
+
+	case REDIS_REPLY_TYPE_ARRAY:
+		if (redis_parser_set_array(value.arr_size(), reply, parser) < 0)
+			return false;
+
+		for (i = 0; i < reply->elements; i++)
+		{
+			if (!__redis_value_transform(value[i], reply->element[i], parser))
+				return false;
+		}
+
+		break;
+
+	case REDIS_REPLY_TYPE_STATUS:
+		pstr = value.string_view();
+		redis_reply_set_status(pstr->c_str(), pstr->size(), reply);
+		break;
+
+	case REDIS_REPLY_TYPE_ERROR:
+		pstr = value.string_view();
+		redis_reply_set_error(pstr->c_str(), pstr->size(), reply);
+		break;
+
+	case REDIS_REPLY_TYPE_STRING:
+		pstr = value.string_view();
+		redis_reply_set_string(pstr->c_str(), pstr->size(), reply);
+		break;
+	}
+
+	return true;
+}
+
 std::string RedisValue::debug_string() const
 {
 	std::string ret;
@@ -525,6 +585,52 @@ bool RedisMessage::encode_reply(redis_reply_t *reply)
 
 		break;
 
+	/* RESP3, only if the peer said HELLO 3. */
+	case REDIS_REPLY_TYPE_DOUBLE:
+		stream << ",";
+		if (reply->str)
+			stream << std::make_pair(reply->str, reply->len);
+		else
+		{
+			char buf[32];
+			int n = snprintf(buf, 32, "%.17g", reply->dval);
+			stream.append_copy(buf, n);
+		}
+
+		stream << "\r\n";
+		break;
+
+	case REDIS_REPLY_TYPE_BOOL:
+		stream << (reply->integer ? "#t\r\n" : "#f\r\n");
+		break;
+
+	case REDIS_REPLY_TYPE_BIGNUM:
+		stream << "(" << std::make_pair(reply->str, reply->len) << "\r\n";
+		break;
+
+	case REDIS_REPLY_TYPE_VERB:
+		stream << "=" << reply->len + 4 << "\r\n";
+		stream.append_nocopy(reply->vtype, 3);
+		stream << ":";
+		stream << std::make_pair(reply->str, reply->len) << "\r\n";
+		break;
+
+	case REDIS_REPLY_TYPE_MAP:
+	case REDIS_REPLY_TYPE_SET:
+	case REDIS_REPLY_TYPE_PUSH:
+		if (reply->type == REDIS_REPLY_TYPE_MAP)
+			stream << "%" << reply->elements / 2 << "\r\n";
+		else if (reply->type == REDIS_REPLY_TYPE_SET)
+			stream << "~" << reply->elements << "\r\n";
+		else
+			stream << ">" << reply->elements << "\r\n";
+
+		for (size_t i = 0; i < reply->elements; i++)
+			if (!encode_reply(reply->element[i]))
+				return false;
+
+		break;
+
 	default:
 		return false;
 	}
@@ -575,7 +681,7 @@ void RedisRequest::set_request(const std::string& command,
 		user_request_.push_back(params[i]);
 
 	redis_reply_t *reply = &parser_->reply;
-	redis_reply_set_array(n, reply);
+	redis_parser_set_array(n, reply, parser_);
 	for (size_t i = 0; i < n; i++)
 	{
 		redis_reply_set_string(user_request_[i].c_str(),
@@ -687,12 +793,14 @@ int RedisResponse::append(const void *buf, size_t *size)
 
 bool RedisResponse::set_result(const RedisValue& value)
 {
-	redis_reply_t *reply = &parser_->reply;
-	redis_reply_deinit(reply);
-	redis_reply_init(reply);
-
+	redis_parser_clear_reply(parser_);
 	value_ = value;
-	return value_.transform(reply);
+	if (!__redis_value_transform(value_, &parser_->reply, parser_))
+		return false;
+
+	/* A result set locally reads back by get_result() like a parsed one. */
+	parser_->parse_succ = 1;
+	return true;
 }
 
 }
@@ -192,7 +192,7 @@ public:// C++ style
 	bool set_result(const RedisValue& value);
 
 public:// C style
-	// redis_parser_t is absolutely same as hiredis-redisReply in memory
+	// redis_reply_t is absolutely same as hiredis-redisReply (1.0+) in memory
 	// If you include hiredis.h, redisReply* can cast to redis_reply_t* safely
 	// BUT this function return not a copy, DONOT free the pointer by yourself
 
@@ -363,6 +363,46 @@ void kafka_config_deinit(kafka_config_t *conf)
 	free(conf->password);
 }
 
+static int __kafka_strdup(char **dst, const char *src)
+{
+	if (src)
+	{
+		*dst = strdup(src);
+		if (!*dst)
+			return -1;
+	}
+	else
+		*dst = NULL;
+
+	return 0;
+}
+
+int kafka_config_copy(kafka_config_t *dst, const kafka_config_t *src)
+{
+	kafka_config_t conf = *src;
+
+	conf.broker_version = NULL;
+	conf.client_id = NULL;
+	conf.rack_id = NULL;
+	conf.mechanisms = NULL;
+	conf.username = NULL;
+	conf.password = NULL;
+	if (__kafka_strdup(&conf.broker_version, src->broker_version) < 0 ||
+		__kafka_strdup(&conf.client_id, src->client_id) < 0 ||
+		__kafka_strdup(&conf.rack_id, src->rack_id) < 0 ||
+		__kafka_strdup(&conf.mechanisms, src->mechanisms) < 0 ||
+		__kafka_strdup(&conf.username, src->username) < 0 ||
+		__kafka_strdup(&conf.password, src->password) < 0)
+	{
+		kafka_config_deinit(&conf);
+		return -1;
+	}
+
+	kafka_config_deinit(dst);
+	*dst = conf;
+	return 0;
+}
+
 void kafka_partition_init(kafka_partition_t *partition)
 {
 	partition->error = 0;
@@ -464,6 +504,7 @@ void kafka_record_header_init(kafka_record_header_t *header)
 	header->value = NULL;
 	header->value_len = 0;
 	header->value_is_moved = 0;
+	header->node_is_moved = 0;
 }
 
 void kafka_record_header_deinit(kafka_record_header_t *header)
@@ -506,7 +547,8 @@ void kafka_record_deinit(kafka_record_t *record)
 		header = list_entry(pos, kafka_record_header_t, list);
 		list_del(pos);
 		kafka_record_header_deinit(header);
-		free(header);
+		if (!header->node_is_moved)
+			free(header);
 	}
 }
 
@@ -355,6 +355,7 @@ typedef struct __kafka_record_header
 	void *value;
 	size_t value_len;
 	int value_is_moved;
+	int node_is_moved;
 } kafka_record_header_t;
 
 typedef struct __kafka_record
@@ -443,6 +444,7 @@ void kafka_broker_deinit(kafka_broker_t *broker);
 
 void kafka_config_init(kafka_config_t *config);
 void kafka_config_deinit(kafka_config_t *config);
+int kafka_config_copy(kafka_config_t *dst, const kafka_config_t *src);
 
 void kafka_meta_init(kafka_meta_t *meta);
 void kafka_meta_deinit(kafka_meta_t *meta);
@@ -374,6 +374,8 @@ static int parse_field_count(const void *buf, size_t len, mysql_parser_t *parser
 
 		result_set->field_count = field_count;
 		result_set->row_count = 0;
+		result_set->rows_begin_offset = 0;
+		result_set->rows_end_offset = 0;
 		result_set->type = MYSQL_PACKET_GET_RESULT;
 
 		list_add_tail(&result_set->list, &parser->result_set_list);
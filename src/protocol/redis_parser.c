@@ -29,6 +29,8 @@
 #define REDIS_MSGBUF_INIT_SIZE		8
 #define REDIS_REPLY_DEPTH_LIMIT		64
 #define REDIS_ARRAY_SIZE_LIMIT		(4 * 1024 * 1024)
+#define REDIS_ARENA_BLOCK_SIZE		4096
+#define REDIS_ARENA_ALIGN			8
 
 enum
 {
@@ -41,23 +43,81 @@ enum
 	REDIS_PARSE_END
 };
 
-struct __redis_read_record
+/* An aggregate reply that is being read. */
+struct __redis_read_frame
 {
-	struct list_head list;
 	redis_reply_t *reply;
+	size_t next;
+};
+
+struct __redis_arena_block
+{
+	struct list_head list;
+	size_t size;
 };
 
+static void *__redis_arena_alloc(size_t size, redis_parser_t *parser)
+{
+	struct __redis_arena_block *block;
+	size_t block_size;
+	void *ptr;
+
+	size = (size + REDIS_ARENA_ALIGN - 1) & ~(size_t)(REDIS_ARENA_ALIGN - 1);
+	if (size > parser->arena_left)
+	{
+		/* A big array gets a block of its own, and the current block
+		 * is kept for the small ones that follow. */
+		block_size = MAX(size, REDIS_ARENA_BLOCK_SIZE);
+		block = (struct __redis_arena_block *)malloc(sizeof *block + block_size);
+		if (!block)
+			return NULL;
+
+		block->size = block_size;
+		list_add_tail(&block->list, &parser->arena_list);
+		ptr = block + 1;
+		if (size >= REDIS_ARENA_BLOCK_SIZE)
+			return ptr;
+
+		parser->arena_ptr = (char *)ptr;
+		parser->arena_left = block_size;
+	}
+
+	ptr = parser->arena_ptr;
+	parser->arena_ptr += size;
+	parser->arena_left -= size;
+	return ptr;
+}
+
+static void __redis_arena_free(redis_parser_t *parser)
+{
+	struct list_head *pos, *tmp;
+	struct __redis_arena_block *block;
+
+	list_for_each_safe(pos, tmp, &parser->arena_list)
+	{
+		block = list_entry(pos, struct __redis_arena_block, list);
+		list_del(pos);
+		free(block);
+	}
+
+	parser->arena_ptr = NULL;
+	parser->arena_left = 0;
+}
+
 void redis_reply_deinit(redis_reply_t *reply)
 {
 	size_t i;
 
+	/* An element in the arena may have been rewritten by malloc. */
 	for (i = 0; i < reply->elements; i++)
 	{
 		redis_reply_deinit(reply->element[i]);
-		free(reply->element[i]);
+		if (!reply->in_arena)
+			free(reply->element[i]);
 	}
 
-	free(reply->element);
+	if (!reply->in_arena)
+		free(reply->element);
 }
 
 static redis_reply_t **__redis_create_array(size_t size, redis_reply_t *reply)
@@ -104,10 +164,64 @@ int redis_reply_set_array(size_t size, redis_reply_t *reply)
 	redis_reply_deinit(reply);
 	reply->element = element;
 	reply->elements = size;
+	reply->in_arena = 0;
 	reply->type = REDIS_REPLY_TYPE_ARRAY;
 	return 0;
 }
 
+/* The element vector and the elements in one allocation of the arena. */
+static int __redis_set_aggregate(int type, size_t size, redis_reply_t *reply,
+								 redis_parser_t *parser)
+{
+	redis_reply_t **element = NULL;
+	redis_reply_t *replies;
+	size_t i;
+
+	if (size > 0)
+	{
+		element = (redis_reply_t **)__redis_arena_alloc(
+				size * (sizeof (void *) + sizeof (redis_reply_t)), parser);
+		if (!element)
+			return -1;
+
+		replies = (redis_reply_t *)(element + size);
+		for (i = 0; i < size; i++)
+		{
+			redis_reply_init(&replies[i]);
+			element[i] = &replies[i];
+		}
+	}
+
+	redis_reply_deinit(reply);
+	reply->type = type;
+	reply->elements = size;
+	reply->element = element;
+	reply->in_arena = 1;
+	return 0;
+}
+
+int redis_parser_set_array(size_t size, redis_reply_t *reply,
+						   redis_parser_t *parser)
+{
+	if (reply == &parser->reply)
+		redis_parser_clear_reply(parser);
+
+	return __redis_set_aggregate(REDIS_REPLY_TYPE_ARRAY, size, reply, parser);
+}
+
+void redis_parser_clear_reply(redis_parser_t *parser)
+{
+	/* Parts built by redis_reply_set_array() on 'result_ptr()'. */
+	redis_reply_deinit(&parser->reply);
+
+	/* Nothing else lives in the arena once the reply is gone. */
+	__redis_arena_free(parser);
+	parser->stack = NULL;
+	parser->depth = 0;
+	parser->cur = &parser->reply;
+	redis_reply_init(&parser->reply);
+}
+
 static int __redis_parse_cmd(const char ch, redis_parser_t *parser)
 {
 	switch (ch)
@@ -117,6 +231,17 @@ static int __redis_parse_cmd(const char ch, redis_parser_t *parser)
 	case ':':
 	case '$':
 	case '*':
+	/* RESP3 */
+	case '_':
+	case ',':
+	case '#':
+	case '(':
+	case '!':
+	case '=':
+	case '%':
+	case '~':
+	case '>':
+	case '|':
 		parser->cmd = ch;
 		parser->status = REDIS_UNTIL_CRLF;
 		parser->findidx = parser->msgidx;
@@ -143,14 +268,67 @@ static int __redis_parse_lf(const char ch, redis_parser_t *parser)
 	return 1;
 }
 
+static int __redis_parse_aggregate(int n, redis_parser_t *parser)
+{
+	redis_reply_t *reply = parser->cur;
+	struct __redis_read_frame *frame;
+	size_t elements = n;
+	int type;
+
+	switch (parser->cmd)
+	{
+	case '*':
+		type = REDIS_REPLY_TYPE_ARRAY;
+		break;
+	case '~':
+		type = REDIS_REPLY_TYPE_SET;
+		break;
+	case '>':
+		type = REDIS_REPLY_TYPE_PUSH;
+		break;
+	case '%':
+		type = REDIS_REPLY_TYPE_MAP;
+		elements *= 2;
+		break;
+	default:
+		type = REDIS_REPLY_TYPE_ATTR;
+		elements *= 2;
+		break;
+	}
+
+	if (__redis_set_aggregate(type, elements, reply, parser) < 0)
+		return -1;
+
+	if (elements == 0)
+		return 1;
+
+	if (parser->depth == REDIS_REPLY_DEPTH_LIMIT)
+		return -2;
+
+	if (!parser->stack)
+	{
+		parser->stack = (struct __redis_read_frame *)__redis_arena_alloc(
+			REDIS_REPLY_DEPTH_LIMIT * sizeof (struct __redis_read_frame),
+			parser);
+		if (!parser->stack)
+			return -1;
+	}
+
+	frame = &parser->stack[parser->depth++];
+	frame->reply = reply;
+	frame->next = 1;
+	parser->cur = reply->element[0];
+	parser->status = REDIS_GET_CMD;
+	return 0;
+}
+
 static int __redis_parse_line(redis_parser_t *parser)
 {
 	char *str = parser->msgbuf + parser->msgidx;
 	size_t slen = parser->findidx - parser->msgidx;
-	char data[32];
-	int i, n;
+	char data[64];
+	int n;
 	const char *offset = (const char *)parser->msgidx;
-	struct __redis_read_record *node;
 
 	parser->msgidx = parser->findidx + 2;
 	switch (parser->cmd)
@@ -172,32 +350,88 @@ static int __redis_parse_line(redis_parser_t *parser)
 		redis_reply_set_integer(atoll(data), parser->cur);
 		return 1;
 
+	case '_':
+		if (slen != 0)
+			return -2;
+
+		redis_reply_set_null(parser->cur);
+		return 1;
+
+	case ',':
+		if (slen == 0 || slen >= sizeof data)
+			return -2;
+
+		memcpy(data, str, slen);
+		data[slen] = '\0';
+		parser->cur->type = REDIS_REPLY_TYPE_DOUBLE;
+		parser->cur->dval = strtod(data, NULL);
+		parser->cur->str = (char *)offset;
+		parser->cur->len = slen;
+		return 1;
+
+	case '#':
+		if (slen != 1 || (*str != 't' && *str != 'f'))
+			return -2;
+
+		parser->cur->type = REDIS_REPLY_TYPE_BOOL;
+		parser->cur->integer = (*str == 't');
+		return 1;
+
+	case '(':
+		if (slen == 0)
+			return -2;
+
+		parser->cur->type = REDIS_REPLY_TYPE_BIGNUM;
+		parser->cur->str = (char *)offset;
+		parser->cur->len = slen;
+		return 1;
+
 	case '$':
+	case '!':
+	case '=':
 		n = atoi(str);
 		if (n < 0)
 		{
+			if (parser->cmd != '$')
+				return -2;
+
 			redis_reply_set_null(parser->cur);
 			return 1;
 		}
 		else if (n == 0)
 		{
 			/* "-0" not acceptable. */
-			if (!isdigit(*str))
+			if (!isdigit(*str) || parser->cmd == '=')
 				return -2;
 
-			redis_reply_set_string(offset, 0, parser->cur);
+			if (parser->cmd == '$')
+				redis_reply_set_string(offset, 0, parser->cur);
+			else
+				redis_reply_set_error(offset, 0, parser->cur);
+
 			parser->status = REDIS_GET_CR;
 			return 0;
 		}
 
+		/* Verbatim string: 3 bytes format, ':', and the text. */
+		if (parser->cmd == '=' && n < 4)
+			return -2;
+
 		parser->nchar = n;
 		parser->status = REDIS_GET_NCHAR;
 		return 0;
 
 	case '*':
+	case '%':
+	case '~':
+	case '>':
+	case '|':
 		n = atoi(str);
 		if (n < 0)
 		{
+			if (parser->cmd != '*')
+				return -2;
+
 			redis_reply_set_null(parser->cur);
 			return 1;
 		}
@@ -208,28 +442,7 @@ static int __redis_parse_line(redis_parser_t *parser)
 		if (n > REDIS_ARRAY_SIZE_LIMIT)
 			return -2;
 
-		parser->nleft += n;
-		if (redis_reply_set_array(n, parser->cur) < 0)
-			return -1;
-
-		if (n == 0)
-			return 1;
-
-		parser->nleft--;
-		for (i = 0; i < n - 1; i++)
-		{
-			node = (struct __redis_read_record *)malloc(sizeof *node);
-			if (!node)
-				return -1;
-
-			node->reply = parser->cur->element[n - 1 - i];
-			list_add(&node->list, &parser->read_list);
-		}
-
-		parser->cur = parser->cur->element[0];
-		parser->status = REDIS_GET_CMD;
-		return 0;
-
+		return __redis_parse_aggregate(n, parser);
 	}
 
 	return -2;
@@ -250,10 +463,33 @@ static int __redis_parse_crlf(redis_parser_t *parser)
 
 static int __redis_parse_nchar(redis_parser_t *parser)
 {
+	const char *offset = (const char *)parser->msgidx;
+	char *str = parser->msgbuf + parser->msgidx;
+	redis_reply_t *reply = parser->cur;
+
 	if (parser->nchar <= parser->msgsize - parser->msgidx)
 	{
-		redis_reply_set_string((const char *)parser->msgidx, parser->nchar,
-							   parser->cur);
+		switch (parser->cmd)
+		{
+		case '$':
+			redis_reply_set_string(offset, parser->nchar, reply);
+			break;
+
+		case '!':
+			redis_reply_set_error(offset, parser->nchar, reply);
+			break;
+
+		case '=':
+			if (str[3] != ':')
+				return -2;
+
+			reply->type = REDIS_REPLY_TYPE_VERB;
+			memcpy(reply->vtype, str, 3);
+			reply->vtype[3] = '\0';
+			reply->str = (char *)offset + 4;
+			reply->len = parser->nchar - 4;
+			break;
+		}
 
 		parser->msgidx += parser->nchar;
 		parser->status = REDIS_GET_CR;
@@ -292,6 +528,42 @@ static int __redis_parser_forward(redis_parser_t *parser)
 	return -2;
 }
 
+/* Move to the next reply to read after 'parser->cur' is finished.
+ * Returns 1 if the whole reply is finished. */
+static int __redis_parse_next(redis_parser_t *parser)
+{
+	redis_reply_t *reply = parser->cur;
+	struct __redis_read_frame *frame;
+
+	while (1)
+	{
+		/* An attribute is out-of-band data, and followed by the real
+		 * reply, which is read into the same place. */
+		if (reply->type == REDIS_REPLY_TYPE_ATTR)
+		{
+			redis_reply_init(reply);
+			parser->cur = reply;
+			break;
+		}
+
+		if (parser->depth == 0)
+			return 1;
+
+		frame = &parser->stack[parser->depth - 1];
+		if (frame->next < frame->reply->elements)
+		{
+			parser->cur = frame->reply->element[frame->next++];
+			break;
+		}
+
+		parser->depth--;
+		reply = frame->reply;
+	}
+
+	parser->status = REDIS_GET_CMD;
+	return 0;
+}
+
 void redis_parser_init(redis_parser_t *parser)
 {
 	redis_reply_init(&parser->reply);
@@ -300,62 +572,50 @@ void redis_parser_init(redis_parser_t *parser)
 	parser->msgsize = 0;
 	parser->bufsize = 0;
 	//parser->status = REDIS_PARSE_INIT;
-	//parser->nleft = 0;
 	parser->status = REDIS_GET_CMD;
-	parser->nleft = 1;
 	parser->cur = &parser->reply;
-	INIT_LIST_HEAD(&parser->read_list);
+	parser->stack = NULL;
+	parser->depth = 0;
 	parser->msgidx = 0;
 	parser->cmd = '\0';
 	parser->nchar = 0;
 	parser->findidx = 0;
+	INIT_LIST_HEAD(&parser->arena_list);
+	parser->arena_ptr = NULL;
+	parser->arena_left = 0;
 }
 
 void redis_parser_deinit(redis_parser_t *parser)
 {
-	struct list_head *pos, *tmp;
-	struct __redis_read_record *next;
-
-	list_for_each_safe(pos, tmp, &parser->read_list)
-	{
-		next = list_entry(pos, struct __redis_read_record, list);
-		list_del(pos);
-		free(next);
-	}
-
 	redis_reply_deinit(&parser->reply);
+	__redis_arena_free(parser);
 	free(parser->msgbuf);
 }
 
-static int __redis_parse_done(redis_reply_t *reply, char *buf, int depth)
+static void __redis_parse_done(redis_reply_t *reply, char *buf)
 {
 	size_t i;
 
-	if (depth == REDIS_REPLY_DEPTH_LIMIT)
-		return -2;
-
 	switch (reply->type)
 	{
-	case REDIS_REPLY_TYPE_INTEGER:
-		break;
-
 	case REDIS_REPLY_TYPE_ARRAY:
+	case REDIS_REPLY_TYPE_MAP:
+	case REDIS_REPLY_TYPE_SET:
+	case REDIS_REPLY_TYPE_PUSH:
 		for (i = 0; i < reply->elements; i++)
-		{
-			if (__redis_parse_done(reply->element[i], buf, depth + 1) < 0)
-				return -2;
-		}
+			__redis_parse_done(reply->element[i], buf);
 
 		break;
 
 	case REDIS_REPLY_TYPE_STATUS:
 	case REDIS_REPLY_TYPE_ERROR:
 	case REDIS_REPLY_TYPE_STRING:
+	case REDIS_REPLY_TYPE_DOUBLE:
+	case REDIS_REPLY_TYPE_BIGNUM:
+	case REDIS_REPLY_TYPE_VERB:
 		reply->str = buf + (size_t)reply->str;
 		break;
 	}
-
-	return 1;
 }
 
 static int __redis_split_inline_command(redis_parser_t *parser)
@@ -388,7 +648,7 @@ static int __redis_split_inline_command(redis_parser_t *parser)
 		return 0;
 	}
 
-	ret = redis_reply_set_array(arr_size, &parser->reply);
+	ret = redis_parser_set_array(arr_size, &parser->reply, parser);
 	if (ret < 0)
 		return ret;
 
@@ -474,21 +734,7 @@ int redis_parser_append_message(const void *buf, size_t *size,
 
 		if (ret == 1)
 		{
-			struct list_head *lnext = parser->read_list.next;
-			struct __redis_read_record *next;
-
-			parser->nleft--;
-			if (lnext && lnext != &parser->read_list)
-			{
-				next = list_entry(lnext, struct __redis_read_record, list);
-				parser->cur = next->reply;
-				list_del(lnext);
-				free(next);
-			}
-
-			if (parser->nleft > 0)
-				parser->status = REDIS_GET_CMD;
-			else
+			if (__redis_parse_next(parser) > 0)
 			{
 				parser->parse_succ = 1;
 				parser->status = REDIS_PARSE_END;
@@ -500,6 +746,8 @@ int redis_parser_append_message(const void *buf, size_t *size,
 	} while (parser->status != REDIS_PARSE_END);
 
 	*size = parser->msgidx - msgsize_bak;
-	return __redis_parse_done(&parser->reply, parser->msgbuf, 0);
+	/* Strings are offsets into 'msgbuf' until here, which may be moved
+	 * by realloc while the message is arriving. */
+	__redis_parse_done(&parser->reply, parser->msgbuf);
+	return 1;
 }
-
@@ -0,0 +1,737 @@
+/*
+  Copyright (c) 2024 Sogou, Inc.
+
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+
+      http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+*/
+
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <time.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <atomic>
+#include <chrono>
+#include <map>
+#include <mutex>
+#include <string>
+#include <utility>
+#ifdef __linux__
+# include <sys/inotify.h>
+#endif
+#include "HttpMessage.h"
+#include "HttpUtil.h"
+#include "ShardedCache.h"
+#include "StringUtil.h"
+#include "WFGlobal.h"
+#include "WFTaskFactory.h"
+#include "WFHttpFileCache.h"
+
+#define GET_CURRENT_SECOND	std::chrono::duration_cast<std::chrono::seconds>(std::chrono::steady_clock::now().time_since_epoch()).count()
+
+#define HTTP_FILE_ALIGNMENT			4096
+#define HTTP_FILE_ENTRY_OVERHEAD	256
+#define HTTP_FILE_CACHE_SHARDS		4
+#define HTTP_FILE_RELOAD_INTERVAL	5	/* seconds, without inotify */
+
+using namespace protocol;
+
+struct __HttpFile
+{
+	char *data;
+	size_t size;
+	const char *content_type;
+	std::string etag;
+	std::string last_modified;
+	int64_t load_time;
+	std::atomic<int> ref;
+};
+
+static void __http_file_release(__HttpFile *file)
+{
+	if (--file->ref == 0)
+	{
+		free(file->data);
+		delete file;
+	}
+}
+
+class __HttpFileDeleter
+{
+public:
+	void operator() (__HttpFile *file) const
+	{
+		__http_file_release(file);
+	}
+};
+
+static const struct
+{
+	const char *ext;
+	const char *type;
+} __http_content_types[] = {
+	{ "html",	"text/html; charset=utf-8"			},
+	{ "htm",	"text/html; charset=utf-8"			},
+	{ "css",	"text/css; charset=utf-8"			},
+	{ "js",		"text/javascript; charset=utf-8"	},
+	{ "json",	"application/json"					},
+	{ "txt",	"text/plain; charset=utf-8"			},
+	{ "xml",	"application/xml"					},
+	{ "svg",	"image/svg+xml"						},
+	{ "png",	"image/png"							},
+	{ "jpg",	"image/jpeg"						},
+	{ "jpeg",	"image/jpeg"						},
+	{ "gif",	"image/gif"							},
+	{ "webp",	"image/webp"						},
+	{ "ico",	"image/x-icon"						},
+	{ "wasm",	"application/wasm"					},
+	{ "woff2",	"font/woff2"						},
+	{ "pdf",	"application/pdf"					},
+};
+
+static const char *__http_content_type(const std::string& path)
+{
+	size_t pos = path.rfind('.');
+	const char *ext;
+	size_t i;
+
+	if (pos != std::string::npos && path.find('/', pos) == std::string::npos)
+	{
+		ext = path.c_str() + pos + 1;
+		for (i = 0; i < sizeof __http_content_types / sizeof *__http_content_types; i++)
+		{
+			if (strcasecmp(ext, __http_content_types[i].ext) == 0)
+				return __http_content_types[i].type;
+		}
+	}
+
+	return "application/octet-stream";
+}
+
+/* Read the whole file into a page aligned buffer. Copying once keeps the
+ * cache safe from files truncated when they are being served, which would
+ * raise SIGBUS with mmap. */
+static __HttpFile *__http_file_load(const std::string& path)
+{
+	__HttpFile *file;
+	struct stat st;
+	struct tm tm;
+	char buf[64];
+	size_t n;
+	ssize_t ret;
+	void *data = NULL;
+	int fd;
+
+	fd = open(path.c_str(), O_RDONLY);
+	if (fd < 0)
+		return NULL;
+
+	if (fstat(fd, &st) < 0)
+	{
+		close(fd);
+		return NULL;
+	}
+
+	if (!S_ISREG(st.st_mode))
+	{
+		close(fd);
+		errno = S_ISDIR(st.st_mode) ? EISDIR : EACCES;
+		return NULL;
+	}
+
+	if (st.st_size > 0)
+	{
+		errno = posix_memalign(&data, HTTP_FILE_ALIGNMENT, st.st_size);
+		if (errno)
+		{
+			close(fd);
+			return NULL;
+		}
+
+		for (n = 0; n < (size_t)st.st_size; n += ret)
+		{
+			ret = pread(fd, (char *)data + n, st.st_size - n, n);
+			if (ret <= 0)
+			{
+				if (ret == 0)
+					break;
+
+				free(data);
+				close(fd);
+				return NULL;
+			}
+		}
+	}
+	else
+		n = 0;
+
+	close(fd);
+	file = new __HttpFile;
+	file->data = (char *)data;
+	file->size = n;
+	file->content_type = __http_content_type(path);
+
+	sprintf(buf, "\"%llx-%llx\"", (unsigned long long)st.st_size,
+			(unsigned long long)st.st_mtime);
+	file->etag = buf;
+	gmtime_r(&st.st_mtime, &tm);
+	strftime(buf, sizeof buf, "%a, %d %b %Y %H:%M:%S GMT", &tm);
+	file->last_modified = buf;
+	file->load_time = GET_CURRENT_SECOND;
+	file->ref = 1;
+	return file;
+}
+
+/* 'value' of 'If-None-Match' is a list of entity tags or "*". */
+static bool __http_etag_match(const std::string& value, const std::string& etag)
+{
+	for (const auto& tag : StringUtil::split(value, ','))
+	{
+		std::string str = StringUtil::strip(tag);
+
+		if (str == "*" || str == etag ||
+			(str.size() > 2 && str[0] == 'W' && str[1] == '/' &&
+			 str.compare(2, std::string::npos, etag) == 0))
+			return true;
+	}
+
+	return false;
+}
+
+/* Parse a single range. Return 1 if satisfiable, 0 if not, and -1 if the
+ * header should be ignored, such as a multiple ranges request. */
+static int __http_parse_range(const std::string& value, size_t size,
+							  size_t *start, size_t *end)
+{
+	unsigned long long first, last;
+	const char *p;
+	char *q;
+
+	if (value.compare(0, 6, "bytes=") != 0 ||
+		value.find(',') != std::string::npos)
+		return -1;
+
+	p = value.c_str() + 6;
+	while (*p == ' ')
+		p++;
+
+	if (*p == '-')
+	{
+		/* Suffix range: the last N bytes. */
+		last = strtoull(p + 1, &q, 10);
+		if (q == p + 1 || *q != '\0')
+			return -1;
+
+		if (last == 0 || size == 0)
+			return 0;
+
+		*start = last < size ? size - last : 0;
+		*end = size - 1;
+		return 1;
+	}
+
+	first = strtoull(p, &q, 10);
+	if (q == p || *q != '-')
+		return -1;
+
+	p = q + 1;
+	if (*p == '\0')
+		last = (unsigned long long)-1;
+	else
+	{
+		last = strtoull(p, &q, 10);
+		if (*q != '\0' || last < first)
+			return -1;
+	}
+
+	if (first >= size)
+		return 0;
+
+	*start = first;
+	*end = last < size ? last : size - 1;
+	return 1;
+}
+
+static void __http_file_reply(WFHttpTask *task, __HttpFile *file)
+{
+	HttpRequest *req = task->get_req();
+	HttpResponse *resp = task->get_resp();
+	HttpHeaderCursor cursor(req);
+	bool head = strcmp(req->get_method(), "HEAD") == 0;
+	size_t start = 0;
+	size_t end = file->size - 1;
+	std::string value;
+	char buf[80];
+	int ret;
+
+	resp->add_header_pair("ETag", file->etag);
+	resp->add_header_pair("Last-Modified", file->last_modified);
+	if (cursor.find("If-None-Match", value))
+	{
+		if (__http_etag_match(value, file->etag))
+		{
+			HttpUtil::set_response_status(resp, HttpStatusNotModified);
+			return;
+		}
+	}
+	else
+	{
+		cursor.rewind();
+		if (cursor.find("If-Modified-Since", value) &&
+			value == file->last_modified)
+		{
+			HttpUtil::set_response_status(resp, HttpStatusNotModified);
+			return;
+		}
+	}
+
+	resp->add_header_pair("Content-Type", file->content_type);
+	resp->add_header_pair("Accept-Ranges", "bytes");
+	cursor.rewind();
+	if (cursor.find("Range", value))
+	{
+		ret = __http_parse_range(value, file->size, &start, &end);
+		if (ret == 0)
+		{
+			HttpUtil::set_response_status(resp,
+										  HttpStatusRequestedRangeNotSatisfiable);
+			sprintf(buf, "bytes */%zu", file->size);
+			resp->add_header_pair("Content-Range", buf);
+			return;
+		}
+
+		if (ret > 0)
+		{
+			HttpUtil::set_response_status(resp, HttpStatusPartialContent);
+			sprintf(buf, "bytes %zu-%zu/%zu", start, end, file->size);
+			resp->add_header_pair("Content-Range", buf);
+		}
+		else
+		{
+			start = 0;
+			end = file->size - 1;
+		}
+	}
+
+	if (file->size == 0)
+		return;
+
+	if (head)
+	{
+		sprintf(buf, "%zu", end - start + 1);
+		resp->add_header_pair("Content-Length", buf);
+	}
+	else
+		resp->append_output_body_nocopy(file->data + start, end - start + 1);
+}
+
+static void __http_file_error(WFHttpTask *task, int error)
+{
+	HttpResponse *resp = task->get_resp();
+	int status_code;
+
+	switch (error)
+	{
+	case ENOENT:
+	case ENOTDIR:
+	case EISDIR:
+	case ENAMETOOLONG:
+		status_code = HttpStatusNotFound;
+		break;
+	case EACCES:
+	case EPERM:
+		status_code = HttpStatusForbidden;
+		break;
+	default:
+		status_code = HttpStatusInternalServerError;
+		break;
+	}
+
+	HttpUtil::set_response_status(resp, status_code);
+}
+
+using HttpFileShardedCache = ShardedCache<std::string, __HttpFile *,
+										  __HttpFileDeleter>;
+
+class HttpFileCacheMember
+{
+public:
+	__HttpFile *get(const std::string& path);
+	__HttpFile *load(const std::string& path);
+
+public:
+	void watch_init();
+	void watch_deinit();
+	int watch(const std::string& path);
+
+private:
+	static void *watch_routine(void *arg);
+	void handle_events(const char *buf, ssize_t n);
+
+public:
+	HttpFileCacheMember() : cache(HTTP_FILE_CACHE_SHARDS) { }
+
+public:
+	std::string root;
+	size_t max_bytes;
+	HttpFileShardedCache cache;
+	/* Guards the watched directories. */
+	std::mutex mutex;
+
+private:
+	int inotify_fd;
+	int pipe_fd[2];
+	pthread_t tid;
+	std::map<int, std::string> wd_dirs;
+	std::map<std::string, int> dir_wds;
+};
+
+__HttpFile *HttpFileCacheMember::get(const std::string& path)
+{
+	const ShardedCacheHandle<std::string, __HttpFile *> *handle;
+	__HttpFile *file = NULL;
+
+	handle = this->cache.get(path);
+	if (handle)
+	{
+		file = handle->value;
+		if (this->inotify_fd < 0 &&
+			GET_CURRENT_SECOND - file->load_time >= HTTP_FILE_RELOAD_INTERVAL)
+		{
+			this->cache.release(handle);
+			this->cache.del(path);
+			return NULL;
+		}
+
+		file->ref++;
+		this->cache.release(handle);
+	}
+
+	return file;
+}
+
+/* Called by the fio threads. The directory is watched before the file is
+ * read, so a change after reading is never missed. */
+__HttpFile *HttpFileCacheMember::load(const std::string& path)
+{
+	__HttpFile *file;
+	int cached;
+
+	cached = (this->watch(path) >= 0);
+	file = __http_file_load(path);
+	if (file && cached &&
+		file->size <= this->max_bytes / HTTP_FILE_CACHE_SHARDS / 4)
+	{
+		file->ref++;
+		this->cache.release(this->cache.put(path, file,
+								file->size + path.size() + HTTP_FILE_ENTRY_OVERHEAD));
+	}
+
+	return file;
+}
+
+#ifdef __linux__
+
+#define HTTP_FILE_WATCH_MASK	(IN_MODIFY | IN_ATTRIB | IN_CLOSE_WRITE | \
+								 IN_MOVED_FROM | IN_MOVED_TO | IN_CREATE | \
+								 IN_DELETE | IN_DELETE_SELF | IN_MOVE_SELF)
+
+/* Without inotify, files are reloaded periodically like other systems. */
+void HttpFileCacheMember::watch_init()
+{
+	this->inotify_fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+	if (this->inotify_fd >= 0)
+	{
+		if (pipe(this->pipe_fd) >= 0)
+		{
+			if (pthread_create(&this->tid, NULL,
+							   HttpFileCacheMember::watch_routine, this) == 0)
+				return;
+
+			close(this->pipe_fd[0]);
+			close(this->pipe_fd[1]);
+		}
+
+		close(this->inotify_fd);
+		this->inotify_fd = -1;
+	}
+}
+
+void HttpFileCacheMember::watch_deinit()
+{
+	if (this->inotify_fd >= 0)
+	{
+		close(this->pipe_fd[1]);
+		pthread_join(this->tid, NULL);
+		close(this->pipe_fd[0]);
+		close(this->inotify_fd);
+	}
+}
+
+/* Watch the directory of 'path'. Return -1 if it can't be watched, and
+ * the file should not be cached. */
+int HttpFileCacheMember::watch(const std::string& path)
+{
+	std::string dir = path.substr(0, path.rfind('/') + 1);
+	int wd;
+
+	if (this->inotify_fd < 0)
+		return 0;
+
+	{
+		std::lock_guard<std::mutex> lock(this->mutex);
+
+		if (this->dir_wds.count(dir) > 0)
+			return 0;
+	}
+
+	wd = inotify_add_watch(this->inotify_fd, dir.c_str(), HTTP_FILE_WATCH_MASK);
+	if (wd < 0)
+		return -1;
+
+	std::lock_guard<std::mutex> lock(this->mutex);
+
+	this->wd_dirs[wd] = dir;
+	this->dir_wds[dir] = wd;
+	return 0;
+}
+
+void HttpFileCacheMember::handle_events(const char *buf, ssize_t n)
+{
+	const struct inotify_event *event;
+	ssize_t off;
+
+	std::lock_guard<std::mutex> lock(this->mutex);
+
+	for (off = 0; off < n; off += sizeof (struct inotify_event) + event->len)
+	{
+		event = (const struct inotify_event *)(buf + off);
+		if (event->mask & IN_Q_OVERFLOW)
+		{
+			this->cache.clear();
+			continue;
+		}
+
+		auto it = this->wd_dirs.find(event->wd);
+		if (it == this->wd_dirs.end())
+			continue;
+
+		if (event->mask & IN_IGNORED)
+		{
+			/* The directory is gone or unmounted. */
+			this->dir_wds.erase(it->second);
+			this->wd_dirs.erase(it);
+			this->cache.clear();
+		}
+		else if (event->len > 0)
+			this->cache.del(it->second + event->name);
+		else if (event->mask & (IN_DELETE_SELF | IN_MOVE_SELF))
+			this->cache.clear();
+	}
+}
+
+void *HttpFileCacheMember::watch_routine(void *arg)
+{
+	HttpFileCacheMember *member = (HttpFileCacheMember *)arg;
+	char buf[4096] __attribute__((aligned(__alignof__(struct inotify_event))));
+	struct pollfd pfds[2];
+	ssize_t n;
+
+	pfds[0].fd = member->inotify_fd;
+	pfds[0].events = POLLIN;
+	pfds[1].fd = member->pipe_fd[0];
+	pfds[1].events = POLLIN;
+	while (1)
+	{
+		if (poll(pfds, 2, -1) < 0)
+		{
+			if (errno == EINTR)
+				continue;
+
+			break;
+		}
+
+		/* The write end of the pipe is closed by deinit(). */
+		if (pfds[1].revents)
+			break;
+
+		while ((n = read(member->inotify_fd, buf, sizeof buf)) > 0)
+			member->handle_events(buf, n);
+	}
+
+	return NULL;
+}
+
+#else
+
+void HttpFileCacheMember::watch_init()
+{
+	this->inotify_fd = -1;
+}
+
+void HttpFileCacheMember::watch_deinit()
+{
+}
+
+int HttpFileCacheMember::watch(const std::string& path)
+{
+	return 0;
+}
+
+#endif
+
+int WFHttpFileCache::init(const std::string& root, size_t max_bytes)
+{
+	this->member = new HttpFileCacheMember;
+	this->member->root = root;
+	while (!this->member->root.empty() && this->member->root.back() == '/')
+		this->member->root.pop_back();
+
+	this->member->max_bytes = max_bytes;
+	this->member->cache.set_max_size(max_bytes);
+	this->member->watch_init();
+	return 0;
+}
+
+void WFHttpFileCache::deinit()
+{
+	this->member->watch_deinit();
+	delete this->member;
+}
+
+/* Reject paths out of the root. */
+static bool __http_path_valid(const std::string& path)
+{
+	size_t pos = 0;
+	size_t next;
+
+	if (path.empty() || path[0] != '/')
+		return false;
+
+	while (pos < path.size())
+	{
+		next = path.find('/', pos + 1);
+		if (next == std::string::npos)
+			next = path.size();
+
+		if (path.compare(pos, next - pos, "/..") == 0)
+			return false;
+
+		pos = next;
+	}
+
+	return path.find('\0') == std::string::npos;
+}
+
+void WFHttpFileCache::serve(WFHttpTask *server_task, http_callback_t callback)
+{
+	HttpFileCacheMember *member = this->member;
+	HttpRequest *req = server_task->get_req();
+	const char *method = req->get_method();
+	const char *uri = req->get_request_uri();
+	const char *p = uri;
+	WFGoTask *go_task;
+	__HttpFile *file;
+	std::string path;
+
+	if (strcmp(method, "GET") != 0 && strcmp(method, "HEAD") != 0)
+	{
+		HttpUtil::set_response_status(server_task->get_resp(),
+									  HttpStatusMethodNotAllowed);
+		server_task->get_resp()->add_header_pair("Allow", "GET, HEAD");
+		server_task->set_callback(std::move(callback));
+		return;
+	}
+
+	while (*p && *p != '?' && *p != '#')
+		p++;
+
+	path.assign(uri, p - uri);
+	StringUtil::url_decode(path);
+	if (!__http_path_valid(path))
+	{
+		__http_file_error(server_task, ENOENT);
+		server_task->set_callback(std::move(callback));
+		return;
+	}
+
+	path = member->root + path;
+	if (path.back() == '/')
+		path += "index.html";
+
+	file = member->get(path);
+	if (file)
+	{
+		__http_file_reply(server_task, file);
+		server_task->set_callback([file, callback](WFHttpTask *task) {
+			if (callback)
+				callback(task);
+
+			__http_file_release(file);
+		});
+		return;
+	}
+
+	auto *ctx = new std::pair<__HttpFile *, int>(NULL, 0);
+	go_task = WFTaskFactory::create_go_task(WFGlobal::get_fio_queue(),
+											WFGlobal::get_fio_executor(),
+											[member, path, ctx]() {
+		ctx->first = member->load(path);
+		ctx->second = errno;
+	});
+
+	go_task->set_callback([server_task, ctx, callback](WFGoTask *task) {
+		__HttpFile *file = ctx->first;
+		int error = ctx->second;
+
+		delete ctx;
+		if (task->get_state() != WFT_STATE_SUCCESS)
+		{
+			if (file)
+				__http_file_release(file);
+
+			file = NULL;
+			error = task->get_error();
+		}
+
+		if (!file)
+		{
+			__http_file_error(server_task, error);
+			server_task->set_callback(std::move(callback));
+			return;
+		}
+
+		__http_file_reply(server_task, file);
+		server_task->set_callback([file, callback](WFHttpTask *task) {
+			if (callback)
+				callback(task);
+
+			__http_file_release(file);
+		});
+	});
+
+	series_of(server_task)->push_back(go_task);
+}
+
+size_t WFHttpFileCache::size() const
+{
+	return this->member->cache.get_size();
+}
+
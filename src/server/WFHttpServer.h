@@ -23,6 +23,7 @@
 #include "HttpMessage.h"
 #include "WFServer.h"
 #include "WFTaskFactory.h"
+#include "HttpTaskImpl.inl"
 
 using http_process_t = std::function<void (WFHttpTask *)>;
 using WFHttpServer = WFServer<protocol::HttpRequest,
@@ -37,6 +38,9 @@ static constexpr struct WFServerParams HTTP_SERVER_PARAMS_DEFAULT =
 	.keep_alive_timeout		=	60 * 1000,
 	.request_size_limit		=	(size_t)-1,
 	.ssl_accept_timeout		=	10 * 1000,
+	.ssl_ticket_rotation		=	-1,
+	.receive_budget			=	0,
+	.datagram_batch			=	1,
 };
 
 template<> inline
@@ -59,5 +63,64 @@ CommSession *WFHttpServer::new_session(long long seq, CommConnection *conn)
 	return task;
 }
 
+using http_extract_t = std::function<void (WFHttpTask *, const void *, size_t)>;
+
+/* The request body is not buffered but passed to 'extract' piece by piece
+ * as it arrives, and 'process' is called after the whole body is received.
+ * In 'process', the request has only the header. 'request_size_limit'
+ * applies to the header only. */
+class WFHttpStreamServer : public WFHttpServer
+{
+public:
+	WFHttpStreamServer(const struct WFServerParams *params,
+					   http_extract_t extract, http_process_t proc) :
+		WFHttpServer(params, std::move(proc)),
+		extract(std::move(extract))
+	{
+	}
+
+	WFHttpStreamServer(http_extract_t extract, http_process_t proc) :
+		WFHttpServer(std::move(proc)),
+		extract(std::move(extract))
+	{
+	}
+
+public:
+	/* Call only in 'extract'. No more data is read from the connection
+	 * until resume(). If paused at the last piece, 'process' is delayed
+	 * and called by resume(). A paused task must be resumed even if the
+	 * connection is broken, because the task is deleted by resume(). */
+	static void pause(WFHttpTask *task)
+	{
+		__WFHttpTaskFactory::pause_stream_server_task(task);
+	}
+
+	/* Can be called in any thread. */
+	static void resume(WFHttpTask *task)
+	{
+		__WFHttpTaskFactory::resume_stream_server_task(task);
+	}
+
+protected:
+	virtual CommSession *new_session(long long seq, CommConnection *conn);
+
+protected:
+	http_extract_t extract;
+};
+
+inline CommSession *WFHttpStreamServer::new_session(long long seq,
+													CommConnection *conn)
+{
+	WFHttpTask *task;
+
+	task = __WFHttpTaskFactory::create_stream_server_task(this, this->process,
+														  this->extract);
+	task->set_keep_alive(this->params.keep_alive_timeout);
+	task->set_receive_timeout(this->params.receive_timeout);
+	task->get_req()->set_size_limit(this->params.request_size_limit);
+
+	return task;
+}
+
 #endif
 
@@ -37,6 +37,9 @@ static constexpr struct WFServerParams MYSQL_SERVER_PARAMS_DEFAULT =
 	.keep_alive_timeout		=	28800 * 1000,
 	.request_size_limit		=	(size_t)-1,
 	.ssl_accept_timeout		=	10 * 1000,
+	.ssl_ticket_rotation		=	-1,
+	.receive_budget			=	0,
+	.datagram_batch			=	1,
 };
 
 class WFMySQLServer : public WFServer<protocol::MySQLRequest,
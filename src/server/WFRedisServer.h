@@ -36,6 +36,9 @@ static constexpr struct WFServerParams REDIS_SERVER_PARAMS_DEFAULT =
 	.keep_alive_timeout		=	300 * 1000,
 	.request_size_limit		=	(size_t)-1,
 	.ssl_accept_timeout		=	5000,
+	.ssl_ticket_rotation		=	-1,
+	.receive_budget			=	0,
+	.datagram_batch			=	1,
 };
 
 template<> inline
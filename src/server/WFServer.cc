@@ -24,10 +24,20 @@
 #include <errno.h>
 #include <unistd.h>
 #include <stdio.h>
+#include <string.h>
+#include <stdint.h>
 #include <atomic>
+#include <chrono>
 #include <mutex>
 #include <condition_variable>
 #include <openssl/ssl.h>
+#include <openssl/evp.h>
+#include <openssl/rand.h>
+#if OPENSSL_VERSION_NUMBER >= 0x30000000L
+# include <openssl/core_names.h>
+#else
+# include <openssl/hmac.h>
+#endif
 #include "CommScheduler.h"
 #include "EndpointParams.h"
 #include "WFConnection.h"
@@ -68,6 +78,179 @@ int WFServerBase::ssl_ctx_callback(SSL *ssl, int *al, void *arg)
 	return SSL_TLSEXT_ERR_OK;
 }
 
+struct __ticket_key
+{
+	unsigned char name[16];
+	unsigned char aes_key[32];
+	unsigned char hmac_key[32];
+};
+
+/* Session ticket keys of a server SSL_CTX. The previous key still
+ * decrypts tickets for one more period, which are then renewed. */
+class __WFTicketKeys
+{
+public:
+	int get_current(struct __ticket_key *key)
+	{
+		std::lock_guard<std::mutex> lock(this->mutex);
+
+		if (this->check_rotate() < 0)
+			return -1;
+
+		*key = this->keys[0];
+		return 0;
+	}
+
+	int find(const unsigned char *name, struct __ticket_key *key)
+	{
+		std::lock_guard<std::mutex> lock(this->mutex);
+
+		if (this->check_rotate() < 0)
+			return 0;
+
+		for (int i = 0; i < this->nkeys; i++)
+		{
+			if (memcmp(this->keys[i].name, name, 16) == 0)
+			{
+				*key = this->keys[i];
+				return i + 1;
+			}
+		}
+
+		return 0;
+	}
+
+private:
+	int check_rotate()
+	{
+		int64_t now = std::chrono::duration_cast<std::chrono::milliseconds>(
+			std::chrono::steady_clock::now().time_since_epoch()).count();
+
+		if (now < this->expire)
+			return 0;
+
+		if (RAND_bytes((unsigned char *)&this->keys[1],
+					   sizeof (struct __ticket_key)) <= 0)
+			return -1;
+
+		std::swap(this->keys[0], this->keys[1]);
+		if (this->nkeys < 2 && this->expire != 0)
+			this->nkeys = 2;
+
+		this->expire = now + this->rotation;
+		return 0;
+	}
+
+public:
+	__WFTicketKeys(int rotation)
+	{
+		this->rotation = rotation;
+		this->expire = 0;
+		this->nkeys = 1;
+	}
+
+private:
+	struct __ticket_key keys[2];
+	int64_t expire;
+	int rotation;
+	int nkeys;
+	std::mutex mutex;
+};
+
+static void __ticket_keys_free(void *parent, void *ptr, CRYPTO_EX_DATA *ad,
+							   int idx, long argl, void *argp)
+{
+	delete (__WFTicketKeys *)ptr;
+}
+
+static int __ticket_keys_index()
+{
+	static int index = SSL_CTX_get_ex_new_index(0, NULL, NULL, NULL,
+												__ticket_keys_free);
+	return index;
+}
+
+#if OPENSSL_VERSION_NUMBER >= 0x30000000L
+typedef EVP_MAC_CTX __ticket_hmac_ctx;
+
+static int __ticket_hmac_init(EVP_MAC_CTX *hctx, unsigned char *hmac_key)
+{
+	OSSL_PARAM params[] = {
+		OSSL_PARAM_construct_octet_string(OSSL_MAC_PARAM_KEY, hmac_key, 32),
+		OSSL_PARAM_construct_utf8_string(OSSL_MAC_PARAM_DIGEST,
+										 (char *)"SHA256", 0),
+		OSSL_PARAM_construct_end()
+	};
+
+	return EVP_MAC_CTX_set_params(hctx, params);
+}
+#else
+typedef HMAC_CTX __ticket_hmac_ctx;
+
+static int __ticket_hmac_init(HMAC_CTX *hctx, unsigned char *hmac_key)
+{
+	return HMAC_Init_ex(hctx, hmac_key, 32, EVP_sha256(), NULL);
+}
+#endif
+
+/* SNI contexts made by new_ssl_ctx() have keys of their own. Both
+ * encryption and decryption see the context chosen by servername. */
+static int __ticket_key_callback(SSL *ssl, unsigned char *name,
+								 unsigned char *iv, EVP_CIPHER_CTX *ctx,
+								 __ticket_hmac_ctx *hctx, int enc)
+{
+	SSL_CTX *ssl_ctx = SSL_get_SSL_CTX(ssl);
+	void *keys = SSL_CTX_get_ex_data(ssl_ctx, __ticket_keys_index());
+	struct __ticket_key key;
+	int ret;
+
+	if (!keys)
+		return 0;
+
+	if (enc)
+	{
+		if (((__WFTicketKeys *)keys)->get_current(&key) < 0 ||
+			RAND_bytes(iv, EVP_CIPHER_iv_length(EVP_aes_256_cbc())) <= 0)
+			return -1;
+
+		memcpy(name, key.name, 16);
+		if (EVP_EncryptInit_ex(ctx, EVP_aes_256_cbc(), NULL,
+							   key.aes_key, iv) <= 0 ||
+			__ticket_hmac_init(hctx, key.hmac_key) <= 0)
+			return -1;
+
+		return 1;
+	}
+
+	ret = ((__WFTicketKeys *)keys)->find(name, &key);
+	if (ret == 0)
+		return 0;
+
+	if (__ticket_hmac_init(hctx, key.hmac_key) <= 0 ||
+		EVP_DecryptInit_ex(ctx, EVP_aes_256_cbc(), NULL,
+						   key.aes_key, iv) <= 0)
+		return -1;
+
+	return ret;
+}
+
+static int __set_ticket_rotation(SSL_CTX *ssl_ctx, int rotation)
+{
+	__WFTicketKeys *keys = new __WFTicketKeys(rotation);
+
+	if (SSL_CTX_set_ex_data(ssl_ctx, __ticket_keys_index(), keys) <= 0)
+	{
+		delete keys;
+		return -1;
+	}
+
+#if OPENSSL_VERSION_NUMBER >= 0x30000000L
+	return SSL_CTX_set_tlsext_ticket_key_evp_cb(ssl_ctx, __ticket_key_callback);
+#else
+	return SSL_CTX_set_tlsext_ticket_key_cb(ssl_ctx, __ticket_key_callback);
+#endif
+}
+
 SSL_CTX *WFServerBase::new_ssl_ctx(const char *cert_file, const char *key_file)
 {
 	SSL_CTX *ssl_ctx = WFGlobal::new_ssl_server_ctx();
@@ -79,7 +262,9 @@ SSL_CTX *WFServerBase::new_ssl_ctx(const char *cert_file, const char *key_file)
 		SSL_CTX_use_PrivateKey_file(ssl_ctx, key_file, SSL_FILETYPE_PEM) > 0 &&
 		SSL_CTX_check_private_key(ssl_ctx) > 0 &&
 		SSL_CTX_set_tlsext_servername_callback(ssl_ctx, ssl_ctx_callback) > 0 &&
-		SSL_CTX_set_tlsext_servername_arg(ssl_ctx, this) > 0)
+		SSL_CTX_set_tlsext_servername_arg(ssl_ctx, this) > 0 &&
+		(this->params.ssl_ticket_rotation <= 0 ||
+		 __set_ticket_rotation(ssl_ctx, this->params.ssl_ticket_rotation) > 0))
 	{
 		return ssl_ctx;
 	}
@@ -112,6 +297,9 @@ int WFServerBase::init(const struct sockaddr *bind_addr, socklen_t addrlen,
 	if (this->CommService::init(bind_addr, addrlen, -1, timeout) < 0)
 		return -1;
 
+	this->set_receive_budget(this->params.receive_budget);
+	this->set_datagram_batch(this->params.datagram_batch);
+
 	if (cert_file && key_file && this->params.transport_type != TT_UDP)
 	{
 		SSL_CTX *ssl_ctx = this->new_ssl_ctx(cert_file, key_file);
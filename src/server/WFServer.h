@@ -40,6 +40,9 @@ struct WFServerParams
 	int keep_alive_timeout;
 	size_t request_size_limit;
 	int ssl_accept_timeout;	/* if not ssl, this will be ignored */
+	int ssl_ticket_rotation;	/* ms to rotate session ticket keys, -1: never */
+	size_t receive_budget;	/* bytes of requests in memory, 0: no limit */
+	size_t datagram_batch;	/* TT_UDP only, datagrams per system call */
 };
 
 static constexpr struct WFServerParams SERVER_PARAMS_DEFAULT =
@@ -51,6 +54,9 @@ static constexpr struct WFServerParams SERVER_PARAMS_DEFAULT =
 	.keep_alive_timeout		=	60 * 1000,
 	.request_size_limit		=	(size_t)-1,
 	.ssl_accept_timeout		=	10 * 1000,
+	.ssl_ticket_rotation		=	-1,
+	.receive_budget			=	0,
+	.datagram_batch			=	1,
 };
 
 class WFServerBase : protected CommService
@@ -21,6 +21,8 @@
 #define _LRUCACHE_H_
 
 #include <assert.h>
+#include <stddef.h>
+#include <utility>
 #include "list.h"
 #include "rbtree.h"
 
@@ -38,6 +40,8 @@ class LRUHandle
 public:
 	VALUE value;
 
+	const KEY& get_key() const { return key; }
+
 private:
 	LRUHandle(const KEY& k, const VALUE& v) :
 		value(v), key(k)
@@ -47,6 +51,7 @@ private:
 	KEY key;
 	struct list_head list;
 	struct rb_node rb;
+	size_t charge;
 	bool in_cache;
 	int ref;
 
@@ -91,12 +96,19 @@ public:
 	}
 
 	// default max_size=0 means no-limit cache
-	// max_size means max cache number of key-value pairs
+	// max_size means max sum of the charges of key-value pairs
+	// with the default charge 1, it's the max number of pairs
 	void set_max_size(size_t max_size)
 	{
 		this->max_size = max_size;
 	}
 
+	// sum of the charges of the cached pairs
+	size_t get_size() const
+	{
+		return this->size;
+	}
+
 	// Remove all cache that are not actively in use.
 	void prune()
 	{
@@ -150,6 +162,12 @@ public:
 	// put copy
 	// Need call release when handle no longer needed
 	const Handle *put(const KEY& key, VALUE value)
+	{
+		return this->put(key, std::move(value), 1);
+	}
+
+	// put copy with a charge, such as the number of bytes of the value
+	const Handle *put(const KEY& key, VALUE value, size_t charge)
 	{
 		struct rb_node **p = &this->cache_map.rb_node;
 		struct rb_node *parent = NULL;
@@ -170,10 +188,11 @@ public:
 		}
 
 		e = new Handle(key, value);
+		e->charge = charge;
 		e->in_cache = true;
 		e->ref = 2;
 		list_add_tail(&e->list, &this->in_use);
-		this->size++;
+		this->size += charge;
 
 		if (bound && !(key < bound->key))
 		{
@@ -240,7 +259,7 @@ private:
 		assert(e->in_cache);
 		list_del(&e->list);
 		e->in_cache = false;
-		this->size--;
+		this->size -= e->charge;
 		this->unref(e);
 	}
 
@@ -0,0 +1,132 @@
+/*
+  Copyright (c) 2024 Sogou, Inc.
+
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+
+      http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+*/
+
+#ifndef _LOCKFREERING_H_
+#define _LOCKFREERING_H_
+
+#include <stddef.h>
+#include <atomic>
+
+/**
+ * @file   LockFreeRing.h
+ * @brief  Bounded multi-producer multi-consumer ring of pointers
+ */
+
+// Every cell has a sequence number telling whether it is ready for the
+// producer of this lap or the consumer. Both sides only CAS their own
+// position, so neither blocks the other.
+// push() returns false when full, pop() returns false when empty. Both may
+// also fail for a moment while a pop or a push of the previous lap on the
+// same cell is still in progress.
+class LockFreeRing
+{
+public:
+	// n is rounded up to a power of 2
+	LockFreeRing(size_t n)
+	{
+		size_t size = 1;
+		size_t i;
+
+		while (size < n)
+			size <<= 1;
+
+		this->cells = new Cell[size];
+		for (i = 0; i < size; i++)
+			this->cells[i].seq.store(i, std::memory_order_relaxed);
+
+		this->mask = size - 1;
+		this->tail.store(0, std::memory_order_relaxed);
+		this->head.store(0, std::memory_order_relaxed);
+	}
+
+	~LockFreeRing() { delete []this->cells; }
+
+	bool push(void *ptr)
+	{
+		size_t pos = this->tail.load(std::memory_order_relaxed);
+		Cell *cell;
+		long diff;
+
+		while (1)
+		{
+			cell = &this->cells[pos & this->mask];
+			diff = (long)(cell->seq.load(std::memory_order_acquire) - pos);
+			if (diff == 0)
+			{
+				if (this->tail.compare_exchange_weak(pos, pos + 1,
+													 std::memory_order_relaxed))
+					break;
+			}
+			else if (diff < 0)
+				return false;
+			else
+				pos = this->tail.load(std::memory_order_relaxed);
+		}
+
+		cell->ptr = ptr;
+		cell->seq.store(pos + 1, std::memory_order_release);
+		return true;
+	}
+
+	bool pop(void **ptr)
+	{
+		size_t pos = this->head.load(std::memory_order_relaxed);
+		Cell *cell;
+		long diff;
+
+		while (1)
+		{
+			cell = &this->cells[pos & this->mask];
+			diff = (long)(cell->seq.load(std::memory_order_acquire) - (pos + 1));
+			if (diff == 0)
+			{
+				if (this->head.compare_exchange_weak(pos, pos + 1,
+													 std::memory_order_relaxed))
+					break;
+			}
+			else if (diff < 0)
+				return false;
+			else
+				pos = this->head.load(std::memory_order_relaxed);
+		}
+
+		*ptr = cell->ptr;
+		cell->seq.store(pos + this->mask + 1, std::memory_order_release);
+		return true;
+	}
+
+private:
+	struct Cell
+	{
+		std::atomic<size_t> seq;
+		void *ptr;
+	};
+
+	Cell *cells;
+	size_t mask;
+	char pad1[64];
+	std::atomic<size_t> tail;
+	char pad2[64];
+	std::atomic<size_t> head;
+	char pad3[64];
+
+public:
+	LockFreeRing(const LockFreeRing&) = delete;
+	LockFreeRing& operator= (const LockFreeRing&) = delete;
+};
+
+#endif
+
@@ -0,0 +1,123 @@
+/*
+  Copyright (c) 2024 Sogou, Inc.
+
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+
+      http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+*/
+
+#include <stddef.h>
+#include <new>
+#include <atomic>
+#include "ObjectRecycler.h"
+
+#define RECYCLER_ALIGN		16
+#define RECYCLER_MAX_SIZE	1024
+#define RECYCLER_CLASSES	(RECYCLER_MAX_SIZE / RECYCLER_ALIGN)
+
+struct __recycled_block
+{
+	struct __recycled_block *next;
+};
+
+/* Trivial, so that it is still usable after the thread's cleaner ran. */
+struct __free_lists
+{
+	struct __recycled_block *head[RECYCLER_CLASSES];
+	size_t size[RECYCLER_CLASSES];
+	bool registered;
+	bool closed;
+};
+
+static thread_local struct __free_lists __lists;
+static std::atomic<size_t> __max_cached(0);
+
+static class __FreeListsCleaner
+{
+public:
+	~__FreeListsCleaner()
+	{
+		struct __recycled_block *block;
+		int i;
+
+		for (i = 0; i < RECYCLER_CLASSES; i++)
+		{
+			while ((block = __lists.head[i]) != NULL)
+			{
+				__lists.head[i] = block->next;
+				::operator delete(block);
+			}
+
+			__lists.size[i] = 0;
+		}
+
+		__lists.closed = true;
+	}
+} thread_local __cleaner;
+
+static inline int __size_class(size_t size)
+{
+	return (int)((size - 1) / RECYCLER_ALIGN);
+}
+
+void *ObjectRecycler::alloc(size_t size)
+{
+	struct __recycled_block *block;
+	int i;
+
+	if (size == 0 || size > RECYCLER_MAX_SIZE)
+		return ::operator new(size);
+
+	i = __size_class(size);
+	block = __lists.head[i];
+	if (block)
+	{
+		__lists.head[i] = block->next;
+		__lists.size[i]--;
+		return block;
+	}
+
+	/* Always the full size of the class, so any block of it can be reused. */
+	return ::operator new((i + 1) * RECYCLER_ALIGN);
+}
+
+void ObjectRecycler::free(void *ptr, size_t size)
+{
+	struct __recycled_block *block = (struct __recycled_block *)ptr;
+	int i;
+
+	if (size != 0 && size <= RECYCLER_MAX_SIZE && !__lists.closed)
+	{
+		i = __size_class(size);
+		if (__lists.size[i] < __max_cached.load(std::memory_order_relaxed))
+		{
+			/* The cleaner frees the lists of this thread when it exits. */
+			if (!__lists.registered)
+			{
+				__lists.registered = true;
+				(void)&__cleaner;
+			}
+
+			block->next = __lists.head[i];
+			__lists.head[i] = block;
+			__lists.size[i]++;
+			return;
+		}
+	}
+
+	::operator delete(ptr);
+}
+
+void ObjectRecycler::set_max_cached(size_t n)
+{
+	__max_cached.store(n, std::memory_order_relaxed);
+}
+
@@ -0,0 +1,62 @@
+/*
+  Copyright (c) 2024 Sogou, Inc.
+
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+
+      http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+*/
+
+#ifndef _OBJECTRECYCLER_H_
+#define _OBJECTRECYCLER_H_
+
+#include <stddef.h>
+
+/**
+ * @file   ObjectRecycler.h
+ * @brief  Per-thread free lists for small objects created at a high rate
+ */
+
+// Blocks up to 1024 bytes are grouped into size classes of 16 bytes. A
+// block freed by a thread is kept by this thread, and is reused by its next
+// allocation of the same size class. Blocks may be freed by any thread.
+// Nothing is kept until set_max_cached() is called with a non-zero value.
+class ObjectRecycler
+{
+public:
+	static void *alloc(size_t size);
+	static void free(void *ptr, size_t size);
+
+public:
+	// Max number of blocks kept by every thread for every size class.
+	static void set_max_cached(size_t n);
+};
+
+// Derive from it to allocate a class and all its subclasses by the
+// ObjectRecycler. The destructor of the class must be virtual.
+class RecycledObject
+{
+public:
+	static void *operator new(size_t size)
+	{
+		return ObjectRecycler::alloc(size);
+	}
+
+	static void *operator new(size_t, void *ptr) { return ptr; }
+	static void operator delete(void *, void *) { }
+
+	static void operator delete(void *ptr, size_t size)
+	{
+		ObjectRecycler::free(ptr, size);
+	}
+};
+
+#endif
+
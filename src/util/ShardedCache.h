@@ -0,0 +1,421 @@
+/*
+  Copyright (c) 2024 Sogou, Inc.
+
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+
+      http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+*/
+
+#ifndef _SHARDEDCACHE_H_
+#define _SHARDEDCACHE_H_
+
+#include <assert.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <mutex>
+#include <utility>
+#include "list.h"
+
+/**
+ * @file   ShardedCache.h
+ * @brief  Template concurrent cache with CLOCK eviction
+ */
+
+// RAII: NO. Release ref by ShardedCache::release
+// Thread safety: YES. A handle may be released by any thread, and so
+// is the ValueDeleter called.
+// DONOT change value by handler, use Cache::put instead
+template<typename KEY, typename VALUE>
+class ShardedCacheHandle
+{
+public:
+	VALUE value;
+
+	const KEY& get_key() const { return key; }
+
+private:
+	ShardedCacheHandle(const KEY& k, VALUE&& v) :
+		value(std::move(v)), key(k)
+	{
+	}
+
+	KEY key;
+	ShardedCacheHandle *next_hash;
+	struct list_head list;
+	size_t hash;
+	size_t charge;
+	int64_t expire;
+	std::atomic<int> ref;
+	bool visited;
+	bool in_cache;
+
+	template<typename, typename, class, class> friend class ShardedCache;
+};
+
+// RAII: NO. Release ref by ShardedCache::release
+// Define ValueDeleter(VALUE& v) for value deleter
+// Thread safety: YES
+// Make sure KEY operator== and HASH usable
+// Keys are hashed into shards, each with its own lock, hash table and
+// CLOCK ring. A hit only marks the entry as visited, nothing is relinked.
+template<typename KEY, typename VALUE, class ValueDeleter,
+		 class HASH = std::hash<KEY>>
+class ShardedCache
+{
+protected:
+	typedef ShardedCacheHandle<KEY, VALUE>	Handle;
+
+public:
+	// shards is rounded up to a power of 2
+	ShardedCache(size_t shards = 16)
+	{
+		size_t i;
+
+		this->shard_bits = 0;
+		while (((size_t)1 << this->shard_bits) < shards)
+			this->shard_bits++;
+
+		this->shard_count = (size_t)1 << this->shard_bits;
+		this->shards = new Shard[this->shard_count];
+		for (i = 0; i < this->shard_count; i++)
+		{
+			Shard *shard = &this->shards[i];
+
+			shard->nbuckets = 16;
+			shard->buckets = new Handle *[shard->nbuckets]();
+			shard->count = 0;
+			shard->size = 0;
+			shard->max_size = 0;
+			INIT_LIST_HEAD(&shard->clock);
+			shard->hand = &shard->clock;
+		}
+	}
+
+	~ShardedCache()
+	{
+		struct list_head *pos, *tmp;
+		Handle *e;
+		size_t i;
+
+		for (i = 0; i < this->shard_count; i++)
+		{
+			Shard *shard = &this->shards[i];
+
+			list_for_each_safe(pos, tmp, &shard->clock)
+			{
+				e = list_entry(pos, Handle, list);
+				// Error if caller has an unreleased handle
+				assert(e->ref == 1);
+				this->erase_node(shard, e);
+			}
+
+			delete []shard->buckets;
+		}
+
+		delete []this->shards;
+	}
+
+	// default max_size=0 means no-limit cache
+	// max_size means max sum of the charges of key-value pairs,
+	// split evenly among the shards
+	void set_max_size(size_t max_size)
+	{
+		size_t per_shard = (max_size + this->shard_count - 1) / this->shard_count;
+		size_t i;
+
+		for (i = 0; i < this->shard_count; i++)
+		{
+			std::lock_guard<std::mutex> lock(this->shards[i].mutex);
+
+			this->shards[i].max_size = per_shard;
+		}
+	}
+
+	// sum of the charges of the cached pairs
+	size_t get_size()
+	{
+		size_t size = 0;
+		size_t i;
+
+		for (i = 0; i < this->shard_count; i++)
+		{
+			std::lock_guard<std::mutex> lock(this->shards[i].mutex);
+
+			size += this->shards[i].size;
+		}
+
+		return size;
+	}
+
+	// Remove all cache that are not actively in use.
+	void prune()
+	{
+		struct list_head *pos, *tmp;
+		Handle *e;
+		size_t i;
+
+		for (i = 0; i < this->shard_count; i++)
+		{
+			Shard *shard = &this->shards[i];
+			std::lock_guard<std::mutex> lock(shard->mutex);
+
+			list_for_each_safe(pos, tmp, &shard->clock)
+			{
+				e = list_entry(pos, Handle, list);
+				if (e->ref == 1)
+					this->erase_node(shard, e);
+			}
+		}
+	}
+
+	// Remove all cache. The ones in use are deleted when released.
+	void clear()
+	{
+		struct list_head *pos, *tmp;
+		size_t i;
+
+		for (i = 0; i < this->shard_count; i++)
+		{
+			Shard *shard = &this->shards[i];
+			std::lock_guard<std::mutex> lock(shard->mutex);
+
+			list_for_each_safe(pos, tmp, &shard->clock)
+				this->erase_node(shard, list_entry(pos, Handle, list));
+		}
+	}
+
+	// release handle by get/put
+	void release(const Handle *handle)
+	{
+		this->unref(const_cast<Handle *>(handle));
+	}
+
+	// get handler
+	// Need call release when handle no longer needed
+	const Handle *get(const KEY& key)
+	{
+		size_t hash = this->hasher(key);
+		Shard *shard = this->get_shard(hash);
+		std::lock_guard<std::mutex> lock(shard->mutex);
+		Handle *e = *this->find(shard, key, hash);
+
+		if (e)
+		{
+			if (e->expire != 0 && e->expire <= ShardedCache::now())
+			{
+				this->erase_node(shard, e);
+				return NULL;
+			}
+
+			e->visited = true;
+			e->ref++;
+		}
+
+		return e;
+	}
+
+	// put copy
+	// Need call release when handle no longer needed
+	const Handle *put(const KEY& key, VALUE value)
+	{
+		return this->put(key, std::move(value), 1, -1);
+	}
+
+	// put copy with a charge, such as the number of bytes of the value
+	const Handle *put(const KEY& key, VALUE value, size_t charge)
+	{
+		return this->put(key, std::move(value), charge, -1);
+	}
+
+	// ttl in milliseconds, -1 means never expire
+	const Handle *put(const KEY& key, VALUE value, size_t charge, int ttl)
+	{
+		Handle *e = new Handle(key, std::move(value));
+		Shard *shard;
+		Handle **p;
+
+		e->hash = this->hasher(key);
+		e->charge = charge;
+		e->expire = ttl >= 0 ? ShardedCache::now() + ttl : 0;
+		e->ref = 2;
+		e->visited = false;
+		e->in_cache = true;
+		shard = this->get_shard(e->hash);
+
+		std::lock_guard<std::mutex> lock(shard->mutex);
+
+		p = this->find(shard, key, e->hash);
+		if (*p)
+			this->erase_node(shard, *p);
+
+		p = &shard->buckets[e->hash & (shard->nbuckets - 1)];
+		e->next_hash = *p;
+		*p = e;
+		if (++shard->count > shard->nbuckets)
+			this->grow(shard);
+
+		// Inserted right behind the hand, to be scanned last.
+		list_add_tail(&e->list, shard->hand);
+		shard->size += charge;
+		if (shard->max_size > 0)
+			this->evict(shard);
+
+		return e;
+	}
+
+	// delete from cache, deleter delay called when all inuse-handle release.
+	void del(const KEY& key)
+	{
+		size_t hash = this->hasher(key);
+		Shard *shard = this->get_shard(hash);
+		std::lock_guard<std::mutex> lock(shard->mutex);
+		Handle *e = *this->find(shard, key, hash);
+
+		if (e)
+			this->erase_node(shard, e);
+	}
+
+private:
+	struct Shard
+	{
+		std::mutex mutex;
+		Handle **buckets;
+		size_t nbuckets;
+		size_t count;
+		size_t size;
+		size_t max_size;
+		struct list_head clock;
+		struct list_head *hand;
+		char pad[64];	// avoid false sharing between locks
+	};
+
+	static int64_t now()
+	{
+		auto now = std::chrono::steady_clock::now().time_since_epoch();
+		return std::chrono::duration_cast<std::chrono::milliseconds>(now).count();
+	}
+
+	Shard *get_shard(size_t hash) const
+	{
+		/* Take the high bits after mixing, leaving the low bits to buckets. */
+		uint64_t h = (uint64_t)hash * 0x9E3779B97F4A7C15ULL;
+
+		if (this->shard_bits == 0)
+			return this->shards;
+
+		return &this->shards[h >> (64 - this->shard_bits)];
+	}
+
+	Handle **find(Shard *shard, const KEY& key, size_t hash) const
+	{
+		Handle **p = &shard->buckets[hash & (shard->nbuckets - 1)];
+
+		while (*p && ((*p)->hash != hash || !((*p)->key == key)))
+			p = &(*p)->next_hash;
+
+		return p;
+	}
+
+	void grow(Shard *shard)
+	{
+		size_t nbuckets = shard->nbuckets * 2;
+		Handle **buckets = new Handle *[nbuckets]();
+		Handle *e, *next;
+		size_t i;
+
+		for (i = 0; i < shard->nbuckets; i++)
+		{
+			for (e = shard->buckets[i]; e; e = next)
+			{
+				next = e->next_hash;
+				e->next_hash = buckets[e->hash & (nbuckets - 1)];
+				buckets[e->hash & (nbuckets - 1)] = e;
+			}
+		}
+
+		delete []shard->buckets;
+		shard->buckets = buckets;
+		shard->nbuckets = nbuckets;
+	}
+
+	// Sweep the hand until the shard fits. A visited entry gets a second
+	// chance, and an entry in use is skipped. Each entry is passed at most
+	// twice, so it stops even if everything is in use.
+	void evict(Shard *shard)
+	{
+		size_t n = 2 * shard->count;
+		Handle *e;
+
+		while (shard->size > shard->max_size && n > 0)
+		{
+			if (shard->hand == &shard->clock)
+				shard->hand = shard->clock.next;
+
+			e = list_entry(shard->hand, Handle, list);
+			shard->hand = shard->hand->next;
+			n--;
+			if (e->ref > 1)
+				continue;
+
+			if (e->visited &&
+				(e->expire == 0 || e->expire > ShardedCache::now()))
+			{
+				e->visited = false;
+				continue;
+			}
+
+			this->erase_node(shard, e);
+		}
+	}
+
+	void unref(Handle *e)
+	{
+		assert(e->ref > 0);
+		if (--e->ref == 0)
+		{
+			assert(!e->in_cache);
+			this->value_deleter(e->value);
+			delete e;
+		}
+	}
+
+	void erase_node(Shard *shard, Handle *e)
+	{
+		Handle **p = &shard->buckets[e->hash & (shard->nbuckets - 1)];
+
+		assert(e->in_cache);
+		while (*p != e)
+			p = &(*p)->next_hash;
+
+		*p = e->next_hash;
+		if (shard->hand == &e->list)
+			shard->hand = e->list.next;
+
+		list_del(&e->list);
+		e->in_cache = false;
+		shard->count--;
+		shard->size -= e->charge;
+		this->unref(e);
+	}
+
+	Shard *shards;
+	size_t shard_count;
+	int shard_bits;
+
+	HASH hasher;
+	ValueDeleter value_deleter;
+};
+
+#endif
+
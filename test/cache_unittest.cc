@@ -0,0 +1,160 @@
+/*
+  Copyright (c) 2024 Sogou, Inc.
+
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+
+      http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+*/
+
+#include <unistd.h>
+#include <string>
+#include <gtest/gtest.h>
+#include "workflow/ShardedCache.h"
+
+static int deleted;
+
+class CountDeleter
+{
+public:
+	void operator() (int& value) const { deleted++; }
+};
+
+using IntCache = ShardedCache<std::string, int, CountDeleter>;
+
+TEST(cache_unittest, ShardedCacheCharge)
+{
+	IntCache cache(1);
+	const ShardedCacheHandle<std::string, int> *handle;
+
+	deleted = 0;
+	cache.set_max_size(10);
+	for (int i = 0; i < 5; i++)
+		cache.release(cache.put("key" + std::to_string(i), i, 2));
+
+	EXPECT_EQ(cache.get_size(), 10);
+
+	/* key0 is visited and gets a second chance, key1 goes instead. */
+	handle = cache.get("key0");
+	ASSERT_TRUE(handle != NULL);
+	EXPECT_EQ(handle->value, 0);
+	cache.release(handle);
+
+	cache.release(cache.put("key5", 5, 2));
+	EXPECT_EQ(cache.get_size(), 10);
+	EXPECT_EQ(deleted, 1);
+	EXPECT_TRUE(cache.get("key1") == NULL);
+
+	handle = cache.get("key0");
+	ASSERT_TRUE(handle != NULL);
+	cache.release(handle);
+
+	/* A large charge evicts as many as needed. */
+	cache.release(cache.put("big", 100, 8));
+	EXPECT_LE(cache.get_size(), 10);
+	handle = cache.get("big");
+	ASSERT_TRUE(handle != NULL);
+	EXPECT_EQ(handle->value, 100);
+	cache.release(handle);
+
+	/* Replacing a key releases the old value and its charge. */
+	size_t size = cache.get_size();
+	cache.release(cache.put("big", 101, 8));
+	EXPECT_EQ(cache.get_size(), size);
+
+	cache.clear();
+	EXPECT_EQ(cache.get_size(), 0);
+	EXPECT_EQ(deleted, 8);
+}
+
+TEST(cache_unittest, ShardedCacheTTL)
+{
+	IntCache cache;
+	const ShardedCacheHandle<std::string, int> *handle;
+
+	deleted = 0;
+	cache.release(cache.put("short", 1, 1, 50));
+	cache.release(cache.put("long", 2, 1, 60000));
+	cache.release(cache.put("forever", 3, 1, -1));
+
+	handle = cache.get("short");
+	ASSERT_TRUE(handle != NULL);
+	cache.release(handle);
+
+	usleep(100 * 1000);
+	EXPECT_TRUE(cache.get("short") == NULL);
+	EXPECT_EQ(deleted, 1);
+
+	handle = cache.get("long");
+	ASSERT_TRUE(handle != NULL);
+	EXPECT_EQ(handle->value, 2);
+	cache.release(handle);
+
+	handle = cache.get("forever");
+	ASSERT_TRUE(handle != NULL);
+	EXPECT_EQ(handle->value, 3);
+	cache.release(handle);
+	EXPECT_EQ(cache.get_size(), 2);
+}
+
+TEST(cache_unittest, ShardedCacheRelease)
+{
+	IntCache cache(4);
+	const ShardedCacheHandle<std::string, int> *handle;
+	const ShardedCacheHandle<std::string, int> *old;
+
+	deleted = 0;
+	cache.set_max_size(4);
+
+	/* A value in use outlives del, and is deleted by the last release. */
+	handle = cache.put("key", 1);
+	old = cache.get("key");
+	cache.del("key");
+	EXPECT_TRUE(cache.get("key") == NULL);
+	EXPECT_EQ(old->value, 1);
+	cache.release(handle);
+	EXPECT_EQ(deleted, 0);
+	cache.release(old);
+	EXPECT_EQ(deleted, 1);
+
+	/* The same for a replaced value. */
+	old = cache.put("key", 2);
+	cache.release(cache.put("key", 3));
+	EXPECT_EQ(old->value, 2);
+	EXPECT_EQ(deleted, 1);
+	cache.release(old);
+	EXPECT_EQ(deleted, 2);
+
+	/* Entries in use are never evicted, and prune keeps them too. */
+	handle = cache.put("held", 4, 4);
+	for (int i = 0; i < 16; i++)
+		cache.release(cache.put("key" + std::to_string(i), i, 4));
+
+	EXPECT_EQ(handle->value, 4);
+	cache.prune();
+	old = cache.get("held");
+	ASSERT_TRUE(old != NULL);
+	cache.release(old);
+
+	/* Cleared while in use, deleted when released. */
+	cache.clear();
+	EXPECT_TRUE(cache.get("held") == NULL);
+	EXPECT_EQ(cache.get_size(), 0);
+	EXPECT_EQ(handle->value, 4);
+	int before = deleted;
+	cache.release(handle);
+	EXPECT_EQ(deleted, before + 1);
+}
+
+int main(int argc, char *argv[])
+{
+	::testing::InitGoogleTest(&argc, argv);
+	return RUN_ALL_TESTS();
+}
@@ -16,10 +16,16 @@
   Author: Liu Kai (liukaidx@sogou-inc.com)
 */
 
+#include <netdb.h>
+#include <atomic>
 #include <future>
 #include <gtest/gtest.h>
 #include "workflow/WFTaskFactory.h"
 #include "workflow/WFDnsClient.h"
+#include "workflow/WFDnsServer.h"
+#include "workflow/WFFacilities.h"
+#include "workflow/DnsUtil.h"
+#include "workflow/DnsCache.h"
 
 #define RETRY_MAX	3
 
@@ -120,6 +126,198 @@ TEST(dns_unittest, WFDnsClient)
 	fut.get();
 }
 
+TEST(dns_unittest, BatchedServer)
+{
+	struct WFServerParams params = DNS_SERVER_PARAMS_DEFAULT;
+	WFFacilities::WaitGroup wait_group(256);
+	std::atomic<int> succeeded(0);
+
+	params.datagram_batch = 16;
+	WFDnsServer server(&params, [](WFDnsTask *task) {
+		auto *resp = task->get_resp();
+		std::string name = task->get_req()->get_question_name();
+		struct in_addr addr;
+
+		addr.s_addr = htonl(task->get_req()->get_id());
+		resp->set_rcode(DNS_RCODE_NO_ERROR);
+		resp->add_a_record(DNS_ANSWER_SECTION, name.c_str(), DNS_CLASS_IN,
+						   600, &addr);
+	});
+
+	ASSERT_EQ(server.start("127.0.0.1", 8866), 0);
+	for (int i = 0; i < 256; i++)
+	{
+		auto *task = WFTaskFactory::create_dns_task("dns://127.0.0.1:8866/"
+													"www.sogou.com", RETRY_MAX,
+		[&](WFDnsTask *task) {
+			auto *resp = task->get_resp();
+
+			if (task->get_state() == WFT_STATE_SUCCESS &&
+				resp->get_ancount() == 1)
+			{
+				protocol::DnsResultCursor cursor(resp);
+				struct dns_record *record;
+
+				if (cursor.next(&record) &&
+					((struct in_addr *)record->rdata)->s_addr ==
+						htonl(task->get_req()->get_id()))
+				{
+					succeeded++;
+				}
+			}
+
+			wait_group.done();
+		});
+
+		task->get_req()->set_id(i + 1);
+		task->get_req()->set_question_type(DNS_TYPE_A);
+		task->start();
+	}
+
+	wait_group.wait();
+	server.stop();
+	EXPECT_EQ(succeeded, 256);
+}
+
+TEST(dns_unittest, BatchedServerReplyError)
+{
+	struct WFServerParams params = DNS_SERVER_PARAMS_DEFAULT;
+	WFFacilities::WaitGroup server_wg(32);
+	WFFacilities::WaitGroup client_wg(32);
+	std::atomic<int> replied(0);
+	std::atomic<int> oversized(0);
+
+	/* Odd requests get replies too large for a datagram. Their server tasks
+	 * must fail, no matter which thread sent the batch. */
+	params.datagram_batch = 16;
+	WFDnsServer server(&params, [&](WFDnsTask *task) {
+		auto *resp = task->get_resp();
+		std::string name = task->get_req()->get_question_name();
+		struct in_addr addr;
+
+		addr.s_addr = htonl(task->get_req()->get_id());
+		resp->set_rcode(DNS_RCODE_NO_ERROR);
+		if (task->get_req()->get_id() % 2)
+		{
+			std::string big(65480, 'x');
+			resp->add_raw_record(DNS_ANSWER_SECTION, "big", DNS_TYPE_TXT,
+								 DNS_CLASS_IN, 600, big.data(), big.size());
+		}
+		else
+		{
+			resp->add_a_record(DNS_ANSWER_SECTION, name.c_str(), DNS_CLASS_IN,
+							   600, &addr);
+		}
+
+		task->set_callback([&](WFDnsTask *task) {
+			if (task->get_state() == WFT_STATE_SUCCESS)
+				replied++;
+			else if (task->get_state() == WFT_STATE_SYS_ERROR &&
+					 task->get_error() == EMSGSIZE)
+				oversized++;
+
+			server_wg.done();
+		});
+	});
+
+	ASSERT_EQ(server.start("127.0.0.1", 8867), 0);
+	for (int i = 0; i < 32; i++)
+	{
+		auto *task = WFTaskFactory::create_dns_task("dns://127.0.0.1:8867/"
+													"www.sogou.com", 0,
+		[&](WFDnsTask *task) {
+			client_wg.done();
+		});
+
+		task->set_receive_timeout(100);
+		task->get_req()->set_id(i + 1);
+		task->get_req()->set_question_type(DNS_TYPE_A);
+		task->start();
+	}
+
+	server_wg.wait();
+	client_wg.wait();
+	server.stop();
+	EXPECT_EQ(replied, 16);
+	EXPECT_EQ(oversized, 16);
+}
+
+static struct addrinfo *__numeric_addrinfo(const char *ip)
+{
+	struct addrinfo hints = { };
+	struct addrinfo *ai;
+
+	hints.ai_flags = AI_NUMERICHOST;
+	EXPECT_EQ(getaddrinfo(ip, "80", &hints, &ai), 0);
+	ai->ai_flags = 1;	/* freed by freeaddrinfo() */
+	return ai;
+}
+
+TEST(dns_unittest, DnsCache)
+{
+	DnsCache cache;
+	const DnsCache::DnsHandle *handle;
+	struct DnsCacheStats stats;
+	bool refresh;
+
+	for (int i = 0; i < 100; i++)
+	{
+		std::string host = "host" + std::to_string(i);
+		handle = cache.put(host, 80, __numeric_addrinfo("127.0.0.1"), 60, 30);
+		cache.release(handle);
+	}
+
+	for (int i = 0; i < 100; i++)
+	{
+		std::string host = "host" + std::to_string(i);
+		handle = cache.get_ttl(host, 80, &refresh);
+		ASSERT_TRUE(handle != NULL);
+		EXPECT_FALSE(refresh);
+		cache.release(handle);
+	}
+
+	EXPECT_TRUE(cache.get_ttl("nohost", 80) == NULL);
+
+	/* A zero TTL is due for refresh at once, handed out only once. */
+	handle = cache.put("zero", 80, __numeric_addrinfo("127.0.0.1"), 0, 0);
+	cache.release(handle);
+	handle = cache.get_ttl("zero", 80, &refresh);
+	if (handle)
+	{
+		EXPECT_TRUE(refresh);
+		cache.release(handle);
+		handle = cache.get_ttl("zero", 80, &refresh);
+		if (handle)
+		{
+			EXPECT_FALSE(refresh);
+			cache.release(handle);
+		}
+
+		/* After a failed refresh, the next lookup starts another. */
+		cache.refresh_failed("zero", 80);
+		handle = cache.get_ttl("zero", 80, &refresh);
+		if (handle)
+		{
+			EXPECT_TRUE(refresh);
+			cache.release(handle);
+		}
+	}
+
+	cache.get_stats(&stats);
+	EXPECT_GE(stats.hits, 100);
+	EXPECT_GE(stats.misses, 1);
+	EXPECT_LE(stats.refreshes, 2);
+
+	/* Only the generation of the changed host moves. */
+	unsigned long long gen0 = cache.get_generation("host0", 80);
+	unsigned long long gen1 = cache.get_generation("host1", 80);
+
+	cache.del("host0", 80);
+	EXPECT_TRUE(cache.get("host0", 80) == NULL);
+	EXPECT_NE(cache.get_generation("host0", 80), gen0);
+	EXPECT_EQ(cache.get_generation("host1", 80), gen1);
+}
+
 int main(int argc, char *argv[])
 {
 	::testing::InitGoogleTest(&argc, argv);
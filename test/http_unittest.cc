@@ -16,13 +16,28 @@
   Author: Wu Jiaxu (wujiaxu@sogou-inc.com)
 */
 
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <atomic>
 #include <mutex>
+#include <functional>
 #include <condition_variable>
 #include <chrono>
+#include <openssl/evp.h>
+#include <openssl/pem.h>
+#include <openssl/x509.h>
 #include <gtest/gtest.h>
 #include "workflow/WFTaskFactory.h"
 #include "workflow/WFOperator.h"
 #include "workflow/WFHttpServer.h"
+#include "workflow/WFHttpFileCache.h"
+#include "workflow/WFFacilities.h"
+#include "workflow/RouteManager.h"
 #include "workflow/HttpUtil.h"
 
 #define RETRY_MAX  3
@@ -211,6 +226,512 @@ KZ1lOvb+vi3TLrQf4tfBekrXXe5tZK40QSJ7UdtY7HHrrbAXU+8=
 	https_server.stop();
 }
 
+/* Write a self-signed certificate and its key. */
+static bool __write_cert(const char *crt_path, const char *key_path)
+{
+	EVP_PKEY_CTX *pctx = EVP_PKEY_CTX_new_id(EVP_PKEY_RSA, NULL);
+	EVP_PKEY *pkey = NULL;
+	X509 *x509 = NULL;
+	bool ret = false;
+	X509_NAME *name;
+	FILE *f;
+
+	if (pctx && EVP_PKEY_keygen_init(pctx) > 0 &&
+		EVP_PKEY_CTX_set_rsa_keygen_bits(pctx, 2048) > 0 &&
+		EVP_PKEY_keygen(pctx, &pkey) > 0)
+	{
+		x509 = X509_new();
+		name = X509_get_subject_name(x509);
+		ASN1_INTEGER_set(X509_get_serialNumber(x509), 1);
+		X509_gmtime_adj(X509_getm_notBefore(x509), 0);
+		X509_gmtime_adj(X509_getm_notAfter(x509), 24 * 3600);
+		X509_set_pubkey(x509, pkey);
+		X509_NAME_add_entry_by_txt(name, "CN", MBSTRING_ASC,
+								   (const unsigned char *)"127.0.0.1",
+								   -1, -1, 0);
+		X509_set_issuer_name(x509, name);
+		if (X509_sign(x509, pkey, EVP_sha256()) > 0)
+		{
+			f = fopen(crt_path, "w");
+			if (f)
+			{
+				ret = PEM_write_X509(f, x509) > 0;
+				fclose(f);
+			}
+
+			f = fopen(key_path, "w");
+			if (f)
+			{
+				ret = ret && PEM_write_PrivateKey(f, pkey, NULL, NULL, 0,
+												  NULL, NULL) > 0;
+				fclose(f);
+			}
+		}
+	}
+
+	X509_free(x509);
+	EVP_PKEY_free(pkey);
+	EVP_PKEY_CTX_free(pctx);
+	return ret;
+}
+
+TEST(http_unittest, SSLSessionResumption)
+{
+	struct WFServerParams params = HTTP_SERVER_PARAMS_DEFAULT;
+	RouteManager::SSLSessionStats before, after;
+	WFFacilities::WaitGroup wait_group(1);
+
+	ASSERT_TRUE(__write_cert("session.crt", "session.key"));
+
+	params.ssl_ticket_rotation = 60 * 1000;
+	WFHttpServer server(&params, [](WFHttpTask *task) {
+		/* Every request needs a new connection. */
+		task->get_resp()->add_header_pair("Connection", "close");
+	});
+	EXPECT_TRUE(server.start("127.0.0.1", 8833, "session.crt", "session.key") == 0);
+
+	auto cb = [](WFHttpTask *task) {
+		EXPECT_EQ(task->get_state(), WFT_STATE_SUCCESS);
+	};
+
+	RouteManager::get_ssl_session_stats(&before);
+	SeriesWork *series = Workflow::create_series_work(
+		WFTaskFactory::create_http_task("https://127.0.0.1:8833/a", 0, 0, cb),
+		[&wait_group](const SeriesWork *) { wait_group.done(); });
+	for (int i = 0; i < 2; i++)
+		series->push_back(WFTaskFactory::create_http_task("https://127.0.0.1:8833/b",
+														  0, 0, cb));
+	series->start();
+	wait_group.wait();
+	RouteManager::get_ssl_session_stats(&after);
+
+	EXPECT_EQ(after.handshakes - before.handshakes, 3);
+	EXPECT_EQ(after.resumed - before.resumed, 2);
+	server.stop();
+	unlink("session.crt");
+	unlink("session.key");
+}
+
+TEST(http_unittest, StreamServer)
+{
+	WFFacilities::WaitGroup wait_group(2);
+	std::atomic<size_t> pieces(0);
+	size_t total = 0;
+	unsigned char sum = 0;
+
+	auto extract = [&](WFHttpTask *task, const void *data, size_t size) {
+		for (size_t i = 0; i < size; i++)
+			sum += ((const unsigned char *)data)[i];
+
+		total += size;
+		/* Slow consumer: stop reading until a timer fires. */
+		if (++pieces % 2 == 0)
+		{
+			WFHttpStreamServer::pause(task);
+			WFTaskFactory::create_timer_task(0, 1000000, [task](WFTimerTask *) {
+				WFHttpStreamServer::resume(task);
+			})->start();
+		}
+	};
+
+	WFHttpStreamServer server(extract, [&](WFHttpTask *task) {
+		const void *body;
+		size_t size;
+
+		EXPECT_FALSE(task->get_req()->get_parsed_body(&body, &size) && size);
+		task->get_resp()->append_output_body(std::to_string(total) + " " +
+											 std::to_string(sum));
+		total = 0;
+		sum = 0;
+	});
+	EXPECT_TRUE(server.start("127.0.0.1", 8844) == 0);
+
+	std::string body(4 * 1024 * 1024 + 7, '\0');
+	unsigned char body_sum = 0;
+	for (size_t i = 0; i < body.size(); i++)
+	{
+		body[i] = (char)(i * 31 + 7);
+		body_sum += (unsigned char)body[i];
+	}
+
+	std::string expected = std::to_string(body.size()) + " " +
+						   std::to_string(body_sum);
+	auto cb = [&wait_group, &expected](WFHttpTask *task) {
+		const void *body;
+		size_t size;
+
+		EXPECT_EQ(task->get_state(), WFT_STATE_SUCCESS);
+		task->get_resp()->get_parsed_body(&body, &size);
+		EXPECT_EQ(std::string((const char *)body, size), expected);
+		wait_group.done();
+	};
+
+	auto *task = WFTaskFactory::create_http_task("http://127.0.0.1:8844/upload",
+												 0, 0, cb);
+	task->get_req()->set_method(HttpMethodPost);
+	task->get_req()->append_output_body_nocopy(body.data(), body.size());
+
+	/* The same body in chunks of various sizes. */
+	char line[32];
+	std::string chunked;
+	size_t off = 0;
+	for (size_t n = 1; off < body.size(); n = n * 3 + 1)
+	{
+		if (n > body.size() - off)
+			n = body.size() - off;
+
+		sprintf(line, "%zx;ext=1\r\n", n);
+		chunked.append(line);
+		chunked.append(body, off, n);
+		chunked.append("\r\n");
+		off += n;
+	}
+
+	chunked.append("0\r\nTrailer: x\r\n\r\n");
+	auto *next = WFTaskFactory::create_http_task("http://127.0.0.1:8844/upload",
+												 0, 0, cb);
+	next->get_req()->set_method(HttpMethodPost);
+	next->get_req()->add_header_pair("Transfer-Encoding", "chunked");
+	next->get_req()->append_output_body_nocopy(chunked.data(), chunked.size());
+
+	SeriesWork *series = Workflow::create_series_work(task, nullptr);
+	series->push_back(next);
+	series->start();
+	wait_group.wait();
+	EXPECT_GT(pieces, 2);
+	server.stop();
+}
+
+TEST(http_unittest, ReceiveBudget)
+{
+	struct WFServerParams params = HTTP_SERVER_PARAMS_DEFAULT;
+	WFFacilities::WaitGroup wait_group(8);
+
+	/* Far less than the requests, but every request must finish. */
+	params.receive_budget = 1536 * 1024;
+	WFHttpServer server(&params, [](WFHttpTask *task) {
+		const void *body;
+		size_t size;
+
+		task->get_req()->get_parsed_body(&body, &size);
+		task->get_resp()->append_output_body(std::to_string(size));
+		/* A slow handler keeps the request in memory for a while. */
+		series_of(task)->push_back(WFTaskFactory::create_timer_task(0, 20000000, nullptr));
+	});
+	EXPECT_TRUE(server.start("127.0.0.1", 8855) == 0);
+
+	std::string body(1024 * 1024, 'x');
+	auto cb = [&wait_group, &body](WFHttpTask *task) {
+		const void *resp_body;
+		size_t size;
+
+		EXPECT_EQ(task->get_state(), WFT_STATE_SUCCESS);
+		task->get_resp()->get_parsed_body(&resp_body, &size);
+		EXPECT_EQ(std::string((const char *)resp_body, size),
+				  std::to_string(body.size()));
+		wait_group.done();
+	};
+
+	for (int i = 0; i < 8; i++)
+	{
+		auto *task = WFTaskFactory::create_http_task("http://127.0.0.1:8855/",
+													 0, 0, cb);
+		task->get_req()->set_method(HttpMethodPost);
+		task->get_req()->append_output_body_nocopy(body.data(), body.size());
+		task->start();
+	}
+
+	wait_group.wait();
+	server.stop();
+}
+
+TEST(http_unittest, ReceiveBudgetKeepAlive)
+{
+	struct WFServerParams params = HTTP_SERVER_PARAMS_DEFAULT;
+	WFFacilities::WaitGroup wait_group(4);
+
+	params.receive_budget = 64 * 1024;
+	WFHttpServer server(&params, [](WFHttpTask *task) {
+		const void *body;
+		size_t size;
+
+		task->get_req()->get_parsed_body(&body, &size);
+		task->get_resp()->append_output_body(std::to_string(size));
+	});
+	EXPECT_TRUE(server.start("127.0.0.1", 8856) == 0);
+
+	/* The next request may arrive before the reply of the previous one is
+	 * handled, when the previous request is still held. */
+	struct sockaddr_in addr = { };
+	int fd = socket(AF_INET, SOCK_STREAM, 0);
+
+	addr.sin_family = AF_INET;
+	addr.sin_port = htons(8856);
+	addr.sin_addr.s_addr = inet_addr("127.0.0.1");
+	ASSERT_TRUE(connect(fd, (struct sockaddr *)&addr, sizeof addr) == 0);
+
+	std::string req = "GET / HTTP/1.1\r\nHost: 127.0.0.1\r\n\r\n";
+	std::string resp;
+	char buf[1024];
+	ssize_t n;
+	size_t pos;
+	int i;
+
+	for (i = 0; i < 200; i++)
+	{
+		if (write(fd, req.data(), req.size()) != (ssize_t)req.size())
+			break;
+
+		resp.clear();
+		while ((pos = resp.find("\r\n\r\n")) == std::string::npos ||
+			   resp.size() < pos + 5)
+		{
+			n = read(fd, buf, sizeof buf);
+			if (n <= 0)
+				break;
+
+			resp.append(buf, n);
+		}
+
+		if (resp.compare(0, 12, "HTTP/1.1 200") != 0)
+			break;
+	}
+
+	EXPECT_EQ(i, 200);
+	close(fd);
+
+	/* Counters stay balanced, so other connections are not stalled. */
+	std::string body(256 * 1024, 'x');
+	auto cb = [&wait_group, &body](WFHttpTask *task) {
+		const void *resp_body;
+		size_t size;
+
+		EXPECT_EQ(task->get_state(), WFT_STATE_SUCCESS);
+		task->get_resp()->get_parsed_body(&resp_body, &size);
+		EXPECT_EQ(std::string((const char *)resp_body, size),
+				  std::to_string(body.size()));
+		wait_group.done();
+	};
+
+	for (int i = 0; i < 4; i++)
+	{
+		auto *task = WFTaskFactory::create_http_task("http://127.0.0.1:8856/",
+													 0, 0, cb);
+		task->get_req()->set_method(HttpMethodPost);
+		task->get_req()->append_output_body_nocopy(body.data(), body.size());
+		task->start();
+	}
+
+	wait_group.wait();
+	server.stop();
+}
+
+static int __http_connect(unsigned short port)
+{
+	struct sockaddr_in addr = { };
+	int fd = socket(AF_INET, SOCK_STREAM, 0);
+
+	addr.sin_family = AF_INET;
+	addr.sin_port = htons(port);
+	addr.sin_addr.s_addr = inet_addr("127.0.0.1");
+	if (connect(fd, (struct sockaddr *)&addr, sizeof addr) < 0)
+	{
+		close(fd);
+		return -1;
+	}
+
+	return fd;
+}
+
+static bool __http_read_reply(int fd, const std::string& body)
+{
+	std::string resp;
+	char buf[1024];
+	ssize_t n;
+
+	while (resp.size() < body.size() ||
+		   resp.compare(resp.size() - body.size(), body.size(), body) != 0)
+	{
+		n = read(fd, buf, sizeof buf);
+		if (n <= 0)
+			return false;
+
+		resp.append(buf, n);
+	}
+
+	return resp.compare(0, 12, "HTTP/1.1 200") == 0;
+}
+
+static void __wait_until(const std::function<bool ()>& cond)
+{
+	for (int i = 0; i < 500 && !cond(); i++)
+		usleep(10000);
+}
+
+TEST(http_unittest, StreamServerReceiveBudget)
+{
+	struct WFServerParams params = HTTP_SERVER_PARAMS_DEFAULT;
+	std::atomic<WFHttpTask *> slow_task(NULL);
+	std::atomic<bool> slow_paused(false);
+	std::atomic<size_t> fast_bytes(0);
+
+	/* The consumer and the budget pause the same connection. Neither may
+	 * restart reading while the other still keeps it paused. */
+	params.receive_budget = 64 * 1024;
+	auto extract = [&](WFHttpTask *task, const void *data, size_t size) {
+		if (strcmp(task->get_req()->get_request_uri(), "/slow") != 0)
+			fast_bytes += size;
+		else
+		{
+			EXPECT_FALSE(slow_paused);
+			if (!slow_task)
+			{
+				slow_paused = true;
+				WFHttpStreamServer::pause(task);
+				slow_task = task;
+			}
+		}
+	};
+
+	WFHttpStreamServer server(&params, extract, [](WFHttpTask *task) {
+		task->get_resp()->append_output_body("done");
+	});
+	EXPECT_TRUE(server.start("127.0.0.1", 8857) == 0);
+
+	std::string body(1024 * 1024, 'x');
+	std::string req = "POST /fast HTTP/1.1\r\nHost: 127.0.0.1\r\n"
+					  "Content-Length: 4096\r\n\r\n";
+	int fast = __http_connect(8857);
+	int slow = __http_connect(8857);
+
+	ASSERT_TRUE(fast >= 0 && slow >= 0);
+
+	/* A fast request is being received while the slow one arrives. */
+	req.append(body, 0, 1024);
+	EXPECT_EQ(write(fast, req.data(), req.size()), (ssize_t)req.size());
+	__wait_until([&]() { return fast_bytes == 1024; });
+
+	req = "POST /slow HTTP/1.1\r\nHost: 127.0.0.1\r\nContent-Length: " +
+		  std::to_string(body.size()) + "\r\n\r\n";
+	req.append(body, 0, body.size() / 2);
+	EXPECT_EQ(write(slow, req.data(), req.size()), (ssize_t)req.size());
+	__wait_until([&]() { return slow_task != NULL; });
+	ASSERT_TRUE(slow_task != NULL);
+
+	/* Finishing the fast request releases budget, but must not restart
+	 * the slow connection that its consumer still keeps paused. */
+	EXPECT_EQ(write(fast, body.data(), 3072), 3072);
+	EXPECT_TRUE(__http_read_reply(fast, "done"));
+	usleep(100000);
+
+	slow_paused = false;
+	WFHttpStreamServer::resume(slow_task);
+	EXPECT_EQ(write(slow, body.data(), body.size() / 2),
+			  (ssize_t)body.size() / 2);
+	EXPECT_TRUE(__http_read_reply(slow, "done"));
+
+	close(fast);
+	close(slow);
+	server.stop();
+}
+
+/* Fetch a url synchronously. Return the status code, with body and etag. */
+static int __http_fetch(const std::string& url, const char *name,
+						const std::string& value, std::string& body,
+						std::string *etag)
+{
+	WFFacilities::WaitGroup wait_group(1);
+	std::string code;
+
+	auto *task = WFTaskFactory::create_http_task(url, 0, 0, [&](WFHttpTask *task) {
+		protocol::HttpResponse *resp = task->get_resp();
+		const void *data;
+		size_t size;
+
+		EXPECT_EQ(task->get_state(), WFT_STATE_SUCCESS);
+		if (task->get_state() == WFT_STATE_SUCCESS)
+		{
+			code = resp->get_status_code();
+			resp->get_parsed_body(&data, &size);
+			body.assign((const char *)data, size);
+			if (etag)
+			{
+				protocol::HttpHeaderCursor cursor(resp);
+				etag->clear();
+				cursor.find("ETag", *etag);
+			}
+		}
+
+		wait_group.done();
+	});
+
+	if (name)
+		task->get_req()->add_header_pair(name, value);
+
+	task->start();
+	wait_group.wait();
+	return atoi(code.c_str());
+}
+
+TEST(http_unittest, FileCache)
+{
+	char dir[] = "/tmp/http_unittest_XXXXXX";
+	std::string url = "http://127.0.0.1:8866";
+	std::string body;
+	std::string etag;
+	WFHttpFileCache cache;
+	FILE *fp;
+
+	ASSERT_TRUE(mkdtemp(dir) != NULL);
+	std::string path = std::string(dir) + "/index.html";
+	fp = fopen(path.c_str(), "w");
+	ASSERT_TRUE(fp != NULL);
+	fputs("0123456789", fp);
+	fclose(fp);
+
+	EXPECT_EQ(cache.init(dir, 1024 * 1024), 0);
+	WFHttpServer server([&cache](WFHttpTask *task) { cache.serve(task); });
+	EXPECT_TRUE(server.start("127.0.0.1", 8866) == 0);
+
+	EXPECT_EQ(__http_fetch(url + "/", NULL, "", body, &etag), 200);
+	EXPECT_EQ(body, "0123456789");
+	EXPECT_FALSE(etag.empty());
+	EXPECT_GT(cache.size(), 10);
+
+	EXPECT_EQ(__http_fetch(url + "/index.html", "If-None-Match", etag,
+						   body, NULL), 304);
+	EXPECT_EQ(__http_fetch(url + "/index.html", "Range", "bytes=2-4",
+						   body, NULL), 206);
+	EXPECT_EQ(body, "234");
+	EXPECT_EQ(__http_fetch(url + "/index.html", "Range", "bytes=-3",
+						   body, NULL), 206);
+	EXPECT_EQ(body, "789");
+	EXPECT_EQ(__http_fetch(url + "/index.html", "Range", "bytes=10-",
+						   body, NULL), 416);
+	EXPECT_EQ(__http_fetch(url + "/none.html", NULL, "", body, NULL), 404);
+	EXPECT_EQ(__http_fetch(url + "/../etc/passwd", NULL, "", body, NULL), 404);
+
+	/* A changed file is served again after invalidation. */
+	fp = fopen(path.c_str(), "w");
+	ASSERT_TRUE(fp != NULL);
+	fputs("abcdefghijklmnopqrstuvwxyz", fp);
+	fclose(fp);
+	for (int i = 0; i < 70; i++)
+	{
+		__http_fetch(url + "/", NULL, "", body, NULL);
+		if (body.size() == 26)
+			break;
+
+		usleep(100000);
+	}
+
+	EXPECT_EQ(body, "abcdefghijklmnopqrstuvwxyz");
+	server.stop();
+	cache.deinit();
+	unlink(path.c_str());
+	rmdir(dir);
+}
+
 #if OPENSSL_VERSION_NUMBER >= 0x10100000L
 
 #include <openssl/ssl.h>
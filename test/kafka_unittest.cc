@@ -0,0 +1,323 @@
+/*
+  Copyright (c) 2024 Sogou, Inc.
+
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+
+      http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+*/
+
+#include <unistd.h>
+#include <stdint.h>
+#include <zlib.h>
+#include <atomic>
+#include <string>
+#include <thread>
+#include <vector>
+#include <gtest/gtest.h>
+#include "workflow/WFKafkaClient.h"
+#include "workflow/KafkaMessage.h"
+#include "workflow/WFFacilities.h"
+
+using namespace protocol;
+
+/* Nothing listens on the port, so every produce task fails quickly. */
+#define BROKER_URL	"kafka://127.0.0.1:1"
+
+TEST(kafka_unittest, ProducerCloseRacesTimer)
+{
+	WFKafkaClient client;
+	int n = 100;
+	WFFacilities::WaitGroup wait_group(n);
+	std::atomic<int> produced(0);
+
+	ASSERT_EQ(client.init(BROKER_URL), 0);
+	for (int i = 0; i < n; i++)
+	{
+		WFKafkaProducer *producer;
+		KafkaRecord record;
+
+		producer = client.create_producer(1024 * 1024, 1, 0,
+										  [&](WFKafkaTask *task) {
+			EXPECT_NE(task->get_state(), WFT_STATE_SUCCESS);
+			produced++;
+			wait_group.done();
+		});
+
+		record.set_key("key", 3);
+		record.set_value("value", 5);
+		EXPECT_TRUE(producer->send("test", 0, std::move(record)));
+
+		/* Close around the end of the linger, from either side of it. */
+		usleep(i % 3 * 500);
+		producer->close();
+	}
+
+	/* One record each, sent by the timer or by close(), never both. */
+	wait_group.wait();
+	EXPECT_EQ(produced, n);
+	client.deinit();
+}
+
+TEST(kafka_unittest, Consumer)
+{
+	WFKafkaClient client;
+	WFKafkaConsumer *consumer;
+	KafkaResult result;
+	std::vector<std::thread> threads;
+
+	ASSERT_EQ(client.init(BROKER_URL), 0);
+	consumer = client.create_consumer("topic=test", 1024, 0);
+
+	/* Toppars may be added from any thread. */
+	for (int i = 0; i < 4; i++)
+	{
+		threads.emplace_back([consumer, i]() {
+			for (int j = 0; j < 16; j++)
+			{
+				KafkaToppar toppar;
+
+				toppar.set_topic_partition("test", i * 16 + j);
+				toppar.set_offset(0);
+				EXPECT_TRUE(consumer->add_toppar(toppar));
+			}
+		});
+	}
+
+	for (std::thread& thread : threads)
+		thread.join();
+
+	/* Before the metadata is known, the leaders are unknown and all the
+	 * toppars go in one fetch. The failed fetch stops the consumer. */
+	consumer->set_broker_fetches(4);
+	consumer->start();
+	EXPECT_EQ(consumer->poll(&result, -1), -1);
+	EXPECT_NE(consumer->get_state(), WFT_STATE_SUCCESS);
+	EXPECT_EQ(consumer->poll(&result, 0), -1);
+	consumer->close();
+	client.deinit();
+}
+
+TEST(kafka_unittest, ConfigCopy)
+{
+	KafkaConfig config;
+	KafkaConfig copy;
+
+	config.set_client_id("client");
+	config.set_fetch_max_bytes(1024);
+	ASSERT_TRUE(copy.copy_from(config));
+	copy.set_fetch_max_bytes(16);
+	copy.set_client_id("copy");
+	EXPECT_EQ(config.get_fetch_max_bytes(), 1024);
+	EXPECT_STREQ(config.get_client_id(), "client");
+	EXPECT_STREQ(copy.get_client_id(), "copy");
+}
+
+/* Records freed by thread_local destructors after the record pool's. */
+TEST(kafka_unittest, RecordPoolThreadExit)
+{
+	std::thread thread([]() {
+		static thread_local std::vector<KafkaRecord> records;
+		KafkaRecord record;
+
+		records.resize(16);
+		record = std::move(records[0]);
+	});
+
+	thread.join();
+}
+
+static void __append_int(std::string& buf, uint64_t val, int bytes)
+{
+	while (--bytes >= 0)
+		buf.push_back((char)(val >> (bytes * 8)));
+}
+
+static void __append_varint(std::string& buf, int64_t val)
+{
+	uint64_t n = ((uint64_t)val << 1) ^ (uint64_t)(val >> 63);
+
+	while (n >= 0x80)
+	{
+		buf.push_back((char)(n | 0x80));
+		n >>= 7;
+	}
+
+	buf.push_back((char)n);
+}
+
+static std::string __gzip(const std::string& data)
+{
+	z_stream strm = { };
+	std::string out(data.size() + 64, '\0');
+
+	deflateInit2(&strm, Z_DEFAULT_COMPRESSION, Z_DEFLATED, 15 | 16, 8,
+				 Z_DEFAULT_STRATEGY);
+	strm.next_in = (Bytef *)data.data();
+	strm.avail_in = data.size();
+	strm.next_out = (Bytef *)&out[0];
+	strm.avail_out = out.size();
+	EXPECT_EQ(deflate(&strm, Z_FINISH), Z_STREAM_END);
+	out.resize(strm.total_out);
+	deflateEnd(&strm);
+	return out;
+}
+
+/* A magic 2 record batch of 'count' records, keyed by their offsets, with
+ * the key as the value of a header too. */
+static std::string __record_batch(int64_t base_offset, int count, bool gzip)
+{
+	std::string records;
+	std::string batch;
+	std::string body;
+
+	for (int i = 0; i < count; i++)
+	{
+		std::string key = "key" + std::to_string(base_offset + i);
+		std::string value = "value" + std::to_string(base_offset + i);
+
+		body.clear();
+		body.push_back(0);
+		__append_varint(body, 0);
+		__append_varint(body, i);
+		__append_varint(body, key.size());
+		body.append(key);
+		__append_varint(body, value.size());
+		body.append(value);
+		__append_varint(body, 1);
+		__append_varint(body, 6);
+		body.append("header");
+		__append_varint(body, key.size());
+		body.append(key);
+		__append_varint(records, body.size());
+		records.append(body);
+	}
+
+	if (gzip)
+		records = __gzip(records);
+
+	body.clear();
+	__append_int(body, gzip ? Kafka_Gzip : 0, 2);
+	__append_int(body, count - 1, 4);
+	__append_int(body, 0, 8);
+	__append_int(body, 0, 8);
+	__append_int(body, -1, 8);
+	__append_int(body, -1, 2);
+	__append_int(body, -1, 4);
+	__append_int(body, count, 4);
+	body.append(records);
+
+	/* Not checked, as check_crcs is off by default. */
+	__append_int(batch, base_offset, 8);
+	__append_int(batch, 4 + 1 + 4 + body.size(), 4);
+	__append_int(batch, 0, 4);
+	batch.push_back(2);
+	__append_int(batch, 0, 4);
+	batch.append(body);
+	return batch;
+}
+
+/* A version 4 fetch response of one toppar. */
+static std::string __fetch_response(const std::string& record_set)
+{
+	std::string msg;
+	std::string buf;
+
+	__append_int(msg, 1, 4);
+	__append_int(msg, 0, 4);
+	__append_int(msg, 1, 4);
+	__append_int(msg, 4, 2);
+	msg.append("test");
+	__append_int(msg, 1, 4);
+	__append_int(msg, 0, 4);
+	__append_int(msg, 0, 2);
+	__append_int(msg, 100, 8);
+	__append_int(msg, 100, 8);
+	__append_int(msg, 0, 4);
+	__append_int(msg, record_set.size(), 4);
+	msg.append(record_set);
+
+	__append_int(buf, msg.size(), 4);
+	buf.append(msg);
+	return buf;
+}
+
+class __KafkaFetchResponse : public KafkaResponse
+{
+public:
+	using KafkaResponse::append;
+};
+
+TEST(kafka_unittest, FetchDecoder)
+{
+	std::string record_set;
+	std::vector<KafkaRecord> records;
+	int64_t offset = 0;
+
+	/* Plain and gzip batches in turn, all in one response. */
+	for (int i = 0; i < 8; i++)
+	{
+		record_set.append(__record_batch(offset, 10, i % 2 == 1));
+		offset += 10;
+	}
+
+	std::string data = __fetch_response(record_set);
+
+	{
+		__KafkaFetchResponse resp;
+		KafkaTopparList toppar_list;
+		KafkaToppar toppar;
+		KafkaToppar *t;
+		KafkaRecord *record;
+		size_t size = data.size();
+
+		toppar.set_topic_partition("test", 0);
+		toppar.set_offset(0);
+		toppar_list.add_item(std::move(toppar));
+		resp.set_api_type(Kafka_Fetch);
+		resp.set_api_version(4);
+		resp.set_toppar_list(toppar_list);
+
+		ASSERT_EQ(resp.append(data.data(), &size), 1);
+		resp.get_toppar_list()->rewind();
+		t = resp.get_toppar_list()->get_next();
+		ASSERT_TRUE(t != NULL);
+		EXPECT_EQ(t->get_error(), 0);
+		while ((record = t->get_record_next()) != NULL)
+			records.push_back(*record);
+	}
+
+	/* The records keep the response buffer, the inflated batches and the
+	 * header nodes. */
+	ASSERT_EQ(records.size(), (size_t)offset);
+	for (int64_t i = 0; i < offset; i++)
+	{
+		struct list_head *head = records[i].get_header_list();
+		kafka_record_header_t *header;
+		const void *p;
+		size_t len;
+
+		EXPECT_EQ(records[i].get_offset(), i);
+		records[i].get_key(&p, &len);
+		EXPECT_EQ(std::string((const char *)p, len), "key" + std::to_string(i));
+		records[i].get_value(&p, &len);
+		EXPECT_EQ(std::string((const char *)p, len),
+				  "value" + std::to_string(i));
+		ASSERT_EQ(head->next->next, head);
+		header = list_entry(head->next, kafka_record_header_t, list);
+		EXPECT_EQ(std::string((const char *)header->key, header->key_len),
+				  "header");
+		EXPECT_EQ(std::string((const char *)header->value, header->value_len),
+				  "key" + std::to_string(i));
+	}
+
+	/* A header added by the user is freed with the record as before. */
+	EXPECT_TRUE(records[0].add_header_pair("user", "header"));
+}
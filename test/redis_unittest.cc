@@ -17,14 +17,25 @@
 */
 
 #include <string.h>
+#include <unistd.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <atomic>
 #include <mutex>
 #include <condition_variable>
 #include <chrono>
+#include <thread>
 #include <vector>
 #include <string>
 #include <gtest/gtest.h>
 #include "workflow/WFTaskFactory.h"
 #include "workflow/WFRedisServer.h"
+#include "workflow/redis_parser.h"
+#include "workflow/WFRedisClusterClient.h"
+#include "workflow/WFRedisCachingClient.h"
+#include "workflow/WFFacilities.h"
 #include "workflow/WFOperator.h"
 
 #define RETRY_MAX  3
@@ -153,3 +164,516 @@ TEST(redis_unittest, WFRedisTask1)
 	server.stop();
 }
 
+
+/* Two nodes, 6691 serves slots 0-8191 and 6692 serves 8192-16383. */
+static void __cluster_process(WFRedisTask *task, int port,
+							  std::atomic<int> *moved)
+{
+	auto *req = task->get_req();
+	std::string cmd;
+	std::vector<std::string> params;
+	protocol::RedisValue val;
+	size_t i;
+
+	req->get_command(cmd);
+	req->get_params(params);
+	if (strcasecmp(cmd.c_str(), "CLUSTER") == 0)
+	{
+		if (params[0] == "SHARDS")
+			val.set_error("ERR unknown subcommand 'SHARDS'");
+		else
+		{
+			val.set_array(2);
+			for (i = 0; i < 2; i++)
+			{
+				val[i].set_array(3);
+				val[i][0].set_int(i * 8192);
+				val[i][1].set_int(i * 8192 + 8191);
+				val[i][2].set_array(2);
+				val[i][2][0].set_string("127.0.0.1");
+				val[i][2][1].set_int(6691 + i);
+			}
+		}
+
+		task->get_resp()->set_result(val);
+		return;
+	}
+
+	size_t step = (strcasecmp(cmd.c_str(), "MSET") == 0 ? 2 : 1);
+	int slot = WFRedisClusterClient::key_slot(params[0]);
+	int owner = (slot < 8192 ? 6691 : 6692);
+
+	for (i = 0; i < params.size(); i += step)
+		EXPECT_EQ(WFRedisClusterClient::key_slot(params[i]), slot);
+
+	if (owner != port)
+	{
+		std::string err = "MOVED " + std::to_string(slot) + " 127.0.0.1:" +
+						  std::to_string(owner);
+		val.set_error(err);
+		(*moved)++;
+	}
+	else if (strcasecmp(cmd.c_str(), "GET") == 0)
+		val.set_string(std::to_string(port) + ":" + params[0]);
+	else if (strcasecmp(cmd.c_str(), "MGET") == 0)
+	{
+		val.set_array(params.size());
+		for (i = 0; i < params.size(); i++)
+			val[i].set_string(std::to_string(port) + ":" + params[i]);
+	}
+	else if (strcasecmp(cmd.c_str(), "DEL") == 0)
+		val.set_int(params.size());
+	else
+		val.set_status("OK");
+
+	task->get_resp()->set_result(val);
+}
+
+static protocol::RedisValue __cluster_request(WFRedisClusterClient& client,
+								const std::string& cmd,
+								const std::vector<std::string>& params)
+{
+	WFFacilities::WaitGroup wait_group(1);
+	protocol::RedisValue val;
+	WFRedisTask *task;
+
+	task = client.create_redis_task(cmd, params, 0,
+									[&val, &wait_group](WFRedisTask *task) {
+		EXPECT_EQ(task->get_state(), WFT_STATE_SUCCESS);
+		task->get_resp()->get_result(val);
+		wait_group.done();
+	});
+	task->start();
+	wait_group.wait();
+	return val;
+}
+
+TEST(redis_unittest, ClusterKeySlot)
+{
+	EXPECT_EQ(WFRedisClusterClient::key_slot("123456789"), 12739);
+	EXPECT_EQ(WFRedisClusterClient::key_slot("foo"), 12182);
+	EXPECT_EQ(WFRedisClusterClient::key_slot("bar"), 5061);
+	EXPECT_EQ(WFRedisClusterClient::key_slot("{user1000}.following"),
+			  WFRedisClusterClient::key_slot("{user1000}.followers"));
+	EXPECT_EQ(WFRedisClusterClient::key_slot("{bar}x"),
+			  WFRedisClusterClient::key_slot("bar"));
+	EXPECT_EQ(WFRedisClusterClient::key_slot("foo{}{bar}"),
+			  WFRedisClusterClient::key_slot("foo{}{bar}", 10));
+	EXPECT_EQ(WFRedisClusterClient::key_slot("foo{{bar}}zap"),
+			  WFRedisClusterClient::key_slot("{bar"));
+}
+
+TEST(redis_unittest, ClusterClient)
+{
+	std::atomic<int> moved(0);
+	WFRedisServer server1(std::bind(__cluster_process, std::placeholders::_1,
+									6691, &moved));
+	WFRedisServer server2(std::bind(__cluster_process, std::placeholders::_1,
+									6692, &moved));
+	WFRedisClusterClient client;
+	protocol::RedisValue val;
+	int n;
+
+	EXPECT_TRUE(server1.start("127.0.0.1", 6691) == 0);
+	EXPECT_TRUE(server2.start("127.0.0.1", 6692) == 0);
+	EXPECT_EQ(client.init("redis://127.0.0.1:6691"), 0);
+
+	/* Seed doesn't serve "foo". At most one MOVED before the slot
+	 * table is patched or loaded. */
+	val = __cluster_request(client, "GET", {"foo"});
+	EXPECT_EQ(val.string_value(), "6692:foo");
+	n = moved;
+	EXPECT_LE(n, 1);
+	val = __cluster_request(client, "GET", {"foo"});
+	EXPECT_EQ(val.string_value(), "6692:foo");
+	EXPECT_EQ(moved, n);
+
+	val = __cluster_request(client, "MGET",
+							{"bar", "foo", "123456789", "{bar}x"});
+	EXPECT_TRUE(val.is_array());
+	EXPECT_EQ(val.arr_size(), 4);
+	EXPECT_EQ(val[0].string_value(), "6691:bar");
+	EXPECT_EQ(val[1].string_value(), "6692:foo");
+	EXPECT_EQ(val[2].string_value(), "6692:123456789");
+	EXPECT_EQ(val[3].string_value(), "6691:{bar}x");
+
+	val = __cluster_request(client, "DEL", {"bar", "foo", "{bar}x"});
+	EXPECT_EQ(val.int_value(), 3);
+
+	val = __cluster_request(client, "MSET", {"bar", "1", "foo", "2"});
+	EXPECT_TRUE(val.is_ok());
+
+	client.deinit();
+	server1.stop();
+	server2.stop();
+}
+
+static int __parse_bytewise(const char *msg, redis_parser_t *parser)
+{
+	size_t len = strlen(msg);
+	size_t i, n;
+	int ret = 0;
+
+	for (i = 0; i < len && ret == 0; i++)
+	{
+		n = 1;
+		ret = redis_parser_append_message(msg + i, &n, parser);
+	}
+
+	return ret;
+}
+
+TEST(redis_unittest, RESP3Parser)
+{
+	const char *msg =
+		"*9\r\n"
+		"%2\r\n+k1\r\n:1\r\n$2\r\nk2\r\n~2\r\n#t\r\n#f\r\n"
+		",3.25\r\n"
+		"(3492890328409238509324850943850943825024385\r\n"
+		"=8\r\ntxt:abcd\r\n"
+		"_\r\n"
+		"!5\r\nERR x\r\n"
+		"|1\r\n+ttl\r\n:100\r\n$3\r\nval\r\n"
+		">2\r\n+invalidate\r\n*1\r\n$1\r\nk\r\n"
+		"*0\r\n";
+	redis_parser_t parser;
+	redis_reply_t *r;
+
+	redis_parser_init(&parser);
+	EXPECT_EQ(__parse_bytewise(msg, &parser), 1);
+	EXPECT_TRUE(parser.parse_succ);
+
+	r = &parser.reply;
+	EXPECT_EQ(r->type, REDIS_REPLY_TYPE_ARRAY);
+	EXPECT_EQ(r->elements, 9);
+
+	EXPECT_EQ(r->element[0]->type, REDIS_REPLY_TYPE_MAP);
+	EXPECT_EQ(r->element[0]->elements, 4);
+	EXPECT_EQ(std::string(r->element[0]->element[0]->str, 2), "k1");
+	EXPECT_EQ(r->element[0]->element[1]->integer, 1);
+	EXPECT_EQ(r->element[0]->element[3]->type, REDIS_REPLY_TYPE_SET);
+	EXPECT_EQ(r->element[0]->element[3]->element[0]->type,
+			  REDIS_REPLY_TYPE_BOOL);
+	EXPECT_EQ(r->element[0]->element[3]->element[0]->integer, 1);
+	EXPECT_EQ(r->element[0]->element[3]->element[1]->integer, 0);
+
+	EXPECT_EQ(r->element[1]->type, REDIS_REPLY_TYPE_DOUBLE);
+	EXPECT_EQ(r->element[1]->dval, 3.25);
+	EXPECT_EQ(r->element[2]->type, REDIS_REPLY_TYPE_BIGNUM);
+	EXPECT_EQ(r->element[2]->len, 43);
+	EXPECT_EQ(r->element[3]->type, REDIS_REPLY_TYPE_VERB);
+	EXPECT_STREQ(r->element[3]->vtype, "txt");
+	EXPECT_EQ(std::string(r->element[3]->str, r->element[3]->len), "abcd");
+	EXPECT_EQ(r->element[4]->type, REDIS_REPLY_TYPE_NIL);
+	EXPECT_EQ(r->element[5]->type, REDIS_REPLY_TYPE_ERROR);
+	EXPECT_EQ(std::string(r->element[5]->str, r->element[5]->len), "ERR x");
+
+	/* The attribute is skipped, and the value takes its place. */
+	EXPECT_EQ(r->element[6]->type, REDIS_REPLY_TYPE_STRING);
+	EXPECT_EQ(std::string(r->element[6]->str, r->element[6]->len), "val");
+
+	EXPECT_EQ(r->element[7]->type, REDIS_REPLY_TYPE_PUSH);
+	EXPECT_EQ(r->element[7]->element[1]->element[0]->str[0], 'k');
+	EXPECT_EQ(r->element[8]->type, REDIS_REPLY_TYPE_ARRAY);
+	EXPECT_EQ(r->element[8]->elements, 0);
+
+	/* Strings point into the message buffer. */
+	EXPECT_TRUE(r->element[6]->str >= parser.msgbuf &&
+				r->element[6]->str < parser.msgbuf + parser.msgsize);
+
+	/* Clearing the reply frees the arena too. */
+	EXPECT_FALSE(list_empty(&parser.arena_list));
+	redis_parser_clear_reply(&parser);
+	EXPECT_TRUE(list_empty(&parser.arena_list));
+	EXPECT_EQ(parser.reply.type, REDIS_REPLY_TYPE_NIL);
+	redis_parser_deinit(&parser);
+
+	/* A parsed reply may be rewritten through redis_reply_set_array(),
+	 * at the top or at any element. */
+	redis_parser_init(&parser);
+	EXPECT_EQ(__parse_bytewise("*2\r\n*1\r\n:1\r\n$1\r\na\r\n", &parser), 1);
+	r = &parser.reply;
+	EXPECT_EQ(redis_reply_set_array(2, r->element[0]), 0);
+	redis_reply_set_integer(2, r->element[0]->element[1]);
+	EXPECT_EQ(redis_reply_set_array(3, r->element[0]->element[0]), 0);
+	EXPECT_EQ(r->element[0]->element[1]->integer, 2);
+	redis_parser_deinit(&parser);
+
+	redis_parser_init(&parser);
+	EXPECT_EQ(__parse_bytewise("*1\r\n*1\r\n:1\r\n", &parser), 1);
+	EXPECT_EQ(redis_reply_set_array(2, r->element[0]), 0);
+	EXPECT_EQ(redis_reply_set_array(1, r), 0);
+	EXPECT_EQ(redis_reply_set_array(1, r->element[0]), 0);
+	redis_parser_deinit(&parser);
+
+	protocol::RedisResponse resp;
+	protocol::RedisValue val;
+
+	val.set_array(2);
+	val[0].set_string("a");
+	val[1].set_int(1);
+	EXPECT_TRUE(resp.set_result(val));
+	EXPECT_EQ(redis_reply_set_array(1, resp.result_ptr()->element[0]), 0);
+	redis_reply_set_integer(3, resp.result_ptr()->element[0]->element[0]);
+	resp.get_result(val);
+	EXPECT_EQ(val[0][0].int_value(), 3);
+	EXPECT_EQ(redis_reply_set_array(1, resp.result_ptr()), 0);
+	redis_reply_set_integer(4, resp.result_ptr()->element[0]);
+	resp.get_result(val);
+	EXPECT_EQ(val.arr_size(), 1);
+	EXPECT_EQ(val[0].int_value(), 4);
+
+	/* Fields of RESP3 follow the ones of hiredis-redisReply. */
+	EXPECT_EQ(offsetof(redis_reply_t, dval),
+			  offsetof(redis_reply_t, element) + sizeof (void *));
+
+	redis_parser_init(&parser);
+	EXPECT_EQ(__parse_bytewise("%1\r\n+k\r\n", &parser), 0);
+	redis_parser_deinit(&parser);
+
+	redis_parser_init(&parser);
+	EXPECT_EQ(__parse_bytewise("=3\r\nabc\r\n", &parser), -2);
+	redis_parser_deinit(&parser);
+
+	redis_parser_init(&parser);
+	EXPECT_EQ(__parse_bytewise("#x\r\n", &parser), -2);
+	redis_parser_deinit(&parser);
+}
+
+static void __resp3_process(WFRedisTask *task)
+{
+	static const char *fields[] = { "f1", "v1", "f2", "v2" };
+	auto *req = task->get_req();
+	redis_reply_t *reply = task->get_resp()->result_ptr();
+	std::string cmd;
+	std::vector<std::string> params;
+	protocol::RedisValue val;
+
+	req->get_command(cmd);
+	req->get_params(params);
+	if (strcasecmp(cmd.c_str(), "HELLO") == 0)
+	{
+		EXPECT_EQ(params[0], "3");
+		EXPECT_EQ(params[2], "default");
+		EXPECT_EQ(params[3], "testpass");
+		val.set_status("OK");
+		task->get_resp()->set_result(val);
+	}
+	else
+	{
+		EXPECT_EQ(cmd, "HGETALL");
+		redis_reply_set_array(4, reply);
+		reply->type = REDIS_REPLY_TYPE_MAP;
+		for (size_t i = 0; i < 4; i++)
+			redis_reply_set_string(fields[i], 2, reply->element[i]);
+	}
+}
+
+TEST(redis_unittest, RESP3Client)
+{
+	WFFacilities::WaitGroup wait_group(1);
+	WFRedisServer server(__resp3_process);
+	WFRedisTask *task;
+
+	EXPECT_TRUE(server.start("127.0.0.1", 6693) == 0);
+	task = WFTaskFactory::create_redis_task(
+				"redis://:testpass@127.0.0.1:6693?protocol=3", 0,
+				[&wait_group](WFRedisTask *task) {
+		redis_reply_t *reply = task->get_resp()->result_ptr();
+		protocol::RedisValue val;
+
+		EXPECT_EQ(task->get_state(), WFT_STATE_SUCCESS);
+		EXPECT_EQ(reply->type, REDIS_REPLY_TYPE_MAP);
+		task->get_resp()->get_result(val);
+		EXPECT_TRUE(val.is_array());
+		EXPECT_EQ(val.arr_size(), 4);
+		EXPECT_EQ(val[3].string_value(), "v2");
+		wait_group.done();
+	});
+	task->get_req()->set_request("HGETALL", {"h"});
+	task->start();
+	wait_group.wait();
+	server.stop();
+}
+
+struct __tracking_server
+{
+	int listen_fd;
+	int tracking_fd;
+	std::atomic<bool> stop;
+	std::atomic<int> gets;
+	int version;
+};
+
+static void __tracking_reply(int fd, const char *buf, size_t n,
+							 __tracking_server *srv)
+{
+	static const char invalidate[] =
+		">2\r\n$10\r\ninvalidate\r\n*1\r\n$1\r\nk\r\n";
+	std::string req(buf, n);
+	std::string reply;
+
+	if (req.find("TRACKING") != std::string::npos)
+	{
+		EXPECT_NE(req.find("BCAST"), std::string::npos);
+		srv->tracking_fd = fd;
+		reply = "+OK\r\n";
+	}
+	else if (req.find("HELLO") != std::string::npos ||
+			 req.find("QUIT") != std::string::npos)
+		reply = "+OK\r\n";
+	else if (req.find("GET") != std::string::npos)
+	{
+		/* Writes of other keys while the read is in flight. */
+		if (req.find("$1\r\nw\r\n") != std::string::npos &&
+			srv->tracking_fd >= 0)
+		{
+			for (int i = 0; i < 32; i++)
+			{
+				std::string key = "o" + std::to_string(i);
+				std::string push = ">2\r\n$10\r\ninvalidate\r\n*1\r\n$" +
+								   std::to_string(key.size()) + "\r\n" +
+								   key + "\r\n";
+
+				EXPECT_TRUE(write(srv->tracking_fd, push.c_str(),
+								  push.size()) > 0);
+			}
+
+			usleep(50 * 1000);
+		}
+
+		srv->gets++;
+		reply = "$2\r\nv" + std::to_string(srv->version) + "\r\n";
+	}
+	else if (req.find("SET") != std::string::npos)
+	{
+		srv->version++;
+		reply = "+OK\r\n";
+		if (srv->tracking_fd >= 0)
+		{
+			EXPECT_TRUE(write(srv->tracking_fd, invalidate,
+							  sizeof invalidate - 1) > 0);
+		}
+	}
+
+	EXPECT_TRUE(write(fd, reply.c_str(), reply.size()) > 0);
+}
+
+static void __tracking_server_routine(__tracking_server *srv)
+{
+	std::vector<struct pollfd> fds;
+	char buf[1024];
+	ssize_t n;
+	size_t i;
+
+	fds.push_back({srv->listen_fd, POLLIN, 0});
+	while (!srv->stop)
+	{
+		if (poll(fds.data(), fds.size(), 50) <= 0)
+			continue;
+
+		for (i = fds.size(); i-- > 1; )
+		{
+			if (!(fds[i].revents & (POLLIN | POLLHUP | POLLERR)))
+				continue;
+
+			n = read(fds[i].fd, buf, sizeof buf);
+			if (n > 0)
+				__tracking_reply(fds[i].fd, buf, n, srv);
+			else
+			{
+				if (fds[i].fd == srv->tracking_fd)
+					srv->tracking_fd = -1;
+
+				close(fds[i].fd);
+				fds.erase(fds.begin() + i);
+			}
+		}
+
+		if (fds[0].revents & POLLIN)
+			fds.push_back({accept(srv->listen_fd, NULL, NULL), POLLIN, 0});
+	}
+
+	for (i = 0; i < fds.size(); i++)
+		close(fds[i].fd);
+}
+
+static protocol::RedisValue __caching_request(WFRedisCachingClient& client,
+								const std::string& cmd,
+								const std::vector<std::string>& params)
+{
+	WFFacilities::WaitGroup wait_group(1);
+	protocol::RedisValue val;
+	WFRedisTask *task;
+
+	task = client.create_redis_task(cmd, params, 0,
+									[&val, &wait_group](WFRedisTask *task) {
+		EXPECT_EQ(task->get_state(), WFT_STATE_SUCCESS);
+		task->get_resp()->get_result(val);
+		wait_group.done();
+	});
+	task->start();
+	wait_group.wait();
+	return val;
+}
+
+TEST(redis_unittest, CachingClient)
+{
+	struct sockaddr_in addr = { };
+	__tracking_server srv;
+	WFRedisCachingClient client;
+	int i;
+
+	srv.listen_fd = socket(AF_INET, SOCK_STREAM, 0);
+	srv.tracking_fd = -1;
+	srv.stop = false;
+	srv.gets = 0;
+	srv.version = 0;
+	i = 1;
+	setsockopt(srv.listen_fd, SOL_SOCKET, SO_REUSEADDR, &i, sizeof i);
+	addr.sin_family = AF_INET;
+	addr.sin_port = htons(6694);
+	addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+	ASSERT_EQ(bind(srv.listen_fd, (struct sockaddr *)&addr, sizeof addr), 0);
+	ASSERT_EQ(listen(srv.listen_fd, 16), 0);
+	std::thread th(__tracking_server_routine, &srv);
+
+	EXPECT_EQ(client.init("redis://127.0.0.1:6694", 1024 * 1024), 0);
+
+	/* Nothing is cached until the tracking connection is on. */
+	for (i = 0; i < 100 && client.size() == 0; i++)
+	{
+		EXPECT_EQ(__caching_request(client, "GET", {"k"}).string_value(), "v0");
+		std::this_thread::sleep_for(std::chrono::milliseconds(10));
+	}
+
+	EXPECT_GT(client.size(), 0);
+	i = srv.gets;
+	EXPECT_EQ(__caching_request(client, "GET", {"k"}).string_value(), "v0");
+	EXPECT_EQ(__caching_request(client, "get", {"k"}).string_value(), "v0");
+	EXPECT_EQ(srv.gets, i);
+
+	/* SET is sent to the server, which pushes an invalidation of 'k'. */
+	EXPECT_TRUE(__caching_request(client, "SET", {"k", "v1"}).is_ok());
+	for (i = 0; i < 100 && client.size() != 0; i++)
+		std::this_thread::sleep_for(std::chrono::milliseconds(10));
+
+	EXPECT_EQ(client.size(), 0);
+	i = srv.gets;
+	EXPECT_EQ(__caching_request(client, "GET", {"k"}).string_value(), "v1");
+	EXPECT_EQ(srv.gets, i + 1);
+	EXPECT_EQ(__caching_request(client, "GET", {"k"}).string_value(), "v1");
+	EXPECT_EQ(srv.gets, i + 1);
+
+	/* Invalidations of other keys do not drop the in-flight reply. */
+	EXPECT_EQ(__caching_request(client, "GET", {"w"}).string_value(), "v1");
+	EXPECT_EQ(srv.gets, i + 2);
+	EXPECT_EQ(__caching_request(client, "GET", {"w"}).string_value(), "v1");
+	EXPECT_EQ(srv.gets, i + 2);
+
+	client.deinit();
+	std::this_thread::sleep_for(std::chrono::milliseconds(100));
+	srv.stop = true;
+	th.join();
+	close(srv.listen_fd);
+}
@@ -19,10 +19,12 @@
 #include <sys/types.h>
 #include <sys/stat.h>
 #include <fcntl.h>
+#include <atomic>
 #include <gtest/gtest.h>
 #include "workflow/WFTask.h"
 #include "workflow/WFTaskFactory.h"
 #include "workflow/WFResourcePool.h"
+#include "workflow/WFMessageQueue.h"
 #include "workflow/WFFacilities.h"
 
 TEST(resource_unittest, resource_pool)
@@ -53,3 +55,128 @@ TEST(resource_unittest, resource_pool)
 	wg.wait();
 }
 
+TEST(resource_unittest, lock_free_resource_pool)
+{
+	int res_concurrency = 3;
+	int task_concurrency = 100;
+	WFLockFreeResourcePool res_pool(res_concurrency);
+	WFFacilities::WaitGroup wg(task_concurrency);
+	std::atomic<int> running(0);
+
+	for (int i = 0; i < task_concurrency; i++)
+	{
+		auto *user_task = WFTaskFactory::create_go_task("lock_free_pool",
+		[&running, res_concurrency]() {
+			EXPECT_LE(++running, res_concurrency);
+			running--;
+		});
+
+		auto *cond = res_pool.get(user_task);
+		Workflow::start_series_work(cond, [&wg, &res_pool](const SeriesWork *) {
+			res_pool.post(NULL);
+			wg.done();
+		});
+	}
+
+	wg.wait();
+}
+
+TEST(resource_unittest, lock_free_message_queue)
+{
+	int capacity = 4;
+	int msg_count = 100;
+	WFLockFreeMessageQueue queue(capacity);
+	WFFacilities::WaitGroup wg(msg_count - capacity + msg_count + 1);
+	std::atomic<long> sum(0);
+
+	for (int i = 0; i < capacity; i++)
+		EXPECT_EQ(queue.post((void *)(long)(i + 1)), 0);
+
+	EXPECT_EQ(queue.post((void *)1), -1);
+
+	/* Putters wait for space and getters wait for messages. */
+	for (int i = capacity; i < msg_count; i++)
+	{
+		auto *cond = queue.put(WFTaskFactory::create_empty_task(),
+							   (void *)(long)(i + 1));
+		Workflow::start_series_work(cond, [&wg](const SeriesWork *) {
+			wg.done();
+		});
+	}
+
+	/* The message is read in the getter's own callback. */
+	for (int i = 0; i < msg_count; i++)
+	{
+		auto *task = WFTaskFactory::create_timer_task(0,
+		[&wg, &sum](WFTimerTask *task) {
+			sum += (long)task->user_data;
+			wg.done();
+		});
+
+		auto *cond = queue.get(task, &task->user_data);
+		Workflow::start_series_work(cond, nullptr);
+	}
+
+	/* One more getter, fed after all the other messages are taken. */
+	auto *task = WFTaskFactory::create_timer_task(0,
+	[&wg, &sum](WFTimerTask *task) {
+		sum += (long)task->user_data;
+		wg.done();
+	});
+
+	auto *cond = queue.get(task, &task->user_data);
+	Workflow::start_series_work(cond, nullptr);
+	EXPECT_EQ(queue.post((void *)1000), 0);
+
+	wg.wait();
+	EXPECT_EQ(sum, msg_count * (msg_count + 1) / 2 + 1000);
+}
+
+TEST(resource_unittest, lock_free_concurrent)
+{
+	int capacity = 2;
+	int msg_count = 2000;
+	WFLockFreeMessageQueue queue(capacity);
+	WFLockFreeResourcePool res_pool(1);
+	WFFacilities::WaitGroup wg(msg_count * 3);
+	std::atomic<long> sum(0);
+	std::atomic<int> running(0);
+
+	/* Putters, getters and pool users race on the compute threads. */
+	for (int i = 0; i < msg_count; i++)
+	{
+		WFTaskFactory::create_go_task("lock_free_put", [&queue, &wg, i]() {
+			auto *cond = queue.put(WFTaskFactory::create_empty_task(),
+								   (void *)(long)(i + 1));
+			Workflow::start_series_work(cond, [&wg](const SeriesWork *) {
+				wg.done();
+			});
+		})->start();
+
+		WFTaskFactory::create_go_task("lock_free_get", [&queue, &wg, &sum]() {
+			auto *task = WFTaskFactory::create_timer_task(0,
+			[&wg, &sum](WFTimerTask *task) {
+				sum += (long)task->user_data;
+				wg.done();
+			});
+
+			auto *cond = queue.get(task, &task->user_data);
+			Workflow::start_series_work(cond, nullptr);
+		})->start();
+
+		auto *user_task = WFTaskFactory::create_go_task("lock_free_pool",
+		[&running]() {
+			EXPECT_EQ(++running, 1);
+			running--;
+		});
+
+		auto *cond = res_pool.get(user_task);
+		Workflow::start_series_work(cond, [&wg, &res_pool](const SeriesWork *) {
+			res_pool.post(NULL);
+			wg.done();
+		});
+	}
+
+	wg.wait();
+	EXPECT_EQ(sum, (long)msg_count * (msg_count + 1) / 2);
+}
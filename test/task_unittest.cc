@@ -22,12 +22,24 @@
 #include <fcntl.h>
 #include <unistd.h>
 #include <string.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
 #include <string>
+#include <vector>
+#include <algorithm>
+#include <atomic>
+#include <thread>
 #include <mutex>
 #include <condition_variable>
 #include <chrono>
 #include <gtest/gtest.h>
 #include "workflow/WFTaskFactory.h"
+#include "workflow/WFFacilities.h"
+#include "workflow/TLVMessage.h"
+#include "workflow/WFMultiplexClient.h"
+#include "workflow/ObjectRecycler.h"
+#include "workflow/Executor.h"
 
 #define GET_CURRENT_MICRO	std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now().time_since_epoch()).count()
 
@@ -125,6 +137,68 @@ TEST(task_unittest, WFCounterTask2)
 	lock.unlock();
 }
 
+TEST(task_unittest, WFTaskName)
+{
+	WFFacilities::WaitGroup wait_group(3);
+	WFTaskName counter_name("counter_name");
+	WFTaskName guard_name("guard_name");
+	std::atomic<int> counted(0);
+	std::atomic<int> guarded(0);
+	int running = 0;
+
+	/* Names by string or pre-hashed refer to the same objects. */
+	auto *counter = WFTaskFactory::create_counter_task(counter_name, 4,
+											[&](WFCounterTask *task) {
+		EXPECT_EQ(task->get_state(), WFT_STATE_SUCCESS);
+		wait_group.done();
+	});
+	counter->start();
+	EXPECT_EQ(WFTaskFactory::count_by_name("counter_name", 2), 0);
+	EXPECT_EQ(WFTaskFactory::count_by_name(counter_name, 2), 1);
+	EXPECT_EQ(WFTaskFactory::count_by_name(counter_name), 0);
+
+	/* Many names spread over the shards. */
+	for (int i = 0; i < 1000; i++)
+	{
+		std::string name = "counter" + std::to_string(i);
+		WFTaskFactory::create_counter_task(name, 1, [&](WFCounterTask *) {
+			counted++;
+		})->start();
+	}
+
+	for (int i = 0; i < 1000; i++)
+		WFTaskFactory::count_by_name(WFTaskName("counter" + std::to_string(i)));
+
+	/* The guard runs its tasks one by one. */
+	auto create = [&](int n) {
+		auto *go = WFTaskFactory::create_go_task("guard", [&]() {
+			EXPECT_EQ(++running, 1);
+			running--;
+		});
+		auto *guard = WFTaskFactory::create_guard(guard_name, go);
+
+		return Workflow::create_series_work(guard, [&, n](const SeriesWork *) {
+			WFTaskFactory::release_guard(n % 2 ? guard_name :
+										 WFTaskName("guard_name"), NULL);
+			if (++guarded == 100)
+				wait_group.done();
+		});
+	};
+
+	for (int i = 0; i < 100; i++)
+		create(i)->start();
+
+	auto *cond = WFTaskFactory::create_conditional(WFTaskName("cond_name"),
+						WFTaskFactory::create_empty_task());
+	Workflow::start_series_work(cond, [&](const SeriesWork *) {
+		wait_group.done();
+	});
+	EXPECT_EQ(WFTaskFactory::signal_by_name(WFTaskName("cond_name"), NULL), 1);
+
+	wait_group.wait();
+	EXPECT_EQ(counted, 1000);
+}
+
 TEST(task_unittest, WFGoTask)
 {
 	srand(time(NULL));
@@ -155,6 +229,208 @@ TEST(task_unittest, WFGoTask)
 	EXPECT_EQ(edit_inner, 100);
 }
 
+TEST(task_unittest, bulk_parallel_work)
+{
+	const size_t n = 5000;
+	std::vector<SubTask *> tasks(n);
+	std::atomic<size_t> count(0);
+	WFFacilities::WaitGroup wait_group(1);
+
+	for (size_t i = 0; i < n; i++)
+	{
+		tasks[i] = WFTaskFactory::create_go_task("bulk", [&count, &tasks, i]() {
+			/* Every series goes on after its first task. */
+			SeriesWork *series = series_of(tasks[i]);
+			series->push_back(WFTaskFactory::create_go_task("bulk", [&count]() {
+				count++;
+			}));
+			count++;
+		});
+	}
+
+	ParallelWork *pwork = Workflow::create_bulk_parallel_work(tasks.data(), n,
+		[&count, &wait_group, n](const ParallelWork *pwork) {
+		EXPECT_EQ(pwork->size(), n + 1);
+		EXPECT_EQ(count, 2 * n);
+		EXPECT_EQ(pwork->series_at(n - 1)->get_context(), nullptr);
+		wait_group.done();
+	});
+
+	pwork->add_series(Workflow::create_series_work(WFTaskFactory::create_empty_task(),
+												   nullptr));
+	EXPECT_EQ(pwork->size(), n + 1);
+	Workflow::start_series_work(pwork, nullptr);
+	wait_group.wait();
+
+	/* Dismissing a bulk parallel destroys its series. */
+	for (size_t i = 0; i < 16; i++)
+		tasks[i] = WFTaskFactory::create_timer_task(0, nullptr);
+
+	pwork = Workflow::create_bulk_parallel_work(tasks.data(), 16, nullptr);
+	pwork->dismiss();
+}
+
+TEST(task_unittest, ObjectRecycler)
+{
+	WFFacilities::WaitGroup wait_group(1);
+	std::atomic<int> count(0);
+	char big[128] = "large captures are allocated by new";
+	void *ptr;
+
+	ObjectRecycler::set_max_cached(16);
+	ptr = ObjectRecycler::alloc(100);
+	ObjectRecycler::free(ptr, 100);
+	EXPECT_EQ(ObjectRecycler::alloc(112), ptr);
+	ObjectRecycler::free(ptr, 112);
+
+	auto *first = WFTaskFactory::create_go_task("recycle", [&count]() {
+		count++;
+	});
+	SeriesWork *series = Workflow::create_series_work(first, [&wait_group](const SeriesWork *) {
+		wait_group.done();
+	});
+
+	for (int i = 0; i < 100; i++)
+	{
+		series->push_back(WFTaskFactory::create_go_task("recycle", [&count, big]() {
+			EXPECT_EQ(strcmp(big, "large captures are allocated by new"), 0);
+			count++;
+		}));
+		series->push_back(WFTaskFactory::create_timer_task(0, nullptr));
+	}
+
+	series->start();
+	wait_group.wait();
+	EXPECT_EQ(count, 101);
+	ObjectRecycler::set_max_cached(0);
+}
+
+TEST(task_unittest, WFGoTaskDeadline)
+{
+	WFFacilities::WaitGroup wait_group(1);
+	bool executed = false;
+
+	auto *task = WFTaskFactory::create_go_task("deadline", [&executed]() {
+		executed = true;
+	});
+
+	task->set_deadline(0, 0);
+	task->set_callback([&wait_group](WFGoTask *task) {
+		EXPECT_EQ(task->get_state(), WFT_STATE_EXPIRED);
+		EXPECT_EQ(task->get_error(), ETIMEDOUT);
+		wait_group.done();
+	});
+
+	task->start();
+	wait_group.wait();
+	EXPECT_FALSE(executed);
+}
+
+TEST(task_unittest, ExecQueuePriority)
+{
+	WFFacilities::WaitGroup started(1);
+	WFFacilities::WaitGroup release(1);
+	WFFacilities::WaitGroup wait_group(1);
+	Executor executor;
+	ExecQueue queues[5];
+	std::string order;
+
+	ASSERT_EQ(executor.init(1), 0);
+	for (ExecQueue& queue : queues)
+		ASSERT_EQ(queue.init(), 0);
+
+	/* 0 blocks the only thread. 1 is of low priority, 2 and 3 have
+	 * deadlines, and 4 shares with 1 by weight. */
+	queues[1].set_priority(-1, 1);
+	queues[4].set_priority(-1, 3);
+	WFTaskFactory::create_go_task(&queues[0], &executor, [&]() {
+		started.done();
+		release.wait();
+	})->start();
+	started.wait();
+
+	SeriesWork *series = Workflow::create_series_work(
+			WFTaskFactory::create_empty_task(), [&wait_group](const SeriesWork *) {
+		wait_group.done();
+	});
+	ParallelWork *pwork = Workflow::create_parallel_work(nullptr);
+	auto push = [&](int i, char c) {
+		auto *task = WFTaskFactory::create_go_task(&queues[i], &executor,
+												   [&order, c]() {
+			order.push_back(c);
+		});
+		pwork->add_series(Workflow::create_series_work(task, nullptr));
+		return task;
+	};
+
+	for (int i = 0; i < 4; i++)
+	{
+		push(1, 'l');
+		push(4, 'w');
+	}
+
+	push(2, 'b')->set_deadline(20, 0);
+	push(3, 'a')->set_deadline(10, 0);
+	push(2, 'c');
+
+	series->push_back(pwork);
+	series->start();
+	release.done();
+	wait_group.wait();
+
+	ASSERT_EQ(order.size(), 11);
+	EXPECT_EQ(order.substr(0, 3), "abc");
+	EXPECT_EQ(std::count(order.begin() + 3, order.begin() + 7, 'w'), 3);
+
+	executor.deinit();
+	for (ExecQueue& queue : queues)
+		queue.deinit();
+}
+
+TEST(task_unittest, ExecQueueDefault)
+{
+	WFFacilities::WaitGroup started(1);
+	WFFacilities::WaitGroup release(1);
+	WFFacilities::WaitGroup wait_group(4);
+	Executor executor;
+	ExecQueue queues[3];
+	std::string order;
+
+	ASSERT_EQ(executor.init(1), 0);
+	for (ExecQueue& queue : queues)
+		ASSERT_EQ(queue.init(), 0);
+
+	/* 1 gets ready while every queue is of the default, and 2 of a high
+	 * priority after it. 2 still goes first. */
+	queues[2].set_priority(1, 1);
+	WFTaskFactory::create_go_task(&queues[0], &executor, [&]() {
+		started.done();
+		release.wait();
+	})->start();
+	started.wait();
+
+	auto push = [&](int i, char c) {
+		auto *task = WFTaskFactory::create_go_task(&queues[i], &executor,
+												   [&order, c]() {
+			order.push_back(c);
+		});
+		task->set_callback([&wait_group](WFGoTask *) { wait_group.done(); });
+		task->start();
+	};
+
+	push(1, 'd');
+	push(1, 'd');
+	push(2, 'p');
+	push(2, 'p');
+	release.done();
+	wait_group.wait();
+	EXPECT_EQ(order, "ppdd");
+
+	executor.deinit();
+	for (ExecQueue& queue : queues)
+		queue.deinit();
+}
+
 TEST(task_unittest, WFThreadTask)
 {
 	std::mutex mutex;
@@ -312,3 +588,227 @@ TEST(task_unittest, WFFilePathIOTask)
 
 	remove(file_path.c_str());
 }
+
+TEST(task_unittest, WFFilePathReadTask)
+{
+	std::string file_path = "./" + std::to_string(time(NULL)) + "__cached";
+	WFFacilities::WaitGroup wait_group(201);
+	std::string content;
+	char bufs[200][16];
+
+	for (int i = 0; i < 4096; i++)
+		content.push_back('a' + i % 26);
+
+	int fd = open(file_path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+	ASSERT_TRUE(fd >= 0);
+	ASSERT_EQ(write(fd, content.data(), content.size()), (ssize_t)content.size());
+	close(fd);
+
+	/* All the tasks share one fd. */
+	for (int i = 0; i < 200; i++)
+	{
+		auto *task = WFTaskFactory::create_pread_task(file_path, bufs[i], 16, i * 20,
+		[&](WFFileIOTask *task) {
+			auto *args = task->get_args();
+
+			EXPECT_EQ(task->get_state(), WFT_STATE_SUCCESS);
+			EXPECT_EQ(task->get_retval(), 16);
+			EXPECT_EQ(memcmp(args->buf, content.data() + args->offset, 16), 0);
+			wait_group.done();
+		});
+
+		task->start();
+	}
+
+	auto *task = WFTaskFactory::create_pread_task(file_path + "__none", bufs[0], 16, 0,
+	[&](WFFileIOTask *task) {
+		EXPECT_EQ(task->get_state(), WFT_STATE_SYS_ERROR);
+		EXPECT_EQ(task->get_error(), ENOENT);
+		wait_group.done();
+	});
+
+	task->start();
+	wait_group.wait();
+
+	/* A file replaced under the same path is read after the next check. */
+	std::string tmp_path = file_path + "__tmp";
+	WFFacilities::WaitGroup replaced(1);
+
+	fd = open(tmp_path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+	ASSERT_TRUE(fd >= 0);
+	ASSERT_EQ(write(fd, "replaced", 8), 8);
+	close(fd);
+	ASSERT_EQ(rename(tmp_path.c_str(), file_path.c_str()), 0);
+	usleep(1100 * 1000);
+
+	task = WFTaskFactory::create_pread_task(file_path, bufs[0], 16, 0,
+	[&](WFFileIOTask *task) {
+		EXPECT_EQ(task->get_state(), WFT_STATE_SUCCESS);
+		EXPECT_EQ(task->get_retval(), 8);
+		EXPECT_EQ(memcmp(task->get_args()->buf, "replaced", 8), 0);
+		replaced.done();
+	});
+
+	task->start();
+	replaced.wait();
+	remove(file_path.c_str());
+}
+
+TEST(task_unittest, WFFileDirectIOTask)
+{
+	std::string file_path = "./" + std::to_string(time(NULL)) + "__direct";
+	WFFacilities::WaitGroup wait_group(64);
+	std::string content;
+	std::mutex mutex;
+	int failed = 0;
+
+	for (int i = 0; i < 10000; i++)
+		content.push_back('a' + i % 26);
+
+	int fd = open(file_path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+	ASSERT_TRUE(fd >= 0);
+	ASSERT_EQ(write(fd, content.data(), content.size()), (ssize_t)content.size());
+	close(fd);
+
+	for (int i = 0; i < 64; i++)
+	{
+		off_t offset = i * 157;
+		size_t count = 100 + i * 97;
+		auto *task = WFTaskFactory::create_direct_pread_task(file_path, count, offset,
+		[&](WFFileIOTask *task) {
+			auto *args = task->get_args();
+
+			if (task->get_state() != WFT_STATE_SUCCESS)
+			{
+				/* Some file systems, like tmpfs, do not support O_DIRECT. */
+				EXPECT_EQ(task->get_error(), EINVAL);
+				std::lock_guard<std::mutex> lock(mutex);
+				failed++;
+			}
+			else
+			{
+				size_t n = std::min(args->count, content.size() - args->offset);
+
+				EXPECT_EQ(task->get_retval(), (long)n);
+				EXPECT_EQ(memcmp(args->buf, content.data() + args->offset, n), 0);
+			}
+
+			wait_group.done();
+		});
+
+		task->start();
+	}
+
+	wait_group.wait();
+	EXPECT_TRUE(failed == 0 || failed == 64);
+	remove(file_path.c_str());
+
+	void *buf = WFTaskFactory::alloc_direct_buffer(5000);
+	ASSERT_TRUE(buf != NULL);
+	EXPECT_EQ((uintptr_t)buf % 4096, 0);
+	WFTaskFactory::free_direct_buffer(buf, 5000);
+	EXPECT_EQ(WFTaskFactory::alloc_direct_buffer(8192), buf);
+	WFTaskFactory::free_direct_buffer(buf, 8192);
+}
+
+static int __multiplex_fd = -1;
+
+/* Echo the TLV frames of each read in reversed order. Never reply "drop". */
+static void __multiplex_server(int listenfd)
+{
+	std::string buf;
+	char tmp[4096];
+	uint32_t len;
+	ssize_t n;
+	int fd;
+
+	fd = accept(listenfd, NULL, NULL);
+	if (fd < 0)
+		return;
+
+	__multiplex_fd = fd;
+	while ((n = read(fd, tmp, sizeof tmp)) > 0)
+	{
+		std::string out;
+
+		buf.append(tmp, n);
+		while (buf.size() >= 8)
+		{
+			memcpy(&len, buf.data() + 4, 4);
+			len = ntohl(len);
+			if (buf.size() < 8 + len)
+				break;
+
+			if (buf.compare(8, len, "drop") != 0)
+				out.insert(0, buf, 0, 8 + len);
+
+			buf.erase(0, 8 + len);
+		}
+
+		if (write(fd, out.data(), out.size()) != (ssize_t)out.size())
+			break;
+	}
+
+	close(fd);
+}
+
+TEST(task_unittest, WFMultiplexClient)
+{
+	using namespace protocol;
+	struct sockaddr_in sin = { };
+	socklen_t len = sizeof sin;
+	int listenfd = socket(AF_INET, SOCK_STREAM, 0);
+
+	sin.sin_family = AF_INET;
+	sin.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+	ASSERT_EQ(bind(listenfd, (struct sockaddr *)&sin, sizeof sin), 0);
+	ASSERT_EQ(listen(listenfd, 8), 0);
+	ASSERT_EQ(getsockname(listenfd, (struct sockaddr *)&sin, &len), 0);
+
+	std::thread server(__multiplex_server, listenfd);
+	WFMultiplexClient<TLVRequest, TLVResponse> client;
+	std::string url = "tcp://127.0.0.1:" + std::to_string(ntohs(sin.sin_port));
+	int ret = client.init(url, [](TLVRequest *req, uint32_t id) {
+		req->set_type(id);
+	}, [](const TLVResponse *resp) {
+		return (uint32_t)resp->get_type();
+	});
+
+	ASSERT_EQ(ret, 0);
+
+	WFFacilities::WaitGroup wait_group(101);
+	for (int i = 0; i < 100; i++)
+	{
+		auto *task = client.create_task([&wait_group, i](WFNetworkTask<TLVRequest, TLVResponse> *task) {
+			EXPECT_EQ(task->get_state(), WFT_STATE_SUCCESS);
+			EXPECT_EQ(*task->get_resp()->get_value(), std::to_string(i));
+			wait_group.done();
+		});
+
+		task->get_req()->set_value(std::to_string(i));
+		task->start();
+	}
+
+	auto *task = client.create_task([&wait_group](WFNetworkTask<TLVRequest, TLVResponse> *task) {
+		EXPECT_EQ(task->get_state(), WFT_STATE_SYS_ERROR);
+		EXPECT_EQ(task->get_error(), ETIMEDOUT);
+		wait_group.done();
+	});
+
+	task->get_req()->set_value("drop");
+	task->set_receive_timeout(200);
+	task->start();
+	wait_group.wait();
+
+	client.deinit();
+	shutdown(__multiplex_fd, SHUT_RDWR);
+	server.join();
+	close(listenfd);
+
+	/* Deinit after a failed init does nothing. */
+	ret = client.init(ParsedURI(), [](TLVRequest *, uint32_t) { },
+					  [](const TLVResponse *) { return 0U; },
+					  &MULTIPLEX_PARAMS_DEFAULT);
+	EXPECT_EQ(ret, -1);
+	client.deinit();
+}
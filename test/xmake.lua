@@ -19,7 +19,8 @@ function all_tests()
         local s = path.filename(x)
         if ((s == "upstream_unittest.cc" and not has_config("upstream")) or
             (s == "redis_unittest.cc" and not has_config("redis")) or
-            (s == "mysql_unittest.cc" and not has_config("mysql"))) then
+            (s == "mysql_unittest.cc" and not has_config("mysql")) or
+            (s == "kafka_unittest.cc" and not has_config("kafka"))) then
         else
             table.insert(item, s:sub(1, #s - 3)) -- target
             table.insert(item, path.relative(x, ".")) -- source
@@ -0,0 +1,35 @@
+
+####### Expanded from @PACKAGE_INIT@ by configure_package_config_file() #######
+####### Any changes to this file will be overwritten by the next CMake run ####
+####### The input file was workflow-config.cmake.in                            ########
+
+get_filename_component(PACKAGE_PREFIX_DIR "${CMAKE_CURRENT_LIST_DIR}/../../../" ABSOLUTE)
+
+macro(set_and_check _var _file)
+  set(${_var} "${_file}")
+  if(NOT EXISTS "${_file}")
+    message(FATAL_ERROR "File or directory ${_file} referenced by variable ${_var} does not exist !")
+  endif()
+endmacro()
+
+macro(check_required_components _NAME)
+  foreach(comp ${${_NAME}_FIND_COMPONENTS})
+    if(NOT ${_NAME}_${comp}_FOUND)
+      if(${_NAME}_FIND_REQUIRED_${comp})
+        set(${_NAME}_FOUND FALSE)
+      endif()
+    endif()
+  endforeach()
+endmacro()
+
+####################################################################################
+
+set(WORKFLOW_VERSION "0.11.11")
+set_and_check(WORKFLOW_INCLUDE_DIR "/root/repo/_include")
+set_and_check(WORKFLOW_LIB_DIR "/root/repo/_lib")
+
+if (EXISTS "${CMAKE_CURRENT_LIST_DIR}/workflow-targets.cmake")
+    include ("${CMAKE_CURRENT_LIST_DIR}/workflow-targets.cmake")
+endif ()
+
+check_required_components(workflow)